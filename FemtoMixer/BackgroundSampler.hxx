@@ -0,0 +1,200 @@
+/**
+ * @file BackgroundSampler.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Random subsampling of the mixed-event pairs. Pairs at low q_inv are always kept, pairs at high q_inv are kept with a known acceptance and filled with the inverse of it as a weight.
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef BackgroundSampler_hxx
+    #define BackgroundSampler_hxx
+
+    #include <algorithm>
+    #include <cmath>
+    #include <cstdint>
+    #include <iostream>
+    #include <random>
+    #include <stdexcept>
+    #include <string>
+
+    #include "PairKinematics.hxx"
+
+    namespace Mixing
+    {
+        /**
+         * @brief Subsampling mode of the mixed-event pairs
+         *
+         */
+        enum class BackgroundSampling{None,FixedCount,QDependent};
+
+        /**
+         * @brief Settings of the BackgroundSampler
+         *
+         */
+        struct BackgroundSamplingSettings
+        {
+            BackgroundSampling mode = BackgroundSampling::None;
+            float qFull = 150.f; // [MeV/c] pairs with smaller q_inv are always kept (with weight 1)
+            std::size_t pairsPerEvent = 5000; // FixedCount: mean number of mixed pairs of one event which are kept
+            float exponent = 2.f; // QDependent: pairs above qFull are kept with the probability (qFull / q_inv)^exponent
+            float minAcceptance = 0.01f; // QDependent: lower limit of the probability, so the weights stay bounded
+            std::uint64_t seed = 0;
+
+            /**
+             * @brief Check that every acceptance of the selected mode is in (0,1], so the weights 1/acceptance are finite and not smaller than 1
+             *
+             * @throws std::invalid_argument if pairsPerEvent is 0 (FixedCount), or if minAcceptance is outside of (0,1] or exponent is negative (QDependent)
+             */
+            void Validate() const
+            {
+                if (mode == BackgroundSampling::FixedCount && pairsPerEvent == 0)
+                    throw std::invalid_argument("BackgroundSamplingSettings: pairsPerEvent has to be positive");
+                if (mode == BackgroundSampling::QDependent && !(minAcceptance > 0.f && minAcceptance <= 1.f))
+                    throw std::invalid_argument("BackgroundSamplingSettings: minAcceptance has to be in (0,1], got " + std::to_string(minAcceptance));
+                if (mode == BackgroundSampling::QDependent && !(exponent >= 0.f))
+                    throw std::invalid_argument("BackgroundSamplingSettings: exponent has to be non-negative, got " + std::to_string(exponent));
+            }
+        };
+
+        /**
+         * @brief Decides which mixed-event pairs are kept. The decision is made only from the pair kinematics, so the dropped pairs are never constructed nor passed to the pair hashing and cutting functions. Each kept pair gets the weight 1/acceptance, so the weighted background is an unbiased estimate of the full one. Every worker should own its sampler (with its own seed).
+         *
+         */
+        class BackgroundSampler
+        {
+            private:
+                BackgroundSamplingSettings m_settings;
+                std::mt19937_64 m_generator;
+                std::uniform_real_distribution<double> m_uniform;
+                double m_eventAcceptance;
+
+            public:
+                /**
+                 * @brief Construct a new Background Sampler object
+                 *
+                 * @param settings
+                 * @throws std::invalid_argument if the settings are invalid (see BackgroundSamplingSettings::Validate)
+                 */
+                explicit BackgroundSampler(const BackgroundSamplingSettings &settings = {}) : m_settings(settings), m_generator(settings.seed), m_uniform(0.,1.), m_eventAcceptance(1.)
+                {
+                    m_settings.Validate();
+                }
+                /**
+                 * @brief Restart the random number generator with a new seed
+                 *
+                 * @param seed
+                 */
+                void SetSeed(std::uint64_t seed)
+                {
+                    m_settings.seed = seed;
+                    m_generator.seed(seed);
+                }
+                /**
+                 * @brief Prepare the sampling of the mixed pairs of a new event
+                 *
+                 * @param nPairs number of mixed pairs which would be created without the sampling
+                 */
+                void BeginEvent(std::size_t nPairs) noexcept
+                {
+                    m_eventAcceptance = (m_settings.mode == BackgroundSampling::FixedCount && nPairs > m_settings.pairsPerEvent) ? static_cast<double>(m_settings.pairsPerEvent) / nPairs : 1.;
+                }
+                /**
+                 * @brief Get the probability that a pair with the given q_inv is kept
+                 *
+                 * @param qinv
+                 * @return double
+                 */
+                [[nodiscard]] double GetAcceptance(float qinv) const noexcept
+                {
+                    if (m_settings.mode == BackgroundSampling::None || qinv < m_settings.qFull)
+                        return 1.;
+                    if (m_settings.mode == BackgroundSampling::FixedCount)
+                        return m_eventAcceptance;
+
+                    return std::max<double>(m_settings.minAcceptance,std::pow(m_settings.qFull / qinv,m_settings.exponent));
+                }
+                /**
+                 * @brief Decide if the pair is kept
+                 *
+                 * @param kinematics
+                 * @return weight of the pair, or 0 if the pair should be dropped
+                 */
+                [[nodiscard]] double operator()(const Selection::PairKinematics &kinematics)
+                {
+                    const double acceptance = GetAcceptance(kinematics.QInv);
+                    if (acceptance >= 1.)
+                        return 1.;
+
+                    return (m_uniform(m_generator) < acceptance) ? 1. / acceptance : 0.;
+                }
+                /**
+                 * @brief Get the largest acceptance of the pairs above qFull. Partners drawn with this probability (DrawSkip) and then thinned (Thin) are kept with exactly GetAcceptance(q_inv)
+                 *
+                 * @return double
+                 */
+                [[nodiscard]] double GetProposalAcceptance() const noexcept
+                {
+                    return (m_settings.mode == BackgroundSampling::FixedCount) ? m_eventAcceptance : 1.;
+                }
+                /**
+                 * @brief Draw how many partner tracks should be skipped before the next proposed one (geometric distribution with the proposal acceptance), so the skipped partners do not cost anything
+                 *
+                 * @return std::size_t
+                 */
+                [[nodiscard]] std::size_t DrawSkip()
+                {
+                    const double proposal = GetProposalAcceptance();
+                    if (proposal >= 1.)
+                        return 0;
+
+                    return std::geometric_distribution<std::size_t>(proposal)(m_generator);
+                }
+                /**
+                 * @brief Decide if a proposed pair above qFull is kept
+                 *
+                 * @param qinv
+                 * @return weight of the pair (inverse of its total acceptance), or 0 if the pair should be dropped
+                 */
+                [[nodiscard]] double Thin(float qinv)
+                {
+                    const double acceptance = GetAcceptance(qinv);
+                    const double proposal = GetProposalAcceptance();
+                    if (acceptance >= proposal)
+                        return 1. / acceptance;
+
+                    return (m_uniform(m_generator) * proposal < acceptance) ? 1. / acceptance : 0.;
+                }
+                /**
+                 * @brief Get the settings of the sampler
+                 *
+                 * @return const BackgroundSamplingSettings&
+                 */
+                [[nodiscard]] const BackgroundSamplingSettings& GetSettings() const noexcept {return m_settings;}
+                /**
+                 * @brief Print the settings of the sampler
+                 *
+                 */
+                void PrintSettings() const
+                {
+                    std::cout << "---=== BackgroundSampler settings ===---\n";
+                    switch (m_settings.mode)
+                    {
+                        case BackgroundSampling::None:
+                            std::cout << "mode: none (all mixed pairs are kept)\n";
+                            break;
+                        case BackgroundSampling::FixedCount:
+                            std::cout << "mode: fixed count, " << m_settings.pairsPerEvent << " pairs per event\n";
+                            break;
+                        case BackgroundSampling::QDependent:
+                            std::cout << "mode: q-dependent, acceptance (" << m_settings.qFull << "/q_inv)^" << m_settings.exponent << " >= " << m_settings.minAcceptance << "\n";
+                            break;
+                    }
+                    std::cout << "all pairs kept below q_inv = " << m_settings.qFull << " MeV/c\n";
+                    std::cout << "seed: " << m_settings.seed << "\n\n";
+                }
+        };
+    } // namespace Mixing
+
+#endif
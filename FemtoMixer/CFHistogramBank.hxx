@@ -0,0 +1,470 @@
+/**
+ * @file CFHistogramBank.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Pre-allocated collection of correlation function numerators and denominators, one set for each pair group
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef CFHistogramBank_hxx
+    #define CFHistogramBank_hxx
+
+    #include <algorithm>
+    #include <cmath>
+    #include <cstdint>
+    #include <iostream>
+    #include <memory>
+    #include <stdexcept>
+    #include <string>
+    #include <unordered_map>
+    #include <vector>
+
+    #include "TDirectory.h"
+    #include "TH1D.h"
+    #include "TH3D.h"
+
+    #include "MixingGroups.hxx"
+    #include "PairUtils.hxx"
+
+    namespace Mixing
+    {
+        /**
+         * @brief Storage used for the 3D q_osl grids
+         *
+         */
+        enum class GridStorage{Dense,Sparse};
+        /**
+         * @brief Sample to which the pair belongs
+         *
+         */
+        enum class CFSample{Signal,Background};
+
+        /**
+         * @brief Binning of a single histogram axis
+         *
+         */
+        struct CFAxis
+        {
+            int nBins;
+            double min, max;
+        };
+
+        /**
+         * @brief Settings of the histograms booked by the CFHistogramBank
+         *
+         */
+        struct CFHistogramSettings
+        {
+            bool fillQinv = false;
+            CFAxis qinvAxis{750,0.,3000.};
+            bool fillQosl = true;
+            CFAxis qoslAxis{125,0.,500.};
+            GridStorage qoslStorage = GridStorage::Sparse; // a dense 125^3 TH3D takes ~16 MB, two per pair group in every bank
+            std::string signalTag = "Sign", backgroundTag = "Bckg"; // histogram names are h<Qinv|Qosl><tag>_<group name>
+            std::string signalTitle = "Signal of Protons 0-10% centrality", backgroundTitle = "Background of Protons 0-10% centrality";
+        };
+
+        namespace Detail
+        {
+            /**
+             * @brief Hashed 3D grid with the same bin numbering as TH3 (including under- and overflow). Only the filled bins are kept in memory
+             *
+             */
+            class SparseGrid3D
+            {
+                private:
+                    struct BinContent
+                    {
+                        double sumw = 0, sumw2 = 0;
+                    };
+
+                    CFAxis m_axis;
+                    std::unordered_map<std::uint32_t,BinContent> m_content;
+                    double m_entries;
+                    bool m_isWeighted;
+
+                    /**
+                     * @brief Find the bin along the axis, 0 is the underflow and nBins + 1 is the overflow
+                     *
+                     * @param val
+                     * @return bin number
+                     */
+                    [[nodiscard]] std::uint32_t FindBin(double val) const noexcept
+                    {
+                        if (val < m_axis.min)
+                            return 0;
+                        if (!(val < m_axis.max)) // NaN goes to the overflow as well
+                            return m_axis.nBins + 1;
+
+                        return 1 + std::min<std::uint32_t>(m_axis.nBins - 1,m_axis.nBins * (val - m_axis.min) / (m_axis.max - m_axis.min));
+                    }
+
+                public:
+                    explicit SparseGrid3D(const CFAxis &axis) : m_axis(axis), m_content(), m_entries(0), m_isWeighted(false) {}
+                    /**
+                     * @brief Add the weight to the bin corresponding to the given coordinates
+                     *
+                     * @param x
+                     * @param y
+                     * @param z
+                     * @param weight
+                     */
+                    void Fill(double x, double y, double z, double weight = 1.)
+                    {
+                        const std::uint32_t width = m_axis.nBins + 2;
+                        BinContent &bin = m_content[FindBin(x) + width * (FindBin(y) + width * FindBin(z))];
+                        bin.sumw += weight;
+                        bin.sumw2 += weight * weight;
+                        m_isWeighted |= (weight != 1.);
+                        ++m_entries;
+                    }
+                    /**
+                     * @brief Get the number of bins which are kept in memory
+                     *
+                     * @return std::size_t
+                     */
+                    [[nodiscard]] std::size_t GetNFilledBins() const noexcept {return m_content.size();}
+                    /**
+                     * @brief Get the memory taken by a single filled bin
+                     *
+                     * @return std::size_t
+                     */
+                    [[nodiscard]] static constexpr std::size_t GetBytesPerBin() noexcept {return sizeof(std::uint32_t) + sizeof(BinContent);}
+                    /**
+                     * @brief Add the contents of another grid with the same binning
+                     *
+                     * @param other
+                     */
+                    void Add(const SparseGrid3D &other)
+                    {
+                        for (const auto &[bin,content] : other.m_content)
+                        {
+                            m_content[bin].sumw += content.sumw;
+                            m_content[bin].sumw2 += content.sumw2;
+                        }
+                        m_entries += other.m_entries;
+                        m_isWeighted |= other.m_isWeighted;
+                    }
+                    /**
+                     * @brief Add the contents of a histogram with the same binning (e.g. a grid written by ToHistogram). Only the non-empty bins are inserted
+                     *
+                     * @param hist
+                     */
+                    void Add(const TH3D &hist)
+                    {
+                        const bool isWeighted = (hist.GetSumw2N() > 0);
+                        for (int bin = 0; bin < hist.GetNcells(); ++bin)
+                        {
+                            const double content = hist.GetBinContent(bin);
+                            if (content == 0.)
+                                continue;
+
+                            const double error = hist.GetBinError(bin);
+                            m_content[static_cast<std::uint32_t>(bin)].sumw += content;
+                            m_content[static_cast<std::uint32_t>(bin)].sumw2 += error * error;
+                        }
+                        m_entries += hist.GetEntries();
+                        m_isWeighted |= isWeighted;
+                    }
+                    /**
+                     * @brief Create a regular histogram with the contents of the grid. Meant to be called only when writing the output
+                     *
+                     * @param name
+                     * @param title
+                     * @return TH3D
+                     */
+                    [[nodiscard]] std::unique_ptr<TH3D> ToHistogram(const std::string &name, const std::string &title) const
+                    {
+                        auto hist = std::make_unique<TH3D>(name.data(),title.data(),m_axis.nBins,m_axis.min,m_axis.max,m_axis.nBins,m_axis.min,m_axis.max,m_axis.nBins,m_axis.min,m_axis.max);
+                        hist->SetDirectory(nullptr);
+                        if (m_isWeighted)
+                            hist->Sumw2();
+                        for (const auto &[bin,content] : m_content)
+                        {
+                            hist->SetBinContent(bin,content.sumw);
+                            if (m_isWeighted)
+                                hist->SetBinError(bin,std::sqrt(content.sumw2));
+                        }
+                        hist->SetEntries(m_entries);
+
+                        return hist;
+                    }
+            };
+
+            /**
+             * @brief Histograms of a single pair group
+             *
+             */
+            struct CFSlot
+            {
+                std::string name;
+                std::unique_ptr<TH1D> qinv[2];
+                std::unique_ptr<TH3D> qosl[2];
+                std::unique_ptr<SparseGrid3D> sparseQosl[2];
+            };
+        } // namespace Detail
+
+        /**
+         * @brief Bank of correlation function histograms. All histograms are booked at construction, one set for each slot of the pair grouping (the out-of-range and rejected slots get only the signal histograms, the mixed pairs of those groups are dropped by the prefilter and never filled). The q_osl grids are sparse by default, so the memory grows only with the filled bins, the dense ones take all their memory at construction. The histograms are filled with the integer group ID returned by the pair hashing function.
+         *
+         */
+        class CFHistogramBank
+        {
+            private:
+                CFHistogramSettings m_settings;
+                std::vector<Detail::CFSlot> m_slots;
+
+                static constexpr const char *m_qinvAxes = ";q_{inv} [MeV/c];CF(q_{inv})";
+                static constexpr const char *m_qoslAxes = ";q_{out} [MeV/c];q_{side} [MeV/c];q_{long} [MeV/c];CF(q_{inv})";
+
+                [[nodiscard]] const std::string& GetTag(int sample) const noexcept {return (sample == 0) ? m_settings.signalTag : m_settings.backgroundTag;}
+                [[nodiscard]] std::string GetTitle(int sample, const char *axes) const {return ((sample == 0) ? m_settings.signalTitle : m_settings.backgroundTitle) + axes;}
+
+                /**
+                 * @brief Book the histograms of a single slot
+                 *
+                 * @param slot
+                 * @param nSamples 2 to book the signal and background histograms, 1 for the signal only
+                 */
+                void Book(Detail::CFSlot &slot, int nSamples) const
+                {
+                    const auto &qinv = m_settings.qinvAxis;
+                    const auto &qosl = m_settings.qoslAxis;
+                    for (int sample = 0; sample < nSamples; ++sample)
+                    {
+                        if (m_settings.fillQinv)
+                        {
+                            slot.qinv[sample] = std::make_unique<TH1D>(("hQinv" + GetTag(sample) + "_" + slot.name).data(),GetTitle(sample,m_qinvAxes).data(),qinv.nBins,qinv.min,qinv.max);
+                            slot.qinv[sample]->SetDirectory(nullptr);
+                        }
+                        if (m_settings.fillQosl && m_settings.qoslStorage == GridStorage::Dense)
+                        {
+                            slot.qosl[sample] = std::make_unique<TH3D>(("hQosl" + GetTag(sample) + "_" + slot.name).data(),GetTitle(sample,m_qoslAxes).data(),qosl.nBins,qosl.min,qosl.max,qosl.nBins,qosl.min,qosl.max,qosl.nBins,qosl.min,qosl.max);
+                            slot.qosl[sample]->SetDirectory(nullptr);
+                        }
+                        else if (m_settings.fillQosl)
+                        {
+                            slot.sparseQosl[sample] = std::make_unique<Detail::SparseGrid3D>(qosl);
+                        }
+                    }
+                }
+
+            public:
+                /**
+                 * @brief Construct a new CFHistogramBank object
+                 *
+                 * @param slotNames names of the pair groups, ordered by their slot index (see Mixing::GetGroupSlot)
+                 * @param settings
+                 */
+                CFHistogramBank(const std::vector<std::string> &slotNames, const CFHistogramSettings &settings = {}) : m_settings(settings), m_slots(slotNames.size())
+                {
+                    for (std::size_t i = 0; i < slotNames.size(); ++i)
+                    {
+                        const GroupId group = GetSlotGroup(i,slotNames.size());
+                        m_slots[i].name = slotNames[i];
+                        Book(m_slots[i],(group == outOfRangeGroup || group == rejectedGroup) ? 1 : 2);
+                    }
+                }
+                /**
+                 * @brief Create the bank for all groups of the 1D analysis
+                 *
+                 * @param grouping
+                 * @param settings
+                 * @return CFHistogramBank
+                 */
+                [[nodiscard]] static CFHistogramBank Create1D(const PairGrouping &grouping, const CFHistogramSettings &settings = {})
+                {
+                    std::vector<std::string> names(PairGrouping::GetNumberOfGroupSlots1D());
+                    for (std::size_t slot = 0; slot < names.size(); ++slot)
+                        names[slot] = grouping.GetGroupName1D(PairGrouping::GetSlotGroup1D(slot));
+
+                    return CFHistogramBank(names,settings);
+                }
+                /**
+                 * @brief Create the bank for all groups of the 3D analysis
+                 *
+                 * @param grouping
+                 * @param settings
+                 * @return CFHistogramBank
+                 */
+                [[nodiscard]] static CFHistogramBank Create3D(const PairGrouping &grouping, const CFHistogramSettings &settings = {})
+                {
+                    std::vector<std::string> names(PairGrouping::GetNumberOfGroupSlots3D());
+                    for (std::size_t slot = 0; slot < names.size(); ++slot)
+                        names[slot] = grouping.GetGroupName3D(PairGrouping::GetSlotGroup3D(slot));
+
+                    return CFHistogramBank(names,settings);
+                }
+                /**
+                 * @brief Create the bank for all groups of a compile-time binning (e.g. a new layout used to rebin the pair tuples)
+                 * 
+                 * @tparam PairBinning Mixing::Binning type
+                 * @param settings
+                 * @return CFHistogramBank
+                 */
+                template <typename PairBinning>
+                [[nodiscard]] static CFHistogramBank Create(const CFHistogramSettings &settings = {})
+                {
+                    std::vector<std::string> names(PairBinning::nGroupSlots);
+                    for (std::size_t slot = 0; slot < names.size(); ++slot)
+                        names[slot] = PairBinning::GetGroupName(PairBinning::GetSlotGroup(slot));
+
+                    return CFHistogramBank(names,settings);
+                }
+                /**
+                 * @brief Fill the histograms of the given group
+                 *
+                 * @param sample signal or background
+                 * @param group group ID returned by the pair hashing function (has to belong to the grouping used to create the bank)
+                 * @param qinv
+                 * @param qout
+                 * @param qside
+                 * @param qlong
+                 * @param weight weight of the pair (e.g. the inverse acceptance of the BackgroundSampler)
+                 */
+                void Fill(CFSample sample, GroupId group, float qinv, float qout, float qside, float qlong, double weight = 1.)
+                {
+                    auto &slot = m_slots[GetGroupSlot(group,m_slots.size())];
+                    const int idx = static_cast<int>(sample);
+
+                    if (slot.qinv[idx] != nullptr)
+                        slot.qinv[idx]->Fill(qinv,weight);
+                    if (slot.qosl[idx] != nullptr)
+                        slot.qosl[idx]->Fill(qout,qside,qlong,weight);
+                    else if (slot.sparseQosl[idx] != nullptr)
+                        slot.sparseQosl[idx]->Fill(qout,qside,qlong,weight);
+                }
+                /**
+                 * @brief Fill the histograms of the given group with the pair
+                 *
+                 * @param sample signal or background
+                 * @param group group ID returned by the pair hashing function
+                 * @param pair
+                 * @param weight weight of the pair
+                 */
+                void Fill(CFSample sample, GroupId group, const Selection::PairCandidate &pair, double weight = 1.)
+                {
+                    float qout, qside, qlong;
+                    std::tie(qout,qside,qlong) = pair.GetOSL();
+                    Fill(sample,group,pair.GetQinv(),qout,qside,qlong,weight);
+                }
+                /**
+                 * @brief Add the histograms of another bank (e.g. filled by a different thread). Both banks have to be created with the same grouping and settings
+                 *
+                 * @param other
+                 */
+                void Add(const CFHistogramBank &other)
+                {
+                    if (other.m_slots.size() != m_slots.size())
+                        throw std::invalid_argument("CFHistogramBank::Add - banks have different number of pair groups");
+
+                    for (std::size_t i = 0; i < m_slots.size(); ++i)
+                        for (int sample = 0; sample < 2; ++sample)
+                        {
+                            auto &slot = m_slots[i];
+                            const auto &otherSlot = other.m_slots[i];
+                            if (slot.qinv[sample] != nullptr && otherSlot.qinv[sample] != nullptr)
+                                slot.qinv[sample]->Add(otherSlot.qinv[sample].get());
+                            if (slot.qosl[sample] != nullptr && otherSlot.qosl[sample] != nullptr)
+                                slot.qosl[sample]->Add(otherSlot.qosl[sample].get());
+                            if (slot.sparseQosl[sample] != nullptr && otherSlot.sparseQosl[sample] != nullptr)
+                                slot.sparseQosl[sample]->Add(*otherSlot.sparseQosl[sample]);
+                        }
+                }
+                /**
+                 * @brief Add the histograms written by Write of a bank with the same grouping and settings (e.g. from a checkpoint file). The histograms are read one at a time
+                 *
+                 * @param directory directory to which the other bank was written
+                 * @throws std::runtime_error if one of the booked histograms is missing
+                 */
+                void Add(TDirectory &directory)
+                {
+                    for (auto &slot : m_slots)
+                        for (int sample = 0; sample < 2; ++sample)
+                        {
+                            if (slot.qinv[sample] != nullptr)
+                            {
+                                const std::string name = "hQinv" + GetTag(sample) + "_" + slot.name;
+                                std::unique_ptr<TH1D> hist(directory.Get<TH1D>(name.data()));
+                                if (hist == nullptr)
+                                    throw std::runtime_error("CFHistogramBank::Add - " + name + " not found in " + directory.GetName());
+                                slot.qinv[sample]->Add(hist.get());
+                            }
+                            if (slot.qosl[sample] != nullptr || slot.sparseQosl[sample] != nullptr)
+                            {
+                                const std::string name = "hQosl" + GetTag(sample) + "_" + slot.name;
+                                std::unique_ptr<TH3D> hist(directory.Get<TH3D>(name.data()));
+                                if (hist == nullptr)
+                                    throw std::runtime_error("CFHistogramBank::Add - " + name + " not found in " + directory.GetName());
+                                if (slot.qosl[sample] != nullptr)
+                                    slot.qosl[sample]->Add(hist.get());
+                                else
+                                    slot.sparseQosl[sample]->Add(*hist);
+                            }
+                        }
+                }
+                /**
+                 * @brief Get the number of booked pair groups
+                 *
+                 * @return std::size_t
+                 */
+                [[nodiscard]] std::size_t GetNumberOfSlots() const noexcept {return m_slots.size();}
+                /**
+                 * @brief Estimate the memory taken by the bin contents. For the sparse storage only the currently filled bins are counted
+                 *
+                 * @return number of bytes
+                 */
+                [[nodiscard]] std::size_t GetAllocatedBytes() const noexcept
+                {
+                    const std::size_t qinvCells = m_settings.qinvAxis.nBins + 2;
+                    const std::size_t qoslCells = static_cast<std::size_t>(m_settings.qoslAxis.nBins + 2) * (m_settings.qoslAxis.nBins + 2) * (m_settings.qoslAxis.nBins + 2);
+
+                    std::size_t bytes = 0;
+                    for (const auto &slot : m_slots)
+                        for (int sample = 0; sample < 2; ++sample)
+                        {
+                            if (slot.qinv[sample] != nullptr)
+                                bytes += qinvCells * sizeof(double);
+                            if (slot.qosl[sample] != nullptr)
+                                bytes += qoslCells * sizeof(double);
+                            else if (slot.sparseQosl[sample] != nullptr)
+                                bytes += slot.sparseQosl[sample]->GetNFilledBins() * Detail::SparseGrid3D::GetBytesPerBin();
+                        }
+
+                    return bytes;
+                }
+                /**
+                 * @brief Print the booked histograms and their memory usage
+                 *
+                 */
+                void PrintSettings() const
+                {
+                    std::cout << "---=== CFHistogramBank settings ===---\n";
+                    std::cout << "pair groups: " << m_slots.size() << "\n";
+                    std::cout << "q_inv histograms: " << (m_settings.fillQinv ? "booked" : "not booked") << "\n";
+                    std::cout << "q_osl histograms: " << (m_settings.fillQosl ? ((m_settings.qoslStorage == GridStorage::Dense) ? "booked (dense)" : "booked (sparse)") : "not booked") << "\n";
+                    std::cout << "allocated memory: " << GetAllocatedBytes() / 1024. / 1024. << " MB\n\n";
+                }
+                /**
+                 * @brief Write all histograms to the current directory. The sparse grids are converted into TH3D one at a time
+                 *
+                 */
+                void Write() const
+                {
+                    for (const auto &slot : m_slots)
+                        for (int sample = 0; sample < 2; ++sample)
+                        {
+                            if (slot.qinv[sample] != nullptr)
+                                slot.qinv[sample]->Write();
+                            if (slot.qosl[sample] != nullptr)
+                                slot.qosl[sample]->Write();
+                            else if (slot.sparseQosl[sample] != nullptr)
+                                slot.sparseQosl[sample]->ToHistogram("hQosl" + GetTag(sample) + "_" + slot.name,GetTitle(sample,m_qoslAxes))->Write();
+                        }
+                }
+        };
+    } // namespace Mixing
+
+#endif
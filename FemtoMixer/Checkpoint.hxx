@@ -0,0 +1,509 @@
+/**
+ * @file Checkpoint.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Checkpoint file of the analysis: the mixing buffers of all event classes, the histogram banks of the workers and the last processed entry. Allows to resume an interrupted job and to warm-start the mixing buffers of a job from the previous one
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef Checkpoint_hxx
+    #define Checkpoint_hxx
+
+    #include <array>
+    #include <cstdint>
+    #include <memory>
+    #include <stdexcept>
+    #include <string>
+    #include <type_traits>
+    #include <vector>
+
+    #include "TDirectory.h"
+    #include "TFile.h"
+    #include "TNamed.h"
+    #include "TParameter.h"
+    #include "TSystem.h"
+    #include "TTree.h"
+
+    #include "CFHistogramBank.hxx"
+    #include "MixingGroups.hxx"
+    #include "MixingPool.hxx"
+    #include "TrackCandidate.hxx"
+    #include "TrackStore.hxx"
+
+    namespace Selection
+    {
+        /**
+         * @brief Columns of the buffered tracks, i.e. the fields kept by TrackStore. One entry of each vector per track, the wires and META hits are stored in fixed-size blocks (same layout as in the femto skim)
+         *
+         */
+        class BufferTrackColumns
+        {
+            public:
+                static constexpr std::size_t wireBlockSize = HADES::MDC::WireInfo::numberOfAllLayers * HADES::MDC::PackedLayersTrack::maxWiresPerLayer;
+                static constexpr std::size_t metaBlockSize = TrackStore::metaBlockSize;
+                static constexpr std::uint16_t emptySlot = TrackStore::emptySlot;
+
+            private:
+                // ROOT needs a persistent pointer to each vector when reading, hence the address member
+                template <typename T>
+                struct Column
+                {
+                    std::vector<T> values;
+                    std::vector<T> *address = &values;
+                };
+
+                struct FloatField
+                {
+                    const char *name;
+                    float TrackCandidate::*member;
+                };
+
+                static constexpr std::size_t nFloatFields = 8;
+                static constexpr std::array<FloatField,nFloatFields> floatFields
+                {{
+                    {"px",&TrackCandidate::Px},
+                    {"py",&TrackCandidate::Py},
+                    {"pz",&TrackCandidate::Pz},
+                    {"energy",&TrackCandidate::Energy},
+                    {"phi",&TrackCandidate::AzimuthalAngle},
+                    {"theta",&TrackCandidate::PolarAngle},
+                    {"rapidity",&TrackCandidate::Rapidity},
+                    {"pt",&TrackCandidate::TransverseMomentum}
+                }};
+
+                std::array<Column<float>,nFloatFields> m_floats;
+                Column<short> m_sector;
+                Column<std::uint32_t> m_trackIndex;
+                Column<std::uint16_t> m_wires, m_metaHits;
+                Column<ULong64_t> m_variationMask;
+
+            public:
+                BufferTrackColumns() {}
+                BufferTrackColumns(const BufferTrackColumns &) = delete;
+                BufferTrackColumns& operator=(const BufferTrackColumns &) = delete;
+                /**
+                 * @brief Create the branches of all columns
+                 *
+                 * @param tree output tree
+                 * @param prefix prefix of the branch names (e.g. to distinguish the HGeantKine tracks)
+                 */
+                void Branch(TTree *tree, const std::string &prefix)
+                {
+                    for (std::size_t i = 0; i < nFloatFields; ++i)
+                        tree->Branch((prefix + floatFields[i].name).data(),&m_floats[i].values);
+                    tree->Branch((prefix + "sector").data(),&m_sector.values);
+                    tree->Branch((prefix + "trackIndex").data(),&m_trackIndex.values);
+                    tree->Branch((prefix + "wires").data(),&m_wires.values);
+                    tree->Branch((prefix + "metaHits").data(),&m_metaHits.values);
+                    tree->Branch((prefix + "variationMask").data(),&m_variationMask.values);
+                }
+                /**
+                 * @brief Connect all columns to the branches of an existing tree
+                 *
+                 * @param tree input tree
+                 * @param prefix prefix of the branch names
+                 */
+                void SetBranchAddresses(TTree *tree, const std::string &prefix)
+                {
+                    for (std::size_t i = 0; i < nFloatFields; ++i)
+                        tree->SetBranchAddress((prefix + floatFields[i].name).data(),&m_floats[i].address);
+                    tree->SetBranchAddress((prefix + "sector").data(),&m_sector.address);
+                    tree->SetBranchAddress((prefix + "trackIndex").data(),&m_trackIndex.address);
+                    tree->SetBranchAddress((prefix + "wires").data(),&m_wires.address);
+                    tree->SetBranchAddress((prefix + "metaHits").data(),&m_metaHits.address);
+                    tree->SetBranchAddress((prefix + "variationMask").data(),&m_variationMask.address);
+                }
+                /**
+                 * @brief Remove all tracks
+                 *
+                 */
+                void Clear() noexcept
+                {
+                    for (auto &column : m_floats)
+                        column.values.clear();
+                    m_sector.values.clear();
+                    m_trackIndex.values.clear();
+                    m_wires.values.clear();
+                    m_metaHits.values.clear();
+                    m_variationMask.values.clear();
+                }
+                /**
+                 * @brief Append a buffered track to the columns
+                 *
+                 * @param track
+                 */
+                void Push(const TrackHandle &track)
+                {
+                    const std::array<float,nFloatFields> values{track.GetPx(),track.GetPy(),track.GetPz(),track.GetEnergy(),track.GetPhi(),track.GetTheta(),track.GetRapidity(),track.GetPt()};
+                    for (std::size_t i = 0; i < nFloatFields; ++i)
+                        m_floats[i].values.push_back(values[i]);
+                    m_sector.values.push_back(track.GetSector());
+                    m_trackIndex.values.push_back(static_cast<std::uint32_t>(track.GetIndex()));
+
+                    const HADES::MDC::PackedLayersTrack &packed = track.GetPackedWires();
+                    for (const auto &layer : HADES::MDC::WireInfo::allLayerIndexing)
+                        for (std::size_t slot = 0; slot < HADES::MDC::PackedLayersTrack::maxWiresPerLayer; ++slot)
+                            m_wires.values.push_back(packed.GetWire(layer,slot));
+
+                    const auto metaHits = track.GetMetaHits();
+                    for (std::size_t slot = 0; slot < metaBlockSize; ++slot)
+                        m_metaHits.values.push_back((slot < metaHits.size()) ? metaHits[slot] : emptySlot);
+
+                    m_variationMask.values.push_back(track.GetVariationMask());
+                }
+                /**
+                 * @brief Append an empty placeholder track (keeps the HGeantKine columns aligned with the reconstructed ones)
+                 *
+                 */
+                void PushEmpty()
+                {
+                    for (auto &column : m_floats)
+                        column.values.push_back(0.f);
+                    m_sector.values.push_back(-1);
+                    m_trackIndex.values.push_back(0);
+                    m_wires.values.insert(m_wires.values.end(),wireBlockSize,HADES::MDC::PackedLayersTrack::noWire);
+                    m_metaHits.values.insert(m_metaHits.values.end(),metaBlockSize,emptySlot);
+                    m_variationMask.values.push_back(0);
+                }
+                /**
+                 * @brief Rebuild the track at the given position. Only the fields kept by TrackStore are set
+                 *
+                 * @param i position of the track
+                 * @param evtId unique ID of the buffered event
+                 * @return TrackCandidate
+                 */
+                [[nodiscard]] TrackCandidate Get(std::size_t i, EventIdentifier evtId) const
+                {
+                    TrackCandidate track;
+                    for (std::size_t field = 0; field < nFloatFields; ++field)
+                        track.*floatFields[field].member = m_floats[field].values[i];
+
+                    track.GeantKineTrack = nullptr;
+                    track.TrackIndex = m_trackIndex.values[i];
+                    track.TrackId = TrackIdentifier{evtId,m_trackIndex.values[i]};
+                    track.Sector = m_sector.values[i];
+
+                    HADES::MDC::PackedLayersTrack packed;
+                    for (const auto &layer : HADES::MDC::WireInfo::allLayerIndexing)
+                        for (std::size_t slot = 0; slot < HADES::MDC::PackedLayersTrack::maxWiresPerLayer; ++slot)
+                        {
+                            const std::uint16_t wire = m_wires.values[i * wireBlockSize + layer * HADES::MDC::PackedLayersTrack::maxWiresPerLayer + slot];
+                            if (wire != HADES::MDC::PackedLayersTrack::noWire)
+                                packed.AddWire(layer,wire);
+                        }
+                    track.firedWiresCollection = packed.Unpack();
+
+                    track.metaHits.clear();
+                    for (std::size_t slot = 0; slot < metaBlockSize; ++slot)
+                        if (m_metaHits.values[i * metaBlockSize + slot] != emptySlot)
+                            track.metaHits.push_back(m_metaHits.values[i * metaBlockSize + slot]);
+
+                    return track;
+                }
+                /**
+                 * @brief Get the variations which accepted the track at the given position
+                 *
+                 * @param i
+                 * @return VariationMask
+                 */
+                [[nodiscard]] VariationMask GetVariationMask(std::size_t i) const {return m_variationMask.values[i];}
+                /**
+                 * @brief Get the number of stored tracks
+                 *
+                 * @return std::size_t
+                 */
+                [[nodiscard]] std::size_t size() const noexcept {return m_sector.values.size();}
+        };
+    } // namespace Selection
+
+    namespace Mixing
+    {
+        /**
+         * @brief Writes a checkpoint. Everything is written into a temporary file, which replaces the previous checkpoint only in Commit, so an interrupted write never destroys the last good checkpoint
+         *
+         */
+        class CheckpointWriter
+        {
+            private:
+                std::string m_fileName;
+                std::unique_ptr<TFile> m_file;
+                TTree *m_tree; // owned by m_file
+                GroupId m_eventClass;
+                ULong64_t m_eventId; // packed EventIdentifier
+                std::vector<std::uint8_t> m_hasKine;
+                Selection::BufferTrackColumns m_tracks, m_kineTracks;
+                std::size_t m_nBanks;
+                bool m_isCommitted;
+
+            public:
+                /**
+                 * @brief Create the temporary file and the tree of the buffered events
+                 *
+                 * @param fileName name of the checkpoint file (see MakeFileName)
+                 * @throws std::runtime_error if the file cannot be created
+                 */
+                explicit CheckpointWriter(const std::string &fileName) : m_fileName(fileName), m_file(), m_tree(nullptr), m_eventClass(0), m_eventId(0), m_nBanks(0), m_isCommitted(false)
+                {
+                    TDirectory::TContext context; // creating the file changes the current directory
+                    m_file = std::make_unique<TFile>((m_fileName + ".tmp").data(),"RECREATE");
+                    if (m_file->IsZombie())
+                        throw std::runtime_error("CheckpointWriter: cannot create file " + m_fileName + ".tmp");
+
+                    m_file->cd();
+                    m_tree = new TTree("mixingBuffer","Events stored in the mixing buffers, from the oldest to the newest in each class");
+                    m_tree->Branch("eventClass",&m_eventClass,"eventClass/i");
+                    m_tree->Branch("eventId",&m_eventId,"eventId/l");
+                    m_tree->Branch("hasKine",&m_hasKine);
+                    m_tracks.Branch(m_tree,"");
+                    m_kineTracks.Branch(m_tree,"kine_");
+                }
+                CheckpointWriter(const CheckpointWriter &) = delete;
+                CheckpointWriter& operator=(const CheckpointWriter &) = delete;
+                /**
+                 * @brief Remove the temporary file if the checkpoint was not committed (e.g. after an exception)
+                 *
+                 */
+                ~CheckpointWriter()
+                {
+                    if (m_isCommitted)
+                        return;
+
+                    m_file->Close();
+                    gSystem->Unlink((m_fileName + ".tmp").data());
+                }
+                /**
+                 * @brief Create the name of the checkpoint file from the name of the analysis output, e.g. femtoOutFile.root -> femtoOutFile_checkpoint.root
+                 *
+                 * @param outFile name of the analysis output file
+                 * @return std::string
+                 */
+                [[nodiscard]] static std::string MakeFileName(const std::string &outFile)
+                {
+                    const std::size_t extension = outFile.rfind(".root");
+                    const std::string stem = (extension == std::string::npos) ? outFile : outFile.substr(0,extension);
+                    return stem + "_checkpoint.root";
+                }
+                /**
+                 * @brief Store all events of the mixing buffer (of one mixer, call it for the mixer of every worker)
+                 *
+                 * @param pool
+                 */
+                void AddMixingBuffer(const MixingPool &pool)
+                {
+                    for (const GroupId eventClass : pool.GetClasses())
+                        pool.ForEachEvent(eventClass,[&](Selection::EventIdentifier eventId, const std::vector<Selection::TrackHandle> &tracks)
+                        {
+                            m_eventClass = eventClass;
+                            m_eventId = eventId.GetValue();
+                            m_tracks.Clear();
+                            m_kineTracks.Clear();
+                            m_hasKine.clear();
+                            for (const auto &track : tracks)
+                            {
+                                m_tracks.Push(track);
+                                m_hasKine.push_back(track.HasGeantKine());
+                                if (track.HasGeantKine())
+                                    m_kineTracks.Push(track.GetGeantKine());
+                                else
+                                    m_kineTracks.PushEmpty();
+                            }
+
+                            m_tree->Fill();
+                        });
+                }
+                /**
+                 * @brief Store the histograms of a bank (of one worker) in its own directory
+                 *
+                 * @param bank
+                 */
+                void AddHistogramBank(const CFHistogramBank &bank)
+                {
+                    TDirectory::TContext context(m_file->mkdir(("bank_" + std::to_string(m_nBanks++)).data()));
+                    bank.Write();
+                }
+                /**
+                 * @brief Store an object (e.g. a monitoring histogram) in the top directory
+                 *
+                 * @param object
+                 */
+                void AddObject(const TObject &object)
+                {
+                    TDirectory::TContext context(m_file.get());
+                    object.Write();
+                }
+                /**
+                 * @brief Store the progress, close the file and replace the previous checkpoint with it
+                 *
+                 * @param nextEntry first entry which was not processed yet
+                 * @param input description of the input (the checkpoint is resumed only with the same input)
+                 * @param isFinished if the job has processed all its entries (then the checkpoint is useful only for a warm start)
+                 * @throws std::runtime_error if the previous checkpoint cannot be replaced
+                 */
+                void Commit(Long64_t nextEntry, const std::string &input, bool isFinished = false)
+                {
+                    {
+                        TDirectory::TContext context(m_file.get());
+                        m_tree->Write();
+                        TParameter<Long64_t>("nextEntry",nextEntry).Write();
+                        TParameter<Bool_t>("isFinished",isFinished).Write();
+                        TNamed("input",input.data()).Write();
+                    }
+                    m_file->Close();
+                    m_isCommitted = true;
+
+                    if (gSystem->Rename((m_fileName + ".tmp").data(),m_fileName.data()) != 0)
+                        throw std::runtime_error("CheckpointWriter: cannot replace " + m_fileName);
+                }
+        };
+
+        /**
+         * @brief Reads a checkpoint written by CheckpointWriter
+         *
+         */
+        class CheckpointReader
+        {
+            private:
+                std::unique_ptr<TFile> m_file;
+                Long64_t m_nextEntry;
+                bool m_isFinished;
+                std::string m_input;
+
+            public:
+                /**
+                 * @brief Open the checkpoint file and read the progress
+                 *
+                 * @param fileName
+                 * @throws std::runtime_error if the file cannot be read or is not a checkpoint
+                 */
+                explicit CheckpointReader(const std::string &fileName) : m_file(), m_nextEntry(0), m_isFinished(false), m_input()
+                {
+                    TDirectory::TContext context;
+                    m_file = std::make_unique<TFile>(fileName.data(),"READ");
+                    if (m_file->IsZombie())
+                        throw std::runtime_error("CheckpointReader: cannot open " + fileName);
+
+                    std::unique_ptr<TParameter<Long64_t> > nextEntry(m_file->Get<TParameter<Long64_t> >("nextEntry"));
+                    std::unique_ptr<TParameter<Bool_t> > isFinished(m_file->Get<TParameter<Bool_t> >("isFinished"));
+                    std::unique_ptr<TNamed> input(m_file->Get<TNamed>("input"));
+                    if (nextEntry == nullptr || isFinished == nullptr || input == nullptr)
+                        throw std::runtime_error("CheckpointReader: " + fileName + " is not a checkpoint file");
+
+                    m_nextEntry = nextEntry->GetVal();
+                    m_isFinished = isFinished->GetVal();
+                    m_input = input->GetTitle();
+                }
+                /**
+                 * @brief Check if a checkpoint file exists
+                 *
+                 * @param fileName
+                 * @return true if it does
+                 */
+                [[nodiscard]] static bool Exists(const std::string &fileName)
+                {
+                    return !gSystem->AccessPathName(fileName.data()); // returns false if the file is there
+                }
+                /**
+                 * @brief Get the first entry which was not processed
+                 *
+                 * @return Long64_t
+                 */
+                [[nodiscard]] Long64_t GetNextEntry() const noexcept {return m_nextEntry;}
+                /**
+                 * @brief Check if the job which wrote the checkpoint has processed all its entries
+                 *
+                 * @return true if it has
+                 */
+                [[nodiscard]] bool IsFinished() const noexcept {return m_isFinished;}
+                /**
+                 * @brief Get the description of the input of the job which wrote the checkpoint
+                 *
+                 * @return const std::string&
+                 */
+                [[nodiscard]] const std::string& GetInput() const noexcept {return m_input;}
+                /**
+                 * @brief Read an object stored with CheckpointWriter::AddObject
+                 *
+                 * @tparam T type of the object
+                 * @param name
+                 * @return the object (owned by the caller) or nullptr if it was not stored
+                 */
+                template <typename T>
+                [[nodiscard]] std::unique_ptr<T> GetObject(const std::string &name) const
+                {
+                    std::unique_ptr<T> object(m_file->Get<T>(name.data()));
+                    if constexpr (std::is_base_of_v<TH1,T>)
+                        if (object != nullptr)
+                            object->SetDirectory(nullptr);
+
+                    return object;
+                }
+                /**
+                 * @brief Add the histograms of all stored banks to the bank (it has to be created with the same grouping and settings). The histograms are read one at a time
+                 *
+                 * @param bank
+                 * @return number of stored banks
+                 */
+                std::size_t AddHistogramBanks(CFHistogramBank &bank) const
+                {
+                    std::size_t nBanks = 0;
+                    for (TDirectory *directory = m_file->GetDirectory("bank_0"); directory != nullptr; directory = m_file->GetDirectory(("bank_" + std::to_string(nBanks)).data()))
+                    {
+                        bank.Add(*directory);
+                        ++nBanks;
+                    }
+
+                    return nBanks;
+                }
+                /**
+                 * @brief Visit all stored events of the mixing buffers, from the oldest to the newest in each class. The tracks are rebuilt in a temporary store, pass them to JJFemtoMixer::BufferEvent to copy them into the buffer
+                 *
+                 * @param func callable with the signature void(GroupId eventClass, Selection::EventIdentifier eventId, const std::vector<Selection::TrackHandle> &tracks)
+                 * @return number of visited events
+                 */
+                template <typename Func>
+                std::size_t ForEachBufferedEvent(Func &&func) const
+                {
+                    std::unique_ptr<TTree> tree(m_file->Get<TTree>("mixingBuffer"));
+                    if (tree == nullptr)
+                        throw std::runtime_error(std::string("CheckpointReader: no mixing buffer in ") + m_file->GetName());
+
+                    GroupId eventClass = 0;
+                    ULong64_t eventId = 0;
+                    // owned here like the BufferTrackColumns columns, ROOT only fills the vector behind the persistent pointer
+                    std::vector<std::uint8_t> hasKine;
+                    std::vector<std::uint8_t> *hasKineAddress = &hasKine;
+                    Selection::BufferTrackColumns tracks, kineTracks;
+                    tree->SetBranchAddress("eventClass",&eventClass);
+                    tree->SetBranchAddress("eventId",&eventId);
+                    tree->SetBranchAddress("hasKine",&hasKineAddress);
+                    tracks.SetBranchAddresses(tree.get(),"");
+                    kineTracks.SetBranchAddresses(tree.get(),"kine_");
+
+                    Selection::TrackStore store;
+                    std::vector<Selection::TrackHandle> handles;
+                    const Long64_t nEvents = tree->GetEntries();
+                    for (Long64_t entry = 0; entry < nEvents; ++entry)
+                    {
+                        tree->GetEntry(entry);
+                        store.Reset(Selection::EventIdentifier(eventId));
+                        handles.clear();
+                        for (std::size_t i = 0; i < tracks.size(); ++i)
+                        {
+                            Selection::TrackCandidate track = tracks.Get(i,Selection::EventIdentifier(eventId));
+                            if (hasKine.at(i))
+                                track.GeantKineTrack = std::make_shared<Selection::TrackCandidate>(kineTracks.Get(i,Selection::EventIdentifier(eventId)));
+                            handles.push_back(store.GetHandle(store.Add(track,tracks.GetVariationMask(i))));
+                        }
+
+                        func(eventClass,Selection::EventIdentifier(eventId),handles);
+                    }
+                    tree->ResetBranchAddresses();
+
+                    return static_cast<std::size_t>(nEvents);
+                }
+        };
+    } // namespace Mixing
+
+#endif
@@ -0,0 +1,330 @@
+/**
+ * @file DstReader.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Read path of the DST chain: booking of the needed categories, TTreeCache restricted to the booked branches with asynchronous prefetching, and per-file read statistics
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef DstReader_hxx
+    #define DstReader_hxx
+
+    #include <algorithm>
+    #include <chrono>
+    #include <cstddef>
+    #include <iomanip>
+    #include <iostream>
+    #include <string>
+    #include <vector>
+
+    #include "TBranch.h"
+    #include "TChain.h"
+    #include "TEnv.h"
+    #include "TFile.h"
+    #include "TObjArray.h"
+    #include "TROOT.h"
+    #include "TTreeCache.h"
+    #include "TTreeCacheUnzip.h"
+
+    namespace JJUtils
+    {
+        /**
+         * @brief Settings of the DstReader
+         *
+         */
+        struct DstReadSettings
+        {
+            Long64_t cacheSize = 64000000; // [B] size of the TTreeCache, every block covers the baskets of all booked branches
+            bool asyncPrefetch = true; // the next cache block is read by a background thread while the current one is processed (TFile.AsyncPrefetching, a process-wide setting)
+            bool printPerFile = false; // print the statistics of each file when the next one is opened
+        };
+
+        /**
+         * @brief Read statistics of a single file of the chain
+         *
+         */
+        struct DstFileStats
+        {
+            std::string fileName;
+            Long64_t entries = 0; // entries read from the file
+            Long64_t bytesRead = 0; // bytes read from the storage (including the prefetched ones)
+            Long64_t bytesOutsideCache = 0; // bytes read by requests which missed the cache
+            Long64_t baskets = 0; // baskets of the cached branches covering the read entries
+            Int_t readCalls = 0; // read requests sent to the storage
+            double readTime = 0; // [s] wall time spent in the reading calls of the event loop
+
+            /**
+             * @brief Get the read throughput seen by the event loop
+             *
+             * @return throughput in MB/s
+             */
+            [[nodiscard]] double GetThroughput() const noexcept {return (readTime > 0) ? bytesRead / 1e6 / readTime : 0.;}
+            /**
+             * @brief Get the fraction of the read bytes which were served by the cache
+             *
+             * @return double
+             */
+            [[nodiscard]] double GetCacheHitRate() const noexcept {return (bytesRead > 0) ? 1. - static_cast<double>(bytesOutsideCache) / bytesRead : 0.;}
+            /**
+             * @brief Add the statistics of another file (e.g. to get the sum over the chain)
+             *
+             * @param other
+             */
+            void Add(const DstFileStats &other) noexcept
+            {
+                entries += other.entries;
+                bytesRead += other.bytesRead;
+                bytesOutsideCache += other.bytesOutsideCache;
+                baskets += other.baskets;
+                readCalls += other.readCalls;
+                readTime += other.readTime;
+            }
+        };
+
+        /**
+         * @brief Sets up the read path of the DST chain of HLoop and reads the events through it. Only the branches enabled by HLoop::setInput (use MakeInputString to book just the categories the analysis reads) are added to the TTreeCache, so the cache blocks do not carry the baskets of the unused categories. The reads of each file are timed and its statistics are collected when the chain moves to the next file.
+         * Global effects: the constructor sets TFile.AsyncPrefetching in gEnv, which applies to every TFile opened afterwards in the process (not only to the files of the chain). Background decompression of the cached baskets is not enabled here, because it needs ROOT::EnableImplicitMT and TTreeCacheUnzip::SetParallelUnzip, which change how every TTree of the job is read: the caller has to enable both before constructing the reader, if wanted
+         *
+         */
+        class DstReader
+        {
+            private:
+                TChain *m_chain; // owned by HLoop
+                DstReadSettings m_settings;
+                std::size_t m_nCachedBranches;
+                std::vector<DstFileStats> m_files;
+                DstFileStats m_current;
+                Int_t m_treeNumber; // tree of the chain which is being read, -1 before the first read
+                Long64_t m_treeBegin, m_treeEnd; // range of the chain entries belonging to m_treeNumber
+                Long64_t m_minLocalEntry, m_maxLocalEntry; // range of the read entries of the current tree
+                Long64_t m_outsideCacheAtOpen; // counter of the cache when the current file was opened (the cache is moved between the files of the chain)
+
+                /**
+                 * @brief Get the cache of the current file of the chain
+                 *
+                 * @return TTreeCache* or nullptr if there is no cache
+                 */
+                [[nodiscard]] TTreeCache* GetCache() const
+                {
+                    TFile *file = m_chain->GetCurrentFile();
+                    return (file == nullptr) ? nullptr : m_chain->GetReadCache(file);
+                }
+                /**
+                 * @brief Count the baskets of the cached branches which hold the read entries of the current tree
+                 *
+                 * @param cache
+                 * @return Long64_t
+                 */
+                [[nodiscard]] Long64_t CountBaskets(const TTreeCache &cache) const
+                {
+                    Long64_t nBaskets = 0;
+                    const TObjArray *branches = cache.GetCachedBranches();
+                    if (branches == nullptr)
+                        return nBaskets;
+
+                    for (Int_t i = 0; i <= branches->GetLast(); ++i)
+                    {
+                        TBranch *branch = static_cast<TBranch*>(branches->UncheckedAt(i));
+                        const Long64_t *basketEntry = branch->GetBasketEntry();
+                        const Int_t nWritten = branch->GetWriteBasket();
+                        for (Int_t basket = 0; basket < nWritten; ++basket)
+                        {
+                            const Long64_t basketEnd = (basket + 1 < nWritten) ? basketEntry[basket + 1] : branch->GetEntries();
+                            if (basketEntry[basket] <= m_maxLocalEntry && basketEnd > m_minLocalEntry)
+                                ++nBaskets;
+                        }
+                    }
+
+                    return nBaskets;
+                }
+                /**
+                 * @brief Collect the statistics of the file which is being read. Has to be called before the chain opens the next one
+                 *
+                 */
+                void CloseFile()
+                {
+                    if (m_treeNumber < 0)
+                        return;
+
+                    TFile *file = m_chain->GetCurrentFile();
+                    if (file != nullptr && m_chain->GetTreeNumber() == m_treeNumber)
+                    {
+                        m_current.bytesRead = file->GetBytesRead();
+                        m_current.readCalls = file->GetReadCalls();
+                        if (const TTreeCache *cache = GetCache())
+                        {
+                            m_current.bytesOutsideCache = std::max<Long64_t>(cache->GetNoCacheBytesRead() - m_outsideCacheAtOpen,0);
+                            m_current.baskets = CountBaskets(*cache);
+                        }
+                    }
+
+                    m_files.push_back(m_current);
+                    if (m_settings.printPerFile)
+                        PrintFile(m_current);
+                    m_treeNumber = -1;
+                }
+                /**
+                 * @brief Start the statistics of the tree holding the entry
+                 *
+                 * @param entry entry of the chain
+                 */
+                void OpenFile(Long64_t entry)
+                {
+                    const Long64_t *offsets = m_chain->GetTreeOffset();
+                    const Int_t nTrees = m_chain->GetNtrees();
+                    Int_t tree = 0;
+                    while (tree + 1 < nTrees && offsets[tree + 1] <= entry)
+                        ++tree;
+
+                    m_treeNumber = tree;
+                    m_treeBegin = offsets[tree];
+                    m_treeEnd = (tree + 1 < nTrees) ? offsets[tree + 1] : m_chain->GetEntries();
+                    m_minLocalEntry = entry - m_treeBegin;
+                    m_maxLocalEntry = m_minLocalEntry;
+
+                    m_current = DstFileStats();
+                    const TObject *fileElement = m_chain->GetListOfFiles()->At(tree);
+                    m_current.fileName = (fileElement != nullptr) ? fileElement->GetTitle() : "";
+
+                    const TTreeCache *cache = GetCache();
+                    m_outsideCacheAtOpen = (cache != nullptr) ? cache->GetNoCacheBytesRead() : 0;
+                }
+                /**
+                 * @brief Print the statistics as a single row of the table
+                 *
+                 * @param stats
+                 */
+                static void PrintFile(const DstFileStats &stats)
+                {
+                    const std::size_t slash = stats.fileName.rfind('/');
+                    std::cout << std::left << std::setw(40) << ((slash == std::string::npos) ? stats.fileName : stats.fileName.substr(slash + 1)) << std::right << std::fixed << std::setprecision(1)
+                              << std::setw(10) << stats.entries << std::setw(10) << stats.bytesRead / 1e6 << std::setw(10) << stats.readTime << std::setw(10) << stats.GetThroughput()
+                              << std::setw(10) << stats.baskets << std::setw(10) << stats.readCalls << std::setw(9) << 100. * stats.GetCacheHitRate() << "%\n" << std::defaultfloat;
+                }
+
+            public:
+                /**
+                 * @brief Configure the read path of the chain. Call it after HLoop::setInput (the enabled branches are taken from the chain) and before the event loop
+                 *
+                 * @param chain chain of the HLoop (HLoop::getChain)
+                 * @param settings
+                 */
+                explicit DstReader(TChain *chain, const DstReadSettings &settings = {}) : m_chain(chain), m_settings(settings), m_nCachedBranches(0), m_files(), m_current(),
+                    m_treeNumber(-1), m_treeBegin(0), m_treeEnd(0), m_minLocalEntry(0), m_maxLocalEntry(0), m_outsideCacheAtOpen(0)
+                {
+                    // has to be set before the cache is created
+                    gEnv->SetValue("TFile.AsyncPrefetching",m_settings.asyncPrefetch ? 1 : 0);
+
+                    m_chain->GetEntries(); // fills the tree offsets, needed to follow the files
+                    m_chain->SetCacheSize(m_settings.cacheSize);
+                    for (TObject *object : *m_chain->GetListOfBranches())
+                        if (m_chain->GetBranchStatus(object->GetName()))
+                        {
+                            m_chain->AddBranchToCache(object->GetName(),kTRUE);
+                            ++m_nCachedBranches;
+                        }
+                    m_chain->StopCacheLearningPhase();
+                }
+                DstReader(const DstReader &) = delete;
+                DstReader& operator=(const DstReader &) = delete;
+                /**
+                 * @brief Create the input string of HLoop::setInput which books only the given categories (the event header is always booked)
+                 *
+                 * @param categories names of the categories, e.g. {"HParticleCand","HParticleEvtInfo"}
+                 * @return std::string
+                 */
+                [[nodiscard]] static std::string MakeInputString(const std::vector<std::string> &categories)
+                {
+                    std::string input = "-*";
+                    for (const auto &category : categories)
+                        input += ",+" + category;
+
+                    return input;
+                }
+                /**
+                 * @brief Read the entry through the loop and account the read to its file
+                 *
+                 * @tparam Loop HLoop (anything with Int_t nextEvent(Long64_t))
+                 * @param loop
+                 * @param entry entry of the chain
+                 * @return number of read bytes returned by the loop (0 or less at the end of the chain or on error)
+                 */
+                template <typename Loop>
+                Int_t NextEvent(Loop &loop, Long64_t entry)
+                {
+                    if (m_treeNumber < 0 || entry < m_treeBegin || entry >= m_treeEnd)
+                    {
+                        CloseFile();
+                        OpenFile(entry);
+                    }
+
+                    const auto start = std::chrono::steady_clock::now();
+                    const Int_t nBytes = loop.nextEvent(entry);
+                    m_current.readTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                    if (nBytes > 0)
+                    {
+                        ++m_current.entries;
+                        m_minLocalEntry = std::min(m_minLocalEntry,entry - m_treeBegin);
+                        m_maxLocalEntry = std::max(m_maxLocalEntry,entry - m_treeBegin);
+                    }
+
+                    return nBytes;
+                }
+                /**
+                 * @brief Collect the statistics of the last file. Call it after the event loop
+                 *
+                 */
+                void Finish() {CloseFile();}
+                /**
+                 * @brief Get the statistics of the files read so far
+                 *
+                 * @return const std::vector<DstFileStats>&
+                 */
+                [[nodiscard]] const std::vector<DstFileStats>& GetFileStats() const noexcept {return m_files;}
+                /**
+                 * @brief Get the statistics summed over all read files
+                 *
+                 * @return DstFileStats
+                 */
+                [[nodiscard]] DstFileStats GetTotal() const
+                {
+                    DstFileStats total;
+                    total.fileName = "total (" + std::to_string(m_files.size()) + " files)";
+                    for (const auto &file : m_files)
+                        total.Add(file);
+
+                    return total;
+                }
+                /**
+                 * @brief Print the settings of the read path
+                 *
+                 */
+                void PrintSettings() const
+                {
+                    std::cout << "---=== DST read path ===---\n";
+                    std::cout << "cache size: " << m_settings.cacheSize / 1e6 << " MB\n";
+                    std::cout << "cached branches: " << m_nCachedBranches << "\n";
+                    std::cout << "asynchronous prefetching: " << (m_settings.asyncPrefetch ? "enabled" : "disabled") << "\n";
+                    std::cout << "background decompression: " << ((ROOT::IsImplicitMTEnabled() && TTreeCacheUnzip::IsParallelUnzip()) ? std::to_string(ROOT::GetThreadPoolSize()) + " implicit-MT threads" : "disabled") << "\n\n";
+                }
+                /**
+                 * @brief Print the read statistics of every file and of the whole chain
+                 *
+                 */
+                void Print() const
+                {
+                    std::cout << "---=== DST read statistics ===---\n";
+                    std::cout << std::left << std::setw(40) << "file" << std::right << std::setw(10) << "entries" << std::setw(10) << "MB" << std::setw(10) << "time [s]" << std::setw(10) << "MB/s"
+                              << std::setw(10) << "baskets" << std::setw(10) << "calls" << std::setw(10) << "cache hit" << "\n";
+                    for (const auto &file : m_files)
+                        PrintFile(file);
+                    PrintFile(GetTotal());
+                    std::cout << std::endl;
+                }
+        };
+    } // namespace JJUtils
+
+#endif
@@ -11,25 +11,43 @@
 #ifndef EventCandidate_hxx
     #define EventCandidate_hxx
 
-#include "TrackCandidate.hxx"
+#include "TrackStore.hxx"
 #include "Target.hxx"
 
 #include <vector>
+#include <numeric>
+#include <memory>
 
+#include "TMath.h"
+#ifndef FEMTOMIXER_STANDALONE
 #include "heventheader.h"
 #include "hparticleevtinfo.h"
 #include "hparticleevtchara.h"
+#endif
 
 namespace Selection
 {
+    /**
+     * @brief Parameters of the event selection (EventCandidate::SelectEvent). Default values correspond to the nominal selection
+     * 
+     */
+    struct EventCuts
+    {
+        std::vector<int> centIndex = {1}; // accepted centrality classes (same layout as from HParticleEvtChara)
+        float nSigmaX = 2, nSigmaY = 2, nSigmaZ = 2; // accepted distance from the mean plate position in each direction
+    };
+
     class EventCandidate
     {
+        friend class FemtoSkimReader;
+
         private:
-            std::string EventId;
+            EventIdentifier EventId;
             short int Centrality, TargetPlate, ChargedTracks;
             float ReactionPlaneAngle;
             float X, Y, Z;
-            std::vector<std::shared_ptr<TrackCandidate> > trackList;
+            std::unique_ptr<TrackStore> trackStore; // kept behind a pointer, so the handles stay valid for the lifetime of the event
+            std::vector<TrackHandle> trackList;
 
             template <std::size_t N>
             auto GetClosestZindex(const std::array<std::pair<double,double>,N> &array) const noexcept
@@ -52,19 +70,21 @@ namespace Selection
              * @brief Construct a new Event Candidate object
              * 
              */
-            EventCandidate(){}
+            EventCandidate() : trackStore(std::make_unique<TrackStore>()) {}
             /**
              * @brief Construct a new Event Candidate object
              * 
-             * @param evtId unique ID of the event (use HEventHeader::getEventSeqNumber and HEventHeader::getEventRunNumber)
+             * @param evtId unique ID of the event (packed HEventHeader::getEventRunNumber and HEventHeader::getEventSeqNumber)
              * @param vertx x position of the event vertex
              * @param verty y position of the event vertex
              * @param vertz z position of the event vertex
              * @param cent event centrality class (use HParticleEvtChara::getCentralityClass)
              * @param EP reaction plane angle (use HParticleEvtChara::getEventPlane)
              */
-            EventCandidate(const std::string &evtId, float vertx, float verty, float vertz, int cent, float EP)
-            : EventId(evtId),Centrality(cent),TargetPlate(-1),ChargedTracks(0),ReactionPlaneAngle((EP < 0) ? 0 : TMath::RadToDeg() * EP),X(vertx),Y(verty),Z(vertz) {}
+            EventCandidate(EventIdentifier evtId, float vertx, float verty, float vertz, int cent, float EP)
+            : EventId(evtId),Centrality(cent),TargetPlate(-1),ChargedTracks(0),ReactionPlaneAngle((EP < 0) ? 0 : TMath::RadToDeg() * EP),X(vertx),Y(verty),Z(vertz),
+            trackStore(std::make_unique<TrackStore>(EventId)) {}
+#ifndef FEMTOMIXER_STANDALONE
             /**
              * @brief Construct a new Event Candidate object
              * 
@@ -74,13 +94,15 @@ namespace Selection
              * @param EP reaction plane angle (use HParticleEvtChara::getEventPlane)
              */
             EventCandidate(HEventHeader* evtHeader, const HParticleEvtInfo* evtInfo,  int cent, float EP)
-                : EventId(std::to_string(evtHeader->getEventRunNumber()) + std::to_string(evtHeader->getEventSeqNumber())),
+                : EventId(static_cast<std::uint32_t>(evtHeader->getEventRunNumber()),static_cast<std::uint32_t>(evtHeader->getEventSeqNumber())),
                 Centrality(cent), TargetPlate(-1),
                 ChargedTracks(evtInfo->getSumRpcMultHitCut() + evtInfo->getSumTofMultCut()),
                 ReactionPlaneAngle((EP < 0) ? 0 : TMath::RadToDeg() * EP),
                 X(evtHeader->getVertexReco().getPos().X()),
                 Y(evtHeader->getVertexReco().getPos().Y()),
-                Z(evtHeader->getVertexReco().getPos().Z()) {}
+                Z(evtHeader->getVertexReco().getPos().Z()),
+                trackStore(std::make_unique<TrackStore>(EventId)) {}
+#endif
             /**
              * @brief Select event for given centrality and vertex position
              * 
@@ -118,12 +140,25 @@ namespace Selection
 
                 return false;
             }
+            /**
+             * @brief Select event for given centrality and vertex position
+             * 
+             * @tparam T HADES target setup
+             * @param cuts parameters of the selection
+             * @return true if event is accepted or false otherwise
+             * @throws std::runtime_error if specified nSigmaZ is > 2 
+             */
+            template <HADES::Target::Setup T>
+            bool SelectEvent(const EventCuts &cuts)
+            {
+                return SelectEvent<T>(cuts.centIndex,cuts.nSigmaX,cuts.nSigmaY,cuts.nSigmaZ);
+            }
             /**
              * @brief Returns the unique event ID
              * 
-             * @return std::string 
+             * @return EventIdentifier 
              */
-            [[nodiscard]] std::string GetID() const noexcept
+            [[nodiscard]] EventIdentifier GetID() const noexcept
             {
                 return EventId;
             }
@@ -166,14 +201,23 @@ namespace Selection
                 return ChargedTracks;
             }
             /**
-             * @brief Get the list of tracks assigned th this EventCandidate
+             * @brief Get the list of handles to the tracks assigned th this EventCandidate
              * 
-             * @return std::vector<TrackCandidate> 
+             * @return const std::vector<TrackHandle>& 
              */
-            [[nodiscard]] std::vector<std::shared_ptr<TrackCandidate> > GetTrackList() const noexcept
+            [[nodiscard]] const std::vector<TrackHandle>& GetTrackList() const noexcept
             {
                 return trackList;
             }
+            /**
+             * @brief Get the columnar store holding the tracks assigned to this EventCandidate
+             * 
+             * @return const TrackStore& 
+             */
+            [[nodiscard]] const TrackStore& GetTrackStore() const noexcept
+            {
+                return *trackStore;
+            }
             /**
              * @brief Get the size of the list of tracks assigned th this EventCandidate
              * 
@@ -229,18 +273,27 @@ namespace Selection
                 if (trackList.empty())
                     return 0.;
                 
-                double avgPt = 0.;
-                std::for_each(trackList.begin(),trackList.end(),[&avgPt](const std::shared_ptr<TrackCandidate> &track){avgPt += track->GetPt();});
-                return  avgPt / trackList.size();
+                const float *ptColumn = trackStore->GetPtColumn();
+                return std::accumulate(ptColumn,ptColumn + trackStore->size(),0.) / trackList.size();
+            }
+            /**
+             * @brief Add new TrackCandidate to this EventCandidate. The track is copied into the columnar TrackStore of this event.
+             * 
+             * @param trck 
+             */
+            void AddTrack(const TrackCandidate &trck)
+            {
+                trackList.push_back(trackStore->GetHandle(trackStore->Add(trck)));
             }
             /**
-             * @brief Add new TrackCandidate to this EventCandidate
+             * @brief Add new TrackCandidate to this EventCandidate together with the cut variations which accept it
              * 
              * @param trck 
+             * @param mask variations which accept both the track and this event
              */
-            void AddTrack(const std::shared_ptr<TrackCandidate> &trck)
+            void AddTrack(const TrackCandidate &trck, VariationMask mask)
             {
-                trackList.push_back(trck);
+                trackList.push_back(trackStore->GetHandle(trackStore->Add(trck,mask)));
             }
     };
 } // namespace Selection
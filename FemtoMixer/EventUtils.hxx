@@ -16,6 +16,7 @@
 
     #include "EventCandidate.hxx"
     #include "JJUtils.hxx"
+    #include "MixingGroups.hxx"
 
     namespace Mixing
     {
@@ -26,25 +27,35 @@
         class EventGrouping
         {
             private:
+                static constexpr GroupId m_plateStride = 100; // keeps the decimal digits of the ID equal to the old "MMPP" string
 
             public:
                 /**
                  * @brief Calculates and returns group ID to which the EventCandidate object is assigned to
                  * 
                  * @param evt pointer to the EventCandidate
-                 * @return group ID
+                 * @return group ID, equal to (number of charged tracks / 10) * 100 + target plate
                  */
-                [[nodiscard]] std::string GetEventIndex(const std::shared_ptr<Selection::EventCandidate> &evt) const noexcept
+                [[nodiscard]] GroupId GetEventIndex(const std::shared_ptr<Selection::EventCandidate> &evt) const noexcept
                 {
-                    return JJUtils::to_fixed_size_string(static_cast<std::size_t>(evt->GetNCharged()/10),2) + 
-                		JJUtils::to_fixed_size_string(static_cast<std::size_t>(evt->GetPlate()),2);
+                    return static_cast<GroupId>(evt->GetNCharged()/10) * m_plateStride + static_cast<GroupId>(evt->GetPlate());
+                }
+                /**
+                 * @brief Get the human-readable name of the event group (multiplicity class and target plate with leading zeros). Meant to be used only when writing the output
+                 * 
+                 * @param group group ID
+                 * @return group name
+                 */
+                [[nodiscard]] std::string GetGroupName(GroupId group) const
+                {
+                    return JJUtils::to_fixed_size_string(group / m_plateStride,2) + JJUtils::to_fixed_size_string(group % m_plateStride,2);
                 }
                 /**
                  * @brief Creates a wrapper for GetEventIndex
                  * 
                  * @return std::function
                  */
-                [[nodiscard]] std::function<std::string (const std::shared_ptr<Selection::EventCandidate> &)> MakeEventGroupingFunction() const noexcept
+                [[nodiscard]] std::function<GroupId (const std::shared_ptr<Selection::EventCandidate> &)> MakeEventGroupingFunction() const noexcept
                 {
                     return [this](const std::shared_ptr<Selection::EventCandidate> &evt){return this->GetEventIndex(evt);};
                 }
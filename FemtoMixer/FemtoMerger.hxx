@@ -1,156 +1,343 @@
+/**
+ * @file FemtoMerger.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Streaming merge of the per-group correlation function histograms into their projections. The histograms are read from the file one at a time and added to the projection targets, so the memory does not grow with the number of pair groups
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
 #ifndef FemtoMerger_hxx
     #define FemtoMerger_hxx
 
-    #include <vector>
-    #include <string>
+    #include <algorithm>
+    #include <array>
+    #include <atomic>
+    #include <cstddef>
+    #include <exception>
     #include <iostream>
+    #include <memory>
+    #include <mutex>
+    #include <stdexcept>
+    #include <string>
+    #include <thread>
+    #include <utility>
+    #include <vector>
+
+    #include "TDirectory.h"
     #include "TFile.h"
+    #include "TROOT.h"
+
+    #include "JJUtils.hxx"
+    #include "MixingGroups.hxx"
 
     namespace Mixing
     {
-        enum class Differenciate{No,Yes};
-
-        struct Extent
-        {
-            std::string extension;
-            std::vector<std::string> elements;
-            Differenciate diff;
-        };
-        struct Histogram
+        /**
+         * @brief Settings of FemtoMerger
+         *
+         */
+        struct MergeSettings
         {
-            std::string nameSignature;
-            std::vector<Extent> extents;
+            // prefixes of the merged histograms, the input histograms are by default named <prefix>_<group name> (see Mixing::Binning::GetGroupName), e.g. hQinvSign_0103
+            std::vector<std::string> prefixes = {"hQinvSign","hQinvBckg"};
+            // if not empty, the input histograms of the i-th prefix are named <inputPrefixes[i]><bin on each axis> instead (e.g. hQinvSign_ for the files of the old macros)
+            std::vector<std::string> inputPrefixes;
+            // minimal number of digits of each bin in the input names, 1 gives the names without leading zeros (e.g. hQoslSign_1234 for the bins 12, 3 and 4)
+            std::size_t inputIndexWidth = 2;
+            // highest bin merged on each axis (a missing entry or 0 means all bins), groups above it are skipped
+            std::vector<std::size_t> maxBins;
+            // write also every input histogram, renamed to <prefix><label><bin> for all axes (e.g. hQinvSignKt1Y3)
+            bool writeDifferential = true;
+            // number of projections merged at the same time, each thread reads the input file on its own
+            std::size_t nThreads = 1;
         };
-        namespace Detail
-        {
-            template <typename T>
-            struct HistogramHandler
-            {
-                Histogram histogram;
-                std::vector<std::pair<std::string,T*> > allHistograms;
-            };
-        }
-        
-        template <typename T>
+
+        /**
+         * @brief Merges the histograms of all pair groups of a binning into the projections on each axis (the other axes integrated, e.g. hQinvSignKt1 is the sum over all rapidity bins of the first kT bin) and into the fully integrated histogram (e.g. hQinvSignInteg). Every (prefix, axis) pair is a separate task which reads the inputs one by one and adds them to its targets, the targets are written and released as soon as the task ends. One thread holds at most one input and the targets of one axis, so the memory is bounded by nThreads * (max(binsPerAxis) + 1) histograms, at the cost of reading every input once per axis
+         *
+         * @tparam T histogram type (TH1D, TH3D)
+         * @tparam PairBinning Mixing::Binning used to group the pairs in the analysis
+         */
+        template <typename T, typename PairBinning>
         class FemtoMerger
         {
+            public:
+                static constexpr std::size_t nAxes = PairBinning::nAxes;
+
             private:
-                std::string m_filePath;
-                std::vector<Detail::HistogramHandler<T> > m_tasks;
+                struct Task
+                {
+                    std::size_t prefix;
+                    std::size_t axis;
+                };
+
+                std::string m_inputFile;
+                MergeSettings m_settings;
+                std::unique_ptr<TFile> m_output;
+                std::mutex m_outputMutex;
+                std::atomic<std::size_t> m_nRead = 0;
+                std::atomic<std::size_t> m_nWritten = 0;
 
-                std::vector<std::string> CreateCombinations(const Histogram &hist)
+                template <std::size_t... I>
+                [[nodiscard]] static constexpr std::array<const char *,nAxes> MakeLabels(std::index_sequence<I...>) noexcept
                 {
-                    std::vector<std::string> allNames = {""};
-                    for (const auto &extent : hist.extents)
+                    return {PairBinning::template Axis<I>::label...};
+                }
+                static constexpr std::array<const char *,nAxes> axisLabels = MakeLabels(std::make_index_sequence<nAxes>{});
+
+                /**
+                 * @brief Write the histogram to the output file. The only place where the threads meet
+                 *
+                 * @param hist
+                 */
+                void Store(T &hist)
+                {
+                    std::lock_guard<std::mutex> lock(m_outputMutex);
+                    TDirectory::TContext context(m_output.get());
+                    hist.Write();
+                    ++m_nWritten;
+                }
+                /**
+                 * @brief Read the input histograms of the prefix one at a time and add them to the projection on the axis. The task of the first axis also writes the renamed inputs (if requested) and the fully integrated histogram, which is the sum of its targets
+                 *
+                 * @param input input file opened by the thread
+                 * @param task
+                 */
+                void RunTask(TFile &input, const Task &task)
+                {
+                    const std::string &prefix = m_settings.prefixes.at(task.prefix);
+                    const bool isFirstAxis = (task.axis == 0);
+                    std::vector<std::unique_ptr<T> > targets(PairBinning::binsPerAxis[task.axis]);
+
+                    for (std::size_t group = 1; group <= PairBinning::nBins; ++group)
                     {
-                        std::vector<std::string> names;
-                        for (const auto &name : allNames)
+                        const auto bins = PairBinning::GetBins(static_cast<GroupId>(group));
+                        if (!IsMerged(bins))
+                            continue;
+
+                        std::unique_ptr<T> hist(input.Get<T>(GetInputName(task.prefix,bins).c_str()));
+                        if (hist == nullptr) // groups without any pairs may be missing
+                            continue;
+
+                        hist->SetDirectory(nullptr);
+                        ++m_nRead;
+
+                        if (isFirstAxis && m_settings.writeDifferential)
+                        {
+                            hist->SetName(GetDifferentialName(prefix,bins).c_str());
+                            Store(*hist);
+                        }
+
+                        std::unique_ptr<T> &target = targets[bins[task.axis] - 1];
+                        if (target == nullptr)
+                        {
+                            // the first input becomes the target, no copy is made
+                            target = std::move(hist);
+                            target->SetName(GetProjectionName(prefix,task.axis,bins[task.axis]).c_str());
+                            if (target->GetSumw2N() == 0)
+                                target->Sumw2();
+                        }
+                        else
                         {
-                            for (const auto &element : extent.elements)
-                            {
-                                names.push_back(name + element);
-                            }
+                            target->Add(hist.get());
                         }
-                        allNames = names;
                     }
 
-                    for (const auto &name : allNames)
-                        std::cout << name << "\t";
+                    std::unique_ptr<T> integrated;
+                    for (auto &target : targets)
+                    {
+                        if (target == nullptr)
+                            continue;
 
-                    std::cout << "\n";
-                    return allNames;
-                }
-                std::vector<std::pair<std::string,T*> > ReadData(const std::string &filePath, const Histogram &hist, const std::vector<std::string> &histExtents)
-                {
-                    std::vector<std::pair<std::string,T*> > allHistos;
-                    TFile inpFile(filePath.c_str());
+                        Store(*target);
+                        if (!isFirstAxis)
+                            continue;
 
-                    for (const auto &extent : histExtents)
-                    {
-                        allHistos.push_back(std::make_pair(extent,inpFile.Get<T>((hist.nameSignature + extent).c_str())));
+                        if (integrated == nullptr)
+                        {
+                            integrated = std::move(target);
+                            integrated->SetName((prefix + "Integ").c_str());
+                        }
+                        else
+                        {
+                            integrated->Add(target.get());
+                        }
+                        target.reset();
                     }
 
-                    for (auto hist : allHistos)
-                        std::cout << hist.second->GetName() << "\t";
+                    if (integrated != nullptr)
+                        Store(*integrated);
+                }
 
-                    std::cout << "\n";
-                    return allHistos;
+                /**
+                 * @brief Check if the group is below the highest merged bin on all axes
+                 *
+                 * @param bins bin on each axis (counting from 1)
+                 * @return true if the group is merged
+                 */
+                [[nodiscard]] bool IsMerged(const std::array<std::size_t,nAxes> &bins) const noexcept
+                {
+                    for (std::size_t axis = 0; axis < nAxes && axis < m_settings.maxBins.size(); ++axis)
+                        if (m_settings.maxBins[axis] > 0 && bins[axis] > m_settings.maxBins[axis])
+                            return false;
+
+                    return true;
                 }
 
             public:
-                FemtoMerger(const std::string &filePath, const std::vector<Histogram> &histograms) : m_filePath(filePath)
+                /**
+                 * @brief Construct a new FemtoMerger object, the output file is created here
+                 *
+                 * @param inputFile file with the histograms of the pair groups
+                 * @param outputFile file to which the merged histograms are written
+                 * @param settings
+                 */
+                FemtoMerger(const std::string &inputFile, const std::string &outputFile, const MergeSettings &settings = {}) : m_inputFile(inputFile), m_settings(settings)
                 {
-                    for (const auto &hist : histograms)
-                    {
-                        m_tasks.push_back({hist,ReadData(filePath,hist,CreateCombinations(hist))});
-                    }
+                    if (m_settings.prefixes.empty())
+                        throw std::invalid_argument("FemtoMerger: no histogram prefixes given");
+                    if (!m_settings.inputPrefixes.empty() && m_settings.inputPrefixes.size() != m_settings.prefixes.size())
+                        throw std::invalid_argument("FemtoMerger: the number of input prefixes differs from the number of prefixes");
+
+                    TDirectory::TContext context; // TFile::Open changes the current directory
+                    m_output.reset(TFile::Open(outputFile.c_str(),"RECREATE"));
+                    if (m_output == nullptr || m_output->IsZombie())
+                        throw std::runtime_error("FemtoMerger: cannot create " + outputFile);
+                }
+                FemtoMerger(const FemtoMerger &) = delete;
+                FemtoMerger &operator=(const FemtoMerger &) = delete;
+                ~FemtoMerger()
+                {
+                    if (m_output != nullptr)
+                        m_output->Close();
+                }
+                /**
+                 * @brief Get the name of the projection on the axis, e.g. hQinvSignKt3
+                 *
+                 * @param prefix
+                 * @param axis axis index
+                 * @param bin bin on the axis (counting from 1)
+                 * @return std::string
+                 */
+                [[nodiscard]] static std::string GetProjectionName(const std::string &prefix, std::size_t axis, std::size_t bin)
+                {
+                    return prefix + axisLabels[axis] + std::to_string(bin);
                 }
+                /**
+                 * @brief Get the name under which the histogram of a single pair group is read from the input file (see MergeSettings), e.g. hQinvSign_0301
+                 *
+                 * @param prefix index of the prefix
+                 * @param bins bin on each axis (counting from 1)
+                 * @return std::string
+                 */
+                [[nodiscard]] std::string GetInputName(std::size_t prefix, const std::array<std::size_t,nAxes> &bins) const
+                {
+                    std::string name = m_settings.inputPrefixes.empty() ? m_settings.prefixes.at(prefix) + "_" : m_settings.inputPrefixes.at(prefix);
+                    for (const std::size_t bin : bins)
+                        name += JJUtils::to_fixed_size_string(bin,m_settings.inputIndexWidth);
 
-                std::vector<T*> MergeHistograms()
+                    return name;
+                }
+                /**
+                 * @brief Get the name of the histogram of a single pair group, e.g. hQinvSignKt3Y1
+                 *
+                 * @param prefix
+                 * @param bins bin on each axis (counting from 1)
+                 * @return std::string
+                 */
+                [[nodiscard]] static std::string GetDifferentialName(const std::string &prefix, const std::array<std::size_t,nAxes> &bins)
                 {
-                    std::vector<T*> mergedHistograms;
-                    for (const auto &task : m_tasks)
+                    std::string name = prefix;
+                    for (std::size_t axis = 0; axis < nAxes; ++axis)
+                        name += axisLabels[axis] + std::to_string(bins[axis]);
+
+                    return name;
+                }
+                /**
+                 * @brief Merge all prefixes and write the results. Exceptions thrown by the threads are rethrown here
+                 *
+                 */
+                void Merge()
+                {
+                    {
+                        // fail before starting the threads if the input cannot be read at all
+                        std::unique_ptr<TFile> input(TFile::Open(m_inputFile.c_str(),"READ"));
+                        if (input == nullptr || input->IsZombie())
+                            throw std::runtime_error("FemtoMerger: cannot open " + m_inputFile);
+                    }
+
+                    std::vector<Task> tasks;
+                    for (std::size_t prefix = 0; prefix < m_settings.prefixes.size(); ++prefix)
+                        for (std::size_t axis = 0; axis < nAxes; ++axis)
+                            tasks.push_back({prefix,axis});
+
+                    const std::size_t nThreads = std::clamp<std::size_t>(m_settings.nThreads,1,tasks.size());
+                    if (nThreads > 1)
+                        ROOT::EnableThreadSafety();
+
+                    std::atomic<std::size_t> nextTask = 0;
+                    std::exception_ptr error;
+                    std::mutex errorMutex;
+                    auto worker = [&]()
                     {
-                        for (std::size_t i = 0; i < task.histogram.extents.size(); ++i)
+                        try
                         {
-                            if (task.histogram.extents.at(i).diff == Differenciate::Yes)
-                            {
-                                std::vector<T*> histograms;
-                                for (std::size_t j = 0; j < task.histogram.extents.at(i).elements.size(); ++j)
-                                {
-                                    std::vector<std::pair<std::string,T*> > histSubset;
-                                    std::copy_if(m_tasks.at(i).allHistograms.begin(),
-                                        m_tasks.at(i).allHistograms.end(),std::back_inserter(histSubset),
-                                        [&](const std::pair<std::string,T*> &elem)
-                                        {
-                                            return (elem.first.at(i) == task.histogram.extents.at(i).elements.at(j));
-                                        });
-
-                                    T *tmpHist = nullptr;
-                                    for (const auto &[name,hist] : histSubset)
-                                    {
-                                        if (hist != nullptr)
-                                        {
-                                            if (tmpHist == nullptr)
-                                            {
-                                                tmpHist = hist;
-                                                tmpHist->SetName((task.histogram.nameSignature + task.histogram.extents.at(i).extension + std::to_string(j)).c_str());
-                                            }
-                                            else
-                                            {
-                                                tmpHist->Add(hist);
-                                            }
-                                        }
-                                    }
-                                    histograms.push_back(tmpHist);
-                                }
-
-                                std::move(histograms.begin(),histograms.end(),std::back_inserter(mergedHistograms));
-                            }
-                        }
+                            TDirectory::TContext context;
+                            std::unique_ptr<TFile> input(TFile::Open(m_inputFile.c_str(),"READ"));
+                            if (input == nullptr || input->IsZombie())
+                                throw std::runtime_error("FemtoMerger: cannot open " + m_inputFile);
 
-                        T *histInteg = nullptr;
-                        for (const auto &[name,hist] : task.allHistograms)
+                            for (std::size_t task = nextTask++; task < tasks.size(); task = nextTask++)
+                                RunTask(*input,tasks[task]);
+                        }
+                        catch (...)
                         {
-                            if (hist != nullptr)
-                            {
-                                if (histInteg == nullptr)
-                                {
-                                    histInteg = hist;
-                                    histInteg->SetName((task.histogram.nameSignature + "Integ").c_str());
-                                }
-                                else
-                                {
-                                    histInteg->Add(hist);
-                                }
-                            }
+                            std::lock_guard<std::mutex> lock(errorMutex);
+                            if (error == nullptr)
+                                error = std::current_exception();
+                            nextTask = tasks.size(); // the other threads stop after their current task
                         }
-                        mergedHistograms.push_back(histInteg);
-                    }
+                    };
+
+                    std::vector<std::thread> threads;
+                    for (std::size_t thread = 1; thread < nThreads; ++thread)
+                        threads.emplace_back(worker);
+                    worker();
+                    for (auto &thread : threads)
+                        thread.join();
+
+                    if (error != nullptr)
+                        std::rethrow_exception(error);
 
-                    return mergedHistograms;
-                } // this is way too much nesting, but for now this will stay like that :/
+                    m_output->Close();
+                    m_output.reset();
+                }
+                /**
+                 * @brief Get the number of input histograms read (every input is read once per axis)
+                 *
+                 * @return std::size_t
+                 */
+                [[nodiscard]] std::size_t GetNRead() const noexcept {return m_nRead;}
+                /**
+                 * @brief Get the number of histograms written to the output
+                 *
+                 * @return std::size_t
+                 */
+                [[nodiscard]] std::size_t GetNWritten() const noexcept {return m_nWritten;}
+                /**
+                 * @brief Print the summary of the merge
+                 *
+                 */
+                void Print() const
+                {
+                    std::cout << "---=== Histogram merging ===---\n";
+                    std::cout << "input file: " << m_inputFile << "\n";
+                    std::cout << "input histograms read: " << m_nRead << " (" << m_settings.prefixes.size() << " prefixes x " << nAxes << " axes)\n";
+                    std::cout << "histograms written: " << m_nWritten << "\n" << std::endl;
+                }
         };
     } // namespace Mixing
-    
-#endif
\ No newline at end of file
+
+#endif
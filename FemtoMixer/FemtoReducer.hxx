@@ -0,0 +1,554 @@
+/**
+ * @file FemtoReducer.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Combines the output files of the farm jobs (replacement for hadd). The files are merged as a tree: every task merges a few files into an intermediate file, the tasks of one level run in parallel. Only one histogram per task is kept in memory, empty histograms are neither added nor written, and the pair counts of every file are checked against hCounter
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef FemtoReducer_hxx
+    #define FemtoReducer_hxx
+
+    #include <algorithm>
+    #include <atomic>
+    #include <cmath>
+    #include <cstddef>
+    #include <exception>
+    #include <fstream>
+    #include <iostream>
+    #include <iterator>
+    #include <memory>
+    #include <mutex>
+    #include <sstream>
+    #include <stdexcept>
+    #include <string>
+    #include <thread>
+    #include <unordered_set>
+    #include <vector>
+
+    #include "TClass.h"
+    #include "TDirectory.h"
+    #include "TFile.h"
+    #include "TH1.h"
+    #include "TKey.h"
+    #include "TList.h"
+    #include "TObjString.h"
+    #include "TROOT.h"
+    #include "TRegexp.h"
+    #include "TString.h"
+    #include "TSystem.h"
+
+    namespace Mixing
+    {
+        /**
+         * @brief Settings of FemtoReducer
+         *
+         */
+        struct ReduceSettings
+        {
+            std::size_t nThreads = 1;
+            std::size_t fanIn = 8; // maximal number of files merged by one task of the reduction tree
+            int compression = 505; // ROOT compression setting of the output (algorithm * 100 + level)
+            int partialCompression = 404; // compression of the intermediate files, LZ4 is fast to write and to read back
+            std::string counterName = "hCounter";
+            // histograms of the signal pairs, named <prefix><group name> (see Mixing::Binning::GetGroupName), their entries are compared with hCounter
+            std::vector<std::string> signalPrefixes = {"hQinvSign_","hQoslSign_"};
+        };
+
+        /**
+         * @brief Number of signal pairs of a file, according to hCounter and to the entries of the signal histograms. The signal pairs are filled with weight 1 into the group of the pair (including the out-of-range and the rejected group), so both numbers have to agree
+         *
+         */
+        struct PairCount
+        {
+            std::string file;
+            // bins "All Pairs" and "Selected Pairs" of hCounter, negative if the file has no such counter
+            double counterAll = -1., counterSelected = -1.;
+            // entries of the histograms of each signal prefix, summed over all groups and over the groups inside the binning
+            std::vector<double> histogramAll, histogramSelected;
+            std::vector<bool> hasHistograms;
+
+            /**
+             * @brief Tells if the counts can be compared, i.e. the file has hCounter with the pair bins
+             *
+             * @return true
+             * @return false
+             */
+            [[nodiscard]] bool IsVerifiable() const noexcept {return counterAll >= 0. && counterSelected >= 0.;}
+            /**
+             * @brief Check if the entries of every signal histogram type agree with hCounter (files which cannot be verified are consistent)
+             *
+             * @return true
+             * @return false
+             */
+            [[nodiscard]] bool IsConsistent() const noexcept
+            {
+                if (!IsVerifiable())
+                    return true;
+
+                for (std::size_t prefix = 0; prefix < hasHistograms.size(); ++prefix)
+                    if (hasHistograms[prefix] && (std::abs(histogramAll[prefix] - counterAll) > 0.5 || std::abs(histogramSelected[prefix] - counterSelected) > 0.5))
+                        return false;
+
+                return true;
+            }
+        };
+
+        /**
+         * @brief Merges the outputs of the analysis jobs into one file. The merged input files are stored in the output, so the reduction can be repeated while the jobs are finishing: only the new files are merged, together with the previous output. The output is replaced only when the whole reduction succeeded
+         *
+         */
+        class FemtoReducer
+        {
+            private:
+                static constexpr const char *m_inputListName = "femtoReducerInputs";
+
+                std::string m_outputFile;
+                ReduceSettings m_settings;
+                std::vector<std::string> m_inputs;
+                std::vector<std::string> m_unreadable;
+                std::vector<PairCount> m_inputCounts;
+                PairCount m_outputCount;
+                std::size_t m_nLevels = 0;
+                std::atomic<std::size_t> m_nWritten = 0;
+                std::atomic<std::size_t> m_nEmpty = 0;
+                bool m_hasPreviousOutput = false;
+
+                [[nodiscard]] PairCount MakeCount(const std::string &file) const
+                {
+                    PairCount count;
+                    count.file = file;
+                    count.histogramAll.assign(m_settings.signalPrefixes.size(),0.);
+                    count.histogramSelected.assign(m_settings.signalPrefixes.size(),0.);
+                    count.hasHistograms.assign(m_settings.signalPrefixes.size(),false);
+                    return count;
+                }
+                /**
+                 * @brief Add the histogram to the pair count if it is hCounter or one of the signal histograms
+                 *
+                 * @param count
+                 * @param name
+                 * @param hist
+                 */
+                void Count(PairCount &count, const std::string &name, TH1 &hist) const
+                {
+                    if (name == m_settings.counterName)
+                    {
+                        const int allBin = hist.GetXaxis()->FindFixBin("All Pairs");
+                        const int selectedBin = hist.GetXaxis()->FindFixBin("Selected Pairs");
+                        if (allBin > 0 && selectedBin > 0)
+                        {
+                            count.counterAll = hist.GetBinContent(allBin);
+                            count.counterSelected = hist.GetBinContent(selectedBin);
+                        }
+                        return;
+                    }
+
+                    for (std::size_t prefix = 0; prefix < m_settings.signalPrefixes.size(); ++prefix)
+                    {
+                        const std::string &signalPrefix = m_settings.signalPrefixes[prefix];
+                        if (name.compare(0,signalPrefix.size(),signalPrefix) != 0)
+                            continue;
+
+                        // "0" is the out-of-range and "bad" the rejected group, all other groups are inside the binning
+                        const std::string group = name.substr(signalPrefix.size());
+                        count.hasHistograms[prefix] = true;
+                        count.histogramAll[prefix] += hist.GetEntries();
+                        if (group != "0" && group != "bad")
+                            count.histogramSelected[prefix] += hist.GetEntries();
+                    }
+                }
+                /**
+                 * @brief Get the names of all histograms in the files, in the order of their first appearance. Other objects are skipped
+                 *
+                 * @param files
+                 * @return std::vector<std::string>
+                 */
+                [[nodiscard]] static std::vector<std::string> GetHistogramNames(const std::vector<std::unique_ptr<TFile> > &files)
+                {
+                    std::vector<std::string> names;
+                    std::unordered_set<std::string> known;
+                    for (const auto &file : files)
+                    {
+                        TIter next(file->GetListOfKeys());
+                        while (TKey *key = static_cast<TKey *>(next()))
+                        {
+                            const TClass *keyClass = TClass::GetClass(key->GetClassName());
+                            if (keyClass == nullptr || !keyClass->InheritsFrom(TH1::Class()))
+                                continue;
+                            if (known.insert(key->GetName()).second) // a key can be stored in several cycles
+                                names.emplace_back(key->GetName());
+                        }
+                    }
+
+                    return names;
+                }
+                /**
+                 * @brief Merge the files into a new one, one histogram name at a time: all versions of the histogram are read one by one and added to the first non-empty one, which is then written and released
+                 *
+                 * @param inputs files to merge
+                 * @param output file to create
+                 * @param compression
+                 * @param inputCounts if not null, the pair counts of the inputs are stored here
+                 * @param mergedInputs list of the merged job outputs, written to the output if not empty
+                 * @return pair count of the output
+                 */
+                PairCount MergeFiles(const std::vector<std::string> &inputs, const std::string &output, int compression, std::vector<PairCount> *inputCounts, const std::string &mergedInputs = "")
+                {
+                    TDirectory::TContext context; // TFile::Open changes the current directory
+                    std::vector<std::unique_ptr<TFile> > files;
+                    for (const auto &input : inputs)
+                    {
+                        files.emplace_back(TFile::Open(input.c_str(),"READ"));
+                        if (files.back() == nullptr || files.back()->IsZombie())
+                            throw std::runtime_error("FemtoReducer: cannot open " + input);
+                    }
+
+                    std::unique_ptr<TFile> outFile(TFile::Open(output.c_str(),"RECREATE","",compression));
+                    if (outFile == nullptr || outFile->IsZombie())
+                        throw std::runtime_error("FemtoReducer: cannot create " + output);
+
+                    std::vector<PairCount> counts;
+                    for (const auto &input : inputs)
+                        counts.push_back(MakeCount(input));
+                    PairCount outputCount = MakeCount(output);
+
+                    for (const auto &name : GetHistogramNames(files))
+                    {
+                        std::unique_ptr<TH1> target;
+                        for (std::size_t file = 0; file < files.size(); ++file)
+                        {
+                            std::unique_ptr<TH1> hist(files[file]->Get<TH1>(name.c_str()));
+                            if (hist == nullptr)
+                                continue;
+
+                            hist->SetDirectory(nullptr);
+                            Count(counts[file],name,*hist);
+                            if (hist->GetEntries() == 0.) // nothing to add, e.g. a pair group without any pairs
+                                continue;
+
+                            if (target == nullptr)
+                                target = std::move(hist);
+                            else
+                                target->Add(hist.get());
+                        }
+
+                        if (target == nullptr)
+                        {
+                            ++m_nEmpty;
+                            continue;
+                        }
+
+                        Count(outputCount,name,*target);
+                        outFile->cd();
+                        target->Write();
+                        ++m_nWritten;
+                    }
+
+                    if (!mergedInputs.empty())
+                    {
+                        outFile->cd();
+                        TObjString(mergedInputs.c_str()).Write(m_inputListName);
+                    }
+                    outFile->Close();
+
+                    if (inputCounts != nullptr)
+                        *inputCounts = std::move(counts);
+
+                    return outputCount;
+                }
+                /**
+                 * @brief Run the tasks on the threads, exceptions thrown by the tasks are rethrown here
+                 *
+                 * @tparam Task
+                 * @param nTasks
+                 * @param task callable taking the task index
+                 */
+                template <typename Task>
+                void RunTasks(std::size_t nTasks, Task &&task) const
+                {
+                    std::atomic<std::size_t> nextTask = 0;
+                    std::exception_ptr error;
+                    std::mutex errorMutex;
+                    auto worker = [&]()
+                    {
+                        try
+                        {
+                            for (std::size_t index = nextTask++; index < nTasks; index = nextTask++)
+                                task(index);
+                        }
+                        catch (...)
+                        {
+                            std::lock_guard<std::mutex> lock(errorMutex);
+                            if (error == nullptr)
+                                error = std::current_exception();
+                            nextTask = nTasks;
+                        }
+                    };
+
+                    const std::size_t nThreads = std::clamp<std::size_t>(m_settings.nThreads,1,std::max<std::size_t>(nTasks,1));
+                    std::vector<std::thread> threads;
+                    for (std::size_t thread = 1; thread < nThreads; ++thread)
+                        threads.emplace_back(worker);
+                    worker();
+                    for (auto &thread : threads)
+                        thread.join();
+
+                    if (error != nullptr)
+                        std::rethrow_exception(error);
+                }
+
+            public:
+                /**
+                 * @brief Construct a new FemtoReducer object
+                 *
+                 * @param outputFile merged output, if it exists it has to be created by FemtoReducer and its inputs are not merged again
+                 * @param settings
+                 */
+                explicit FemtoReducer(const std::string &outputFile, const ReduceSettings &settings = {}) : m_outputFile(outputFile), m_settings(settings)
+                {
+                    if (m_settings.fanIn < 2)
+                        throw std::invalid_argument("FemtoReducer: at least two files have to be merged by one task");
+                }
+                /**
+                 * @brief Get the list of files from a file list (one file per line, *.list or *.txt) or from a wildcard (e.g. /lustre/.../apr12ana_all_*.root)
+                 *
+                 * @param inputs
+                 * @return std::vector<std::string> sorted file names
+                 */
+                [[nodiscard]] static std::vector<std::string> ExpandInputs(const std::string &inputs)
+                {
+                    std::vector<std::string> files;
+                    const TString pattern(inputs.c_str());
+                    if (pattern.EndsWith(".list") || pattern.EndsWith(".txt"))
+                    {
+                        std::ifstream list(inputs);
+                        std::string line;
+                        while (std::getline(list,line))
+                            if (!line.empty() && line.front() != '#')
+                                files.push_back(line);
+
+                        return files;
+                    }
+                    if (!pattern.MaybeWildcard())
+                        return {inputs};
+
+                    const TString directory = gSystem->GetDirName(pattern);
+                    const TRegexp wildcard(gSystem->BaseName(pattern),kTRUE);
+                    void *dir = gSystem->OpenDirectory(directory);
+                    if (dir == nullptr)
+                        return files;
+
+                    while (const char *entry = gSystem->GetDirEntry(dir))
+                    {
+                        const TString name(entry);
+                        Ssiz_t length = 0;
+                        if (wildcard.Index(name,&length) == 0 && length == name.Length())
+                            files.push_back((directory + "/" + name).Data());
+                    }
+                    gSystem->FreeDirectory(dir);
+                    std::sort(files.begin(),files.end());
+
+                    return files;
+                }
+                /**
+                 * @brief Add a file to merge
+                 *
+                 * @param file
+                 */
+                void AddInput(const std::string &file) {m_inputs.push_back(file);}
+                /**
+                 * @brief Add the files from a file list or a wildcard (see ExpandInputs)
+                 *
+                 * @param inputs
+                 * @return number of added files
+                 */
+                std::size_t AddInputs(const std::string &inputs)
+                {
+                    const std::vector<std::string> files = ExpandInputs(inputs);
+                    m_inputs.insert(m_inputs.end(),files.begin(),files.end());
+                    return files.size();
+                }
+                /**
+                 * @brief Get the job outputs which are already merged into the output file
+                 *
+                 * @return std::vector<std::string>
+                 */
+                [[nodiscard]] std::vector<std::string> GetMergedInputs() const
+                {
+                    std::vector<std::string> merged;
+                    if (gSystem->AccessPathName(m_outputFile.c_str())) // sic, true if the file does not exist
+                        return merged;
+
+                    TDirectory::TContext context;
+                    std::unique_ptr<TFile> file(TFile::Open(m_outputFile.c_str(),"READ"));
+                    if (file == nullptr || file->IsZombie())
+                        throw std::runtime_error("FemtoReducer: cannot read " + m_outputFile);
+
+                    std::unique_ptr<TObjString> list(file->Get<TObjString>(m_inputListName));
+                    if (list == nullptr)
+                        throw std::runtime_error("FemtoReducer: " + m_outputFile + " exists, but was not created by FemtoReducer");
+
+                    std::istringstream stream(list->GetString().Data());
+                    std::string line;
+                    while (std::getline(stream,line))
+                        if (!line.empty())
+                            merged.push_back(line);
+
+                    return merged;
+                }
+                /**
+                 * @brief Merge the new inputs (and the previous output) into the output file
+                 *
+                 * @return true if the pair counts of all files agree with their hCounter
+                 * @return false otherwise
+                 */
+                bool Reduce()
+                {
+                    const std::vector<std::string> merged = GetMergedInputs();
+                    std::unordered_set<std::string> known(merged.begin(),merged.end());
+
+                    // the unreadable files are probably jobs which are still running (or crashed), they are merged in a later call
+                    std::vector<std::string> newInputs;
+                    m_unreadable.clear();
+                    for (const auto &input : m_inputs)
+                    {
+                        if (!known.insert(input).second)
+                            continue;
+
+                        TDirectory::TContext context;
+                        std::unique_ptr<TFile> file(TFile::Open(input.c_str(),"READ"));
+                        if (file == nullptr || file->IsZombie() || file->TestBit(TFile::kRecovered))
+                            m_unreadable.push_back(input);
+                        else
+                            newInputs.push_back(input);
+                    }
+
+                    m_inputCounts.clear();
+                    m_outputCount = MakeCount(m_outputFile);
+                    m_nLevels = 0;
+                    m_nWritten = 0;
+                    m_nEmpty = 0;
+                    m_hasPreviousOutput = !merged.empty();
+                    if (newInputs.empty())
+                        return true;
+
+                    std::string mergedInputs;
+                    for (const auto &input : merged)
+                        mergedInputs += input + "\n";
+                    for (const auto &input : newInputs)
+                        mergedInputs += input + "\n";
+
+                    std::vector<std::string> level = newInputs;
+                    if (m_hasPreviousOutput)
+                        level.insert(level.begin(),m_outputFile);
+
+                    if (m_settings.nThreads > 1)
+                        ROOT::EnableThreadSafety();
+
+                    const std::string temporaryOutput = m_outputFile + ".tmp";
+                    std::vector<std::string> partials;
+                    while (true)
+                    {
+                        // enough tasks to keep all threads busy, but not more than fanIn files per task
+                        const std::size_t nFiles = level.size();
+                        const std::size_t nTasks = (nFiles <= 2) ? 1 : std::max((nFiles + m_settings.fanIn - 1) / m_settings.fanIn,std::min(m_settings.nThreads,nFiles / 2));
+                        const bool isFirstLevel = (m_nLevels == 0);
+                        ++m_nLevels;
+
+                        if (nTasks == 1)
+                        {
+                            std::vector<PairCount> counts;
+                            m_outputCount = MergeFiles(level,temporaryOutput,m_settings.compression,isFirstLevel ? &counts : nullptr,mergedInputs);
+                            if (isFirstLevel)
+                                m_inputCounts = std::move(counts);
+                            break;
+                        }
+
+                        std::vector<std::string> nextLevel(nTasks);
+                        std::vector<std::vector<PairCount> > counts(nTasks);
+                        RunTasks(nTasks,[&](std::size_t task)
+                        {
+                            const std::vector<std::string> chunk(level.begin() + nFiles * task / nTasks,level.begin() + nFiles * (task + 1) / nTasks);
+                            nextLevel[task] = m_outputFile + ".level" + std::to_string(m_nLevels) + "_" + std::to_string(task);
+                            MergeFiles(chunk,nextLevel[task],m_settings.partialCompression,isFirstLevel ? &counts[task] : nullptr);
+                        });
+
+                        if (isFirstLevel)
+                            for (auto &taskCounts : counts)
+                                std::move(taskCounts.begin(),taskCounts.end(),std::back_inserter(m_inputCounts));
+
+                        for (const auto &partial : partials)
+                            gSystem->Unlink(partial.c_str());
+                        partials = nextLevel;
+                        level = std::move(nextLevel);
+                    }
+
+                    for (const auto &partial : partials)
+                        gSystem->Unlink(partial.c_str());
+                    if (gSystem->Rename(temporaryOutput.c_str(),m_outputFile.c_str()) != 0)
+                        throw std::runtime_error("FemtoReducer: cannot replace " + m_outputFile + " with " + temporaryOutput);
+                    m_outputCount.file = m_outputFile;
+
+                    return m_outputCount.IsConsistent() && std::all_of(m_inputCounts.begin(),m_inputCounts.end(),[](const PairCount &count){return count.IsConsistent();});
+                }
+                /**
+                 * @brief Get the pair counts of the merged files (the previous output included)
+                 *
+                 * @return const std::vector<PairCount>&
+                 */
+                [[nodiscard]] const std::vector<PairCount>& GetInputCounts() const noexcept {return m_inputCounts;}
+                /**
+                 * @brief Get the pair counts of the output
+                 *
+                 * @return const PairCount&
+                 */
+                [[nodiscard]] const PairCount& GetOutputCount() const noexcept {return m_outputCount;}
+                /**
+                 * @brief Get the files which could not be opened during the last reduction
+                 *
+                 * @return const std::vector<std::string>&
+                 */
+                [[nodiscard]] const std::vector<std::string>& GetUnreadableInputs() const noexcept {return m_unreadable;}
+                /**
+                 * @brief Print the summary of the last reduction
+                 *
+                 */
+                void Print() const
+                {
+                    std::cout << "---=== Femto reduction ===---\n";
+                    std::cout << "output file: " << m_outputFile << "\n";
+                    if (m_nLevels == 0)
+                        std::cout << "no new files to merge\n";
+                    else
+                        std::cout << "merged files: " << m_inputCounts.size() << (m_hasPreviousOutput ? " (including the previous output)" : "") << "\t reduction levels: " << m_nLevels << "\n";
+                    std::cout << "histograms written (all levels): " << m_nWritten << "\t empty histograms skipped: " << m_nEmpty << "\n";
+                    for (const auto &file : m_unreadable)
+                        std::cout << "not readable (skipped): " << file << "\n";
+
+                    std::size_t nUnverified = 0;
+                    for (const auto &count : m_inputCounts)
+                    {
+                        if (!count.IsVerifiable())
+                            ++nUnverified;
+                        else if (!count.IsConsistent())
+                            std::cout << "pair counts do not agree with " << m_settings.counterName << ": " << count.file << "\n";
+                    }
+                    if (nUnverified > 0)
+                        std::cout << "files without pair counters (not verified): " << nUnverified << "\n";
+
+                    if (m_outputCount.IsVerifiable())
+                    {
+                        std::cout << "pairs in " << m_settings.counterName << ": " << m_outputCount.counterAll << " (selected: " << m_outputCount.counterSelected << ")\n";
+                        for (std::size_t prefix = 0; prefix < m_settings.signalPrefixes.size(); ++prefix)
+                            if (m_outputCount.hasHistograms[prefix])
+                                std::cout << "pairs in " << m_settings.signalPrefixes[prefix] << "*: " << m_outputCount.histogramAll[prefix] << " (selected: " << m_outputCount.histogramSelected[prefix] << ")\n";
+                    }
+                    std::cout << std::endl;
+                }
+        };
+    } // namespace Mixing
+
+#endif
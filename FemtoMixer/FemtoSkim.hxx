@@ -0,0 +1,458 @@
+/**
+ * @file FemtoSkim.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Compact columnar file with the preselected events and tracks ("femto skim"). Written once from the DSTs, it allows to rerun the selection and mixing without HYDRA.
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef FemtoSkim_hxx
+    #define FemtoSkim_hxx
+
+    #include "EventCandidate.hxx"
+
+    #include <array>
+    #include <cstdint>
+    #include <iterator>
+    #include <memory>
+    #include <stdexcept>
+    #include <string>
+    #include <vector>
+
+    #include "TChain.h"
+    #include "TFile.h"
+    #include "TTree.h"
+
+    namespace Selection
+    {
+        /**
+         * @brief Columns of the femto skim holding the TrackCandidate fields. One entry of each vector per track, the wires and META hits are stored in fixed-size blocks (same layout as in TrackStore).
+         *
+         */
+        class SkimTrackColumns
+        {
+            public:
+                static constexpr std::size_t wireBlockSize = HADES::MDC::WireInfo::numberOfAllLayers * HADES::MDC::PackedLayersTrack::maxWiresPerLayer;
+                static constexpr std::size_t metaBlockSize = TrackStore::metaBlockSize;
+                static constexpr std::uint16_t emptySlot = TrackStore::emptySlot;
+
+            private:
+                // ROOT needs a persistent pointer to each vector when reading, hence the address member
+                template <typename T>
+                struct Column
+                {
+                    std::vector<T> values;
+                    std::vector<T> *address = &values;
+                };
+
+                struct FloatField
+                {
+                    const char *name;
+                    float TrackCandidate::*member;
+                };
+
+                static constexpr std::size_t nFloatFields = 17;
+                static constexpr std::array<FloatField,nFloatFields> floatFields
+                {{
+                    {"rapidity",&TrackCandidate::Rapidity},
+                    {"p",&TrackCandidate::TotalMomentum},
+                    {"pt",&TrackCandidate::TransverseMomentum},
+                    {"px",&TrackCandidate::Px},
+                    {"py",&TrackCandidate::Py},
+                    {"pz",&TrackCandidate::Pz},
+                    {"energy",&TrackCandidate::Energy},
+                    {"mass",&TrackCandidate::Mass},
+                    {"mass2",&TrackCandidate::Mass2},
+                    {"beta",&TrackCandidate::Beta},
+                    {"theta",&TrackCandidate::PolarAngle},
+                    {"phi",&TrackCandidate::AzimuthalAngle},
+                    {"phiWrtEP",&TrackCandidate::AzimuthalAngleWrtEP},
+                    {"innerSegChi2",&TrackCandidate::innerSegChi2},
+                    {"outerSegChi2",&TrackCandidate::outerSegChi2},
+                    {"metaMatchQuality",&TrackCandidate::metaMatchQuality},
+                    {"chi2",&TrackCandidate::chi2}
+                }};
+
+                // bits of the flags column
+                static constexpr std::uint8_t atMdcEdgeBit = 1u << 0;
+                static constexpr std::uint8_t goodMetaCellBit = 1u << 1;
+                static constexpr std::uint8_t tofBit = 1u << 2;
+
+                std::array<Column<float>,nFloatFields> m_floats;
+                Column<short> m_pid, m_charge, m_sector;
+                Column<std::uint8_t> m_flags;
+                Column<std::uint32_t> m_trackIndex, m_nBadLayers;
+                Column<std::uint16_t> m_goodLayers, m_wires, m_metaHits;
+
+            public:
+                SkimTrackColumns() {}
+                SkimTrackColumns(const SkimTrackColumns &) = delete;
+                SkimTrackColumns& operator=(const SkimTrackColumns &) = delete;
+                /**
+                 * @brief Create the branches of all columns
+                 *
+                 * @param tree output tree
+                 * @param prefix prefix of the branch names (e.g. to distinguish the HGeantKine tracks)
+                 */
+                void Branch(TTree *tree, const std::string &prefix)
+                {
+                    for (std::size_t i = 0; i < nFloatFields; ++i)
+                        tree->Branch((prefix + floatFields[i].name).data(),&m_floats[i].values);
+                    tree->Branch((prefix + "pid").data(),&m_pid.values);
+                    tree->Branch((prefix + "charge").data(),&m_charge.values);
+                    tree->Branch((prefix + "sector").data(),&m_sector.values);
+                    tree->Branch((prefix + "flags").data(),&m_flags.values);
+                    tree->Branch((prefix + "trackIndex").data(),&m_trackIndex.values);
+                    tree->Branch((prefix + "nBadLayers").data(),&m_nBadLayers.values);
+                    tree->Branch((prefix + "goodLayers").data(),&m_goodLayers.values);
+                    tree->Branch((prefix + "wires").data(),&m_wires.values);
+                    tree->Branch((prefix + "metaHits").data(),&m_metaHits.values);
+                }
+                /**
+                 * @brief Connect all columns to the branches of an existing tree
+                 *
+                 * @param tree input tree
+                 * @param prefix prefix of the branch names
+                 */
+                void SetBranchAddresses(TTree *tree, const std::string &prefix)
+                {
+                    for (std::size_t i = 0; i < nFloatFields; ++i)
+                        tree->SetBranchAddress((prefix + floatFields[i].name).data(),&m_floats[i].address);
+                    tree->SetBranchAddress((prefix + "pid").data(),&m_pid.address);
+                    tree->SetBranchAddress((prefix + "charge").data(),&m_charge.address);
+                    tree->SetBranchAddress((prefix + "sector").data(),&m_sector.address);
+                    tree->SetBranchAddress((prefix + "flags").data(),&m_flags.address);
+                    tree->SetBranchAddress((prefix + "trackIndex").data(),&m_trackIndex.address);
+                    tree->SetBranchAddress((prefix + "nBadLayers").data(),&m_nBadLayers.address);
+                    tree->SetBranchAddress((prefix + "goodLayers").data(),&m_goodLayers.address);
+                    tree->SetBranchAddress((prefix + "wires").data(),&m_wires.address);
+                    tree->SetBranchAddress((prefix + "metaHits").data(),&m_metaHits.address);
+                }
+                /**
+                 * @brief Remove all tracks
+                 *
+                 */
+                void Clear() noexcept
+                {
+                    for (auto &column : m_floats)
+                        column.values.clear();
+                    for (auto *column : {&m_pid.values, &m_charge.values, &m_sector.values})
+                        column->clear();
+                    for (auto *column : {&m_trackIndex.values, &m_nBadLayers.values})
+                        column->clear();
+                    for (auto *column : {&m_goodLayers.values, &m_wires.values, &m_metaHits.values})
+                        column->clear();
+                    m_flags.values.clear();
+                }
+                /**
+                 * @brief Append a track to the columns. The wires are stored in the packed layout, which is lossless, because the layers with more than two fired wires were already removed by the TrackCandidate
+                 *
+                 * @param track
+                 */
+                void Push(const TrackCandidate &track)
+                {
+                    for (std::size_t i = 0; i < nFloatFields; ++i)
+                        m_floats[i].values.push_back(track.*floatFields[i].member);
+                    m_pid.values.push_back(track.PID);
+                    m_charge.values.push_back(track.Charge);
+                    m_sector.values.push_back(track.Sector);
+                    m_flags.values.push_back((track.isAtMdcEdge ? atMdcEdgeBit : 0) | (track.isGoodMetaCell ? goodMetaCellBit : 0) | ((track.System == Detector::ToF) ? tofBit : 0));
+                    m_trackIndex.values.push_back(static_cast<std::uint32_t>(track.TrackIndex));
+                    m_nBadLayers.values.push_back(track.NBadLayers);
+                    m_goodLayers.values.insert(m_goodLayers.values.end(),track.goodLayers.begin(),track.goodLayers.end());
+
+                    const HADES::MDC::PackedLayersTrack packed(track.firedWiresCollection);
+                    for (const auto &layer : HADES::MDC::WireInfo::allLayerIndexing)
+                        for (std::size_t slot = 0; slot < HADES::MDC::PackedLayersTrack::maxWiresPerLayer; ++slot)
+                            m_wires.values.push_back(packed.GetWire(layer,slot));
+
+                    TrackStore::PackMetaHits(track.metaHits,std::back_inserter(m_metaHits.values));
+                }
+                /**
+                 * @brief Append an empty placeholder track (keeps the HGeantKine columns aligned with the reconstructed ones)
+                 *
+                 */
+                void PushEmpty()
+                {
+                    for (auto &column : m_floats)
+                        column.values.push_back(0.f);
+                    m_pid.values.push_back(-1);
+                    m_charge.values.push_back(0);
+                    m_sector.values.push_back(-1);
+                    m_flags.values.push_back(0);
+                    m_trackIndex.values.push_back(0);
+                    m_nBadLayers.values.push_back(0);
+                    m_goodLayers.values.insert(m_goodLayers.values.end(),HADES::MDC::WireInfo::numberOfPlanes,0);
+                    m_wires.values.insert(m_wires.values.end(),wireBlockSize,HADES::MDC::PackedLayersTrack::noWire);
+                    m_metaHits.values.insert(m_metaHits.values.end(),metaBlockSize,emptySlot);
+                }
+                /**
+                 * @brief Rebuild the track at the given position
+                 *
+                 * @param i position of the track
+                 * @param evtId unique ID of the underlying event
+                 * @param EP event plane angle of the underlying event (in deg)
+                 * @return TrackCandidate
+                 */
+                [[nodiscard]] TrackCandidate Get(std::size_t i, EventIdentifier evtId, float EP) const
+                {
+                    TrackCandidate track;
+                    for (std::size_t field = 0; field < nFloatFields; ++field)
+                        track.*floatFields[field].member = m_floats[field].values[i];
+
+                    track.GeantKineTrack = nullptr;
+                    track.TrackIndex = m_trackIndex.values[i];
+                    track.TrackId = TrackIdentifier{evtId,m_trackIndex.values[i]};
+                    track.ReactionPlaneAngle = EP;
+                    track.PID = m_pid.values[i];
+                    track.Charge = m_charge.values[i];
+                    track.Sector = m_sector.values[i];
+                    track.isAtMdcEdge = m_flags.values[i] & atMdcEdgeBit;
+                    track.isGoodMetaCell = m_flags.values[i] & goodMetaCellBit;
+                    track.System = (m_flags.values[i] & tofBit) ? Detector::ToF : Detector::RPC;
+                    track.NBadLayers = m_nBadLayers.values[i];
+
+                    for (std::size_t plane = 0; plane < HADES::MDC::WireInfo::numberOfPlanes; ++plane)
+                        track.goodLayers[plane] = m_goodLayers.values[i * HADES::MDC::WireInfo::numberOfPlanes + plane];
+
+                    HADES::MDC::PackedLayersTrack packed;
+                    for (const auto &layer : HADES::MDC::WireInfo::allLayerIndexing)
+                        for (std::size_t slot = 0; slot < HADES::MDC::PackedLayersTrack::maxWiresPerLayer; ++slot)
+                        {
+                            const std::uint16_t wire = m_wires.values[i * wireBlockSize + layer * HADES::MDC::PackedLayersTrack::maxWiresPerLayer + slot];
+                            if (wire != HADES::MDC::PackedLayersTrack::noWire)
+                                packed.AddWire(layer,wire);
+                        }
+                    track.firedWiresCollection = packed.Unpack();
+
+                    track.metaHits.clear();
+                    for (std::size_t slot = 0; slot < metaBlockSize; ++slot)
+                        if (m_metaHits.values[i * metaBlockSize + slot] != emptySlot)
+                            track.metaHits.push_back(m_metaHits.values[i * metaBlockSize + slot]);
+
+                    return track;
+                }
+                /**
+                 * @brief Attach the HGeantKine counterpart to a track
+                 *
+                 * @param track reconstructed track
+                 * @param kine its HGeantKine counterpart
+                 */
+                static void SetGeantKine(TrackCandidate &track, TrackCandidate &&kine)
+                {
+                    track.GeantKineTrack = std::make_shared<TrackCandidate>(std::move(kine));
+                }
+                /**
+                 * @brief Get the number of stored tracks
+                 *
+                 * @return std::size_t
+                 */
+                [[nodiscard]] std::size_t size() const noexcept {return m_pid.values.size();}
+        };
+
+        /**
+         * @brief Writes the preselected events and their tracks into the femto skim. Store the tracks before the track selection (and the events with loose cuts), so that the cuts can be varied when reading the skim.
+         *
+         */
+        class FemtoSkimWriter
+        {
+            private:
+                std::unique_ptr<TFile> m_file;
+                TTree *m_tree; // owned by m_file
+                ULong64_t m_eventId; // packed EventIdentifier
+                float m_x, m_y, m_z, m_reactionPlane;
+                short m_centrality, m_plate, m_nCharged;
+                std::vector<std::uint8_t> m_hasKine;
+                SkimTrackColumns m_tracks, m_kineTracks;
+                bool m_isClosed;
+
+            public:
+                /**
+                 * @brief Create the output file and the skim tree
+                 *
+                 * @param fileName name of the output file (it is recreated)
+                 * @param treeName name of the skim tree
+                 * @throws std::runtime_error if the file cannot be created
+                 */
+                explicit FemtoSkimWriter(const std::string &fileName, const std::string &treeName = "femtoSkim")
+                    : m_file(std::make_unique<TFile>(fileName.data(),"RECREATE")), m_tree(nullptr), m_eventId(0),
+                    m_x(0), m_y(0), m_z(0), m_reactionPlane(0), m_centrality(0), m_plate(-1), m_nCharged(0), m_isClosed(false)
+                {
+                    if (m_file->IsZombie())
+                        throw std::runtime_error("FemtoSkimWriter: cannot create file " + fileName);
+
+                    m_file->cd();
+                    m_tree = new TTree(treeName.data(),"Preselected events and tracks for the femtoscopic analysis");
+                    m_tree->Branch("eventId",&m_eventId,"eventId/l");
+                    m_tree->Branch("vertexX",&m_x,"vertexX/F");
+                    m_tree->Branch("vertexY",&m_y,"vertexY/F");
+                    m_tree->Branch("vertexZ",&m_z,"vertexZ/F");
+                    m_tree->Branch("reactionPlane",&m_reactionPlane,"reactionPlane/F");
+                    m_tree->Branch("centrality",&m_centrality,"centrality/S");
+                    m_tree->Branch("plate",&m_plate,"plate/S");
+                    m_tree->Branch("nCharged",&m_nCharged,"nCharged/S");
+                    m_tree->Branch("hasKine",&m_hasKine);
+                    m_tracks.Branch(m_tree,"");
+                    m_kineTracks.Branch(m_tree,"kine_");
+                }
+                FemtoSkimWriter(const FemtoSkimWriter &) = delete;
+                FemtoSkimWriter& operator=(const FemtoSkimWriter &) = delete;
+                ~FemtoSkimWriter()
+                {
+                    Close();
+                }
+                /**
+                 * @brief Store the event together with its preselected tracks
+                 *
+                 * @param event
+                 * @param tracks preselected tracks of the event
+                 */
+                void Fill(const EventCandidate &event, const std::vector<TrackCandidate> &tracks)
+                {
+                    m_eventId = event.GetID().GetValue();
+                    m_x = event.GetX();
+                    m_y = event.GetY();
+                    m_z = event.GetZ();
+                    m_reactionPlane = event.GetReactionPlane();
+                    m_centrality = event.GetCentrality();
+                    m_plate = event.GetPlate();
+                    m_nCharged = event.GetNCharged();
+
+                    m_tracks.Clear();
+                    m_kineTracks.Clear();
+                    m_hasKine.clear();
+                    for (const auto &track : tracks)
+                    {
+                        m_tracks.Push(track);
+                        m_hasKine.push_back(track.GetGeantKine() != nullptr);
+                        if (track.GetGeantKine() != nullptr)
+                            m_kineTracks.Push(*track.GetGeantKine());
+                        else
+                            m_kineTracks.PushEmpty();
+                    }
+
+                    m_tree->Fill();
+                }
+                /**
+                 * @brief Get the number of stored events
+                 *
+                 * @return Long64_t
+                 */
+                [[nodiscard]] Long64_t GetEntries() const {return m_tree->GetEntries();}
+                /**
+                 * @brief Write the tree and close the file. Called by the destructor
+                 *
+                 */
+                void Close()
+                {
+                    if (m_isClosed)
+                        return;
+
+                    m_file->cd();
+                    m_tree->Write();
+                    m_file->Close();
+                    m_isClosed = true;
+                }
+        };
+
+        /**
+         * @brief Reads the femto skim and rebuilds the EventCandidate and TrackCandidate objects, so the event and track selection can be rerun without HYDRA
+         *
+         */
+        class FemtoSkimReader
+        {
+            private:
+                std::unique_ptr<TChain> m_chain;
+                Long64_t m_entry, m_nEntries;
+                ULong64_t m_eventId; // packed EventIdentifier
+                float m_x, m_y, m_z, m_reactionPlane;
+                short m_centrality, m_plate, m_nCharged;
+                std::vector<std::uint8_t> m_hasKine;
+                std::vector<std::uint8_t> *m_hasKineAddress; // ROOT needs the address of a pointer to the vector, which stays owned by the reader
+                SkimTrackColumns m_tracks, m_kineTracks;
+
+            public:
+                /**
+                 * @brief Open the skim file(s)
+                 *
+                 * @param fileName name of the skim file, wildcards are accepted (see TChain::Add)
+                 * @param treeName name of the skim tree
+                 * @throws std::runtime_error if no skim tree was found
+                 */
+                explicit FemtoSkimReader(const std::string &fileName, const std::string &treeName = "femtoSkim")
+                    : m_chain(std::make_unique<TChain>(treeName.data())), m_entry(-1), m_nEntries(0), m_eventId(0),
+                    m_x(0), m_y(0), m_z(0), m_reactionPlane(0), m_centrality(0), m_plate(-1), m_nCharged(0), m_hasKine(), m_hasKineAddress(&m_hasKine)
+                {
+                    if (m_chain->Add(fileName.data()) == 0)
+                        throw std::runtime_error("FemtoSkimReader: no file matches " + fileName);
+                    m_nEntries = m_chain->GetEntries();
+
+                    m_chain->SetBranchAddress("eventId",&m_eventId);
+                    m_chain->SetBranchAddress("vertexX",&m_x);
+                    m_chain->SetBranchAddress("vertexY",&m_y);
+                    m_chain->SetBranchAddress("vertexZ",&m_z);
+                    m_chain->SetBranchAddress("reactionPlane",&m_reactionPlane);
+                    m_chain->SetBranchAddress("centrality",&m_centrality);
+                    m_chain->SetBranchAddress("plate",&m_plate);
+                    m_chain->SetBranchAddress("nCharged",&m_nCharged);
+                    m_chain->SetBranchAddress("hasKine",&m_hasKineAddress);
+                    m_tracks.SetBranchAddresses(m_chain.get(),"");
+                    m_kineTracks.SetBranchAddresses(m_chain.get(),"kine_");
+                }
+                /**
+                 * @brief Get the number of stored events
+                 *
+                 * @return Long64_t
+                 */
+                [[nodiscard]] Long64_t GetEntries() const noexcept {return m_nEntries;}
+                /**
+                 * @brief Load the next event
+                 *
+                 * @return true if an event was loaded, false at the end of the skim
+                 */
+                bool Next()
+                {
+                    if (m_entry + 1 >= m_nEntries)
+                        return false;
+
+                    m_chain->GetEntry(++m_entry);
+                    return true;
+                }
+                /**
+                 * @brief Create the current event. Its track list is empty, the tracks which pass the selection have to be added with EventCandidate::AddTrack
+                 *
+                 * @return std::shared_ptr<EventCandidate>
+                 */
+                [[nodiscard]] std::shared_ptr<EventCandidate> GetEvent() const
+                {
+                    auto event = std::make_shared<EventCandidate>(EventIdentifier(m_eventId),m_x,m_y,m_z,m_centrality,0.f);
+                    event->ReactionPlaneAngle = m_reactionPlane; // stored in deg
+                    event->TargetPlate = m_plate;
+                    event->ChargedTracks = m_nCharged;
+
+                    return event;
+                }
+                /**
+                 * @brief Rebuild the preselected tracks of the current event (together with their HGeantKine counterparts, if stored)
+                 *
+                 * @return std::vector<TrackCandidate>
+                 */
+                [[nodiscard]] std::vector<TrackCandidate> GetTracks() const
+                {
+                    std::vector<TrackCandidate> tracks;
+                    tracks.reserve(m_tracks.size());
+                    for (std::size_t i = 0; i < m_tracks.size(); ++i)
+                    {
+                        tracks.push_back(m_tracks.Get(i,EventIdentifier(m_eventId),m_reactionPlane));
+                        if (m_hasKine.at(i))
+                            SkimTrackColumns::SetGeantKine(tracks.back(),m_kineTracks.Get(i,EventIdentifier(m_eventId),m_reactionPlane));
+                    }
+
+                    return tracks;
+                }
+        };
+    } // namespace Selection
+
+#endif
@@ -0,0 +1,127 @@
+/**
+ * @file Identifiers.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Numeric identifiers of events, tracks and pairs. They are trivially copyable and compared as integers, the string form is created only on demand (e.g. for printing).
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef Identifiers_hxx
+    #define Identifiers_hxx
+
+    #include <cstddef>
+    #include <cstdint>
+    #include <functional>
+    #include <string>
+
+    namespace Selection
+    {
+        /**
+         * @brief Unique ID of an event: the run number in the upper and the sequence number in the lower 32 bits
+         *
+         */
+        class EventIdentifier
+        {
+            private:
+                std::uint64_t m_value;
+
+            public:
+                constexpr EventIdentifier() noexcept : m_value(0) {}
+                /**
+                 * @brief Construct a new Event Identifier object from the packed value (e.g. read back from a skim)
+                 *
+                 * @param value
+                 */
+                constexpr explicit EventIdentifier(std::uint64_t value) noexcept : m_value(value) {}
+                /**
+                 * @brief Construct a new Event Identifier object
+                 *
+                 * @param run run number (HEventHeader::getEventRunNumber)
+                 * @param sequence sequence number of the event within the run (HEventHeader::getEventSeqNumber)
+                 */
+                constexpr EventIdentifier(std::uint32_t run, std::uint32_t sequence) noexcept : m_value((static_cast<std::uint64_t>(run) << 32) | sequence) {}
+
+                [[nodiscard]] constexpr std::uint64_t GetValue() const noexcept {return m_value;}
+                [[nodiscard]] constexpr std::uint32_t GetRun() const noexcept {return static_cast<std::uint32_t>(m_value >> 32);}
+                [[nodiscard]] constexpr std::uint32_t GetSequence() const noexcept {return static_cast<std::uint32_t>(m_value);}
+                /**
+                 * @brief Format the ID as "run_sequence"
+                 *
+                 * @return std::string
+                 */
+                [[nodiscard]] std::string ToString() const {return std::to_string(GetRun()) + "_" + std::to_string(GetSequence());}
+
+                [[nodiscard]] constexpr bool operator==(const EventIdentifier &other) const noexcept {return m_value == other.m_value;}
+                [[nodiscard]] constexpr bool operator!=(const EventIdentifier &other) const noexcept {return m_value != other.m_value;}
+                [[nodiscard]] constexpr bool operator<(const EventIdentifier &other) const noexcept {return m_value < other.m_value;}
+        };
+
+        /**
+         * @brief Unique ID of a track: the ID of its event and the index of the track within the event
+         *
+         */
+        struct TrackIdentifier
+        {
+            EventIdentifier event;
+            std::uint32_t index = 0;
+
+            /**
+             * @brief Format the ID as "run_sequence_index"
+             *
+             * @return std::string
+             */
+            [[nodiscard]] std::string ToString() const {return event.ToString() + "_" + std::to_string(index);}
+
+            [[nodiscard]] constexpr bool operator==(const TrackIdentifier &other) const noexcept {return event == other.event && index == other.index;}
+            [[nodiscard]] constexpr bool operator!=(const TrackIdentifier &other) const noexcept {return !(*this == other);}
+            [[nodiscard]] constexpr bool operator<(const TrackIdentifier &other) const noexcept
+            {
+                return (event == other.event) ? index < other.index : event < other.event;
+            }
+        };
+
+        /**
+         * @brief Unique ID of a pair: the IDs of its tracks (in the order of the pair)
+         *
+         */
+        struct PairIdentifier
+        {
+            TrackIdentifier first, second;
+
+            /**
+             * @brief Format the ID as "run_sequence_index-run_sequence_index"
+             *
+             * @return std::string
+             */
+            [[nodiscard]] std::string ToString() const {return first.ToString() + "-" + second.ToString();}
+
+            [[nodiscard]] constexpr bool operator==(const PairIdentifier &other) const noexcept {return first == other.first && second == other.second;}
+            [[nodiscard]] constexpr bool operator!=(const PairIdentifier &other) const noexcept {return !(*this == other);}
+            [[nodiscard]] constexpr bool operator<(const PairIdentifier &other) const noexcept
+            {
+                return (first == other.first) ? second < other.second : first < other.first;
+            }
+        };
+    } // namespace Selection
+
+    namespace std
+    {
+        template <>
+        struct hash<Selection::EventIdentifier>
+        {
+            std::size_t operator()(const Selection::EventIdentifier &id) const noexcept {return std::hash<std::uint64_t>()(id.GetValue());}
+        };
+
+        template <>
+        struct hash<Selection::TrackIdentifier>
+        {
+            std::size_t operator()(const Selection::TrackIdentifier &id) const noexcept
+            {
+                return std::hash<std::uint64_t>()(id.event.GetValue() ^ (static_cast<std::uint64_t>(id.index) * 0x9E3779B97F4A7C15ull));
+            }
+        };
+    } // namespace std
+
+#endif
@@ -0,0 +1,497 @@
+/**
+ * @file JJFemtoMixer.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Event mixer for femtoscopic analysis. Builds same-event and mixed-event pairs from the lightweight track handles.
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef JJFemtoMixer_hxx
+    #define JJFemtoMixer_hxx
+
+    #include <algorithm>
+    #include <cstdint>
+    #include <iterator>
+    #include <functional>
+    #include <iostream>
+    #include <map>
+    #include <memory>
+    #include <optional>
+    #include <string>
+    #include <type_traits>
+    #include <vector>
+
+    #include "BackgroundSampler.hxx"
+    #include "MixingGroups.hxx"
+    #include "MixingPool.hxx"
+    #include "PairKinematics.hxx"
+    #include "PairPrefilter.hxx"
+    #include "StageProfiler.hxx"
+
+    namespace Mixing
+    {
+        /**
+         * @brief Mixer class. Events are grouped according to the event hashing function and their tracks are copied into a MixingPool of fixed depth for each group. Pairs are grouped according to the pair hashing function, pairs rejected by the pair cutting function are assigned to the rejectedGroup. The pairs are either passed one by one to a callable (ForEachSignalPair, ForEachMixedPair) or collected into maps (AddEvent, GetSimilarPairs).
+         *
+         * @tparam Event event type, has to provide GetID and GetTrackList
+         * @tparam Track track type (Selection::TrackHandle pointing to the columnar track data owned by the event, the tracks of one event have to be contiguous in their store)
+         * @tparam Pair pair type, constructible from two Track objects and their Selection::PairKinematics
+         * @tparam PairHashing type of the pair hashing function, callable with const std::shared_ptr<Pair>& and returning GroupId. A stateless binning (e.g. Mixing::PairBinning1D) lets the compiler inline the grouping of every pair, the default std::function can be set to anything at runtime
+         * @tparam PairCutting type of the pair cutting function, callable with const std::shared_ptr<Pair>& and returning true for rejected pairs. A compile-time policy (e.g. Mixing::NominalPairCuts) is inlined and counts the rejections of each cut, the default std::function can be set to anything at runtime
+         */
+        template <typename Event, typename Track, typename Pair, typename PairHashing = std::function<GroupId (const std::shared_ptr<Pair> &)>, typename PairCutting = std::function<bool (const std::shared_ptr<Pair> &)> >
+        class JJFemtoMixer
+        {
+            private:
+                using PairMap = std::map<GroupId,std::vector<std::shared_ptr<Pair> > >;
+
+                MixingPool m_pool; // copies of the tracks of the buffered events, so the events themselves are not kept alive
+                std::function<GroupId (const std::shared_ptr<Event> &)> m_eventHashingFunction;
+                PairHashing m_pairHashingFunction;
+                PairCutting m_pairCuttingFunction;
+                std::optional<GroupId> m_outOfRangeGroup; // pairs hashed to this group are not passed to the cutting function
+                std::optional<PairPrefilter> m_prefilter; // mixed pairs outside of it are not created at all
+                bool m_useMomentumTree; // low-q mixed pairs are searched in the momentum KD-tree of the buffer
+                mutable Selection::Kinematics::KinematicsBlock m_kinematics; // scratch space for the batched kinematics
+                mutable JJUtils::StageProfiler m_profiler; // pair construction and rejection (filled only if FEMTOMIXER_PROFILING is defined)
+
+                /**
+                 * @brief Check if the function is set (std::function can be empty, any other callable is always set)
+                 *
+                 * @tparam Func
+                 * @param func
+                 * @return true if the function can be called
+                 */
+                template <typename Func>
+                [[nodiscard]] static constexpr bool IsSet(const Func &func) noexcept
+                {
+                    if constexpr (std::is_constructible_v<bool,const Func &>)
+                        return static_cast<bool>(func);
+                    else
+                        return true;
+                }
+                /**
+                 * @brief Find the group of the pair given by the hashing function, or the rejected group if it was rejected. The group is found first, so pairs falling into the out-of-range group skip the (expensive) cutting function.
+                 *
+                 * @param pair non-owning pointer to the pair, the hashing and cutting functions must not store it
+                 * @return GroupId
+                 */
+                [[nodiscard]] GroupId ClassifyPair(const std::shared_ptr<Pair> &pair) const
+                {
+                    const GroupId hash = IsSet(m_pairHashingFunction) ? m_pairHashingFunction(pair) : outOfRangeGroup;
+                    if (m_outOfRangeGroup && hash == *m_outOfRangeGroup)
+                        return hash;
+                    else if (IsSet(m_pairCuttingFunction) && m_pairCuttingFunction(pair))
+                        return rejectedGroup;
+                    else
+                        return hash;
+                }
+
+                /**
+                 * @brief Construct the pair, find its group and pass it to the function
+                 *
+                 * @param track1
+                 * @param track2
+                 * @param kinematics
+                 * @param weight
+                 * @param func callable with the signature void(GroupId group, Pair &pair, double weight)
+                 */
+                template <typename Func>
+                void EmitPair(const Track &track1, const Track &track2, const Selection::PairKinematics &kinematics, double weight, Func &func) const
+                {
+                    Pair pair = [&]
+                    {
+                        JJ_PROFILE_SAMPLED_STAGE(m_profiler,JJUtils::Stage::PairConstruction);
+                        return Pair(track1,track2,kinematics);
+                    }();
+                    const std::shared_ptr<Pair> view(std::shared_ptr<Pair>(),&pair); // aliasing constructor: no allocation, no ownership
+                    const GroupId group = [&]
+                    {
+                        JJ_PROFILE_SAMPLED_STAGE(m_profiler,JJUtils::Stage::PairRejection);
+                        return ClassifyPair(view);
+                    }();
+                    func(group,pair,weight);
+                }
+
+                /**
+                 * @brief Selector which keeps every pair with weight 1
+                 *
+                 */
+                struct KeepAllPairs
+                {
+                    [[nodiscard]] constexpr double operator()(const Selection::PairKinematics &, const Track &) const noexcept {return 1.;}
+                };
+
+                /**
+                 * @brief Create pairs of one track with a range of partner tracks and pass them to the function. The pair kinematics is calculated with Selection::Kinematics::CalculateBlock for each run of partners stored next to each other in the same store (the whole range for the tracks of an event or a buffered event), each pair lives on the stack only for the duration of the call. Pairs dropped by the selector are not constructed at all.
+                 *
+                 * @param track1 
+                 * @param first iterator to the first partner track
+                 * @param last iterator past the last partner track
+                 * @param selector callable with the signature double(const Selection::PairKinematics &kinematics, const Track &partner), returning the weight of the pair (0 drops the pair)
+                 * @param func callable with the signature void(GroupId group, Pair &pair, double weight)
+                 */
+                template <typename Iter, typename Selector, typename Func>
+                void PairWithBlock(const Track &track1, Iter first, Iter last, Selector &selector, Func &func) const
+                {
+                    const auto *store1 = track1.GetStore();
+                    const std::uint32_t pos1 = track1.GetPosition();
+
+                    while (first != last)
+                    {
+                        // a block spans only the handles which follow each other in the same store, any gap (e.g. a handle list which is not in store order) starts a new block
+                        const auto *store2 = first->GetStore();
+                        const std::uint32_t pos2 = first->GetPosition();
+                        const std::size_t nMax = std::min<std::size_t>(std::distance(first,last),Selection::Kinematics::blockSize);
+                        std::size_t n = 1;
+                        for (Iter next = std::next(first); n < nMax && next->GetStore() == store2 && next->GetPosition() == pos2 + n; ++next)
+                            ++n;
+
+                        const Selection::Kinematics::TrackBlock partners{store2->GetPxColumn() + pos2,store2->GetPyColumn() + pos2,store2->GetPzColumn() + pos2,store2->GetEnergyColumn() + pos2,n};
+
+                        Selection::Kinematics::CalculateBlock(store1->GetPxColumn()[pos1],store1->GetPyColumn()[pos1],store1->GetPzColumn()[pos1],store1->GetEnergyColumn()[pos1],partners,m_kinematics);
+                        for (std::size_t i = 0; i < n; ++i, ++first)
+                        {
+                            const Selection::PairKinematics kinematics = m_kinematics.at(i);
+                            const double weight = selector(kinematics,*first);
+                            if (weight != 0.)
+                                EmitPair(track1,*first,kinematics,weight,func);
+                        }
+                    }
+                }
+
+                /**
+                 * @brief Create the mixed-event pairs of the event with the buffered events from its group (except for the event itself). If the prefilter is set, the buffered tracks are ordered by rapidity, so for each track only the partners which can give a pair rapidity inside the prefilter are visited (found by binary search), and the remaining pairs are checked with the prefilter before they are constructed
+                 *
+                 * @param event
+                 * @param selector see PairWithBlock
+                 * @param func callable with the signature void(GroupId group, Pair &pair, double weight)
+                 */
+                template <typename Selector, typename Func>
+                void MixWithBuffer(const std::shared_ptr<Event> &event, Selector &selector, Func &func) const
+                {
+                    const auto &tracks = event->GetTrackList();
+                    const Selection::EventIdentifier eventId = event->GetID();
+                    m_pool.ForEachEvent(GetEventGroup(event),
+                        [&](Selection::EventIdentifier bufferedId, const std::vector<Track> &bufferedTracks)
+                        {
+                            if (bufferedId == eventId)
+                                return;
+
+                            if (!m_prefilter)
+                            {
+                                for (const auto &track1 : tracks)
+                                    PairWithBlock(track1,bufferedTracks.begin(),bufferedTracks.end(),selector,func);
+                                return;
+                            }
+
+                            for (const auto &track1 : tracks)
+                            {
+                                const float rapidity1 = track1.GetRapidity();
+                                const auto [minRapidity,maxRapidity] = m_prefilter->GetPartnerRapidityRange(rapidity1);
+                                const auto first = std::partition_point(bufferedTracks.begin(),bufferedTracks.end(),[minRapidity](const Track &track) {return track.GetRapidity() < minRapidity;});
+                                const auto last = std::partition_point(first,bufferedTracks.end(),[maxRapidity](const Track &track) {return track.GetRapidity() <= maxRapidity;});
+
+                                auto prefilteredSelector = [&](const Selection::PairKinematics &kinematics, const Track &partner)
+                                {
+                                    return m_prefilter->Accept(kinematics,rapidity1,partner.GetRapidity()) ? selector(kinematics,partner) : 0.;
+                                };
+                                PairWithBlock(track1,first,last,prefilteredSelector,func);
+                            }
+                        });
+                }
+
+                /**
+                 * @brief Create the sampled mixed-event pairs using the momentum tree of the buffer. Pairs below qFull of the sampler are searched in the tree and all of them are kept: for identical particles |p1 - p2| <= gamma * q_inv, where gamma is the Lorentz factor of the pair (not larger than the largest one of the tracks), so the search radius is qFull times the largest gamma. Pairs above qFull are created only for the partners drawn by the sampler (BackgroundSampler::DrawSkip), so their cost is proportional to the number of kept pairs
+                 *
+                 * @param event
+                 * @param sampler
+                 * @param func callable with the signature void(GroupId group, Pair &pair, double weight)
+                 */
+                template <typename Func>
+                void MixWithTree(const std::shared_ptr<Event> &event, BackgroundSampler &sampler, Func &func) const
+                {
+                    constexpr float radiusMargin = 1.01f; // protects the search radius against rounding
+                    const auto &tracks = event->GetTrackList();
+                    const Selection::EventIdentifier eventId = event->GetID();
+                    const GroupId eventGroup = GetEventGroup(event);
+                    const float qFull = sampler.GetSettings().qFull;
+                    const float maxGamma = m_pool.GetMaxGamma(eventGroup);
+
+                    auto isInPrefilter = [this](const Selection::PairKinematics &kinematics, const Track &track1, const Track &track2)
+                    {
+                        return !m_prefilter || m_prefilter->Accept(kinematics,track1.GetRapidity(),track2.GetRapidity());
+                    };
+                    auto calculate = [](const Track &track1, const Track &track2)
+                    {
+                        return Selection::Kinematics::Calculate(track1.GetPx(),track1.GetPy(),track1.GetPz(),track1.GetEnergy(),track2.GetPx(),track2.GetPy(),track2.GetPz(),track2.GetEnergy());
+                    };
+
+                    // low-q region: every pair is created
+                    for (const auto &track1 : tracks)
+                    {
+                        const float radius = qFull * std::max(maxGamma,MixingPool::GetGamma(track1)) * radiusMargin;
+                        m_pool.ForEachNeighbour(eventGroup,track1.GetPx(),track1.GetPy(),track1.GetPz(),radius,
+                            [&](Selection::EventIdentifier bufferedId, const Track &track2)
+                            {
+                                if (bufferedId == eventId)
+                                    return;
+
+                                const Selection::PairKinematics kinematics = calculate(track1,track2);
+                                if (kinematics.QInv < qFull && isInPrefilter(kinematics,track1,track2))
+                                    EmitPair(track1,track2,kinematics,1.,func);
+                            });
+                    }
+
+                    // normalisation region: only the drawn partners are created, the skip is carried over between the buffered events
+                    for (const auto &track1 : tracks)
+                    {
+                        std::size_t skip = sampler.DrawSkip();
+                        m_pool.ForEachEvent(eventGroup,
+                            [&](Selection::EventIdentifier bufferedId, const std::vector<Track> &bufferedTracks)
+                            {
+                                if (bufferedId == eventId)
+                                    return;
+
+                                std::size_t i = skip;
+                                for (; i < bufferedTracks.size(); i += 1 + sampler.DrawSkip())
+                                {
+                                    const Selection::PairKinematics kinematics = calculate(track1,bufferedTracks[i]);
+                                    if (kinematics.QInv < qFull || !isInPrefilter(kinematics,track1,bufferedTracks[i]))
+                                        continue;
+
+                                    const double weight = sampler.Thin(kinematics.QInv);
+                                    if (weight != 0.)
+                                        EmitPair(track1,bufferedTracks[i],kinematics,weight,func);
+                                }
+                                skip = i - bufferedTracks.size();
+                            });
+                    }
+                }
+
+            public:
+                JJFemtoMixer() : m_pool(1), m_useMomentumTree(false) {}
+                /**
+                 * @brief Set the maximal number of events stored in each event group. Removes all buffered events
+                 *
+                 * @param size
+                 */
+                void SetMaxBufferSize(std::size_t size) {m_pool.Configure(size,m_pool.GetMaxTracks());}
+                /**
+                 * @brief Set the number of tracks reserved for each buffered event (events with more tracks are still stored, but their slot has to grow). Removes all buffered events
+                 *
+                 * @param nTracks
+                 */
+                void SetMaxTracksPerEvent(std::size_t nTracks) {m_pool.Configure(m_pool.GetDepth(),nTracks);}
+                /**
+                 * @brief Set the function which assigns events to groups
+                 *
+                 * @param func
+                 */
+                void SetEventHashingFunction(const std::function<GroupId (const std::shared_ptr<Event> &)> &func) {m_eventHashingFunction = func;}
+                /**
+                 * @brief Set the function which assigns pairs to groups
+                 *
+                 * @param func
+                 */
+                void SetPairHashingFunction(const PairHashing &func) {m_pairHashingFunction = func;}
+                /**
+                 * @brief Set the function which decides if a pair should be rejected
+                 *
+                 * @param func
+                 */
+                void SetPairCuttingFunction(const PairCutting &func) {m_pairCuttingFunction = func;}
+                /**
+                 * @brief Get the pair cutting function used by the mixer (e.g. to read the rejection counters of a PairCutPolicy)
+                 *
+                 * @return const PairCutting&
+                 */
+                [[nodiscard]] const PairCutting& GetPairCuttingFunction() const noexcept {return m_pairCuttingFunction;}
+                /**
+                 * @brief Get the event group of the event (given by the event hashing function, 0 if it is not set)
+                 *
+                 * @param event
+                 * @return GroupId
+                 */
+                [[nodiscard]] GroupId GetEventGroup(const std::shared_ptr<Event> &event) const
+                {
+                    return m_eventHashingFunction ? m_eventHashingFunction(event) : 0;
+                }
+                /**
+                 * @brief Set the group of pairs which are outside of the analysed ranges. Such pairs are stored without calling the pair cutting function (by default every pair is checked).
+                 *
+                 * @param hash group returned by the pair hashing function for out-of-range pairs
+                 */
+                void SetOutOfRangeGroup(GroupId hash) {m_outOfRangeGroup = hash;}
+                /**
+                 * @brief Set the bounds of the analysed pair phase space (e.g. PairGrouping::MakePairPrefilter1D). Mixed-event pairs outside of them are skipped before they are constructed, so they are never passed to the hashing and cutting functions nor to the visitors (they would end up in the out-of-range group or the histogram overflow anyway). Same-event pairs are not affected, so the counters of all pairs stay the same. Removes all buffered events
+                 *
+                 * @param prefilter
+                 */
+                void SetPairPrefilter(const PairPrefilter &prefilter)
+                {
+                    m_prefilter = prefilter;
+                    m_pool.SetSortByRapidity(true);
+                }
+                /**
+                 * @brief Enable the low-q search mode of the sampled mixing (ForEachMixedPair with a BackgroundSampler): pairs below qFull of the sampler are found in a momentum KD-tree of the buffer instead of looping over all buffered tracks, the normalisation region is sampled. Makes deep buffers affordable together with BackgroundSampling::FixedCount (with the other modes the normalisation region is still fully looped over). Requires identical particles (tracks with the same mass)
+                 *
+                 * @param enable
+                 */
+                void SetLowQSearch(bool enable) {m_useMomentumTree = enable;}
+                /**
+                 * @brief Print the current settings of the mixer
+                 *
+                 */
+                void PrintSettings() const
+                {
+                    std::cout << "---=== JJFemtoMixer settings ===---\n";
+                    std::cout << "max buffer size: " << m_pool.GetDepth() << "\n";
+                    std::cout << "max tracks per buffered event: " << m_pool.GetMaxTracks() << "\n";
+                    std::cout << "event hashing function: " << (m_eventHashingFunction ? "set" : "not set") << "\n";
+                    std::cout << "pair hashing function: " << (IsSet(m_pairHashingFunction) ? "set" : "not set") << "\n";
+                    std::cout << "pair cutting function: " << (IsSet(m_pairCuttingFunction) ? "set" : "not set") << "\n";
+                    std::cout << "out-of-range group: " << (m_outOfRangeGroup ? std::to_string(*m_outOfRangeGroup) : "not set") << "\n";
+                    std::cout << "low-q search in momentum tree: " << (m_useMomentumTree ? "enabled" : "disabled") << "\n";
+                    if (m_prefilter)
+                        std::cout << "mixed pair prefilter: kT (" << m_prefilter->ktMin << "," << m_prefilter->ktMax << "], y (" << m_prefilter->rapidityMin << "," << m_prefilter->rapidityMax << "], q_inv < " << m_prefilter->qInvMax << ", q_osl < " << m_prefilter->qOslMax << "\n\n";
+                    else
+                        std::cout << "mixed pair prefilter: not set\n\n";
+                }
+                /**
+                 * @brief Print how much of the buffer was filled for each event group
+                 *
+                 */
+                void PrintStatus() const
+                {
+                    std::cout << "---=== JJFemtoMixer buffer status ===---\n";
+                    m_pool.PrintStatus();
+                    std::cout << "\n";
+                }
+                /**
+                 * @brief Get the profile of the pair construction and rejection done by this mixer (empty unless FEMTOMIXER_PROFILING is defined)
+                 *
+                 * @return const JJUtils::StageProfiler&
+                 */
+                [[nodiscard]] const JJUtils::StageProfiler& GetProfiler() const noexcept {return m_profiler;}
+                /**
+                 * @brief Create all same-event pairs of the event and pass each of them to the function as soon as it is formed. No pair container is allocated, the pair must not be kept after the call returns (copy it if needed)
+                 *
+                 * @param event
+                 * @param func callable with the signature void(GroupId group, Pair &pair)
+                 */
+                template <typename Func>
+                void ForEachSignalPair(const std::shared_ptr<Event> &event, Func &&func) const
+                {
+                    KeepAllPairs selector;
+                    auto visit = [&func](GroupId group, Pair &pair, double) {func(group,pair);};
+                    const auto &tracks = event->GetTrackList();
+                    for (auto iter = tracks.begin(); iter != tracks.end(); ++iter)
+                        PairWithBlock(*iter,std::next(iter),tracks.end(),selector,visit);
+                }
+                /**
+                 * @brief Store the tracks of the event in the buffer of its group
+                 *
+                 * @param event
+                 */
+                void BufferEvent(const std::shared_ptr<Event> &event)
+                {
+                    m_pool.Insert(GetEventGroup(event),event->GetID(),event->GetTrackList());
+                }
+                /**
+                 * @brief Store the tracks in the buffer of the given group, e.g. when the buffer is restored from a checkpoint (see Mixing::CheckpointReader)
+                 *
+                 * @param eventGroup
+                 * @param eventId unique ID of the buffered event
+                 * @param tracks handles to the tracks, they are copied into the buffer
+                 */
+                void BufferEvent(GroupId eventGroup, Selection::EventIdentifier eventId, const std::vector<Track> &tracks)
+                {
+                    m_pool.Insert(eventGroup,eventId,tracks);
+                }
+                /**
+                 * @brief Get the buffer of the mixer (e.g. to write it to a checkpoint)
+                 *
+                 * @return const MixingPool&
+                 */
+                [[nodiscard]] const MixingPool& GetMixingPool() const noexcept {return m_pool;}
+                /**
+                 * @brief Create all mixed-event pairs between the event and the buffered events from its group (except for the event itself) and pass each of them to the function as soon as it is formed. The pair must not be kept after the call returns
+                 *
+                 * @param event
+                 * @param func callable with the signature void(GroupId group, Pair &pair)
+                 */
+                template <typename Func>
+                void ForEachMixedPair(const std::shared_ptr<Event> &event, Func &&func) const
+                {
+                    KeepAllPairs selector;
+                    auto visit = [&func](GroupId group, Pair &pair, double) {func(group,pair);};
+                    MixWithBuffer(event,selector,visit);
+                }
+                /**
+                 * @brief Create the mixed-event pairs like ForEachMixedPair, but pass only the pairs kept by the sampler. The sampling decision is made from the pair kinematics, before the pair is constructed and before the pair hashing and cutting functions are called. In the low-q search mode (SetLowQSearch) the pairs below qFull are found in the momentum tree of the buffer
+                 *
+                 * @param event
+                 * @param sampler
+                 * @param func callable with the signature void(GroupId group, Pair &pair, double weight), the weight (inverse of the acceptance) has to be used when filling the background
+                 */
+                template <typename Func>
+                void ForEachMixedPair(const std::shared_ptr<Event> &event, BackgroundSampler &sampler, Func &&func) const
+                {
+                    std::size_t nBufferedTracks = 0;
+                    const Selection::EventIdentifier eventId = event->GetID();
+                    m_pool.ForEachEvent(GetEventGroup(event),
+                        [&](Selection::EventIdentifier bufferedId, const std::vector<Track> &bufferedTracks)
+                        {
+                            if (bufferedId != eventId)
+                                nBufferedTracks += bufferedTracks.size();
+                        });
+
+                    sampler.BeginEvent(nBufferedTracks * event->GetTrackList().size()); // counted before the prefilter
+                    if (m_useMomentumTree)
+                    {
+                        MixWithTree(event,sampler,func);
+                        return;
+                    }
+
+                    auto selector = [&sampler](const Selection::PairKinematics &kinematics, const Track &) {return sampler(kinematics);};
+                    MixWithBuffer(event,selector,func);
+                }
+                /**
+                 * @brief Create all same-event pairs and store the event in the buffer of its group. Prefer ForEachSignalPair and BufferEvent, which do not allocate the pairs
+                 *
+                 * @param event
+                 * @param tracks handles to the tracks of the event, in any order and from any stores
+                 * @return pairs grouped by the pair hashing function
+                 */
+                PairMap AddEvent(const std::shared_ptr<Event> &event, const std::vector<Track> &tracks)
+                {
+                    PairMap pairMap;
+                    KeepAllPairs selector;
+                    auto insertPair = [&pairMap](GroupId group, Pair &pair, double) {pairMap[group].push_back(std::make_shared<Pair>(std::move(pair)));};
+                    for (auto iter = tracks.begin(); iter != tracks.end(); ++iter)
+                        PairWithBlock(*iter,std::next(iter),tracks.end(),selector,insertPair);
+
+                    m_pool.Insert(GetEventGroup(event),event->GetID(),tracks);
+
+                    return pairMap;
+                }
+                /**
+                 * @brief Create all mixed-event pairs between the given event and the buffered events from its group. The pairs point into the buffer, so they are valid only until the next AddEvent. Prefer ForEachMixedPair, which does not allocate the pairs
+                 *
+                 * @param event
+                 * @return pairs grouped by the pair hashing function
+                 */
+                PairMap GetSimilarPairs(const std::shared_ptr<Event> &event) const
+                {
+                    PairMap pairMap;
+                    ForEachMixedPair(event,[&pairMap](GroupId group, Pair &pair) {pairMap[group].push_back(std::make_shared<Pair>(std::move(pair)));});
+
+                    return pairMap;
+                }
+        };
+    } // namespace Mixing
+
+#endif
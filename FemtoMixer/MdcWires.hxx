@@ -2,10 +2,16 @@
     #define MdcWires_hxx
 
     #include <array>
+    #include <bitset>
+    #include <cstdint>
     #include <vector>
     #include <numeric>
+    #include <limits>
+    #include <algorithm>
 
-    #include "hparticlemetamatcher.h"
+    #ifndef FEMTOMIXER_STANDALONE
+        #include "hparticlemetamatcher.h"
+    #endif
 
     namespace HADES
     {
@@ -77,6 +83,117 @@
             using LayersPair = MDCLayers<std::pair<std::vector<unsigned>, std::vector<unsigned> > >;
             using WireDistances = MDCLayers<OptionalDistance<unsigned> >;
 
+            /**
+             * @brief Fixed-capacity representation of the wires fired by a single track. HParticleWireInfo holds at most two wires per layer, so each layer gets two slots (empty slots are set to noWire) and a bit in the occupancy mask. No heap allocation is needed.
+             * 
+             */
+            class PackedLayersTrack
+            {
+                public:
+                    static constexpr std::size_t maxWiresPerLayer = 2;
+                    static constexpr std::uint16_t noWire = std::numeric_limits<std::uint16_t>::max();
+                    using Mask = std::uint32_t;
+
+                private:
+                    std::array<std::uint16_t,WireInfo::numberOfAllLayers * maxWiresPerLayer> m_wires;
+                    std::array<std::uint8_t,WireInfo::numberOfAllLayers> m_nWires;
+                    Mask m_occupancy;
+
+                public:
+                    PackedLayersTrack() : m_occupancy(0)
+                    {
+                        m_wires.fill(noWire);
+                        m_nWires.fill(0);
+                    }
+                    /**
+                     * @brief Construct a new Packed Layers Track object from the vector-based representation. Wires above the capacity of the layer are dropped.
+                     * 
+                     * @param layers collection of wires fired by the track
+                     */
+                    explicit PackedLayersTrack(const LayersTrack &layers) : PackedLayersTrack()
+                    {
+                        for (const auto &layer : WireInfo::allLayerIndexing)
+                            for (const auto &wire : layers[layer])
+                                AddWire(layer,wire);
+                    }
+                    /**
+                     * @brief Add a fired wire to the given layer. Wires above the capacity of the layer are ignored.
+                     * 
+                     * @param layer 
+                     * @param wire 
+                     */
+                    void AddWire(std::size_t layer, unsigned wire) noexcept
+                    {
+                        if (m_nWires[layer] < maxWiresPerLayer)
+                        {
+                            m_wires[layer * maxWiresPerLayer + m_nWires[layer]] = static_cast<std::uint16_t>(wire);
+                            ++m_nWires[layer];
+                            m_occupancy |= (Mask(1) << layer);
+                        }
+                    }
+                    /**
+                     * @brief Remove all wires from the given layer
+                     * 
+                     * @param layer 
+                     */
+                    void ClearLayer(std::size_t layer) noexcept
+                    {
+                        for (std::size_t slot = 0; slot < maxWiresPerLayer; ++slot)
+                            m_wires[layer * maxWiresPerLayer + slot] = noWire;
+                        m_nWires[layer] = 0;
+                        m_occupancy &= ~(Mask(1) << layer);
+                    }
+                    /**
+                     * @brief Get the wire stored in the given slot of the given layer
+                     * 
+                     * @param layer 
+                     * @param slot 
+                     * @return wire index or noWire if the slot is empty
+                     */
+                    [[nodiscard]] std::uint16_t GetWire(std::size_t layer, std::size_t slot) const noexcept {return m_wires[layer * maxWiresPerLayer + slot];}
+                    /**
+                     * @brief Get the number of wires fired in the given layer
+                     * 
+                     * @param layer 
+                     * @return std::size_t 
+                     */
+                    [[nodiscard]] std::size_t GetNWires(std::size_t layer) const noexcept {return m_nWires[layer];}
+                    /**
+                     * @brief Check if at least one wire was fired in the given layer
+                     * 
+                     * @param layer 
+                     * @return true if it was and false otherwise
+                     */
+                    [[nodiscard]] bool IsFired(std::size_t layer) const noexcept {return (m_occupancy >> layer) & Mask(1);}
+                    /**
+                     * @brief Get the occupancy bitmask (bit N is set if layer N has at least one fired wire)
+                     * 
+                     * @return Mask 
+                     */
+                    [[nodiscard]] Mask GetOccupancy() const noexcept {return m_occupancy;}
+                    /**
+                     * @brief Get the number of layers with at least one fired wire
+                     * 
+                     * @return std::size_t 
+                     */
+                    [[nodiscard]] std::size_t GetNFiredLayers() const noexcept {return std::bitset<WireInfo::numberOfAllLayers>(m_occupancy).count();}
+                    /**
+                     * @brief Convert back to the vector-based representation
+                     * 
+                     * @return LayersTrack 
+                     */
+                    [[nodiscard]] LayersTrack Unpack() const
+                    {
+                        LayersTrack layers;
+                        for (const auto &layer : WireInfo::allLayerIndexing)
+                            for (std::size_t slot = 0; slot < m_nWires[layer]; ++slot)
+                                layers[layer].push_back(GetWire(layer,slot));
+
+                        return layers;
+                    }
+            };
+
+    #ifndef FEMTOMIXER_STANDALONE
             /**
              * @brief Create a Track Layers object
              * 
@@ -102,6 +219,7 @@
 
                 return array;
             }
+    #endif
             /**
              * @brief Create a Pair Layers object
              * 
@@ -232,6 +350,106 @@
 
                 return (nHits1 > 0 || nHits2 > 0) ? std::accumulate(splittingLevels.begin(),splittingLevels.end(),0.) / (nHits1 + nHits2) : 0.;
             }
+    #ifndef FEMTOMIXER_STANDALONE
+            /**
+             * @brief Create a Packed Track Layers object
+             * 
+             * @param wi HParticleWireInfo object, obtained from HParticleMetaMatcher
+             * @return fixed-capacity collection of wires fired by the track
+             */
+            [[nodiscard]] PackedLayersTrack CreatePackedTrackLayers(const HParticleWireInfo &wi)
+            {
+                PackedLayersTrack packed;
+
+                for (std::size_t mod = 0; mod < HADES::MDC::WireInfo::numberOfPlanes; ++mod)
+                    for (std::size_t lay = 0; lay < HADES::MDC::WireInfo::numberOfLayersInPlane; ++lay)
+                        for (std::size_t slot = 0; slot < PackedLayersTrack::maxWiresPerLayer; ++slot)
+                            if (wi.ar[mod][lay][slot] > WireInfo::noWire)
+                                packed.AddWire(mod * HADES::MDC::WireInfo::numberOfLayersInPlane + lay,static_cast<unsigned>(wi.ar[mod][lay][slot]));
+
+                return packed;
+            }
+    #endif
+            /**
+             * @brief Calculate the number of MDC layers where both tracks had fired at least one wire
+             * 
+             * @param track1 fired wires of the first track
+             * @param track2 fired wires of the second track
+             * @return number of layers where both traks had fired a wire 
+             */
+            [[nodiscard]] unsigned CalculateBothLayers(const PackedLayersTrack &track1, const PackedLayersTrack &track2) noexcept
+            {
+                return std::bitset<WireInfo::numberOfAllLayers>(track1.GetOccupancy() & track2.GetOccupancy()).count();
+            }
+            /**
+             * @brief Calculate smallest distance between all the wires for each MDC layer
+             * 
+             * @param track1 fired wires of the first track
+             * @param track2 fired wires of the second track
+             * @return collection of smallest distances 
+             */
+            [[nodiscard]] WireDistances CalculateWireDistances(const PackedLayersTrack &track1, const PackedLayersTrack &track2) noexcept
+            {
+                WireDistances wireDistances;
+                const PackedLayersTrack::Mask both = track1.GetOccupancy() & track2.GetOccupancy();
+
+                for (const auto &layer : WireInfo::allLayerIndexing)
+                {
+                    if (!((both >> layer) & 1u))
+                        continue;
+
+                    long minDist = std::numeric_limits<unsigned>::max();
+                    for (std::size_t slot1 = 0; slot1 < track1.GetNWires(layer); ++slot1)
+                        for (std::size_t slot2 = 0; slot2 < track2.GetNWires(layer); ++slot2)
+                            minDist = std::min(minDist, std::abs(static_cast<long>(track1.GetWire(layer,slot1)) - static_cast<long>(track2.GetWire(layer,slot2))));
+
+                    wireDistances[layer] = OptionalDistance<unsigned>(minDist);
+                }
+
+                return wireDistances;
+            }
+            /**
+             * @brief Calculate number of shared wires within the pair of tracks
+             * 
+             * @param track1 fired wires of the first track
+             * @param track2 fired wires of the second track
+             * @return number of shared wires
+             */
+            [[nodiscard]] unsigned CalculateSharedWires(const PackedLayersTrack &track1, const PackedLayersTrack &track2) noexcept
+            {
+                unsigned sharedWires = 0;
+                const PackedLayersTrack::Mask both = track1.GetOccupancy() & track2.GetOccupancy();
+
+                for (const auto &layer : WireInfo::allLayerIndexing)
+                {
+                    if (!((both >> layer) & 1u))
+                        continue;
+
+                    for (std::size_t slot1 = 0; slot1 < track1.GetNWires(layer); ++slot1)
+                        for (std::size_t slot2 = 0; slot2 < track2.GetNWires(layer); ++slot2)
+                            if (track1.GetWire(layer,slot1) == track2.GetWire(layer,slot2))
+                                ++sharedWires;
+                }
+
+                return sharedWires;
+            }
+            /**
+             * @brief Calculate pair splitting level according to Adams J., et al., Phys. Rev. C 71.4 (2005): 044906
+             * 
+             * @param track1 fired wires of the first track
+             * @param track2 fired wires of the second track
+             * @return splitting level (e.g. SL = -0.5 no splitting, SL = 1 possible split tracks)
+             */
+            [[nodiscard]] double CalcluateSplittingLevel(const PackedLayersTrack &track1, const PackedLayersTrack &track2) noexcept
+            {
+                using Bits = std::bitset<WireInfo::numberOfAllLayers>;
+                const PackedLayersTrack::Mask occ1 = track1.GetOccupancy(), occ2 = track2.GetOccupancy();
+                const long both = Bits(occ1 & occ2).count();
+                const long single = Bits(occ1 ^ occ2).count();
+                const std::size_t nHits = Bits(occ1).count() + Bits(occ2).count();
+
+                return (nHits > 0) ? static_cast<double>(single - both) / nHits : 0.;
+            }
         } // namespace MDC
         
     } // namespace HADES
@@ -0,0 +1,61 @@
+/**
+ * @file MixingGroups.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Integer identifiers of the event and pair groups used by the mixer
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef MixingGroups_hxx
+    #define MixingGroups_hxx
+
+    #include <cstddef>
+    #include <cstdint>
+    #include <limits>
+
+    namespace Mixing
+    {
+        /**
+         * @brief Identifier of an event or pair group. Human-readable names are created from it only when the output is written
+         *
+         */
+        using GroupId = std::uint32_t;
+
+        /**
+         * @brief Group of pairs which fall outside of all analysed intervals (formerly "0")
+         *
+         */
+        constexpr GroupId outOfRangeGroup = 0;
+        /**
+         * @brief Group of pairs rejected by the pair cutting function (formerly "bad")
+         *
+         */
+        constexpr GroupId rejectedGroup = std::numeric_limits<GroupId>::max();
+
+        /**
+         * @brief Maps the group ID onto a dense slot index: the out-of-range group is the first slot, the rejected group is the last one
+         *
+         * @param group group ID
+         * @param nSlots number of slots
+         * @return slot index
+         */
+        [[nodiscard]] constexpr std::size_t GetGroupSlot(GroupId group, std::size_t nSlots) noexcept
+        {
+            return (group == rejectedGroup) ? nSlots - 1 : group;
+        }
+        /**
+         * @brief Inverse of GetGroupSlot
+         *
+         * @param slot slot index
+         * @param nSlots number of slots
+         * @return group ID
+         */
+        [[nodiscard]] constexpr GroupId GetSlotGroup(std::size_t slot, std::size_t nSlots) noexcept
+        {
+            return (slot == nSlots - 1) ? rejectedGroup : static_cast<GroupId>(slot);
+        }
+    } // namespace Mixing
+
+#endif
@@ -0,0 +1,330 @@
+/**
+ * @file MixingPool.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Buffer of the events used for mixing. Each event class is a fixed-capacity ring of track blocks, which are reused instead of reallocated.
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef MixingPool_hxx
+    #define MixingPool_hxx
+
+    #include <algorithm>
+    #include <cmath>
+    #include <cstddef>
+    #include <cstdint>
+    #include <iostream>
+    #include <limits>
+    #include <map>
+    #include <numeric>
+    #include <vector>
+
+    #include "MixingGroups.hxx"
+    #include "MomentumKDTree.hxx"
+    #include "TrackStore.hxx"
+
+    namespace Mixing
+    {
+        /**
+         * @brief Mixing buffer keyed by the integer event class. Every class owns a ring of maxDepth slots, and each slot is a Selection::TrackStore reserved for maxTracks tracks. Inserting an event copies its tracks (optionally ordered by rapidity) into the oldest slot, so after the rings are filled no memory is allocated (unless an event has more than maxTracks tracks, then the slot grows once and keeps its capacity). The memory is bounded by classes x depth x max tracks. The tracks of each class can also be searched by their momentum (ForEachNeighbour).
+         *
+         */
+        class MixingPool
+        {
+            private:
+                struct Slot
+                {
+                    Selection::TrackStore store;
+                    std::vector<Selection::TrackHandle> tracks; // handles pointing into the store of this slot
+                };
+
+                struct Ring
+                {
+                    std::vector<Slot> slots; // never resized after creation, so the handles stay valid
+                    std::size_t next = 0; // slot which will be overwritten by the next event
+                    std::size_t size = 0; // number of stored events
+                    // momentum tree of all stored tracks, rebuilt lazily when queried after an insertion
+                    mutable MomentumKDTree tree;
+                    mutable std::vector<std::pair<std::uint32_t,std::uint32_t> > treeTracks; // (slot, track) of each tree point
+                    mutable float maxGamma = 1;
+                    mutable bool isTreeValid = false;
+                };
+
+                std::size_t m_depth, m_maxTracks;
+                bool m_sortByRapidity;
+                std::map<GroupId,Ring> m_rings;
+                std::vector<std::size_t> m_order; // scratch space for sorting the inserted tracks
+
+                /**
+                 * @brief Get the ring of a given class, create it (with all slots reserved) if it does not exist
+                 *
+                 * @param eventClass
+                 * @return Ring&
+                 */
+                Ring& GetRing(GroupId eventClass)
+                {
+                    auto [iter,isNew] = m_rings.try_emplace(eventClass);
+                    if (isNew)
+                    {
+                        iter->second.slots = std::vector<Slot>(m_depth);
+                        for (auto &slot : iter->second.slots)
+                        {
+                            slot.store.Reserve(m_maxTracks);
+                            slot.tracks.reserve(m_maxTracks);
+                        }
+                    }
+                    return iter->second;
+                }
+
+                /**
+                 * @brief Rebuild the momentum tree of the ring if any event was inserted since it was built
+                 *
+                 * @param ring
+                 */
+                void UpdateTree(const Ring &ring) const
+                {
+                    if (ring.isTreeValid)
+                        return;
+
+                    ring.tree.Clear();
+                    ring.treeTracks.clear();
+                    ring.maxGamma = 1;
+                    for (std::size_t i = 0; i < ring.size; ++i)
+                    {
+                        const std::size_t slotIndex = (ring.next + m_depth - ring.size + i) % m_depth;
+                        const Slot &slot = ring.slots[slotIndex];
+                        for (std::size_t j = 0; j < slot.tracks.size(); ++j)
+                        {
+                            const auto &track = slot.tracks[j];
+                            ring.tree.Add(track.GetPx(),track.GetPy(),track.GetPz(),ring.treeTracks.size());
+                            ring.treeTracks.emplace_back(slotIndex,j);
+                            ring.maxGamma = std::max(ring.maxGamma,GetGamma(track));
+                        }
+                    }
+                    ring.tree.Build();
+                    ring.isTreeValid = true;
+                }
+
+            public:
+                /**
+                 * @brief Construct a new Mixing Pool object
+                 *
+                 * @param depth maximal number of events stored in each class
+                 * @param maxTracks number of tracks reserved for each stored event
+                 */
+                explicit MixingPool(std::size_t depth = 1, std::size_t maxTracks = 32) : m_depth(depth), m_maxTracks(maxTracks), m_sortByRapidity(false) {}
+                MixingPool(const MixingPool &) = delete;
+                MixingPool& operator=(const MixingPool &) = delete;
+                MixingPool(MixingPool &&) = default;
+                MixingPool& operator=(MixingPool &&) = default;
+                /**
+                 * @brief Change the depth and the reserved number of tracks. All stored events are removed
+                 *
+                 * @param depth maximal number of events stored in each class
+                 * @param maxTracks number of tracks reserved for each stored event
+                 */
+                void Configure(std::size_t depth, std::size_t maxTracks)
+                {
+                    m_depth = depth;
+                    m_maxTracks = maxTracks;
+                    m_rings.clear();
+                }
+                /**
+                 * @brief Store the tracks of each event ordered by rapidity (needed for the pruning of the partner tracks by the mixer). All stored events are removed
+                 *
+                 * @param sort
+                 */
+                void SetSortByRapidity(bool sort)
+                {
+                    m_sortByRapidity = sort;
+                    m_rings.clear();
+                }
+                /**
+                 * @brief Check if the tracks of the stored events are ordered by rapidity
+                 *
+                 * @return true if the tracks are sorted
+                 */
+                [[nodiscard]] bool IsSortedByRapidity() const noexcept {return m_sortByRapidity;}
+                /**
+                 * @brief Store the tracks of the event in its class, replacing the oldest stored event if the ring is full
+                 *
+                 * @param eventClass
+                 * @param eventId unique ID of the event
+                 * @param tracks handles to the tracks of the event
+                 */
+                void Insert(GroupId eventClass, Selection::EventIdentifier eventId, const std::vector<Selection::TrackHandle> &tracks)
+                {
+                    if (m_depth == 0)
+                        return;
+
+                    Ring &ring = GetRing(eventClass);
+                    Slot &slot = ring.slots[ring.next];
+                    slot.store.Reset(eventId);
+                    slot.tracks.clear();
+                    if (m_sortByRapidity)
+                    {
+                        m_order.resize(tracks.size());
+                        std::iota(m_order.begin(),m_order.end(),0);
+                        std::stable_sort(m_order.begin(),m_order.end(),[&tracks](std::size_t a, std::size_t b) {return tracks[a].GetRapidity() < tracks[b].GetRapidity();});
+                        for (const std::size_t i : m_order)
+                            slot.tracks.push_back(slot.store.GetHandle(slot.store.Add(tracks[i])));
+                    }
+                    else
+                    {
+                        for (const auto &track : tracks)
+                            slot.tracks.push_back(slot.store.GetHandle(slot.store.Add(track)));
+                    }
+
+                    ring.next = (ring.next + 1) % m_depth;
+                    ring.size = std::min(ring.size + 1,m_depth);
+                    ring.isTreeValid = false;
+                }
+                /**
+                 * @brief Visit all events stored in the class, from the oldest to the newest
+                 *
+                 * @param eventClass
+                 * @param func callable with the signature void(Selection::EventIdentifier eventId, const std::vector<Selection::TrackHandle> &tracks)
+                 */
+                template <typename Func>
+                void ForEachEvent(GroupId eventClass, Func &&func) const
+                {
+                    const auto iter = m_rings.find(eventClass);
+                    if (iter == m_rings.end())
+                        return;
+
+                    const Ring &ring = iter->second;
+                    for (std::size_t i = 0; i < ring.size; ++i)
+                    {
+                        const Slot &slot = ring.slots[(ring.next + m_depth - ring.size + i) % m_depth];
+                        func(slot.store.GetEventID(),slot.tracks);
+                    }
+                }
+                /**
+                 * @brief Visit the stored tracks of the class whose momentum vector lies within the radius from the given one. The search uses a KD-tree of all tracks of the class, which is built on the first query after an insertion
+                 *
+                 * @param eventClass
+                 * @param px
+                 * @param py
+                 * @param pz
+                 * @param radius
+                 * @param func callable with the signature void(Selection::EventIdentifier eventId, const Selection::TrackHandle &track)
+                 */
+                template <typename Func>
+                void ForEachNeighbour(GroupId eventClass, float px, float py, float pz, float radius, Func &&func) const
+                {
+                    const auto iter = m_rings.find(eventClass);
+                    if (iter == m_rings.end())
+                        return;
+
+                    const Ring &ring = iter->second;
+                    UpdateTree(ring);
+                    ring.tree.ForEachInRadius(px,py,pz,radius,[&](std::uint32_t payload)
+                    {
+                        const auto [slotIndex,trackIndex] = ring.treeTracks[payload];
+                        const Slot &slot = ring.slots[slotIndex];
+                        func(slot.store.GetEventID(),slot.tracks[trackIndex]);
+                    });
+                }
+                /**
+                 * @brief Get the largest Lorentz factor of the tracks stored in the class
+                 *
+                 * @param eventClass
+                 * @return float
+                 */
+                [[nodiscard]] float GetMaxGamma(GroupId eventClass) const
+                {
+                    const auto iter = m_rings.find(eventClass);
+                    if (iter == m_rings.end())
+                        return 1;
+
+                    UpdateTree(iter->second);
+                    return iter->second.maxGamma;
+                }
+                /**
+                 * @brief Get the Lorentz factor of the track
+                 *
+                 * @param track
+                 * @return float
+                 */
+                [[nodiscard]] static float GetGamma(const Selection::TrackHandle &track) noexcept
+                {
+                    const float p2 = track.GetPx() * track.GetPx() + track.GetPy() * track.GetPy() + track.GetPz() * track.GetPz();
+                    const float e = track.GetEnergy();
+                    return e / std::sqrt(std::max(e * e - p2,std::numeric_limits<float>::min()));
+                }
+                /**
+                 * @brief Get the maximal number of events stored in each class
+                 *
+                 * @return std::size_t
+                 */
+                [[nodiscard]] std::size_t GetDepth() const noexcept {return m_depth;}
+                /**
+                 * @brief Get the number of tracks reserved for each stored event
+                 *
+                 * @return std::size_t
+                 */
+                [[nodiscard]] std::size_t GetMaxTracks() const noexcept {return m_maxTracks;}
+                /**
+                 * @brief Get the number of event classes which have a ring
+                 *
+                 * @return std::size_t
+                 */
+                [[nodiscard]] std::size_t GetNClasses() const noexcept {return m_rings.size();}
+                /**
+                 * @brief Get the event classes which have a ring, in ascending order
+                 *
+                 * @return std::vector<GroupId>
+                 */
+                [[nodiscard]] std::vector<GroupId> GetClasses() const
+                {
+                    std::vector<GroupId> classes;
+                    classes.reserve(m_rings.size());
+                    for (const auto &[eventClass,ring] : m_rings)
+                        classes.push_back(eventClass);
+
+                    return classes;
+                }
+                /**
+                 * @brief Get the number of events stored in the class
+                 *
+                 * @param eventClass
+                 * @return std::size_t
+                 */
+                [[nodiscard]] std::size_t GetSize(GroupId eventClass) const
+                {
+                    const auto iter = m_rings.find(eventClass);
+                    return (iter == m_rings.end()) ? 0 : iter->second.size;
+                }
+                /**
+                 * @brief Get the size of the memory allocated by all rings
+                 *
+                 * @return std::size_t
+                 */
+                [[nodiscard]] std::size_t GetAllocatedBytes() const noexcept
+                {
+                    std::size_t bytes = 0;
+                    for (const auto &[eventClass,ring] : m_rings)
+                    {
+                        for (const auto &slot : ring.slots)
+                            bytes += sizeof(Slot) + slot.store.GetAllocatedBytes() + slot.tracks.capacity() * sizeof(Selection::TrackHandle);
+                        bytes += ring.tree.GetAllocatedBytes() + ring.treeTracks.capacity() * sizeof(std::pair<std::uint32_t,std::uint32_t>);
+                    }
+
+                    return bytes;
+                }
+                /**
+                 * @brief Print how much of the ring was filled for each event class
+                 *
+                 */
+                void PrintStatus() const
+                {
+                    for (const auto &[eventClass,ring] : m_rings)
+                        std::cout << eventClass << ":\t" << ring.size << "/" << m_depth << "\n";
+                    std::cout << "allocated memory: " << GetAllocatedBytes() / 1024. / 1024. << " MB\n";
+                }
+        };
+    } // namespace Mixing
+
+#endif
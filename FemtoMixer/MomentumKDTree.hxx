@@ -0,0 +1,135 @@
+/**
+ * @file MomentumKDTree.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Static 3D KD-tree of track momenta, used to find the partner tracks which can form a low-q pair without looping over all of them
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef MomentumKDTree_hxx
+    #define MomentumKDTree_hxx
+
+    #include <algorithm>
+    #include <array>
+    #include <cstddef>
+    #include <cstdint>
+    #include <vector>
+
+    namespace Mixing
+    {
+        /**
+         * @brief Implicit KD-tree over 3D momentum vectors. The points are stored in a single vector ordered as a balanced tree (the median of each range is its node, ranges of at most leafSize points are leaves scanned linearly), so building does not allocate once the vector has grown and the tree has no node objects. Each point carries a user-defined 32-bit payload (e.g. the index of the track)
+         *
+         */
+        class MomentumKDTree
+        {
+            public:
+                struct Point
+                {
+                    std::array<float,3> p;
+                    std::uint32_t payload;
+                };
+
+            private:
+                static constexpr std::size_t leafSize = 8;
+                std::vector<Point> m_points;
+
+                /**
+                 * @brief Order the range [first,last) as a subtree split along the given axis
+                 *
+                 * @param first
+                 * @param last
+                 * @param axis
+                 */
+                void Build(std::size_t first, std::size_t last, std::size_t axis)
+                {
+                    if (last - first <= leafSize)
+                        return;
+
+                    const std::size_t mid = first + (last - first) / 2;
+                    std::nth_element(m_points.begin() + first,m_points.begin() + mid,m_points.begin() + last,[axis](const Point &a, const Point &b) {return a.p[axis] < b.p[axis];});
+                    Build(first,mid,(axis + 1) % 3);
+                    Build(mid + 1,last,(axis + 1) % 3);
+                }
+
+                template <typename Func>
+                void Query(std::size_t first, std::size_t last, std::size_t axis, const std::array<float,3> &center, float radius2, Func &func) const
+                {
+                    if (last - first <= leafSize)
+                    {
+                        for (std::size_t i = first; i < last; ++i)
+                        {
+                            const float dx = m_points[i].p[0] - center[0], dy = m_points[i].p[1] - center[1], dz = m_points[i].p[2] - center[2];
+                            if (dx * dx + dy * dy + dz * dz <= radius2)
+                                func(m_points[i].payload);
+                        }
+                        return;
+                    }
+
+                    const std::size_t mid = first + (last - first) / 2;
+                    const Point &node = m_points[mid];
+                    const float dx = node.p[0] - center[0], dy = node.p[1] - center[1], dz = node.p[2] - center[2];
+                    if (dx * dx + dy * dy + dz * dz <= radius2)
+                        func(node.payload);
+
+                    const float delta = center[axis] - node.p[axis];
+                    const std::size_t nextAxis = (axis + 1) % 3;
+                    if (delta <= 0 || delta * delta <= radius2)
+                        Query(first,mid,nextAxis,center,radius2,func);
+                    if (delta >= 0 || delta * delta <= radius2)
+                        Query(mid + 1,last,nextAxis,center,radius2,func);
+                }
+
+            public:
+                MomentumKDTree() {}
+                /**
+                 * @brief Remove all points (the memory is kept)
+                 *
+                 */
+                void Clear() noexcept {m_points.clear();}
+                /**
+                 * @brief Add a point, the tree has to be rebuilt with Build before the next query
+                 *
+                 * @param px
+                 * @param py
+                 * @param pz
+                 * @param payload
+                 */
+                void Add(float px, float py, float pz, std::uint32_t payload) {m_points.push_back({{px,py,pz},payload});}
+                /**
+                 * @brief Order the added points as a tree
+                 *
+                 */
+                void Build() {Build(0,m_points.size(),0);}
+                /**
+                 * @brief Call the function for every point within the radius from the center
+                 *
+                 * @param px
+                 * @param py
+                 * @param pz
+                 * @param radius
+                 * @param func callable with the signature void(std::uint32_t payload)
+                 */
+                template <typename Func>
+                void ForEachInRadius(float px, float py, float pz, float radius, Func &&func) const
+                {
+                    Query(0,m_points.size(),0,{px,py,pz},radius * radius,func);
+                }
+                /**
+                 * @brief Get the number of points
+                 *
+                 * @return std::size_t
+                 */
+                [[nodiscard]] std::size_t size() const noexcept {return m_points.size();}
+                /**
+                 * @brief Get the size of the memory allocated by the tree
+                 *
+                 * @return std::size_t
+                 */
+                [[nodiscard]] std::size_t GetAllocatedBytes() const noexcept {return m_points.capacity() * sizeof(Point);}
+        };
+    } // namespace Mixing
+
+#endif
@@ -0,0 +1,295 @@
+/**
+ * @file PairBinning.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Compile-time description of the pair groups: every axis is a type (the pair variable and its intervals), so the group ID of a pair is computed by code which the compiler can fully inline
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef PairBinning_hxx
+    #define PairBinning_hxx
+
+    #include <array>
+    #include <cstddef>
+    #include <cstdint>
+    #include <memory>
+    #include <string>
+    #include <tuple>
+
+    #include "JJUtils.hxx"
+    #include "MixingGroups.hxx"
+
+    namespace Mixing
+    {
+        /**
+         * @brief Pair variables which can be used as binning axes. Each one reads the value from the pair and has a short label used in the names of the merged histograms (see Mixing::FemtoMerger)
+         *
+         */
+        namespace PairVariable
+        {
+            struct Kt
+            {
+                static constexpr const char *label = "Kt";
+
+                template <typename Pair>
+                [[nodiscard]] static float Get(const Pair &pair) noexcept {return pair.GetKt();}
+            };
+            struct Rapidity
+            {
+                static constexpr const char *label = "Y";
+
+                template <typename Pair>
+                [[nodiscard]] static float Get(const Pair &pair) noexcept {return pair.GetRapidity();}
+            };
+            struct AzimuthalAngle
+            {
+                static constexpr const char *label = "Psi";
+
+                template <typename Pair>
+                [[nodiscard]] static float Get(const Pair &pair) noexcept {return pair.GetPhi();}
+            };
+        } // namespace PairVariable
+
+        namespace Detail
+        {
+            template <typename T, std::size_t N>
+            [[nodiscard]] constexpr bool IsStrictlyIncreasing(const std::array<T,N> &edges) noexcept
+            {
+                for (std::size_t i = 1; i < N; ++i)
+                    if (!(edges[i - 1] < edges[i]))
+                        return false;
+
+                return true;
+            }
+        } // namespace Detail
+
+        /**
+         * @brief Axis with arbitrary interval edges, the bin is found by binary search. Bin i (counting from 1) is the interval (edges[i-1], edges[i]], values outside of all intervals give bin 0
+         *
+         * @tparam Variable pair variable (see Mixing::PairVariable)
+         * @tparam Edges constexpr std::array of the interval edges with static storage duration (e.g. an inline constexpr variable)
+         */
+        template <typename Variable, const auto &Edges>
+        struct VariableAxis
+        {
+            static_assert(Edges.size() > 1,"VariableAxis: at least one interval is needed");
+            static_assert(Detail::IsStrictlyIncreasing(Edges),"VariableAxis: the edges have to be strictly increasing");
+
+            static constexpr std::size_t nBins = Edges.size() - 1;
+            static constexpr const char *label = Variable::label;
+
+            /**
+             * @brief Find the interval of the value
+             *
+             * @param value
+             * @return bin number in [1,nBins], or 0 if the value is outside of the axis
+             */
+            [[nodiscard]] static constexpr std::size_t FindBin(float value) noexcept
+            {
+                // the same as std::lower_bound, which is not constexpr in C++17
+                std::size_t first = 0, count = Edges.size();
+                while (count > 0)
+                {
+                    const std::size_t step = count / 2;
+                    if (Edges[first + step] < value)
+                    {
+                        first += step + 1;
+                        count -= step + 1;
+                    }
+                    else
+                    {
+                        count = step;
+                    }
+                }
+
+                return (first == 0 || first > nBins) ? 0 : first;
+            }
+            /**
+             * @brief Get the edge of the axis
+             *
+             * @param i edge index in [0,nBins]
+             * @return float
+             */
+            [[nodiscard]] static constexpr float GetEdge(std::size_t i) noexcept {return Edges[i];}
+            /**
+             * @brief Get the pair value of this axis
+             *
+             * @tparam Pair
+             * @param pair
+             * @return float
+             */
+            template <typename Pair>
+            [[nodiscard]] static float GetValue(const Pair &pair) noexcept {return Variable::Get(pair);}
+        };
+
+        /**
+         * @brief Axis with equal intervals, the bin is found by arithmetic. The range is (Min / Denominator, Max / Denominator] (template parameters cannot be floating point in C++17), the bins follow the same convention as in VariableAxis
+         *
+         * @tparam Variable pair variable (see Mixing::PairVariable)
+         * @tparam Min numerator of the lower edge of the axis
+         * @tparam Max numerator of the upper edge of the axis
+         * @tparam NBins number of intervals
+         * @tparam Denominator common denominator of the edges
+         */
+        template <typename Variable, std::int64_t Min, std::int64_t Max, std::size_t NBins, std::int64_t Denominator = 1>
+        struct UniformAxis
+        {
+            static_assert(NBins > 0,"UniformAxis: at least one interval is needed");
+            static_assert(Min < Max && Denominator > 0,"UniformAxis: the range has to be non-empty");
+
+            static constexpr std::size_t nBins = NBins;
+            static constexpr const char *label = Variable::label;
+
+            /**
+             * @brief Find the interval of the value
+             *
+             * @param value
+             * @return bin number in [1,nBins], or 0 if the value is outside of the axis
+             */
+            [[nodiscard]] static constexpr std::size_t FindBin(float value) noexcept
+            {
+                // in double precision the edges with a small denominator are exact, so a value equal to an edge lands in the lower bin (as with VariableAxis)
+                const double position = (static_cast<double>(value) * Denominator - Min) * NBins / (Max - Min);
+                if (!(position > 0.) || position > NBins) // also rejects NaN
+                    return 0;
+
+                const std::size_t bin = static_cast<std::size_t>(position);
+                return (bin < position) ? bin + 1 : bin;
+            }
+            /**
+             * @brief Get the edge of the axis
+             *
+             * @param i edge index in [0,nBins]
+             * @return float
+             */
+            [[nodiscard]] static constexpr float GetEdge(std::size_t i) noexcept
+            {
+                return static_cast<float>((Min + static_cast<double>(Max - Min) * i / NBins) / Denominator);
+            }
+            /**
+             * @brief Get the pair value of this axis
+             *
+             * @tparam Pair
+             * @param pair
+             * @return float
+             */
+            template <typename Pair>
+            [[nodiscard]] static float GetValue(const Pair &pair) noexcept {return Variable::Get(pair);}
+        };
+
+        /**
+         * @brief Grouping of the pairs into the cells of a multidimensional binning. The group ID of a cell is 1 + its row-major flat index (the last axis changes the fastest), pairs outside of any axis go to outOfRangeGroup. Stateless, so it can be used directly as the pair hashing function of JJFemtoMixer
+         *
+         * @tparam Axes VariableAxis or UniformAxis types
+         */
+        template <typename... Axes>
+        class Binning
+        {
+            static_assert(sizeof...(Axes) > 0,"Binning: at least one axis is needed");
+
+            public:
+                static constexpr std::size_t nAxes = sizeof...(Axes);
+                static constexpr std::size_t nBins = (Axes::nBins * ...);
+                // all cells plus the out-of-range and the rejected group
+                static constexpr std::size_t nGroupSlots = nBins + 2;
+                static constexpr std::array<std::size_t,nAxes> binsPerAxis{Axes::nBins...};
+
+                template <std::size_t I>
+                using Axis = std::tuple_element_t<I,std::tuple<Axes...> >;
+
+                /**
+                 * @brief Calculate the group of the pair
+                 *
+                 * @tparam Pair
+                 * @param pair
+                 * @return group ID (outOfRangeGroup if the pair is outside of the binning)
+                 */
+                template <typename Pair>
+                [[nodiscard]] static GroupId GetGroup(const Pair &pair) noexcept
+                {
+                    return GetGroup({Axes::FindBin(Axes::GetValue(pair))...});
+                }
+                /**
+                 * @brief Calculate the group of the cell
+                 *
+                 * @param bins bin number on each axis (counting from 1, 0 means out of range)
+                 * @return group ID (outOfRangeGroup if any bin is 0)
+                 */
+                [[nodiscard]] static constexpr GroupId GetGroup(const std::array<std::size_t,nAxes> &bins) noexcept
+                {
+                    std::size_t index = 0;
+                    for (std::size_t axis = 0; axis < nAxes; ++axis)
+                    {
+                        if (bins[axis] == 0)
+                            return outOfRangeGroup;
+                        index = index * binsPerAxis[axis] + (bins[axis] - 1);
+                    }
+
+                    return static_cast<GroupId>(index + 1);
+                }
+                /**
+                 * @brief Get the bin number on each axis of a group (inverse of GetGroup)
+                 *
+                 * @param group group ID of a cell (not outOfRangeGroup nor rejectedGroup)
+                 * @return bin number on each axis (counting from 1)
+                 */
+                [[nodiscard]] static constexpr std::array<std::size_t,nAxes> GetBins(GroupId group) noexcept
+                {
+                    std::array<std::size_t,nAxes> bins{};
+                    std::size_t index = group - 1;
+                    for (std::size_t axis = nAxes; axis-- > 0;)
+                    {
+                        bins[axis] = index % binsPerAxis[axis] + 1;
+                        index /= binsPerAxis[axis];
+                    }
+
+                    return bins;
+                }
+                /**
+                 * @brief Get the index of the slot in a dense array which corresponds to the group ID
+                 *
+                 * @param group group ID
+                 * @return slot index in [0, nGroupSlots)
+                 */
+                [[nodiscard]] static constexpr std::size_t GetGroupSlot(GroupId group) noexcept {return Mixing::GetGroupSlot(group,nGroupSlots);}
+                /**
+                 * @brief Get the group ID which corresponds to the slot of a dense array
+                 *
+                 * @param slot slot index
+                 * @return group ID
+                 */
+                [[nodiscard]] static constexpr GroupId GetSlotGroup(std::size_t slot) noexcept {return Mixing::GetSlotGroup(slot,nGroupSlots);}
+                /**
+                 * @brief Get the human-readable name of the group, i.e. the bin numbers on all axes with leading zeros ("0" for out-of-range and "bad" for rejected pairs). Meant to be used only when writing the output
+                 *
+                 * @param group group ID
+                 * @return group name
+                 */
+                [[nodiscard]] static std::string GetGroupName(GroupId group)
+                {
+                    if (group == outOfRangeGroup)
+                        return "0";
+                    if (group == rejectedGroup)
+                        return "bad";
+
+                    std::string name;
+                    for (const std::size_t bin : GetBins(group))
+                        name += JJUtils::to_fixed_size_string(bin,2);
+
+                    return name;
+                }
+                /**
+                 * @brief Calculate the group of the pair, so the binning can be passed as the pair hashing function
+                 *
+                 * @tparam Pair
+                 * @param pair
+                 * @return group ID
+                 */
+                template <typename Pair>
+                [[nodiscard]] GroupId operator()(const std::shared_ptr<Pair> &pair) const noexcept {return GetGroup(*pair);}
+        };
+    } // namespace Mixing
+
+#endif
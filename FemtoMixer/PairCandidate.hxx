@@ -2,6 +2,7 @@
     #define PairCandidate_hxx
 
     #include "EventCandidate.hxx"
+    #include "PairKinematics.hxx"
 
     namespace Selection
     {
@@ -10,33 +11,40 @@
             public:
                 enum class Behaviour{OneUnder,Uniform,Weighted};
                 /**
-                 * @brief Construct a new Pair Candidate object
+                 * @brief Construct a new Pair Candidate object. The LCMS kinematics is calculated in double precision.
                  * 
                  * @param trck1 
                  * @param trck2 
                  */
-                PairCandidate(const std::shared_ptr<TrackCandidate> &trck1, const std::shared_ptr<TrackCandidate> &trck2) : 
-                    pairId(trck1->GetID() + trck2->GetID()),
-                    Particle1(trck1), 
-                    Particle2(trck2), 
-                    GeantKinePair((trck1->GeantKineTrack == nullptr || trck1->GeantKineTrack == nullptr) ? nullptr : new PairCandidate(trck1->GeantKineTrack,trck2->GeantKineTrack)), 
-                    pairLayers(HADES::MDC::CreatePairLayers(trck1->GetAllWires(),trck2->GetAllWires())), 
-                    wireDistances(HADES::MDC::CalculateWireDistances(pairLayers)),
-                    SharedWires(HADES::MDC::CalculateSharedWires(pairLayers)), 
-                    BothLayers(HADES::MDC::CalculateBothLayers(pairLayers)), 
-                    SharedMetaCells(CalcSharedMetaCells(trck1,trck2)), 
-                    MinWireDistance(*std::min_element(wireDistances.begin(),wireDistances.end())), 
-                    QInv(0.), QOut(0.), QSide(0.), QLong(0.), Kt(0.), 
-                    Rapidity((trck1->GetRapidity() + trck2->GetRapidity()) / 2.), 
-                    AzimuthalAngle(ConstrainAngle(trck1->GetPhi() + trck2->GetPhi()) / 2.), 
-                    OpeningAngle(CalcOpeningAngle(trck1,trck2)), 
-                    DeltaPhi(trck1->GetPhi() - trck2->GetPhi()), 
-                    DeltaTheta(trck1->GetTheta() - trck2->GetTheta()), 
-                    SplittingLevel(HADES::MDC::CalcluateSplittingLevel(pairLayers)), 
-                    areSameSector(trck1->GetSector() == trck2->GetSector())
+                PairCandidate(const TrackHandle &trck1, const TrackHandle &trck2) : PairCandidate(trck1,trck2,PairKinematics{0.,0.,0.,0.,0.})
                 {
                     CFKinematics(trck1,trck2);
                 }
+                /**
+                 * @brief Construct a new Pair Candidate object with the LCMS kinematics already calculated (e.g. by Kinematics::CalculateBlock)
+                 * 
+                 * @param trck1 
+                 * @param trck2 
+                 * @param kinematics 
+                 */
+                PairCandidate(const TrackHandle &trck1, const TrackHandle &trck2, const PairKinematics &kinematics) : 
+                    Particle1(trck1), 
+                    Particle2(trck2), 
+                    GeantKinePair(nullptr), 
+                    wireDistances(), SharedWires(0), BothLayers(0), SharedMetaCells(0), MinWireDistance(), 
+                    QInv(kinematics.QInv), QOut(kinematics.QOut), QSide(kinematics.QSide), QLong(kinematics.QLong), Kt(kinematics.Kt), 
+                    Rapidity((trck1.GetRapidity() + trck2.GetRapidity()) / 2.), 
+                    AzimuthalAngle(ConstrainAngle(trck1.GetPhi() + trck2.GetPhi()) / 2.), 
+                    OpeningAngle(0.), 
+                    DeltaPhi(trck1.GetPhi() - trck2.GetPhi()), 
+                    DeltaTheta(trck1.GetTheta() - trck2.GetTheta()), 
+                    SplittingLevel(0.), 
+                    areSameSector(trck1.GetSector() == trck2.GetSector()),
+                    variationMask(trck1.GetVariationMask() & trck2.GetVariationMask()),
+                    pairCutMask(allVariations),
+                    calculatedVariables(0),
+                    isGeantKinePairCreated(false)
+                {}
                 /**
                  * @brief Perform pair selection based on the fraction of neighbouring wires with certain distance from each other. Allows for a modifiable behaviour of selection
                  * 
@@ -55,16 +63,30 @@
                         std::exit(1);
                     }
 
+                    return AreHitsTooClose<T>(fraction,cutoff);
+                }
+                /**
+                 * @brief Same as RejectPairByCloseHits, but without the range check of the fraction, which has to be validated by the caller beforehand (e.g. at compile time in Mixing::PairCut::CloseHits). Only the wire distances are calculated
+                 * 
+                 * @tparam T Behaviour type
+                 * @param fraction in what fraction of the all hits the merging can occur (between 0 and 1)
+                 * @param cutoff how close the wires are allowed to be
+                 * @return true if the pair should be rejected
+                 */
+                template<Behaviour T> 
+                [[nodiscard]] bool AreHitsTooClose(float fraction, unsigned cutoff) const noexcept
+                {
+                    CalcDetectorVariable(DetectorVariable::WireDistances);
                     return Reject(type<T>{},fraction,cutoff);
                 }
                 /**
-                 * @brief Returns unique ID of the pair
+                 * @brief Returns unique ID of the pair (use PairIdentifier::ToString to print it)
                  * 
-                 * @return std::string 
+                 * @return PairIdentifier 
                  */
-                std::string GetID() const noexcept
+                PairIdentifier GetID() const noexcept
                 {
-                    return pairId;
+                    return PairIdentifier{Particle1.GetID(),Particle2.GetID()};
                 }
                 /**
                  * @brief Get the transverse component of the average pair momentum
@@ -116,8 +138,9 @@
                  * 
                  * @return float 
                  */
-                float GetSplittingLevel() const noexcept
+                float GetSplittingLevel() const
                 {
+                    CalcDetectorVariable(DetectorVariable::SplittingLevel);
                     return SplittingLevel;
                 }
                 /**
@@ -125,8 +148,9 @@
                  * 
                  * @return unsigned int 
                  */
-                unsigned GetSharedWires() const noexcept
+                unsigned GetSharedWires() const
                 {
+                    CalcDetectorVariable(DetectorVariable::SharedWires);
                     return SharedWires;
                 }
                 /**
@@ -134,8 +158,9 @@
                  * 
                  * @return unsigned 
                  */
-                unsigned GetBothLayers() const noexcept
+                unsigned GetBothLayers() const
                 {
+                    CalcDetectorVariable(DetectorVariable::BothLayers);
                     return BothLayers;
                 }
                 /**
@@ -143,8 +168,9 @@
                  * 
                  * @return collection of distances between the wires in each MDC layer
                  */
-                HADES::MDC::WireDistances GetAllLayerDistances() const noexcept
+                const HADES::MDC::WireDistances& GetAllLayerDistances() const
                 {
+                    CalcDetectorVariable(DetectorVariable::WireDistances);
                     return wireDistances;
                 }
                 /**
@@ -152,14 +178,26 @@
                  * 
                  * @return unsigned 
                  */
-                HADES::MDC::OptionalDistance<unsigned> GetMinWireDistance() const noexcept
+                HADES::MDC::OptionalDistance<unsigned> GetMinWireDistance() const
                 {
+                    CalcDetectorVariable(DetectorVariable::WireDistances);
                     return MinWireDistance;
                 }
-                unsigned GetSharedMetaCells() const noexcept
+                unsigned GetSharedMetaCells() const
                 {
+                    CalcDetectorVariable(DetectorVariable::SharedMetaCells);
                     return SharedMetaCells;
                 }
+                /**
+                 * @brief Get the opening angle between the two tracks
+                 * 
+                 * @return float 
+                 */
+                float GetOpeningAngle() const
+                {
+                    CalcDetectorVariable(DetectorVariable::OpeningAngle);
+                    return OpeningAngle;
+                }
                 /**
                  * @brief Get the Qinv
                  * 
@@ -183,8 +221,14 @@
                  * 
                  * @return std::shared_ptr<PairCandidate> 
                  */
-                [[nodiscard]] const std::shared_ptr<PairCandidate>& GetGeantKinePair() const noexcept
+                [[nodiscard]] const std::shared_ptr<PairCandidate>& GetGeantKinePair() const
                 {
+                    if (!isGeantKinePairCreated)
+                    {
+                        if (Particle1.HasGeantKine() && Particle2.HasGeantKine())
+                            GeantKinePair = std::make_shared<PairCandidate>(Particle1.GetGeantKine(),Particle2.GetGeantKine());
+                        isGeantKinePairCreated = true;
+                    }
                     return GeantKinePair;
                 }
                 /**
@@ -196,31 +240,105 @@
                 {
                     return areSameSector;
                 }
+                /**
+                 * @brief Get the cut variations which accept both tracks (and their events)
+                 * 
+                 * @return VariationMask 
+                 */
+                [[nodiscard]] VariationMask GetVariationMask() const noexcept
+                {
+                    return variationMask;
+                }
+                /**
+                 * @brief Get the cut variations whose pair cuts accept this pair (all of them if the pair cuts were not evaluated)
+                 * 
+                 * @return VariationMask 
+                 */
+                [[nodiscard]] VariationMask GetPairCutMask() const noexcept
+                {
+                    return pairCutMask;
+                }
+                /**
+                 * @brief Set the cut variations whose pair cuts accept this pair
+                 * 
+                 * @param mask 
+                 */
+                void SetPairCutMask(VariationMask mask) noexcept
+                {
+                    pairCutMask = mask;
+                }
             private:
-                std::string pairId;
-                std::shared_ptr<TrackCandidate> Particle1,Particle2;
-                std::shared_ptr<PairCandidate> GeantKinePair;
-                HADES::MDC::LayersPair pairLayers;
-                HADES::MDC::WireDistances wireDistances;
-                unsigned SharedWires, BothLayers, SharedMetaCells;
-                HADES::MDC::OptionalDistance<unsigned> MinWireDistance;
-                float QInv, QOut, QSide, QLong, Kt, Rapidity, AzimuthalAngle, OpeningAngle, DeltaPhi, DeltaTheta, SplittingLevel;
+                TrackHandle Particle1,Particle2;
+                // the detector-level (close-track) variables and the HGeantKine pair are calculated only when they are requested
+                mutable std::shared_ptr<PairCandidate> GeantKinePair;
+                mutable HADES::MDC::WireDistances wireDistances;
+                mutable unsigned SharedWires, BothLayers, SharedMetaCells;
+                mutable HADES::MDC::OptionalDistance<unsigned> MinWireDistance;
+                float QInv, QOut, QSide, QLong, Kt, Rapidity, AzimuthalAngle;
+                mutable float OpeningAngle;
+                float DeltaPhi, DeltaTheta;
+                mutable float SplittingLevel;
                 bool areSameSector;
+                VariationMask variationMask, pairCutMask;
+                // bits of calculatedVariables, each detector-level variable is calculated separately, so a cheap pair cut does not pay for the expensive ones
+                enum class DetectorVariable : std::uint8_t {BothLayers = 1u << 0, SharedMetaCells = 1u << 1, WireDistances = 1u << 2, SharedWires = 1u << 3, SplittingLevel = 1u << 4, OpeningAngle = 1u << 5};
+                mutable std::uint8_t calculatedVariables;
+                mutable bool isGeantKinePairCreated;
                 template <Behaviour T> struct type {}; // helper struct
 
+                /**
+                 * @brief Calculates the detector-level variable (wire distances together with the minimal distance, shared wires, layers fired by both tracks, shared META cells, splitting level or opening angle) if it was not calculated yet
+                 * 
+                 * @param variable
+                 */
+                void CalcDetectorVariable(DetectorVariable variable) const noexcept
+                {
+                    const auto bit = static_cast<std::uint8_t>(variable);
+                    if (calculatedVariables & bit)
+                        return;
+
+                    const auto &wires1 = Particle1.GetPackedWires();
+                    const auto &wires2 = Particle2.GetPackedWires();
+                    switch (variable)
+                    {
+                        case DetectorVariable::BothLayers:
+                            BothLayers = HADES::MDC::CalculateBothLayers(wires1,wires2);
+                            break;
+                        case DetectorVariable::SharedMetaCells:
+                            SharedMetaCells = CalcSharedMetaCells(Particle1,Particle2);
+                            break;
+                        case DetectorVariable::WireDistances:
+                            wireDistances = HADES::MDC::CalculateWireDistances(wires1,wires2);
+                            MinWireDistance = *std::min_element(wireDistances.begin(),wireDistances.end());
+                            break;
+                        case DetectorVariable::SharedWires:
+                            SharedWires = HADES::MDC::CalculateSharedWires(wires1,wires2);
+                            break;
+                        case DetectorVariable::SplittingLevel:
+                            SplittingLevel = HADES::MDC::CalcluateSplittingLevel(wires1,wires2);
+                            break;
+                        case DetectorVariable::OpeningAngle:
+                            OpeningAngle = CalcOpeningAngle(Particle1,Particle2);
+                            break;
+                    }
+                    calculatedVariables |= bit;
+                }
+
                 /**
                  * @brief Calculates the pair variables in their centre of mass system (here: LCMS)
                  * 
                  * @param part1 
                  * @param part2 
                  */
-                void CFKinematics(const std::shared_ptr<TrackCandidate> &part1, const std::shared_ptr<TrackCandidate> &part2)
+                void CFKinematics(const TrackHandle &part1, const TrackHandle &part2)
                 {
                     // adapted from https://github.com/DanielWielanek/HAL/blob/main/analysis/femto/base/FemtoPairKinematics.cxx
-                    double tPx = part1->Px + part2->Px;
-                    double tPy = part1->Py + part2->Py;
-                    double tPz = part1->Pz + part2->Pz;
-                    double tE = part1->Energy + part2->Energy;
+                    const double p1x = part1.GetPx(), p1y = part1.GetPy(), p1z = part1.GetPz(), p1e = part1.GetEnergy();
+                    const double p2x = part2.GetPx(), p2y = part2.GetPy(), p2z = part2.GetPz(), p2e = part2.GetEnergy();
+                    double tPx = p1x + p2x;
+                    double tPy = p1y + p2y;
+                    double tPz = p1z + p2z;
+                    double tE = p1e + p2e;
                     double tPt = tPx * tPx + tPy * tPy;
                     double tMt = tE * tE - tPz * tPz;  // mCVK;
                     tMt = std::sqrt(tMt);
@@ -230,18 +348,18 @@
 
                     // Transform to LCMS
 
-                    double particle1lcms_pz = tGamma * (part1->Pz - tBeta * part1->Energy);
-                    double particle1lcms_e  = tGamma * (part1->Energy - tBeta * part1->Pz);
-                    double particle2lcms_pz = tGamma * (part2->Pz - tBeta * part2->Energy);
-                    double particle2lcms_e  = tGamma * (part2->Energy - tBeta * part2->Pz);
+                    double particle1lcms_pz = tGamma * (p1z - tBeta * p1e);
+                    double particle1lcms_e  = tGamma * (p1e - tBeta * p1z);
+                    double particle2lcms_pz = tGamma * (p2z - tBeta * p2e);
+                    double particle2lcms_e  = tGamma * (p2e - tBeta * p2z);
 
                     // Rotate in transverse plane
 
-                    double particle1lcms_px = (part1->Px * tPx + part1->Py * tPy) / Kt;
-                    double particle1lcms_py = (-part1->Px * tPy + part1->Py * tPx) / Kt;
+                    double particle1lcms_px = (p1x * tPx + p1y * tPy) / Kt;
+                    double particle1lcms_py = (-p1x * tPy + p1y * tPx) / Kt;
 
-                    double particle2lcms_px = (part2->Px * tPx + part2->Py * tPy) / Kt;
-                    double particle2lcms_py = (-part2->Px * tPy + part2->Py * tPx) / Kt;
+                    double particle2lcms_px = (p2x * tPx + p2y * tPy) / Kt;
+                    double particle2lcms_py = (-p2x * tPy + p2y * tPx) / Kt;
 
                     QOut = std::abs(particle1lcms_px - particle2lcms_px);
                     QSide = std::abs(particle1lcms_py - particle2lcms_py);
@@ -256,16 +374,18 @@
                  * @param part2 
                  * @return float 
                  */
-                float CalcOpeningAngle(const std::shared_ptr<TrackCandidate> &part1, const std::shared_ptr<TrackCandidate> &part2) const
+                float CalcOpeningAngle(const TrackHandle &part1, const TrackHandle &part2) const noexcept
                 {
-                    float ptot = std::sqrt((part1->Px*part1->Px + part1->Py*part1->Py + part1->Pz*part1->Pz) * (part2->Px*part2->Px + part2->Py*part2->Py + part2->Pz*part2->Pz));
+                    const float p1x = part1.GetPx(), p1y = part1.GetPy(), p1z = part1.GetPz();
+                    const float p2x = part2.GetPx(), p2y = part2.GetPy(), p2z = part2.GetPz();
+                    float ptot = std::sqrt((p1x*p1x + p1y*p1y + p1z*p1z) * (p2x*p2x + p2y*p2y + p2z*p2z));
                     if (ptot <= 0.)
                     {	
                         return 0.;
                     }
                     else
                     {
-                        float arg = (part1->Px*part2->Px + part1->Py*part2->Py + part1->Pz*part2->Pz) / ptot;
+                        float arg = (p1x*p2x + p1y*p2y + p1z*p2z) / ptot;
                         if (arg > 1.) return 1.;
                         if (arg < -1.) return -1.;
                         return std::acos(arg);
@@ -299,16 +419,16 @@
                  * @param part2 Pointer to the second tracks
                  * @return number of shared META cells
                  */
-                unsigned CalcSharedMetaCells(const std::shared_ptr<TrackCandidate> &part1, const std::shared_ptr<TrackCandidate> &part2) const noexcept
+                unsigned CalcSharedMetaCells(const TrackHandle &part1, const TrackHandle &part2) const noexcept
                 {
                     unsigned SMC = 0;
-                    auto meta1 = part1->GetMetaHits();
-                    auto meta2 = part2->GetMetaHits();
+                    const std::uint16_t *meta1 = part1.GetStore()->GetMetaBlock(part1.GetPosition());
+                    const std::uint16_t *meta2 = part2.GetStore()->GetMetaBlock(part2.GetPosition());
                     
-                    for (const auto &hit1 : meta1)
-                        for (const auto &hit2 : meta2)
+                    for (std::size_t i = 0; i < TrackStore::metaBlockSize; ++i)
+                        for (std::size_t j = 0; j < TrackStore::metaBlockSize; ++j)
                         {
-                            if (hit1 == hit2) ++SMC;
+                            if (meta1[i] != TrackStore::emptySlot && meta1[i] == meta2[j]) ++SMC;
                         }
 
                     return SMC;
@@ -0,0 +1,177 @@
+/**
+ * @file PairCutPolicy.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Compile-time pair rejection: every cut is a type with its values as template parameters, so the values are validated when the analysis is compiled and the whole rejection can be inlined into the mixer. The cuts are evaluated one after another and the first one which rejects the pair ends the evaluation
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef PairCutPolicy_hxx
+    #define PairCutPolicy_hxx
+
+    #include <array>
+    #include <cstddef>
+    #include <cstdint>
+    #include <iomanip>
+    #include <iostream>
+    #include <memory>
+
+    #include "PairCandidate.hxx"
+
+    namespace Mixing
+    {
+        /**
+         * @brief Pair cuts which can be used in PairCutPolicy. Each one tells if the pair should be rejected and calculates only the detector-level variable it needs
+         *
+         */
+        namespace PairCut
+        {
+            /**
+             * @brief Reject pairs with the fraction of close wires above the limit (see Selection::PairCandidate::RejectPairByCloseHits). The fraction is FractionNumerator / FractionDenominator (template parameters cannot be floating point in C++17)
+             *
+             * @tparam B behaviour of the selection
+             * @tparam Cutoff how close the wires are allowed to be
+             * @tparam FractionNumerator numerator of the maximal fraction of close wires
+             * @tparam FractionDenominator denominator of the maximal fraction of close wires
+             */
+            template <Selection::PairCandidate::Behaviour B, unsigned Cutoff, unsigned FractionNumerator, unsigned FractionDenominator = 100>
+            struct CloseHits
+            {
+                static_assert(FractionDenominator > 0 && FractionNumerator <= FractionDenominator,"CloseHits: the fraction has to be in [0,1]");
+
+                static constexpr const char *name = "close hits";
+                static constexpr float fraction = static_cast<float>(static_cast<double>(FractionNumerator) / FractionDenominator);
+
+                template <typename Pair>
+                [[nodiscard]] static bool Reject(const Pair &pair) noexcept {return pair.template AreHitsTooClose<B>(fraction,Cutoff);}
+            };
+            /**
+             * @brief Reject pairs with less than MinLayers MDC layers fired by both tracks
+             *
+             * @tparam MinLayers
+             */
+            template <unsigned MinLayers>
+            struct BothLayers
+            {
+                static constexpr const char *name = "both layers";
+
+                template <typename Pair>
+                [[nodiscard]] static bool Reject(const Pair &pair) {return pair.GetBothLayers() < MinLayers;}
+            };
+            /**
+             * @brief Reject pairs with more than MaxCells META cells shared by the tracks
+             *
+             * @tparam MaxCells
+             */
+            template <unsigned MaxCells>
+            struct SharedMeta
+            {
+                static constexpr const char *name = "shared META cells";
+
+                template <typename Pair>
+                [[nodiscard]] static bool Reject(const Pair &pair) {return pair.GetSharedMetaCells() > MaxCells;}
+            };
+        } // namespace PairCut
+
+        /**
+         * @brief Pair rejection made of PairCut types. The cuts are applied only to pairs of tracks from the same sector (tracks from different sectors cannot share wires nor META cells) and are evaluated in the given order until one rejects the pair, so the cheapest ones should go first. Every policy object counts the checked pairs and the pairs rejected by each cut (the counters are not synchronised, use one object per thread). Can be used directly as the pair cutting function of JJFemtoMixer
+         *
+         * @tparam Cuts PairCut types
+         */
+        template <typename... Cuts>
+        class PairCutPolicy
+        {
+            static_assert(sizeof...(Cuts) > 0,"PairCutPolicy: at least one cut is needed");
+
+            public:
+                static constexpr std::size_t nCuts = sizeof...(Cuts);
+                static constexpr std::array<const char *,nCuts> cutNames{Cuts::name...};
+
+            private:
+                mutable std::uint64_t m_checked = 0;
+                mutable std::array<std::uint64_t,nCuts> m_rejected{};
+
+            public:
+                /**
+                 * @brief Evaluate the cuts
+                 *
+                 * @tparam Pair
+                 * @param pair
+                 * @return true if the pair should be removed
+                 * @return false otherwise
+                 */
+                template <typename Pair>
+                [[nodiscard]] bool Reject(const Pair &pair) const
+                {
+                    if (!pair.AreTracksFromTheSameSector())
+                        return false;
+
+                    ++m_checked;
+                    std::size_t cut = 0;
+                    return ((Cuts::Reject(pair) ? (++m_rejected[cut], true) : (++cut, false)) || ...);
+                }
+                /**
+                 * @brief Evaluate the cuts, so the policy can be passed as the pair cutting function
+                 *
+                 * @tparam Pair
+                 * @param pair
+                 * @return true if the pair should be removed
+                 */
+                template <typename Pair>
+                [[nodiscard]] bool operator()(const std::shared_ptr<Pair> &pair) const {return Reject(*pair);}
+                /**
+                 * @brief Get the number of pairs to which the cuts were applied
+                 *
+                 * @return std::uint64_t
+                 */
+                [[nodiscard]] std::uint64_t GetNChecked() const noexcept {return m_checked;}
+                /**
+                 * @brief Get the number of pairs rejected by the cut (pairs already rejected by one of the previous cuts are not counted)
+                 *
+                 * @param cut index of the cut in Cuts
+                 * @return std::uint64_t
+                 */
+                [[nodiscard]] std::uint64_t GetNRejected(std::size_t cut) const {return m_rejected.at(cut);}
+                /**
+                 * @brief Add the counters of another policy (e.g. of another worker) to this one
+                 *
+                 * @param other
+                 */
+                void Add(const PairCutPolicy &other) noexcept
+                {
+                    m_checked += other.m_checked;
+                    for (std::size_t cut = 0; cut < nCuts; ++cut)
+                        m_rejected[cut] += other.m_rejected[cut];
+                }
+                /**
+                 * @brief Set all counters to zero
+                 *
+                 */
+                void Reset() noexcept
+                {
+                    m_checked = 0;
+                    m_rejected.fill(0);
+                }
+                /**
+                 * @brief Print the number of pairs rejected by each cut
+                 *
+                 */
+                void Print() const
+                {
+                    std::cout << "---=== Pair cuts ===---\n";
+                    std::cout << "checked pairs (same sector): " << m_checked << "\n";
+                    for (std::size_t cut = 0; cut < nCuts; ++cut)
+                    {
+                        std::cout << std::setw(20) << std::left << cutNames[cut] << std::right << m_rejected[cut];
+                        if (m_checked > 0)
+                            std::cout << " (" << std::fixed << std::setprecision(2) << 100. * m_rejected[cut] / m_checked << "%)" << std::defaultfloat;
+                        std::cout << "\n";
+                    }
+                    std::cout << std::endl;
+                }
+        };
+    } // namespace Mixing
+
+#endif
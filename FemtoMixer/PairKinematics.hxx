@@ -0,0 +1,255 @@
+/**
+ * @file PairKinematics.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Batched calculation of the pair kinematics in LCMS (q_inv, q_out, q_side, q_long, kT) for one track against a block of partner tracks stored as SoA float arrays.
+ * Uses AVX-512 or AVX2 if the code is compiled with support for it (e.g. -mavx2 or -march=native, for ACLiC use gSystem->SetFlagsOpt), otherwise falls back to the scalar implementation.
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef PairKinematics_hxx
+    #define PairKinematics_hxx
+
+    #include <array>
+    #include <cmath>
+    #include <cstddef>
+
+    #if defined(__AVX512F__) || defined(__AVX2__)
+        #include <immintrin.h>
+    #endif
+
+    namespace Selection
+    {
+        /**
+         * @brief Kinematic variables of a single pair, calculated in LCMS
+         *
+         */
+        struct PairKinematics
+        {
+            float QInv, QOut, QSide, QLong, Kt;
+        };
+
+        namespace Kinematics
+        {
+            /**
+             * @brief Maximal number of partner tracks processed in a single call of CalculateBlock
+             *
+             */
+            constexpr std::size_t blockSize = 256;
+
+            /**
+             * @brief Non-owning view of a block of tracks stored as SoA float arrays
+             *
+             */
+            struct TrackBlock
+            {
+                const float *Px, *Py, *Pz, *Energy;
+                std::size_t size;
+            };
+            /**
+             * @brief Results of CalculateBlock, stored as SoA float arrays
+             *
+             */
+            struct KinematicsBlock
+            {
+                alignas(64) std::array<float,blockSize> QInv, QOut, QSide, QLong, Kt;
+
+                /**
+                 * @brief Get kinematic variables of the pair created with the i-th partner track
+                 *
+                 * @param i
+                 * @return PairKinematics
+                 */
+                [[nodiscard]] PairKinematics at(std::size_t i) const noexcept
+                {
+                    return PairKinematics{QInv[i],QOut[i],QSide[i],QLong[i],Kt[i]};
+                }
+            };
+
+            /**
+             * @brief Calculates the pair variables in their centre of mass system (here: LCMS). Same formula as in PairCandidate::CFKinematics (adapted from HAL), but in single precision.
+             *
+             * @return PairKinematics
+             */
+            [[nodiscard]] inline PairKinematics Calculate(float p1x, float p1y, float p1z, float p1e, float p2x, float p2y, float p2z, float p2e) noexcept
+            {
+                PairKinematics kin;
+                const float tPx = p1x + p2x;
+                const float tPy = p1y + p2y;
+                const float tPz = p1z + p2z;
+                const float tE = p1e + p2e;
+                const float tMt = std::sqrt(tE * tE - tPz * tPz);
+                kin.Kt = std::sqrt(tPx * tPx + tPy * tPy);
+                const float tBeta = tPz / tE;
+                const float tGamma = tE / tMt;
+
+                // Transform to LCMS
+                const float particle1lcms_pz = tGamma * (p1z - tBeta * p1e);
+                const float particle1lcms_e  = tGamma * (p1e - tBeta * p1z);
+                const float particle2lcms_pz = tGamma * (p2z - tBeta * p2e);
+                const float particle2lcms_e  = tGamma * (p2e - tBeta * p2z);
+
+                // Rotate in transverse plane
+                const float particle1lcms_px = (p1x * tPx + p1y * tPy) / kin.Kt;
+                const float particle1lcms_py = (-p1x * tPy + p1y * tPx) / kin.Kt;
+                const float particle2lcms_px = (p2x * tPx + p2y * tPy) / kin.Kt;
+                const float particle2lcms_py = (-p2x * tPy + p2y * tPx) / kin.Kt;
+
+                kin.QOut = std::abs(particle1lcms_px - particle2lcms_px);
+                kin.QSide = std::abs(particle1lcms_py - particle2lcms_py);
+                kin.QLong = std::abs(particle1lcms_pz - particle2lcms_pz);
+                const float mDE = particle1lcms_e - particle2lcms_e;
+                kin.QInv = std::sqrt(std::abs(kin.QOut * kin.QOut + kin.QSide * kin.QSide + kin.QLong * kin.QLong - mDE * mDE));
+
+                return kin;
+            }
+
+            namespace Detail
+            {
+                /**
+                 * @brief Scalar implementation for the partner tracks [first,last)
+                 *
+                 */
+                inline void CalculateScalar(float p1x, float p1y, float p1z, float p1e, const TrackBlock &partners, std::size_t first, std::size_t last, KinematicsBlock &out) noexcept
+                {
+                    for (std::size_t i = first; i < last; ++i)
+                    {
+                        const PairKinematics kin = Calculate(p1x,p1y,p1z,p1e,partners.Px[i],partners.Py[i],partners.Pz[i],partners.Energy[i]);
+                        out.QInv[i] = kin.QInv;
+                        out.QOut[i] = kin.QOut;
+                        out.QSide[i] = kin.QSide;
+                        out.QLong[i] = kin.QLong;
+                        out.Kt[i] = kin.Kt;
+                    }
+                }
+
+                #if defined(__AVX512F__)
+                /**
+                 * @brief AVX-512 implementation, processes 16 partner tracks at once. Returns the number of processed tracks.
+                 *
+                 */
+                inline std::size_t CalculateSimd(float p1x_, float p1y_, float p1z_, float p1e_, const TrackBlock &partners, KinematicsBlock &out) noexcept
+                {
+                    constexpr std::size_t width = 16;
+                    const __m512 p1x = _mm512_set1_ps(p1x_), p1y = _mm512_set1_ps(p1y_), p1z = _mm512_set1_ps(p1z_), p1e = _mm512_set1_ps(p1e_);
+                    std::size_t i = 0;
+                    for (; i + width <= partners.size; i += width)
+                    {
+                        const __m512 p2x = _mm512_loadu_ps(partners.Px + i);
+                        const __m512 p2y = _mm512_loadu_ps(partners.Py + i);
+                        const __m512 p2z = _mm512_loadu_ps(partners.Pz + i);
+                        const __m512 p2e = _mm512_loadu_ps(partners.Energy + i);
+
+                        const __m512 tPx = _mm512_add_ps(p1x,p2x);
+                        const __m512 tPy = _mm512_add_ps(p1y,p2y);
+                        const __m512 tPz = _mm512_add_ps(p1z,p2z);
+                        const __m512 tE = _mm512_add_ps(p1e,p2e);
+                        const __m512 tMt = _mm512_sqrt_ps(_mm512_sub_ps(_mm512_mul_ps(tE,tE),_mm512_mul_ps(tPz,tPz)));
+                        const __m512 kt = _mm512_sqrt_ps(_mm512_add_ps(_mm512_mul_ps(tPx,tPx),_mm512_mul_ps(tPy,tPy)));
+                        const __m512 tBeta = _mm512_div_ps(tPz,tE);
+                        const __m512 tGamma = _mm512_div_ps(tE,tMt);
+
+                        const __m512 l1z = _mm512_mul_ps(tGamma,_mm512_sub_ps(p1z,_mm512_mul_ps(tBeta,p1e)));
+                        const __m512 l1e = _mm512_mul_ps(tGamma,_mm512_sub_ps(p1e,_mm512_mul_ps(tBeta,p1z)));
+                        const __m512 l2z = _mm512_mul_ps(tGamma,_mm512_sub_ps(p2z,_mm512_mul_ps(tBeta,p2e)));
+                        const __m512 l2e = _mm512_mul_ps(tGamma,_mm512_sub_ps(p2e,_mm512_mul_ps(tBeta,p2z)));
+
+                        const __m512 l1x = _mm512_div_ps(_mm512_add_ps(_mm512_mul_ps(p1x,tPx),_mm512_mul_ps(p1y,tPy)),kt);
+                        const __m512 l1y = _mm512_div_ps(_mm512_sub_ps(_mm512_mul_ps(p1y,tPx),_mm512_mul_ps(p1x,tPy)),kt);
+                        const __m512 l2x = _mm512_div_ps(_mm512_add_ps(_mm512_mul_ps(p2x,tPx),_mm512_mul_ps(p2y,tPy)),kt);
+                        const __m512 l2y = _mm512_div_ps(_mm512_sub_ps(_mm512_mul_ps(p2y,tPx),_mm512_mul_ps(p2x,tPy)),kt);
+
+                        const __m512 qOut = _mm512_abs_ps(_mm512_sub_ps(l1x,l2x));
+                        const __m512 qSide = _mm512_abs_ps(_mm512_sub_ps(l1y,l2y));
+                        const __m512 qLong = _mm512_abs_ps(_mm512_sub_ps(l1z,l2z));
+                        const __m512 dE = _mm512_sub_ps(l1e,l2e);
+                        const __m512 q2 = _mm512_sub_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(qOut,qOut),_mm512_mul_ps(qSide,qSide)),_mm512_mul_ps(qLong,qLong)),_mm512_mul_ps(dE,dE));
+
+                        _mm512_store_ps(out.QInv.data() + i,_mm512_sqrt_ps(_mm512_abs_ps(q2)));
+                        _mm512_store_ps(out.QOut.data() + i,qOut);
+                        _mm512_store_ps(out.QSide.data() + i,qSide);
+                        _mm512_store_ps(out.QLong.data() + i,qLong);
+                        _mm512_store_ps(out.Kt.data() + i,kt);
+                    }
+                    return i;
+                }
+                #elif defined(__AVX2__)
+                /**
+                 * @brief AVX2 implementation, processes 8 partner tracks at once. Returns the number of processed tracks.
+                 *
+                 */
+                inline std::size_t CalculateSimd(float p1x_, float p1y_, float p1z_, float p1e_, const TrackBlock &partners, KinematicsBlock &out) noexcept
+                {
+                    constexpr std::size_t width = 8;
+                    const __m256 signMask = _mm256_set1_ps(-0.f);
+                    const __m256 p1x = _mm256_set1_ps(p1x_), p1y = _mm256_set1_ps(p1y_), p1z = _mm256_set1_ps(p1z_), p1e = _mm256_set1_ps(p1e_);
+                    std::size_t i = 0;
+                    for (; i + width <= partners.size; i += width)
+                    {
+                        const __m256 p2x = _mm256_loadu_ps(partners.Px + i);
+                        const __m256 p2y = _mm256_loadu_ps(partners.Py + i);
+                        const __m256 p2z = _mm256_loadu_ps(partners.Pz + i);
+                        const __m256 p2e = _mm256_loadu_ps(partners.Energy + i);
+
+                        const __m256 tPx = _mm256_add_ps(p1x,p2x);
+                        const __m256 tPy = _mm256_add_ps(p1y,p2y);
+                        const __m256 tPz = _mm256_add_ps(p1z,p2z);
+                        const __m256 tE = _mm256_add_ps(p1e,p2e);
+                        const __m256 tMt = _mm256_sqrt_ps(_mm256_sub_ps(_mm256_mul_ps(tE,tE),_mm256_mul_ps(tPz,tPz)));
+                        const __m256 kt = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(tPx,tPx),_mm256_mul_ps(tPy,tPy)));
+                        const __m256 tBeta = _mm256_div_ps(tPz,tE);
+                        const __m256 tGamma = _mm256_div_ps(tE,tMt);
+
+                        const __m256 l1z = _mm256_mul_ps(tGamma,_mm256_sub_ps(p1z,_mm256_mul_ps(tBeta,p1e)));
+                        const __m256 l1e = _mm256_mul_ps(tGamma,_mm256_sub_ps(p1e,_mm256_mul_ps(tBeta,p1z)));
+                        const __m256 l2z = _mm256_mul_ps(tGamma,_mm256_sub_ps(p2z,_mm256_mul_ps(tBeta,p2e)));
+                        const __m256 l2e = _mm256_mul_ps(tGamma,_mm256_sub_ps(p2e,_mm256_mul_ps(tBeta,p2z)));
+
+                        const __m256 l1x = _mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(p1x,tPx),_mm256_mul_ps(p1y,tPy)),kt);
+                        const __m256 l1y = _mm256_div_ps(_mm256_sub_ps(_mm256_mul_ps(p1y,tPx),_mm256_mul_ps(p1x,tPy)),kt);
+                        const __m256 l2x = _mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(p2x,tPx),_mm256_mul_ps(p2y,tPy)),kt);
+                        const __m256 l2y = _mm256_div_ps(_mm256_sub_ps(_mm256_mul_ps(p2y,tPx),_mm256_mul_ps(p2x,tPy)),kt);
+
+                        const __m256 qOut = _mm256_andnot_ps(signMask,_mm256_sub_ps(l1x,l2x));
+                        const __m256 qSide = _mm256_andnot_ps(signMask,_mm256_sub_ps(l1y,l2y));
+                        const __m256 qLong = _mm256_andnot_ps(signMask,_mm256_sub_ps(l1z,l2z));
+                        const __m256 dE = _mm256_sub_ps(l1e,l2e);
+                        const __m256 q2 = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(qOut,qOut),_mm256_mul_ps(qSide,qSide)),_mm256_mul_ps(qLong,qLong)),_mm256_mul_ps(dE,dE));
+
+                        _mm256_store_ps(out.QInv.data() + i,_mm256_sqrt_ps(_mm256_andnot_ps(signMask,q2)));
+                        _mm256_store_ps(out.QOut.data() + i,qOut);
+                        _mm256_store_ps(out.QSide.data() + i,qSide);
+                        _mm256_store_ps(out.QLong.data() + i,qLong);
+                        _mm256_store_ps(out.Kt.data() + i,kt);
+                    }
+                    return i;
+                }
+                #else
+                inline std::size_t CalculateSimd(float, float, float, float, const TrackBlock &, KinematicsBlock &) noexcept
+                {
+                    return 0;
+                }
+                #endif
+            } // namespace Detail
+
+            /**
+             * @brief Calculate the pair kinematics of one track against a block of partner tracks
+             *
+             * @param p1x momentum of the first track along X-axis
+             * @param p1y momentum of the first track along Y-axis
+             * @param p1z momentum of the first track along Z-axis
+             * @param p1e energy of the first track
+             * @param partners SoA view of the partner tracks (at most blockSize tracks)
+             * @param out results, the i-th element corresponds to the pair with the i-th partner
+             */
+            inline void CalculateBlock(float p1x, float p1y, float p1z, float p1e, const TrackBlock &partners, KinematicsBlock &out) noexcept
+            {
+                const std::size_t done = Detail::CalculateSimd(p1x,p1y,p1z,p1e,partners,out);
+                Detail::CalculateScalar(p1x,p1y,p1z,p1e,partners,done,partners.size,out);
+            }
+        } // namespace Kinematics
+    } // namespace Selection
+
+#endif
@@ -0,0 +1,61 @@
+/**
+ * @file PairPrefilter.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Cheap kinematic bounds of the analysed pair phase space, checked by the mixer before a pair is constructed
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef PairPrefilter_hxx
+    #define PairPrefilter_hxx
+
+    #include <algorithm>
+    #include <limits>
+    #include <utility>
+
+    #include "PairKinematics.hxx"
+
+    namespace Mixing
+    {
+        /**
+         * @brief Bounds of the pair phase space which can end up in a live group or in the histogram range. The bounds follow the conventions of PairGrouping (a pair is inside if min < value <= max), pair rapidity is the mean rapidity of the two tracks (as in Selection::PairCandidate)
+         *
+         */
+        struct PairPrefilter
+        {
+            float ktMin = -std::numeric_limits<float>::infinity(), ktMax = std::numeric_limits<float>::infinity();
+            float rapidityMin = -std::numeric_limits<float>::infinity(), rapidityMax = std::numeric_limits<float>::infinity();
+            float qInvMax = std::numeric_limits<float>::infinity(); // pairs with q_inv >= qInvMax are dropped
+            float qOslMax = std::numeric_limits<float>::infinity(); // pairs with any of |q_out|, |q_side|, |q_long| >= qOslMax are dropped
+
+            /**
+             * @brief Get the range of partner rapidities for which the pair rapidity can be inside the bounds. The range is slightly wider than the exact one, so rounding never drops an accepted pair
+             *
+             * @param rapidity rapidity of the first track
+             * @return lower and upper limit of the partner rapidity
+             */
+            [[nodiscard]] std::pair<float,float> GetPartnerRapidityRange(float rapidity) const noexcept
+            {
+                constexpr float margin = 1e-4f;
+                return {2 * rapidityMin - rapidity - margin,2 * rapidityMax - rapidity + margin};
+            }
+            /**
+             * @brief Check if the pair is inside the bounds
+             *
+             * @param kinematics kinematics of the pair
+             * @param rapidity1 rapidity of the first track
+             * @param rapidity2 rapidity of the second track
+             * @return true if the pair can end up in a live group
+             */
+            [[nodiscard]] bool Accept(const Selection::PairKinematics &kinematics, float rapidity1, float rapidity2) const noexcept
+            {
+                const float rapidity = (rapidity1 + rapidity2) / 2.; // the same arithmetic as in PairCandidate
+                return kinematics.Kt > ktMin && kinematics.Kt <= ktMax && rapidity > rapidityMin && rapidity <= rapidityMax && kinematics.QInv < qInvMax
+                    && std::max({kinematics.QOut,kinematics.QSide,kinematics.QLong}) < qOslMax;
+            }
+        };
+    } // namespace Mixing
+
+#endif
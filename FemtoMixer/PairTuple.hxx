@@ -0,0 +1,342 @@
+/**
+ * @file PairTuple.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Columnar output of the accepted low-q pairs ("pair tuple"). One entry per pair with the LCMS momenta, the pair kinematics and the close-track variables, so the correlation functions can be rebinned offline (newPairRebinning.cc) without rerunning over the data.
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef PairTuple_hxx
+    #define PairTuple_hxx
+
+    #include <algorithm>
+    #include <cstdint>
+    #include <limits>
+    #include <memory>
+    #include <stdexcept>
+    #include <string>
+    #include <tuple>
+    #include <type_traits>
+
+    #include "TChain.h"
+    #include "TDirectory.h"
+    #include "TFile.h"
+    #include "TTree.h"
+
+    #include "CFHistogramBank.hxx"
+    #include "MixingGroups.hxx"
+    #include "PairCandidate.hxx"
+
+    namespace Mixing
+    {
+        /**
+         * @brief Settings of the pair tuple output
+         *
+         */
+        struct PairTupleSettings
+        {
+            float qInvMax = 500.f; // only pairs with q_inv below it are stored [MeV/c]; since q_inv <= |q_LCMS|, the stored q_osl distributions are complete only for q_out, q_side, q_long < qInvMax / sqrt(3)
+            int compression = 505; // ROOT compression setting (algorithm * 100 + level), 505 is ZSTD level 5
+            std::string treeName = "femtoPairs";
+        };
+
+        /**
+         * @brief Single stored pair. Provides the same kinematic getters as Selection::PairCandidate, so the Mixing::Binning types can group it directly
+         *
+         */
+        struct PairTupleRecord
+        {
+            static constexpr std::uint8_t mixedBit = 1u << 0; // background pair
+            static constexpr std::uint8_t sameSectorBit = 1u << 1; // both tracks in the same sector
+            static constexpr std::uint16_t noWireDistance = 0xFFFF; // the tracks have no common MDC layer
+
+            float qOut = 0, qSide = 0, qLong = 0, qInv = 0, kt = 0, rapidity = 0, phi = 0, weight = 1;
+            GroupId eventClass = 0;
+            std::uint8_t flags = 0;
+            // close-track variables
+            std::uint8_t bothLayers = 0, sharedMetaCells = 0;
+            std::uint16_t sharedWires = 0, minWireDistance = noWireDistance;
+            float splittingLevel = 0, openingAngle = 0, deltaPhi = 0, deltaTheta = 0;
+
+            [[nodiscard]] float GetKt() const noexcept {return kt;}
+            [[nodiscard]] float GetRapidity() const noexcept {return rapidity;}
+            [[nodiscard]] float GetPhi() const noexcept {return phi;}
+            [[nodiscard]] CFSample GetSample() const noexcept {return (flags & mixedBit) ? CFSample::Background : CFSample::Signal;}
+            [[nodiscard]] bool AreTracksFromTheSameSector() const noexcept {return flags & sameSectorBit;}
+
+            /**
+             * @brief Call the function with the name and the address of every kinematic column (the ones needed to rebuild the correlation functions)
+             *
+             * @tparam Func callable with (const char *name, T *address)
+             * @param func
+             */
+            template <typename Func>
+            void ForEachKinematicColumn(Func &&func)
+            {
+                func("qOut",&qOut);
+                func("qSide",&qSide);
+                func("qLong",&qLong);
+                func("qInv",&qInv);
+                func("kt",&kt);
+                func("rapidity",&rapidity);
+                func("phi",&phi);
+                func("weight",&weight);
+                func("eventClass",&eventClass);
+                func("flags",&flags);
+            }
+            /**
+             * @brief Call the function with the name and the address of every close-track column
+             *
+             * @tparam Func callable with (const char *name, T *address)
+             * @param func
+             */
+            template <typename Func>
+            void ForEachCloseTrackColumn(Func &&func)
+            {
+                func("bothLayers",&bothLayers);
+                func("sharedMetaCells",&sharedMetaCells);
+                func("sharedWires",&sharedWires);
+                func("minWireDistance",&minWireDistance);
+                func("splittingLevel",&splittingLevel);
+                func("openingAngle",&openingAngle);
+                func("deltaPhi",&deltaPhi);
+                func("deltaTheta",&deltaTheta);
+            }
+        };
+
+        namespace Detail
+        {
+            /**
+             * @brief ROOT leaf type code of the column type
+             *
+             * @tparam T
+             * @return leaf type code (see TTree::Branch)
+             */
+            template <typename T>
+            [[nodiscard]] constexpr char GetLeafType() noexcept
+            {
+                if constexpr (std::is_same_v<T,float>)
+                    return 'F';
+                else if constexpr (std::is_same_v<T,std::uint32_t>)
+                    return 'i';
+                else if constexpr (std::is_same_v<T,std::uint16_t>)
+                    return 's';
+                else
+                {
+                    static_assert(std::is_same_v<T,std::uint8_t>,"GetLeafType: unsupported column type");
+                    return 'b';
+                }
+            }
+
+            /**
+             * @brief Clamp the value to the range of the narrower column type
+             *
+             * @tparam T column type
+             * @param value
+             * @return T
+             */
+            template <typename T>
+            [[nodiscard]] constexpr T Saturate(unsigned value) noexcept
+            {
+                return static_cast<T>(std::min<unsigned>(value,std::numeric_limits<T>::max()));
+            }
+        } // namespace Detail
+
+        /**
+         * @brief Writes the pair tuple. Every worker thread needs its own writer (and file), see MakeFileName
+         *
+         */
+        class PairTupleWriter
+        {
+            private:
+                std::unique_ptr<TFile> m_file;
+                TTree *m_tree; // owned by m_file
+                PairTupleSettings m_settings;
+                PairTupleRecord m_record;
+                bool m_isClosed;
+
+            public:
+                /**
+                 * @brief Create the output file and the pair tree
+                 *
+                 * @param fileName name of the output file (it is recreated)
+                 * @param settings
+                 * @throws std::runtime_error if the file cannot be created
+                 */
+                explicit PairTupleWriter(const std::string &fileName, const PairTupleSettings &settings = {})
+                    : m_file(nullptr), m_tree(nullptr), m_settings(settings), m_record(), m_isClosed(false)
+                {
+                    TDirectory::TContext context; // the objects created later by the caller must not end up in this file
+                    m_file = std::make_unique<TFile>(fileName.data(),"RECREATE","",m_settings.compression);
+                    if (m_file->IsZombie())
+                        throw std::runtime_error("PairTupleWriter: cannot create file " + fileName);
+
+                    m_file->cd();
+                    m_tree = new TTree(m_settings.treeName.data(),"Accepted low-q pairs for the offline rebinning");
+                    auto branch = [this](const char *name, auto *address)
+                    {
+                        const std::string leaf = std::string(name) + "/" + Detail::GetLeafType<std::remove_pointer_t<decltype(address)> >();
+                        m_tree->Branch(name,address,leaf.data());
+                    };
+                    m_record.ForEachKinematicColumn(branch);
+                    m_record.ForEachCloseTrackColumn(branch);
+                }
+                PairTupleWriter(const PairTupleWriter &) = delete;
+                PairTupleWriter& operator=(const PairTupleWriter &) = delete;
+                ~PairTupleWriter()
+                {
+                    Close();
+                }
+                /**
+                 * @brief Create the name of the pair tuple file of a worker from the name of the analysis output, e.g. femtoOutFile.root -> femtoOutFile_pairs_0.root
+                 *
+                 * @param outFile name of the analysis output file
+                 * @param worker index of the worker
+                 * @return std::string
+                 */
+                [[nodiscard]] static std::string MakeFileName(const std::string &outFile, std::size_t worker)
+                {
+                    const std::size_t extension = outFile.rfind(".root");
+                    const std::string stem = (extension == std::string::npos) ? outFile : outFile.substr(0,extension);
+                    return stem + "_pairs_" + std::to_string(worker) + ".root";
+                }
+                /**
+                 * @brief Store the pair if it was accepted and its q_inv is below the limit. Pairs in the out-of-range group are not stored either (they were not checked by the pair cuts, and the mixed ones are not even created with a prefilter), so the rebinning can only change the intervals inside the ranges of the pair binning used by the mixer. The close-track variables are calculated only for the stored pairs
+                 *
+                 * @param sample signal or background
+                 * @param eventClass group of the event (JJFemtoMixer::GetEventGroup)
+                 * @param pairGroup group assigned by the mixer
+                 * @param pair
+                 * @param weight weight of the pair (e.g. the inverse acceptance of the BackgroundSampler)
+                 * @return true if the pair was stored
+                 */
+                bool Fill(CFSample sample, GroupId eventClass, GroupId pairGroup, const Selection::PairCandidate &pair, double weight = 1.)
+                {
+                    if (pairGroup == rejectedGroup || pairGroup == outOfRangeGroup || !(pair.GetQinv() < m_settings.qInvMax))
+                        return false;
+
+                    std::tie(m_record.qOut,m_record.qSide,m_record.qLong) = pair.GetOSL();
+                    m_record.qInv = pair.GetQinv();
+                    m_record.kt = pair.GetKt();
+                    m_record.rapidity = pair.GetRapidity();
+                    m_record.phi = pair.GetPhi();
+                    m_record.weight = weight;
+                    m_record.eventClass = eventClass;
+                    m_record.flags = ((sample == CFSample::Background) ? PairTupleRecord::mixedBit : 0) | (pair.AreTracksFromTheSameSector() ? PairTupleRecord::sameSectorBit : 0);
+
+                    const auto minWireDistance = pair.GetMinWireDistance();
+                    m_record.bothLayers = Detail::Saturate<std::uint8_t>(pair.GetBothLayers());
+                    m_record.sharedMetaCells = Detail::Saturate<std::uint8_t>(pair.GetSharedMetaCells());
+                    m_record.sharedWires = Detail::Saturate<std::uint16_t>(pair.GetSharedWires());
+                    m_record.minWireDistance = minWireDistance.has_value ? Detail::Saturate<std::uint16_t>(minWireDistance.value) : PairTupleRecord::noWireDistance;
+                    m_record.splittingLevel = pair.GetSplittingLevel();
+                    m_record.openingAngle = pair.GetOpeningAngle();
+                    m_record.deltaPhi = pair.GetDPhi();
+                    m_record.deltaTheta = pair.GetDTheta();
+
+                    m_tree->Fill();
+                    return true;
+                }
+                /**
+                 * @brief Get the number of stored pairs
+                 *
+                 * @return Long64_t
+                 */
+                [[nodiscard]] Long64_t GetEntries() const {return m_tree->GetEntries();}
+                /**
+                 * @brief Write the tree and close the file. Called by the destructor
+                 *
+                 */
+                void Close()
+                {
+                    if (m_isClosed)
+                        return;
+
+                    TDirectory::TContext context;
+                    m_file->cd();
+                    m_tree->Write();
+                    m_file->Close();
+                    m_isClosed = true;
+                }
+        };
+
+        /**
+         * @brief Reads the pair tuple. For the multi-threaded reading every thread opens its own reader and reads its own range of entries (SetEntryRange)
+         *
+         */
+        class PairTupleReader
+        {
+            private:
+                std::unique_ptr<TChain> m_chain;
+                Long64_t m_entry, m_end, m_nEntries;
+                PairTupleRecord m_record;
+
+            public:
+                /**
+                 * @brief Open the pair tuple file(s)
+                 *
+                 * @param fileName name of the pair tuple file, wildcards are accepted (see TChain::Add)
+                 * @param readCloseTrackVariables if false, only the kinematic columns are read
+                 * @param treeName name of the pair tree
+                 * @throws std::runtime_error if no pair tree was found
+                 */
+                explicit PairTupleReader(const std::string &fileName, bool readCloseTrackVariables = true, const std::string &treeName = PairTupleSettings{}.treeName)
+                    : m_chain(std::make_unique<TChain>(treeName.data())), m_entry(-1), m_end(0), m_nEntries(0), m_record()
+                {
+                    if (m_chain->Add(fileName.data()) == 0)
+                        throw std::runtime_error("PairTupleReader: no file matches " + fileName);
+                    m_nEntries = m_chain->GetEntries();
+                    m_end = m_nEntries;
+
+                    m_chain->SetBranchStatus("*",false);
+                    auto read = [this](const char *name, auto *address)
+                    {
+                        m_chain->SetBranchStatus(name,true);
+                        m_chain->SetBranchAddress(name,address);
+                    };
+                    m_record.ForEachKinematicColumn(read);
+                    if (readCloseTrackVariables)
+                        m_record.ForEachCloseTrackColumn(read);
+                }
+                /**
+                 * @brief Get the number of stored pairs
+                 *
+                 * @return Long64_t
+                 */
+                [[nodiscard]] Long64_t GetEntries() const noexcept {return m_nEntries;}
+                /**
+                 * @brief Restrict the reading to the entries [first,last)
+                 *
+                 * @param first
+                 * @param last
+                 */
+                void SetEntryRange(Long64_t first, Long64_t last) noexcept
+                {
+                    m_entry = std::max<Long64_t>(first,0) - 1;
+                    m_end = std::min(last,m_nEntries);
+                }
+                /**
+                 * @brief Load the next pair
+                 *
+                 * @return true if a pair was loaded, false at the end of the range
+                 */
+                bool Next()
+                {
+                    if (m_entry + 1 >= m_end)
+                        return false;
+
+                    m_chain->GetEntry(++m_entry);
+                    return true;
+                }
+                /**
+                 * @brief Get the current pair
+                 *
+                 * @return const PairTupleRecord&
+                 */
+                [[nodiscard]] const PairTupleRecord& GetRecord() const noexcept {return m_record;}
+        };
+    } // namespace Mixing
+
+#endif
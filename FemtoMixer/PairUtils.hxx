@@ -12,14 +12,43 @@
     #define PairUtils_hxx
 
     #include "JJUtils.hxx"
+    #include "MixingGroups.hxx"
+    #include "PairBinning.hxx"
     #include "PairCandidate.hxx"
+    #include "PairCutPolicy.hxx"
+    #include "PairPrefilter.hxx"
 
     #include <array>
+    #include <stdexcept>
 
     namespace Mixing
     {
+        namespace Detail
+        {
+            inline constexpr std::array<float,10> rapidityEdges1D{0.09,0.19,0.29,0.39,0.49,0.59,0.69,0.79,0.89,0.99};
+            inline constexpr std::array<float,8> rapidityEdges3D{0.09,0.39,0.49,0.59,0.69,0.79,0.89,0.99};
+        } // namespace Detail
+
+        /**
+         * @brief Pair groups of the 1D analysis: kT (300,2100] MeV in 12 equal intervals and rapidity (0.09,0.99]
+         * 
+         */
+        using PairBinning1D = Binning<UniformAxis<PairVariable::Kt,300,2100,12>,VariableAxis<PairVariable::Rapidity,Detail::rapidityEdges1D> >;
+        /**
+         * @brief Pair groups of the 3D analysis: kT (300,2100] MeV in 12 equal intervals, rapidity (0.09,0.99] in 7 intervals and azimuthal angle (-202.5,157.5] deg in 8 equal intervals.
+         * The rapidity axis differs from the original m_rapArr3D, which declared 9 intervals but held only 8 edges and a zero tail: the binary search over the unsorted tail sent every pair with y > 0.79 to the out-of-range group, so only the rapidity bins 1-5 were filled.
+         * Now the bins 6 (0.79,0.89] and 7 (0.89,0.99] are filled too and the group stride is 7 instead of 9, so the numeric group IDs and the number of slots (674 instead of 866) changed. The group names of the bins 1-5 (and so the names of the merged histograms) are the same as before
+         * 
+         */
+        using PairBinning3D = Binning<UniformAxis<PairVariable::Kt,300,2100,12>,VariableAxis<PairVariable::Rapidity,Detail::rapidityEdges3D>,UniformAxis<PairVariable::AzimuthalAngle,-2025,1575,8,10> >;
         /**
-         * @brief Class storing intervals and observables according to which the pairs are grouped
+         * @brief Nominal pair rejection (the same as PairRejection with the default PairCuts), cheapest cuts first: shared META cells, layers fired by both tracks and the close hits
+         * 
+         */
+        using NominalPairCuts = PairCutPolicy<PairCut::SharedMeta<0>,PairCut::BothLayers<20>,PairCut::CloseHits<Selection::PairCandidate::Behaviour::OneUnder,3,75> >;
+
+        /**
+         * @brief Class storing intervals and observables according to which the pairs are grouped. The intervals are defined by PairBinning1D and PairBinning3D
          * 
          */
         class PairGrouping
@@ -55,79 +84,181 @@
                     
                     return val;
                 }
+                /**
+                 * @brief Get the bin numbers of the axis together with the strings containing their intervals
+                 * 
+                 * @tparam Axis VariableAxis or UniformAxis
+                 * @return collection of pairs of indexes with strings
+                 */
+                template <typename Axis>
+                [[nodiscard]] std::array<std::pair<std::size_t,TString>,Axis::nBins> MakeIndexIntervalPairs() const
+                {
+                    std::array<std::pair<std::size_t,TString>,Axis::nBins> indecesAndIntervals;
+                    for (std::size_t i = 1; i <= Axis::nBins; ++i)
+                    {
+                        TString lowEdge = RemoveTrailingZeros(TString(std::to_string(Axis::GetEdge(i - 1))));
+                        TString highEdge = RemoveTrailingZeros(TString(std::to_string(Axis::GetEdge(i))));
+                        indecesAndIntervals[i - 1] = std::make_pair(i,TString::Format("(%s,%s)", lowEdge.Data(), highEdge.Data()));
+                    }
+
+                    return indecesAndIntervals;
+                }
 
-                static constexpr std::size_t m_ktIntervals1D = 12, m_rapIntervals1D = 9;
-                static constexpr std::array<float, m_ktIntervals1D + 1> m_ktArr1D = {300,450,600,750,900,1050,1200,1350,1500,1650,1800,1950,2100};
-                static constexpr std::array<float, m_rapIntervals1D + 1> m_rapArr1D = {0.09,0.19,0.29,0.39,0.49,0.59,0.69,0.79,0.89,0.99};
+                using KtAxis1D = PairBinning1D::Axis<0>;
+                using RapAxis1D = PairBinning1D::Axis<1>;
+                using KtAxis3D = PairBinning3D::Axis<0>;
+                using RapAxis3D = PairBinning3D::Axis<1>;
+                using PsiAxis3D = PairBinning3D::Axis<2>;
 
-                static constexpr std::size_t m_ktIntervals3D = 12, m_rapIntervals3D = 9, m_psiIntervals3D = 8;
-                static constexpr std::array<float, m_ktIntervals3D + 1> m_ktArr3D = {300,450,600,750,900,1050,1200,1350,1500,1650,1800,1950,2100};
-                static constexpr std::array<float, m_rapIntervals3D + 1> m_rapArr3D = {0.09,0.39,0.49,0.59,0.69,0.79,0.89,0.99};
-                static constexpr std::array<float,m_psiIntervals3D + 1> m_epArr3D = {-202.5,-157.5,-112.5,-67.5,-22.5,22.5,67.5,112.5,157.5};
+                static constexpr std::size_t m_ktIntervals1D = KtAxis1D::nBins, m_rapIntervals1D = RapAxis1D::nBins;
+                static constexpr std::size_t m_ktIntervals3D = KtAxis3D::nBins, m_rapIntervals3D = RapAxis3D::nBins, m_psiIntervals3D = PsiAxis3D::nBins;
 
             public:
                 /**
                  * @brief Calculates and returns group ID to which the PairCandidate object is assigned to. Used for 1D analysis
                  * 
                  * @param pair pointer to the PairCandidate
-                 * @param ktArr array of kT intervals
-                 * @param rapArr array of rapidity intervals
-                 * @return group ID
+                 * @return group ID (outOfRangeGroup if the pair is outside of the intervals)
                  */
-                [[nodiscard]] std::string GetPairIndex1D(const std::shared_ptr<Selection::PairCandidate> &pair, const std::array<float, m_ktIntervals1D + 1> &ktArr, const std::array<float, m_rapIntervals1D + 1> &rapArr) const
+                [[nodiscard]] GroupId GetPairIndex1D(const std::shared_ptr<Selection::PairCandidate> &pair) const noexcept
                 {
-                    std::size_t ktCut = std::lower_bound(ktArr.begin(),ktArr.end(),pair->GetKt()) - ktArr.begin();
-                    std::size_t yCut = std::lower_bound(rapArr.begin(),rapArr.end(),pair->GetRapidity()) - rapArr.begin();
-
-                    // reject if value is below first slice or above the last
-                    if (ktCut == 0 || ktCut > ktArr.size()-1 || yCut == 0 || yCut > rapArr.size()-1)
-                        return "0";
-                    else
-                        return JJUtils::to_fixed_size_string((ktCut),2) + JJUtils::to_fixed_size_string(yCut,2);
+                    return PairBinning1D::GetGroup(*pair);
                 }
                 /**
-                 * @brief Calculates and returns group ID to which the PairCandidate object is assigned to. Used for 1D analysis
+                 * @brief Calculates and returns group ID to which the PairCandidate object is assigned to. Used for 3D analysis
                  * 
                  * @param pair pointer to the PairCandidate
-                 * @param ktArr array of kT intervals
-                 * @param rapArr array of rapidity intervals
-                 * @param psiArr array of azimuthal angle intervals
+                 * @return group ID (outOfRangeGroup if the pair is outside of the intervals)
+                 */
+                [[nodiscard]] GroupId GetPairIndex3D(const std::shared_ptr<Selection::PairCandidate> &pair) const noexcept
+                {
+                    return PairBinning3D::GetGroup(*pair);
+                }
+                /**
+                 * @brief Get the number of group slots used in 1D analysis (all kT and rapidity interval combinations, the out-of-range group and the rejected group)
+                 * 
+                 * @return number of slots
+                 */
+                [[nodiscard]] static constexpr std::size_t GetNumberOfGroupSlots1D() noexcept
+                {
+                    return PairBinning1D::nGroupSlots;
+                }
+                /**
+                 * @brief Get the number of group slots used in 3D analysis (all kT, rapidity and azimuthal angle interval combinations, the out-of-range group and the rejected group)
+                 * 
+                 * @return number of slots
+                 */
+                [[nodiscard]] static constexpr std::size_t GetNumberOfGroupSlots3D() noexcept
+                {
+                    return PairBinning3D::nGroupSlots;
+                }
+                /**
+                 * @brief Get the index of the slot in a dense array which corresponds to the 1D group ID
+                 * 
+                 * @param group group ID
+                 * @return slot index in [0, GetNumberOfGroupSlots1D())
+                 */
+                [[nodiscard]] static constexpr std::size_t GetGroupSlot1D(GroupId group) noexcept
+                {
+                    return PairBinning1D::GetGroupSlot(group);
+                }
+                /**
+                 * @brief Get the index of the slot in a dense array which corresponds to the 3D group ID
+                 * 
+                 * @param group group ID
+                 * @return slot index in [0, GetNumberOfGroupSlots3D())
+                 */
+                [[nodiscard]] static constexpr std::size_t GetGroupSlot3D(GroupId group) noexcept
+                {
+                    return PairBinning3D::GetGroupSlot(group);
+                }
+                /**
+                 * @brief Get the group ID which corresponds to the slot of a dense array in 1D analysis
+                 * 
+                 * @param slot slot index
                  * @return group ID
                  */
-                [[nodiscard]] std::string GetPairIndex3D(const std::shared_ptr<Selection::PairCandidate> &pair, const std::array<float, m_ktIntervals3D + 1> &ktArr, const std::array<float, m_rapIntervals3D + 1> &rapArr, const std::array<float,m_psiIntervals3D + 1> &psiArr) const
+                [[nodiscard]] static constexpr GroupId GetSlotGroup1D(std::size_t slot) noexcept
                 {
-                    std::size_t ktCut = std::lower_bound(ktArr.begin(),ktArr.end(),pair->GetKt()) - ktArr.begin();
-                    std::size_t yCut = std::lower_bound(rapArr.begin(),rapArr.end(),pair->GetRapidity()) - rapArr.begin();
-                    std::size_t EpCut = std::lower_bound(psiArr.begin(),psiArr.end(),pair->GetPhi()) - psiArr.begin();
-
-                    // reject if value is below first slice or above the last
-                    if (ktCut == 0 || ktCut > ktArr.size()-1 || yCut == 0 || yCut > rapArr.size()-1 || EpCut == 0 || EpCut > psiArr.size() - 1)
-                        return "0";
-                    else
-                        return JJUtils::to_fixed_size_string(ktCut,2) + JJUtils::to_fixed_size_string(yCut,2) + JJUtils::to_fixed_size_string(EpCut,2);
+                    return PairBinning1D::GetSlotGroup(slot);
                 }
                 /**
-                 * @brief Creates a wrapper function for GetPairIndex1D
+                 * @brief Get the group ID which corresponds to the slot of a dense array in 3D analysis
+                 * 
+                 * @param slot slot index
+                 * @return group ID
+                 */
+                [[nodiscard]] static constexpr GroupId GetSlotGroup3D(std::size_t slot) noexcept
+                {
+                    return PairBinning3D::GetSlotGroup(slot);
+                }
+                /**
+                 * @brief Get the human-readable name of the 1D group, i.e. the kT and rapidity indexes with leading zeros ("0" for out-of-range and "bad" for rejected pairs). Meant to be used only when writing the output
+                 * 
+                 * @param group group ID
+                 * @return group name
+                 */
+                [[nodiscard]] std::string GetGroupName1D(GroupId group) const
+                {
+                    return PairBinning1D::GetGroupName(group);
+                }
+                /**
+                 * @brief Get the human-readable name of the 3D group, i.e. the kT, rapidity and azimuthal angle indexes with leading zeros ("0" for out-of-range and "bad" for rejected pairs). Meant to be used only when writing the output
+                 * 
+                 * @param group group ID
+                 * @return group name
+                 */
+                [[nodiscard]] std::string GetGroupName3D(GroupId group) const
+                {
+                    return PairBinning3D::GetGroupName(group);
+                }
+                /**
+                 * @brief Creates a wrapper function for GetPairIndex1D. The mixer can use PairBinning1D directly instead (see JJFemtoMixer), which avoids the type-erased call
                  * 
                  * @return std::function
                  */
-                [[nodiscard]] std::function<std::string (const std::shared_ptr<Selection::PairCandidate> &)> MakePairGroupingFunction1D() const noexcept
+                [[nodiscard]] std::function<GroupId (const std::shared_ptr<Selection::PairCandidate> &)> MakePairGroupingFunction1D() const noexcept
                 {
-                    auto newKtArr = m_ktArr1D; // this is a workaround, because I have the arrays marked as static and the std::function (i think) tries to move them (which is a big no-no according to the compiler)
-                    auto newRapArr = m_rapArr1D;
-                    return [this,newKtArr,newRapArr](const std::shared_ptr<Selection::PairCandidate> &pair) -> std::string {return this->GetPairIndex1D(pair,newKtArr,newRapArr);};
+                    return PairBinning1D();
                 }
                 /**
-                 * @brief Creates a wrapper function for GetPairIndex3D
+                 * @brief Creates a wrapper function for GetPairIndex3D. The mixer can use PairBinning3D directly instead (see JJFemtoMixer), which avoids the type-erased call
                  * 
                  * @return std::function
                  */
-                [[nodiscard]] std::function<std::string (const std::shared_ptr<Selection::PairCandidate> &)> MakePairGroupingFunction3D() const noexcept
+                [[nodiscard]] std::function<GroupId (const std::shared_ptr<Selection::PairCandidate> &)> MakePairGroupingFunction3D() const noexcept
                 {
-                    auto newKtArr = m_ktArr3D; // this is a workaround, because I have the arrays marked as static and the std::function (i think) tries to move them (which is a big no-no according to the compiler)
-                    auto newRapArr = m_rapArr3D;
-                    auto newPsiArr = m_epArr3D;
-                    return [this,newKtArr,newRapArr,newPsiArr](const std::shared_ptr<Selection::PairCandidate> &pair) -> std::string {return this->GetPairIndex3D(pair,newKtArr,newRapArr,newPsiArr);};
+                    return PairBinning3D();
+                }
+                /**
+                 * @brief Creates the bounds of the kT and rapidity intervals of the 1D analysis, pairs outside of them always end up in the out-of-range group
+                 * 
+                 * @return PairPrefilter
+                 */
+                [[nodiscard]] static PairPrefilter MakePairPrefilter1D() noexcept
+                {
+                    PairPrefilter prefilter;
+                    prefilter.ktMin = KtAxis1D::GetEdge(0);
+                    prefilter.ktMax = KtAxis1D::GetEdge(KtAxis1D::nBins);
+                    prefilter.rapidityMin = RapAxis1D::GetEdge(0);
+                    prefilter.rapidityMax = RapAxis1D::GetEdge(RapAxis1D::nBins);
+                    return prefilter;
+                }
+                /**
+                 * @brief Creates the bounds of the kT and rapidity intervals of the 3D analysis
+                 * 
+                 * @param qOslMax upper edge of the q_osl histograms (pairs above it would only fill the overflow)
+                 * @return PairPrefilter
+                 */
+                [[nodiscard]] static PairPrefilter MakePairPrefilter3D(float qOslMax) noexcept
+                {
+                    PairPrefilter prefilter;
+                    prefilter.ktMin = KtAxis3D::GetEdge(0);
+                    prefilter.ktMax = KtAxis3D::GetEdge(KtAxis3D::nBins);
+                    prefilter.rapidityMin = RapAxis3D::GetEdge(0);
+                    prefilter.rapidityMax = RapAxis3D::GetEdge(RapAxis3D::nBins);
+                    prefilter.qOslMax = qOslMax;
+                    return prefilter;
                 }
                 /**
                  * @brief Get the kT index sequence for 1D anaysis
@@ -181,18 +312,7 @@
                  */
                 [[nodiscard]] std::array<std::pair<std::size_t,TString>,m_ktIntervals1D> GetKtIndexIntervalPairs1D() const noexcept 
                 {
-                    auto ktIndices = GetKtIndexSequence1D();
-                    std::array<std::pair<std::size_t,TString>,m_ktIntervals1D> ktIndecesAndIntervals;
-                    std::transform(ktIndices.begin(),ktIndices.end(),ktIndecesAndIntervals.begin(),
-                        [this,newKtArr = m_ktArr1D](std::size_t i)
-                        {
-                            TString lowEdge = RemoveTrailingZeros(TString(std::to_string(newKtArr.at(i - 1))));
-                            TString highEdge = RemoveTrailingZeros(TString(std::to_string(newKtArr.at(i))));
-                            return std::make_pair(i,TString::Format("(%s,%s)", lowEdge.Data(), highEdge.Data()));
-                        }
-                    );
-
-                    return ktIndecesAndIntervals;
+                    return MakeIndexIntervalPairs<KtAxis1D>();
                 }
                 /**
                  * @brief Get the rapidity index sequence together with string containing the interval range used for 1D analysis. Useful for making legends
@@ -201,18 +321,7 @@
                  */
                 [[nodiscard]] std::array<std::pair<std::size_t,TString>,m_rapIntervals1D> GetRapIndexIntervalPairs1D() const noexcept 
                 {
-                    auto rapIndices = GetRapIndexSequence1D();
-                    std::array<std::pair<std::size_t,TString>,m_rapIntervals1D> rapIndecesAndIntervals;
-                    std::transform(rapIndices.begin(),rapIndices.end(),rapIndecesAndIntervals.begin(),
-                        [this,newRapArr = m_rapArr1D](std::size_t i)
-                        {
-                            TString lowEdge = RemoveTrailingZeros(TString(std::to_string(newRapArr.at(i - 1))));
-                            TString highEdge = RemoveTrailingZeros(TString(std::to_string(newRapArr.at(i))));
-                            return std::make_pair(i,TString::Format("(%s,%s)", lowEdge.Data(), highEdge.Data()));
-                        }
-                    );
-
-                    return rapIndecesAndIntervals;
+                    return MakeIndexIntervalPairs<RapAxis1D>();
                 }
                 /**
                  * @brief Get the kT index sequence together with string containing the interval range used for 3D analysis. Useful for making legends
@@ -221,18 +330,7 @@
                  */
                 [[nodiscard]] std::array<std::pair<std::size_t,TString>,m_ktIntervals3D> GetKtIndexIntervalPairs3D() const noexcept 
                 {
-                    auto ktIndices = GetKtIndexSequence1D();
-                    std::array<std::pair<std::size_t,TString>,m_ktIntervals3D> ktIndecesAndIntervals;
-                    std::transform(ktIndices.begin(),ktIndices.end(),ktIndecesAndIntervals.begin(),
-                        [this,newKtArr = m_ktArr3D](std::size_t i)
-                        {
-                            TString lowEdge = RemoveTrailingZeros(TString(std::to_string(newKtArr.at(i - 1))));
-                            TString highEdge = RemoveTrailingZeros(TString(std::to_string(newKtArr.at(i))));
-                            return std::make_pair(i,TString::Format("(%s,%s)", lowEdge.Data(), highEdge.Data()));
-                        }
-                    );
-
-                    return ktIndecesAndIntervals;
+                    return MakeIndexIntervalPairs<KtAxis3D>();
                 }
                 /**
                  * @brief Get the rapidity index sequence together with string containing the interval range used for 3D analysis. Useful for making legends
@@ -241,18 +339,7 @@
                  */
                 [[nodiscard]] std::array<std::pair<std::size_t,TString>,m_rapIntervals3D> GetRapIndexIntervalPairs3D() const noexcept 
                 {
-                    auto rapIndices = GetRapIndexSequence1D();
-                    std::array<std::pair<std::size_t,TString>,m_rapIntervals1D> rapIndecesAndIntervals;
-                    std::transform(rapIndices.begin(),rapIndices.end(),rapIndecesAndIntervals.begin(),
-                        [this,newRapArr = m_rapArr3D](std::size_t i)
-                        {
-                            TString lowEdge = RemoveTrailingZeros(TString(std::to_string(newRapArr.at(i - 1))));
-                            TString highEdge = RemoveTrailingZeros(TString(std::to_string(newRapArr.at(i))));
-                            return std::make_pair(i,TString::Format("(%s,%s)", lowEdge.Data(), highEdge.Data()));
-                        }
-                    );
-
-                    return rapIndecesAndIntervals;
+                    return MakeIndexIntervalPairs<RapAxis3D>();
                 }
                 /**
                  * @brief Get the azimuthal angle index sequence together with string containing the interval range used for 3D analysis. Useful for making legends
@@ -261,21 +348,33 @@
                  */
                 [[nodiscard]] std::array<std::pair<std::size_t,TString>,m_psiIntervals3D> GetPsiIndexIntervalPairs3D() const noexcept 
                 {
-                    auto psiIndices = GetPsiIndexSequence3D();
-                    std::array<std::pair<std::size_t,TString>,m_psiIntervals3D> psiIndecesAndIntervals;
-                    std::transform(psiIndices.begin(),psiIndices.end(),psiIndecesAndIntervals.begin(),
-                        [this,newPsiArr = m_epArr3D](std::size_t i)
-                        {
-                            TString lowEdge = RemoveTrailingZeros(TString(std::to_string(newPsiArr.at(i - 1))));
-                            TString highEdge = RemoveTrailingZeros(TString(std::to_string(newPsiArr.at(i))));
-                            return std::make_pair(i,TString::Format("(%s,%s)", lowEdge.Data(), highEdge.Data()));
-                        }
-                    );
-
-                    return psiIndecesAndIntervals;
+                    return MakeIndexIntervalPairs<PsiAxis3D>();
                 }
         };
 
+        /**
+         * @brief Parameters of the pair rejection (PairRejection::Reject). Default values correspond to the nominal selection
+         * 
+         */
+        struct PairCuts
+        {
+            float closeHitsFraction = 0.75; // maximal fraction of the common layers with the wires closer than closeHitsCutoff
+            unsigned closeHitsCutoff = 3;
+            unsigned minBothLayers = 20; // minimal number of layers fired by both tracks
+            unsigned maxSharedMetaCells = 0;
+
+            /**
+             * @brief Check the values of the cuts, meant to be called once when the cuts are configured (PairRejection::Reject does not check them for every pair)
+             * 
+             * @throws std::invalid_argument if closeHitsFraction is outside of [0,1]
+             */
+            void Validate() const
+            {
+                if (!(closeHitsFraction >= 0. && closeHitsFraction <= 1.))
+                    throw std::invalid_argument("PairCuts: closeHitsFraction has to be in [0,1], got " + std::to_string(closeHitsFraction));
+            }
+        };
+
         /**
          * @brief Class storing the pair rejection function used in my analysis
          * 
@@ -292,15 +391,27 @@
                  * @return true if pair should be removed
                  * @return false otherwise
                  */
-                [[nodiscard]] bool Reject(const std::shared_ptr<Selection::PairCandidate> &pair) const noexcept
+                [[nodiscard]] bool Reject(const std::shared_ptr<Selection::PairCandidate> &pair) const
+                {
+                    return Reject(*pair,PairCuts{});
+                }
+                /**
+                 * @brief Pair rejection function with modifiable cut values. The cheapest cuts are evaluated first
+                 * 
+                 * @param pair PairCandidate
+                 * @param cuts parameters of the rejection (checked beforehand with PairCuts::Validate)
+                 * @return true if pair should be removed
+                 * @return false otherwise
+                 */
+                [[nodiscard]] bool Reject(const Selection::PairCandidate &pair, const PairCuts &cuts) const
                 {
                     using Behaviour = Selection::PairCandidate::Behaviour;
 
-                    if (pair->AreTracksFromTheSameSector())
+                    if (pair.AreTracksFromTheSameSector())
                     {
-                        return pair->RejectPairByCloseHits<Behaviour::OneUnder>(0.75,3) ||
-                            pair->GetBothLayers() < 20 ||
-                            pair->GetSharedMetaCells() > 0;
+                        return pair.GetSharedMetaCells() > cuts.maxSharedMetaCells ||
+                            pair.GetBothLayers() < cuts.minBothLayers ||
+                            pair.AreHitsTooClose<Behaviour::OneUnder>(cuts.closeHitsFraction,cuts.closeHitsCutoff);
                     }
                     else
                     {
@@ -308,7 +419,7 @@
                     }
                 }
                 /**
-                 * @brief Creates a wrapper function for Reject
+                 * @brief Creates a wrapper function for Reject (NominalPairCuts does the same without the std::function and with per-cut counters)
                  * 
                  * @return std::function
                  */
@@ -0,0 +1,208 @@
+/**
+ * @file ShardedEventProcessor.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Parallel driver distributing selected events among worker threads according to their event class
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef ShardedEventProcessor_hxx
+    #define ShardedEventProcessor_hxx
+
+    #include <algorithm>
+    #include <condition_variable>
+    #include <cstdint>
+    #include <deque>
+    #include <exception>
+    #include <functional>
+    #include <memory>
+    #include <mutex>
+    #include <thread>
+    #include <vector>
+
+    #include "MixingGroups.hxx"
+
+    namespace Mixing
+    {
+        /**
+         * @brief Distributes events among worker threads. All events of a given class (the event hashing function) are always processed by the same worker and in the order in which they were pushed, so each worker can own the mixing buffers of its classes and the mixing is identical to the serial one. The workers should fill their own (thread-local) outputs, which are reduced after Finish.
+         *
+         * @tparam Item type of the pushed object (e.g. std::shared_ptr<Selection::EventCandidate>)
+         * @tparam Worker callable with the signature void(Item&), one instance per thread
+         */
+        template <typename Item, typename Worker>
+        class ShardedEventProcessor
+        {
+            private:
+                struct Shard
+                {
+                    Worker worker;
+                    std::deque<Item> queue;
+                    std::mutex mutex;
+                    std::condition_variable cv;
+                    bool closed = false;
+                    bool busy = false; // an event taken from the queue is being processed
+                    std::exception_ptr error;
+                    std::thread thread;
+
+                    explicit Shard(Worker &&wrk) : worker(std::move(wrk)) {}
+                };
+
+                std::vector<std::unique_ptr<Shard> > m_shards;
+                std::function<GroupId (const Item &)> m_classFunction;
+                std::size_t m_maxQueueSize;
+                bool m_finished;
+
+                /**
+                 * @brief Main loop of the worker thread: process the queued events until the queue is closed and empty
+                 *
+                 * @param shard
+                 */
+                static void Run(Shard &shard)
+                {
+                    while (true)
+                    {
+                        std::unique_lock<std::mutex> lock(shard.mutex);
+                        shard.cv.wait(lock,[&shard]{return shard.closed || !shard.queue.empty();});
+                        if (shard.queue.empty())
+                            return;
+
+                        Item item = std::move(shard.queue.front());
+                        shard.queue.pop_front();
+                        shard.busy = true;
+                        lock.unlock();
+                        shard.cv.notify_all(); // wake up the producer waiting for a free place in the queue
+
+                        if (shard.error == nullptr)
+                        {
+                            try
+                            {
+                                shard.worker(item);
+                            }
+                            catch (...)
+                            {
+                                shard.error = std::current_exception(); // keep draining the queue, the error is rethrown in Finish
+                            }
+                        }
+
+                        lock.lock();
+                        shard.busy = false;
+                        lock.unlock();
+                        shard.cv.notify_all(); // wake up Synchronize
+                    }
+                }
+
+            public:
+                /**
+                 * @brief Construct a new ShardedEventProcessor object and start the worker threads
+                 *
+                 * @param nWorkers number of worker threads (at least one)
+                 * @param workerFactory function creating the worker of each thread
+                 * @param classFunction function returning the event class of the pushed object (use the same one as the event hashing function of the mixer)
+                 * @param maxQueueSize maximal number of events waiting for a worker, Push blocks when it is reached
+                 */
+                ShardedEventProcessor(std::size_t nWorkers, const std::function<Worker ()> &workerFactory, const std::function<GroupId (const Item &)> &classFunction, std::size_t maxQueueSize = 64) :
+                    m_shards(), m_classFunction(classFunction), m_maxQueueSize(std::max<std::size_t>(maxQueueSize,1)), m_finished(false)
+                {
+                    for (std::size_t i = 0; i < std::max<std::size_t>(nWorkers,1); ++i)
+                        m_shards.push_back(std::make_unique<Shard>(workerFactory()));
+                    for (auto &shard : m_shards)
+                        shard->thread = std::thread(&ShardedEventProcessor::Run,std::ref(*shard));
+                }
+                ShardedEventProcessor(const ShardedEventProcessor &) = delete;
+                ShardedEventProcessor& operator=(const ShardedEventProcessor &) = delete;
+                ~ShardedEventProcessor()
+                {
+                    if (!m_finished)
+                    {
+                        try {Finish();} catch (...) {}
+                    }
+                }
+                /**
+                 * @brief Hand the event over to the worker responsible for its class
+                 *
+                 * @param item
+                 */
+                void Push(Item item)
+                {
+                    auto &shard = *m_shards[GetWorkerIndex(m_classFunction(item))];
+                    {
+                        std::unique_lock<std::mutex> lock(shard.mutex);
+                        shard.cv.wait(lock,[&]{return shard.queue.size() < m_maxQueueSize;});
+                        shard.queue.push_back(std::move(item));
+                    }
+                    shard.cv.notify_all();
+                }
+                /**
+                 * @brief Wait until all pushed events are processed and stop the worker threads. Rethrows the first exception thrown by any of the workers
+                 *
+                 */
+                void Finish()
+                {
+                    if (m_finished)
+                        return;
+
+                    for (auto &shard : m_shards)
+                    {
+                        {
+                            std::lock_guard<std::mutex> lock(shard->mutex);
+                            shard->closed = true;
+                        }
+                        shard->cv.notify_all();
+                    }
+                    for (auto &shard : m_shards)
+                        shard->thread.join();
+                    m_finished = true;
+
+                    for (auto &shard : m_shards)
+                        if (shard->error != nullptr)
+                            std::rethrow_exception(shard->error);
+                }
+                /**
+                 * @brief Wait until all pushed events are processed, then call the function in this thread while the workers are idle (e.g. to write or restore a checkpoint of their outputs and mixing buffers). The workers stay alive, so more events can be pushed afterwards. Rethrows the first exception thrown by any of the workers
+                 *
+                 * @param func callable with the signature void(), the workers can be accessed with GetWorker
+                 */
+                template <typename Func>
+                void Synchronize(Func &&func)
+                {
+                    for (auto &shard : m_shards)
+                    {
+                        std::unique_lock<std::mutex> lock(shard->mutex);
+                        shard->cv.wait(lock,[&shard]{return shard->queue.empty() && !shard->busy;});
+                        if (shard->error != nullptr)
+                            std::rethrow_exception(shard->error);
+                    }
+
+                    func();
+                }
+                /**
+                 * @brief Select the worker responsible for the given event class (Fibonacci hashing, so that neighbouring classes land on different workers). The 32-bit product with 2^32/phi is mapped onto the workers by its high bits (multiply-high by the number of workers), the low bits would repeat the pattern of the class numbers for some worker counts
+                 *
+                 * @param eventClass
+                 * @return index of the worker
+                 */
+                [[nodiscard]] std::size_t GetWorkerIndex(GroupId eventClass) const noexcept
+                {
+                    const std::uint32_t hash = static_cast<std::uint32_t>(eventClass) * 2654435769u;
+                    return static_cast<std::size_t>((static_cast<std::uint64_t>(hash) * m_shards.size()) >> 32);
+                }
+                /**
+                 * @brief Get the number of worker threads
+                 *
+                 * @return std::size_t
+                 */
+                [[nodiscard]] std::size_t GetNWorkers() const noexcept {return m_shards.size();}
+                /**
+                 * @brief Get the worker of the given thread. Its outputs should be accessed only after Finish or inside Synchronize
+                 *
+                 * @param i index of the worker
+                 * @return Worker&
+                 */
+                [[nodiscard]] Worker& GetWorker(std::size_t i) noexcept {return m_shards[i]->worker;}
+        };
+    } // namespace Mixing
+
+#endif
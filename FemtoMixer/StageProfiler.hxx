@@ -0,0 +1,302 @@
+/**
+ * @file StageProfiler.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Per-stage timers and counters of the analysis. The scoped timers are compiled in only if FEMTOMIXER_PROFILING is defined, otherwise JJ_PROFILE_STAGE and JJ_PROFILE_SAMPLED_STAGE expand to nothing.
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef StageProfiler_hxx
+    #define StageProfiler_hxx
+
+    #include <array>
+    #include <chrono>
+    #include <cstddef>
+    #include <cstdint>
+    #include <cstdlib>
+    #include <ctime>
+    #include <iomanip>
+    #include <iostream>
+    #include <new>
+    #include <string>
+
+    #include "TH1D.h"
+
+    namespace JJUtils
+    {
+        /**
+         * @brief Instrumented stages of the analysis. The stages can be nested (e.g. PairConstruction is a part of Mixing), the time of each stage includes the time of the nested ones
+         *
+         */
+        enum class Stage : std::size_t {DstRead,TrackSorter,WireFetch,TrackConstruction,TrackSelection,Mixing,PairConstruction,PairRejection,HistogramFill,NStages};
+
+        namespace Detail
+        {
+            inline thread_local std::uint64_t allocationCount = 0; // incremented by operator new if FEMTOMIXER_COUNT_ALLOCATIONS is defined
+
+            /**
+             * @brief Get the CPU time used by the calling thread
+             *
+             * @return time in seconds
+             */
+            inline double GetThreadCpuTime() noexcept
+            {
+                timespec time;
+                clock_gettime(CLOCK_THREAD_CPUTIME_ID,&time);
+                return time.tv_sec + 1e-9 * time.tv_nsec;
+            }
+        } // namespace Detail
+
+        /**
+         * @brief Wall time, CPU time, number of calls and number of heap allocations of each stage. Every thread should own its profiler, the profilers are merged with Add after the threads are finished
+         *
+         */
+        class StageProfiler
+        {
+            public:
+                static constexpr std::size_t nStages = static_cast<std::size_t>(Stage::NStages);
+                static constexpr std::uint64_t sampleInterval = 64; // per-pair stages are timed once per sampleInterval calls, a timer costs ~1 us (two clock_gettime and two steady_clock reads) which is comparable to the pair itself
+
+                struct StageRecord
+                {
+                    double wallTime = 0, cpuTime = 0; // [s]
+                    std::uint64_t calls = 0, allocations = 0;
+                };
+
+            private:
+                std::array<StageRecord,nStages> m_records;
+
+            public:
+                StageProfiler() : m_records() {}
+                /**
+                 * @brief Get the name of the stage
+                 *
+                 * @param stage
+                 * @return const char*
+                 */
+                [[nodiscard]] static const char* GetStageName(Stage stage) noexcept
+                {
+                    constexpr std::array<const char*,nStages> names{"DST read","track sorter","wire fetch","track construction","track selection","mixing","pair construction","pair rejection","histogram fill"};
+                    return names[static_cast<std::size_t>(stage)];
+                }
+                /**
+                 * @brief Add one call of the stage
+                 *
+                 * @param stage
+                 * @param wallTime [s]
+                 * @param cpuTime [s]
+                 * @param allocations
+                 */
+                void Record(Stage stage, double wallTime, double cpuTime, std::uint64_t allocations) noexcept
+                {
+                    StageRecord &record = m_records[static_cast<std::size_t>(stage)];
+                    record.wallTime += wallTime;
+                    record.cpuTime += cpuTime;
+                    record.calls += 1;
+                    record.allocations += allocations;
+                }
+                /**
+                 * @brief Count one call of the stage without timing it
+                 *
+                 * @param stage
+                 * @return true if this call should be timed (one in sampleInterval calls), see RecordSample
+                 */
+                [[nodiscard]] bool Count(Stage stage) noexcept
+                {
+                    return (m_records[static_cast<std::size_t>(stage)].calls++ % sampleInterval) == 0;
+                }
+                /**
+                 * @brief Add the measurement of one sampled call of the stage, scaled by sampleInterval to stand for all calls counted with Count
+                 *
+                 * @param stage
+                 * @param wallTime [s]
+                 * @param cpuTime [s]
+                 * @param allocations
+                 */
+                void RecordSample(Stage stage, double wallTime, double cpuTime, std::uint64_t allocations) noexcept
+                {
+                    StageRecord &record = m_records[static_cast<std::size_t>(stage)];
+                    record.wallTime += sampleInterval * wallTime;
+                    record.cpuTime += sampleInterval * cpuTime;
+                    record.allocations += sampleInterval * allocations;
+                }
+                /**
+                 * @brief Get the accumulated record of the stage
+                 *
+                 * @param stage
+                 * @return const StageRecord&
+                 */
+                [[nodiscard]] const StageRecord& GetRecord(Stage stage) const noexcept {return m_records[static_cast<std::size_t>(stage)];}
+                /**
+                 * @brief Add the records of another profiler (e.g. of a worker thread)
+                 *
+                 * @param other
+                 */
+                void Add(const StageProfiler &other) noexcept
+                {
+                    for (std::size_t i = 0; i < nStages; ++i)
+                    {
+                        m_records[i].wallTime += other.m_records[i].wallTime;
+                        m_records[i].cpuTime += other.m_records[i].cpuTime;
+                        m_records[i].calls += other.m_records[i].calls;
+                        m_records[i].allocations += other.m_records[i].allocations;
+                    }
+                }
+                /**
+                 * @brief Clear all records
+                 *
+                 */
+                void Reset() noexcept {m_records.fill(StageRecord());}
+                /**
+                 * @brief Print the summary table of the stages which were called at least once
+                 *
+                 */
+                void Print() const
+                {
+                    std::cout << "---=== Stage profile ===---\n";
+#ifndef FEMTOMIXER_PROFILING
+                    std::cout << "profiling disabled (define FEMTOMIXER_PROFILING to enable it)\n\n";
+#else
+                    std::cout << std::left << std::setw(20) << "stage" << std::right << std::setw(14) << "wall [s]" << std::setw(14) << "CPU [s]" << std::setw(14) << "calls" << std::setw(16) << "wall/call [us]" << std::setw(14) << "allocations" << "\n";
+                    for (std::size_t i = 0; i < nStages; ++i)
+                    {
+                        const StageRecord &record = m_records[i];
+                        if (record.calls == 0)
+                            continue;
+
+                        std::cout << std::left << std::setw(20) << GetStageName(static_cast<Stage>(i)) << std::right << std::setw(14) << record.wallTime << std::setw(14) << record.cpuTime
+                            << std::setw(14) << record.calls << std::setw(16) << 1e6 * record.wallTime / record.calls << std::setw(14);
+#ifdef FEMTOMIXER_COUNT_ALLOCATIONS
+                        std::cout << record.allocations << "\n";
+#else
+                        std::cout << "n/a" << "\n";
+#endif
+                    }
+                    std::cout << "stage times include the nested stages (e.g. mixing includes pair construction)\n";
+                    std::cout << "pair construction, pair rejection and histogram fill are timed once per " << sampleInterval << " pairs and scaled\n\n";
+#endif
+                }
+                /**
+                 * @brief Write the summary into the current directory, as histograms with one labelled bin per stage (hProfileWallTime, hProfileCpuTime, hProfileCalls, hProfileAllocations)
+                 *
+                 */
+                void Write() const
+                {
+                    const std::array<std::string,4> names{"hProfileWallTime","hProfileCpuTime","hProfileCalls","hProfileAllocations"};
+                    const std::array<std::string,4> titles{"Wall time per stage;;t [s]","CPU time per stage;;t [s]","Calls per stage;;N_{calls}","Heap allocations per stage;;N_{alloc}"};
+                    for (std::size_t quantity = 0; quantity < names.size(); ++quantity)
+                    {
+                        TH1D histogram(names[quantity].data(),titles[quantity].data(),nStages,0,nStages);
+                        histogram.SetDirectory(nullptr);
+                        for (std::size_t i = 0; i < nStages; ++i)
+                        {
+                            const StageRecord &record = m_records[i];
+                            const double values[] = {record.wallTime,record.cpuTime,static_cast<double>(record.calls),static_cast<double>(record.allocations)};
+                            histogram.GetXaxis()->SetBinLabel(i + 1,GetStageName(static_cast<Stage>(i)));
+                            histogram.SetBinContent(i + 1,values[quantity]);
+                        }
+                        histogram.Write();
+                    }
+                }
+        };
+
+        /**
+         * @brief Measures the scope it lives in and records it in the profiler as one call of the stage. Use it through JJ_PROFILE_STAGE, so it disappears when profiling is disabled
+         *
+         */
+        class ScopedStageTimer
+        {
+            private:
+                StageProfiler &m_profiler;
+                Stage m_stage;
+                std::chrono::steady_clock::time_point m_wallStart;
+                double m_cpuStart;
+                std::uint64_t m_allocationStart;
+
+            public:
+                /**
+                 * @brief Construct a new Scoped Stage Timer object and start the measurement
+                 *
+                 * @param profiler
+                 * @param stage
+                 */
+                ScopedStageTimer(StageProfiler &profiler, Stage stage) noexcept :
+                    m_profiler(profiler), m_stage(stage), m_wallStart(std::chrono::steady_clock::now()), m_cpuStart(Detail::GetThreadCpuTime()), m_allocationStart(Detail::allocationCount) {}
+                ScopedStageTimer(const ScopedStageTimer &) = delete;
+                ScopedStageTimer& operator=(const ScopedStageTimer &) = delete;
+                ~ScopedStageTimer()
+                {
+                    const double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_wallStart).count();
+                    m_profiler.Record(m_stage,wallTime,Detail::GetThreadCpuTime() - m_cpuStart,Detail::allocationCount - m_allocationStart);
+                }
+        };
+
+        /**
+         * @brief Counts every call of a per-pair stage, but measures the scope only in one of StageProfiler::sampleInterval calls. Use it through JJ_PROFILE_SAMPLED_STAGE, so it disappears when profiling is disabled
+         *
+         */
+        class SampledStageTimer
+        {
+            private:
+                StageProfiler &m_profiler;
+                Stage m_stage;
+                bool m_sampled;
+                std::chrono::steady_clock::time_point m_wallStart;
+                double m_cpuStart = 0;
+                std::uint64_t m_allocationStart = 0;
+
+            public:
+                /**
+                 * @brief Construct a new Sampled Stage Timer object, count the call and start the measurement if the call is sampled
+                 *
+                 * @param profiler
+                 * @param stage
+                 */
+                SampledStageTimer(StageProfiler &profiler, Stage stage) noexcept : m_profiler(profiler), m_stage(stage), m_sampled(profiler.Count(stage))
+                {
+                    if (m_sampled)
+                    {
+                        m_wallStart = std::chrono::steady_clock::now();
+                        m_cpuStart = Detail::GetThreadCpuTime();
+                        m_allocationStart = Detail::allocationCount;
+                    }
+                }
+                SampledStageTimer(const SampledStageTimer &) = delete;
+                SampledStageTimer& operator=(const SampledStageTimer &) = delete;
+                ~SampledStageTimer()
+                {
+                    if (!m_sampled)
+                        return;
+
+                    const double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_wallStart).count();
+                    m_profiler.RecordSample(m_stage,wallTime,Detail::GetThreadCpuTime() - m_cpuStart,Detail::allocationCount - m_allocationStart);
+                }
+        };
+    } // namespace JJUtils
+
+    #define JJ_PROFILE_CONCAT_IMPL(a,b) a##b
+    #define JJ_PROFILE_CONCAT(a,b) JJ_PROFILE_CONCAT_IMPL(a,b)
+    #ifdef FEMTOMIXER_PROFILING
+        #define JJ_PROFILE_STAGE(profiler,stage) const JJUtils::ScopedStageTimer JJ_PROFILE_CONCAT(stageTimer,__LINE__)((profiler),(stage))
+        #define JJ_PROFILE_SAMPLED_STAGE(profiler,stage) const JJUtils::SampledStageTimer JJ_PROFILE_CONCAT(stageTimer,__LINE__)((profiler),(stage))
+    #else
+        #define JJ_PROFILE_STAGE(profiler,stage) static_cast<void>(0)
+        #define JJ_PROFILE_SAMPLED_STAGE(profiler,stage) static_cast<void>(0)
+    #endif
+
+    // Counting of the heap allocations replaces the global operator new/delete, so it must be enabled in only one translation unit of a compiled program (not in a macro loaded into an interactive ROOT session)
+    #ifdef FEMTOMIXER_COUNT_ALLOCATIONS
+        void* operator new(std::size_t size)
+        {
+            ++JJUtils::Detail::allocationCount;
+            if (void *ptr = std::malloc(size > 0 ? size : 1))
+                return ptr;
+            throw std::bad_alloc();
+        }
+        void operator delete(void *ptr) noexcept {std::free(ptr);}
+        void operator delete(void *ptr, std::size_t) noexcept {std::free(ptr);}
+    #endif
+
+#endif
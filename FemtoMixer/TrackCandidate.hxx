@@ -1,26 +1,49 @@
 #ifndef TrackCandidate_hxx
     #define TrackCandidate_hxx
 
+#include "Identifiers.hxx"
 #include "MdcWires.hxx"
 
+#include <memory>
+#include <string>
+#include <utility>
+
 #include "TLorentzVector.h"
 #include "TCutG.h"
+#ifndef FEMTOMIXER_STANDALONE // define it to use the candidates without HYDRA (e.g. when reading a femto skim)
 #include "hparticlecand.h"
 #include "hparticlecandsim.h"
 #include "hparticlemetamatcher.h"
 #include "hgeantkine.h"
+#endif
 
 namespace Selection
 {
     enum class Detector {RPC, ToF};
 
+    /**
+     * @brief Parameters of the track selection (TrackCandidate::SelectTrack). Default values correspond to the nominal selection
+     * 
+     */
+    struct TrackCuts
+    {
+        const TCutG *rpcCut = nullptr; // beta vs momentum cut for the RPC tracks
+        const TCutG *tofCut = nullptr; // beta vs momentum cut for the ToF tracks
+        bool checkPID = true;
+        unsigned maxBadLayers = 1; // maximal number of layers with too many fired wires
+        unsigned short minLayersInPlane = 4; // minimal number of fired layers in each MDC plane
+    };
+
     class TrackCandidate
     {
-        friend class PairCandidate; // this is here because I have a poorly structured code
+        friend class TrackStore; // this is here because I have a poorly structured code
+        friend class SkimTrackColumns;
+        friend class BufferTrackColumns;
 
         private:
             std::shared_ptr<TrackCandidate> GeantKineTrack;
-            std::string TrackId;
+            TrackIdentifier TrackId;
+            std::size_t TrackIndex;
             Detector System;
             bool isAtMdcEdge, isGoodMetaCell;
             short int PID, Charge, Sector;
@@ -102,6 +125,7 @@ namespace Selection
 
                 return tmpArray;
             }
+#ifndef FEMTOMIXER_STANDALONE
             /**
              * @brief Get the Meta Hits information for this track
              * 
@@ -218,6 +242,7 @@ namespace Selection
 
                 return output;
             }
+#endif
             /**
              * @brief Gets rid of the angle wrap when calculating pair azimuthal angle. Used phi range is (-202.5,157.5] (I need this for asHBT, to have a in-plane and out-of-plane bin)
              * 
@@ -236,25 +261,27 @@ namespace Selection
 
         public:
             TrackCandidate(){}
+#ifndef FEMTOMIXER_STANDALONE
             /**
              * @brief Construct a new Track Candidate object
              * 
              * @param particleCand HParticleCand object pointer
-             * @param wires array of the fired wires
+             * @param wires array of the fired wires (moved into the track, e.g. straight from HADES::MDC::CreateTrackLayers)
              * @param evtId unique ID of the underlying event
              * @param EP event plane angle of the underlying event
              * @param trackId unique ID of this track within the event (e.g. index of the track in the loop)
              * @param pid PID of the particle we want (when using DSTs put here whatever, just make sure the same PID is in the TrackCandidate::SelectTrack method)
              */
-            TrackCandidate(HParticleCand* particleCand, const HADES::MDC::LayersTrack &wires, const std::string &evtId, float EP, std::size_t trackId, short pid) : 
-                GeantKineTrack(nullptr), ReactionPlaneAngle(EP),NBadLayers(0),firedWiresCollection(wires),
+            TrackCandidate(HParticleCand* particleCand, HADES::MDC::LayersTrack &&wires, EventIdentifier evtId, float EP, std::size_t trackId, short pid) : 
+                GeantKineTrack(nullptr), ReactionPlaneAngle(EP),NBadLayers(0),firedWiresCollection(std::move(wires)),
                 goodLayers(CalculateLayersPerPlane(firedWiresCollection)),metaHits(CalcMetaHits(particleCand))
             {
                 particleCand->calc4vectorProperties(HPhysicsConstants::mass(14));
                 TLorentzVector vecTmp = *particleCand;
                 NBadLayers = RemoveAndCountBadLayers(firedWiresCollection,2);
 
-                TrackId = evtId + std::to_string(trackId);
+                TrackId = TrackIdentifier{evtId,static_cast<std::uint32_t>(trackId)};
+                TrackIndex = trackId;
                 AzimuthalAngle = particleCand->getPhi();
                 AzimuthalAngleWrtEP = ConstrainAngle(particleCand->getPhi() - ReactionPlaneAngle);
                 Beta = particleCand->getBeta(); // or should I use this one Beta = 1 - (1/(1+(TotalMomentum*TotalMomentum/Mass2))); ?
@@ -283,26 +310,33 @@ namespace Selection
                 metaMatchQuality = particleCand->getMetaMatchQuality();
                 chi2 = particleCand->getChi2();
             }
+            /**
+             * @brief Construct a new Track Candidate object from a copy of the wires (see the overload taking the wires as an rvalue)
+             * 
+             */
+            TrackCandidate(HParticleCand* particleCand, const HADES::MDC::LayersTrack &wires, EventIdentifier evtId, float EP, std::size_t trackId, short pid) : 
+                TrackCandidate(particleCand,HADES::MDC::LayersTrack(wires),evtId,EP,trackId,pid) {}
             /**
              * @brief Construct a new Track Candidate object
              * 
              * @param particleCand HParticleCandSim object pointer (contains PID)
-             * @param wires 
+             * @param wires array of the fired wires (moved into the track, e.g. straight from HADES::MDC::CreateTrackLayers)
              * @param evtId unique ID of the underlying event
              * @param EP event plane angle of the underlying event
              * @param trackId unique ID of this track within the event (e.g. index of the track in the loop)
              * @param pid PID of the particle we want (put here whatever, we use HParticleCandSim for PID later)
              */
-            TrackCandidate(HParticleCandSim* particleCand,HGeantKine* geantKine, const HADES::MDC::LayersTrack &wires, const std::string &evtId, float EP, std::size_t trackId, short pid) : 
+            TrackCandidate(HParticleCandSim* particleCand,HGeantKine* geantKine, HADES::MDC::LayersTrack &&wires, EventIdentifier evtId, float EP, std::size_t trackId, short pid) : 
                 GeantKineTrack((geantKine == nullptr) ? nullptr : new TrackCandidate(geantKine,evtId,EP,trackId,pid)), 
-                ReactionPlaneAngle(EP),NBadLayers(0),firedWiresCollection(wires),goodLayers(CalculateLayersPerPlane(firedWiresCollection)),
+                ReactionPlaneAngle(EP),NBadLayers(0),firedWiresCollection(std::move(wires)),goodLayers(CalculateLayersPerPlane(firedWiresCollection)),
                 metaHits(CalcMetaHits(particleCand))
             {
                 particleCand->calc4vectorProperties(HPhysicsConstants::mass(particleCand->getGeantPID()));
                 TLorentzVector vecTmp = *particleCand;
                 NBadLayers = RemoveAndCountBadLayers(firedWiresCollection,2);
 
-                TrackId = evtId + std::to_string(trackId);
+                TrackId = TrackIdentifier{evtId,static_cast<std::uint32_t>(trackId)};
+                TrackIndex = trackId;
                 AzimuthalAngle = particleCand->getPhi();
                 AzimuthalAngleWrtEP = ConstrainAngle(particleCand->getPhi() - ReactionPlaneAngle);
                 Beta = particleCand->getBeta(); // or should I use this one Beta = 1 - (1/(1+(TotalMomentum*TotalMomentum/Mass2))); ?
@@ -331,6 +365,12 @@ namespace Selection
                 metaMatchQuality = particleCand->getMetaMatchQuality();
                 chi2 = particleCand->getChi2();
             }
+            /**
+             * @brief Construct a new Track Candidate object from a copy of the wires (see the overload taking the wires as an rvalue)
+             * 
+             */
+            TrackCandidate(HParticleCandSim* particleCand,HGeantKine* geantKine, const HADES::MDC::LayersTrack &wires, EventIdentifier evtId, float EP, std::size_t trackId, short pid) : 
+                TrackCandidate(particleCand,geantKine,HADES::MDC::LayersTrack(wires),evtId,EP,trackId,pid) {}
             /**
              * @brief Construct a new Track Candidate object
              * 
@@ -341,13 +381,14 @@ namespace Selection
              * @param trackId unique ID of this track within the event (e.g. index of the track in the loop)
              * @param pid PID of the particle we want (put here whatever, we use HParticleCandSim for PID later)
              */
-            TrackCandidate(HGeantKine* particleCand, const std::string &evtId, float EP, std::size_t trackId, short pid) :
+            TrackCandidate(HGeantKine* particleCand, EventIdentifier evtId, float EP, std::size_t trackId, short pid) :
                 GeantKineTrack(nullptr), ReactionPlaneAngle(EP),innerSegChi2(std::numeric_limits<float>::max()), 
                 outerSegChi2(std::numeric_limits<float>::max()), metaMatchQuality(std::numeric_limits<float>::max()), 
                 chi2(std::numeric_limits<float>::max()),NBadLayers(0),firedWiresCollection({}),goodLayers({}),
                 metaHits(CalcMetaHits(particleCand))
             {
-                TrackId = evtId + std::to_string(trackId);
+                TrackId = TrackIdentifier{evtId,static_cast<std::uint32_t>(trackId)};
+                TrackIndex = trackId;
                 AzimuthalAngle = particleCand->getPhiDeg();
                 AzimuthalAngleWrtEP = ConstrainAngle(particleCand->getPhiDeg() - ReactionPlaneAngle);
                 Energy = particleCand->getE();
@@ -368,6 +409,7 @@ namespace Selection
                 TransverseMomentum = particleCand->getTransverseMomentum();
                 Beta = 1 - (1/(1+(TotalMomentum*TotalMomentum/Mass2))); // beta = 1 - 1/(1+p^2/m_0^2) if my calculations are correct
             }
+#endif
             /**
              * @brief Track selection method
              * 
@@ -379,7 +421,23 @@ namespace Selection
              */
             bool SelectTrack(const TCutG *rpcCut, const TCutG *tofCut, bool checkPID = true) const
             {
-                if (PID != 14 && checkPID)
+                TrackCuts cuts;
+                cuts.rpcCut = rpcCut;
+                cuts.tofCut = tofCut;
+                cuts.checkPID = checkPID;
+
+                return SelectTrack(cuts);
+            }
+            /**
+             * @brief Track selection method
+             * 
+             * @param cuts parameters of the selection
+             * @return true if track is selected
+             * @return false otherwise
+             */
+            bool SelectTrack(const TrackCuts &cuts) const
+            {
+                if (PID != 14 && cuts.checkPID)
                     return false;
                 if (isAtMdcEdge)
                     return false;
@@ -391,20 +449,20 @@ namespace Selection
                 //     return false;
                 // if (chi2 >= 400)
                 //     return false;
-                if (NBadLayers > 1)
+                if (NBadLayers > cuts.maxBadLayers)
                     return false;
-                if (std::count_if(goodLayers.begin(),goodLayers.end(),[](unsigned i){return (i > 3);}) != 4)
+                if (std::count_if(goodLayers.begin(),goodLayers.end(),[&cuts](unsigned i){return (i >= cuts.minLayersInPlane);}) != 4)
                     return false;
 
                 switch (System)
                 {
                     case Detector::RPC:
-                        if (rpcCut->IsInside(TotalMomentum*Charge,Beta))
+                        if (cuts.rpcCut->IsInside(TotalMomentum*Charge,Beta))
                             return true;
                         break;
 
                     case Detector::ToF:
-                        if (tofCut->IsInside(TotalMomentum*Charge,Beta))
+                        if (cuts.tofCut->IsInside(TotalMomentum*Charge,Beta))
                             return true;
                         break;
                 }
@@ -415,31 +473,40 @@ namespace Selection
              * @brief Get the indexes of wires at given layer
              * 
              * @param layer 
-             * @return std::vector<unsigned> 
+             * @return const std::vector<unsigned>& 
              * @throw std::out_of_range is thrown when layer value exceeds the HADES::MDC::WireInfo::numberOfAllLayers-1 value
              */
-            [[nodiscard]] std::vector<unsigned> GetWires(std::size_t layer) const
+            [[nodiscard]] const std::vector<unsigned>& GetWires(std::size_t layer) const
             {
                 return firedWiresCollection.at(layer);
             }
             /**
              * @brief Get the All Wires object
              * 
-             * @return HADES::MDC::LayersTrack 
+             * @return const HADES::MDC::LayersTrack& 
              */
-            [[nodiscard]] HADES::MDC::LayersTrack GetAllWires() const noexcept
+            [[nodiscard]] const HADES::MDC::LayersTrack& GetAllWires() const noexcept
             {
                 return firedWiresCollection;
             }
             /**
              * @brief Get the unique ID of this track
              * 
-             * @return std::string 
+             * @return TrackIdentifier 
              */
-            [[nodiscard]] std::string GetID() const noexcept
+            [[nodiscard]] TrackIdentifier GetID() const noexcept
             {
                 return TrackId;
             }
+            /**
+             * @brief Get the index of this track within the event (e.g. index of the track in the loop)
+             * 
+             * @return std::size_t 
+             */
+            [[nodiscard]] std::size_t GetIndex() const noexcept
+            {
+                return TrackIndex;
+            }
             /**
              * @brief Get the detector which registered the track
              * 
@@ -605,9 +672,9 @@ namespace Selection
             /**
              * @brief Get all META hits
              * 
-             * @return std::vector<unsigned> 
+             * @return const std::vector<unsigned>& 
              */
-            [[nodiscard]] std::vector<unsigned> GetMetaHits() const noexcept
+            [[nodiscard]] const std::vector<unsigned>& GetMetaHits() const noexcept
             {
                 return metaHits;
             }
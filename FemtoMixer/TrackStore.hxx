@@ -0,0 +1,441 @@
+/**
+ * @file TrackStore.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Columnar (structure-of-arrays) storage of the selected tracks of an event, together with lightweight handles pointing into it
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef TrackStore_hxx
+    #define TrackStore_hxx
+
+    #include "TrackCandidate.hxx"
+
+    #include <atomic>
+    #include <cstddef>
+    #include <cstdint>
+    #include <iterator>
+    #include <limits>
+    #include <memory>
+    #include <vector>
+
+    namespace Selection
+    {
+        /**
+         * @brief Bitmask of the cut variations (see Mixing::VariationTable) which an object passes. Bit N is set if the N-th variation accepts it
+         *
+         */
+        using VariationMask = std::uint64_t;
+        /**
+         * @brief Mask of an object accepted by every variation (default, when no variations are used)
+         *
+         */
+        constexpr VariationMask allVariations = std::numeric_limits<VariationMask>::max();
+
+        /**
+         * @brief Non-owning, read-only view of a contiguous range of elements (a minimal stand-in for C++20 std::span). The viewed memory must outlive the view.
+         *
+         * @tparam T element type
+         */
+        template <typename T>
+        class Span
+        {
+            private:
+                const T *m_data;
+                std::size_t m_size;
+
+            public:
+                constexpr Span() noexcept : m_data(nullptr), m_size(0) {}
+                constexpr Span(const T *data, std::size_t size) noexcept : m_data(data), m_size(size) {}
+
+                [[nodiscard]] constexpr const T* begin() const noexcept {return m_data;}
+                [[nodiscard]] constexpr const T* end() const noexcept {return m_data + m_size;}
+                [[nodiscard]] constexpr const T* data() const noexcept {return m_data;}
+                [[nodiscard]] constexpr std::size_t size() const noexcept {return m_size;}
+                [[nodiscard]] constexpr bool empty() const noexcept {return m_size == 0;}
+                [[nodiscard]] constexpr const T& operator[](std::size_t i) const noexcept {return m_data[i];}
+        };
+
+        class TrackStore;
+
+        /**
+         * @brief Lightweight, trivially copyable reference to a single track held inside a TrackStore. The handle does not own the store, the store must outlive it.
+         *
+         */
+        class TrackHandle
+        {
+            private:
+                const TrackStore *m_store;
+                std::uint32_t m_index;
+
+            public:
+                TrackHandle() : m_store(nullptr), m_index(0) {}
+                TrackHandle(const TrackStore *store, std::uint32_t index) : m_store(store), m_index(index) {}
+
+                /**
+                 * @brief Get the store in which this track lives
+                 *
+                 * @return const TrackStore*
+                 */
+                [[nodiscard]] const TrackStore* GetStore() const noexcept {return m_store;}
+                /**
+                 * @brief Get the position of this track inside the store (not to be confused with GetIndex)
+                 *
+                 * @return std::uint32_t
+                 */
+                [[nodiscard]] std::uint32_t GetPosition() const noexcept {return m_index;}
+
+                [[nodiscard]] inline TrackIdentifier GetID() const noexcept;
+                [[nodiscard]] inline std::size_t GetIndex() const noexcept;
+                [[nodiscard]] inline float GetPx() const noexcept;
+                [[nodiscard]] inline float GetPy() const noexcept;
+                [[nodiscard]] inline float GetPz() const noexcept;
+                [[nodiscard]] inline float GetEnergy() const noexcept;
+                [[nodiscard]] inline float GetPhi() const noexcept;
+                [[nodiscard]] inline float GetTheta() const noexcept;
+                [[nodiscard]] inline float GetRapidity() const noexcept;
+                [[nodiscard]] inline float GetPt() const noexcept;
+                [[nodiscard]] inline short int GetSector() const noexcept;
+                [[nodiscard]] inline const HADES::MDC::PackedLayersTrack& GetPackedWires() const noexcept;
+                [[nodiscard]] inline HADES::MDC::LayersTrack GetAllWires() const;
+                [[nodiscard]] inline Span<std::uint16_t> GetMetaHits() const noexcept;
+                [[nodiscard]] inline bool HasGeantKine() const noexcept;
+                [[nodiscard]] inline TrackHandle GetGeantKine() const noexcept;
+                [[nodiscard]] inline VariationMask GetVariationMask() const noexcept;
+        };
+
+        /**
+         * @brief Structure-of-arrays container of tracks. Kinematic variables are kept in contiguous float columns, while the fired MDC wires (HADES::MDC::PackedLayersTrack) and META cells are kept in fixed-width blocks, so no per-track heap allocation is needed.
+         *
+         */
+        class TrackStore
+        {
+            public:
+                // reconstructed tracks have at most two META hits, HGeantKine tracks have one per crossed cell (or RPC gap), so they can have more: those above the block are dropped and counted (see GetNDroppedMetaHits)
+                static constexpr std::size_t metaBlockSize = 4;
+                static constexpr std::uint16_t emptySlot = std::numeric_limits<std::uint16_t>::max();
+
+            private:
+                inline static std::atomic<std::size_t> m_nDroppedMetaHits = 0;
+
+                EventIdentifier m_eventId;
+                std::vector<float> m_px, m_py, m_pz, m_energy, m_phi, m_theta, m_rapidity, m_pt;
+                std::vector<short int> m_sector;
+                std::vector<std::uint32_t> m_trackIndex;
+                std::vector<HADES::MDC::PackedLayersTrack> m_wires;
+                std::vector<std::uint16_t> m_metaHits;
+                std::vector<std::uint8_t> m_hasKine;
+                std::vector<VariationMask> m_variationMask;
+                std::unique_ptr<TrackStore> m_kineStore;
+
+                /**
+                 * @brief Append a single track to the columns without touching the HGeantKine store
+                 *
+                 * @param track selected track
+                 */
+                void PushColumns(const TrackCandidate &track)
+                {
+                    m_px.push_back(track.Px);
+                    m_py.push_back(track.Py);
+                    m_pz.push_back(track.Pz);
+                    m_energy.push_back(track.Energy);
+                    m_phi.push_back(track.AzimuthalAngle);
+                    m_theta.push_back(track.PolarAngle);
+                    m_rapidity.push_back(track.Rapidity);
+                    m_pt.push_back(track.TransverseMomentum);
+                    m_sector.push_back(track.Sector);
+                    m_trackIndex.push_back(static_cast<std::uint32_t>(track.TrackIndex));
+
+                    m_wires.emplace_back(track.firedWiresCollection);
+
+                    PackMetaHits(track.metaHits,std::back_inserter(m_metaHits));
+
+                    m_hasKine.push_back(0);
+                    m_variationMask.push_back(allVariations);
+                }
+                /**
+                 * @brief Append an empty placeholder track (used to keep the HGeantKine store aligned with the reconstructed one)
+                 *
+                 */
+                void PushEmpty()
+                {
+                    for (auto *column : {&m_px, &m_py, &m_pz, &m_energy, &m_phi, &m_theta, &m_rapidity, &m_pt})
+                        column->push_back(0.f);
+                    m_sector.push_back(-1);
+                    m_trackIndex.push_back(0);
+                    m_wires.emplace_back();
+                    m_metaHits.insert(m_metaHits.end(),metaBlockSize,emptySlot);
+                    m_hasKine.push_back(0);
+                    m_variationMask.push_back(allVariations);
+                }
+                /**
+                 * @brief Append a copy of a track from another store without touching the HGeantKine store
+                 *
+                 * @param other source store
+                 * @param position position of the track in the source store
+                 */
+                void PushColumns(const TrackStore &other, std::uint32_t position)
+                {
+                    m_px.push_back(other.m_px[position]);
+                    m_py.push_back(other.m_py[position]);
+                    m_pz.push_back(other.m_pz[position]);
+                    m_energy.push_back(other.m_energy[position]);
+                    m_phi.push_back(other.m_phi[position]);
+                    m_theta.push_back(other.m_theta[position]);
+                    m_rapidity.push_back(other.m_rapidity[position]);
+                    m_pt.push_back(other.m_pt[position]);
+                    m_sector.push_back(other.m_sector[position]);
+                    m_trackIndex.push_back(other.m_trackIndex[position]);
+                    m_wires.push_back(other.m_wires[position]);
+                    m_metaHits.insert(m_metaHits.end(),other.GetMetaBlock(position),other.GetMetaBlock(position) + metaBlockSize);
+                    m_hasKine.push_back(0);
+                    m_variationMask.push_back(other.m_variationMask[position]);
+                }
+
+            public:
+                /**
+                 * @brief Write the META hits of a track as a block of metaBlockSize slots (the unused slots are set to emptySlot). This is the only place where the hits are truncated, so the TrackStore, the femto skim (FemtoSkim.hxx) and the checkpoints (Checkpoint.hxx) keep the same hits. The hits which do not fit are dropped and counted
+                 *
+                 * @tparam OutputIt output iterator of std::uint16_t
+                 * @param hits META cells of the track (TrackCandidate::metaHits)
+                 * @param out
+                 * @return OutputIt iterator past the written block
+                 */
+                template <typename OutputIt>
+                static OutputIt PackMetaHits(const std::vector<unsigned> &hits, OutputIt out)
+                {
+                    for (std::size_t slot = 0; slot < metaBlockSize; ++slot)
+                        *out++ = (slot < hits.size()) ? static_cast<std::uint16_t>(hits[slot]) : emptySlot;
+
+                    if (hits.size() > metaBlockSize)
+                        m_nDroppedMetaHits.fetch_add(hits.size() - metaBlockSize,std::memory_order_relaxed);
+
+                    return out;
+                }
+                /**
+                 * @brief Get the number of META hits dropped by PackMetaHits in this process (all threads), non-zero only for tracks with more than metaBlockSize hits. Those tracks can miss a shared META cell in the pair rejection
+                 *
+                 * @return std::size_t
+                 */
+                [[nodiscard]] static std::size_t GetNDroppedMetaHits() noexcept {return m_nDroppedMetaHits.load(std::memory_order_relaxed);}
+
+                TrackStore() {}
+                /**
+                 * @brief Construct a new Track Store object
+                 *
+                 * @param evtId unique ID of the event to which the stored tracks belong
+                 */
+                explicit TrackStore(EventIdentifier evtId) : m_eventId(evtId) {}
+                /**
+                 * @brief Reserve memory for a given number of tracks
+                 *
+                 * @param nTracks
+                 */
+                void Reserve(std::size_t nTracks)
+                {
+                    for (auto *column : {&m_px, &m_py, &m_pz, &m_energy, &m_phi, &m_theta, &m_rapidity, &m_pt})
+                        column->reserve(nTracks);
+                    m_sector.reserve(nTracks);
+                    m_trackIndex.reserve(nTracks);
+                    m_wires.reserve(nTracks);
+                    m_metaHits.reserve(nTracks * metaBlockSize);
+                    m_hasKine.reserve(nTracks);
+                    m_variationMask.reserve(nTracks);
+                }
+                /**
+                 * @brief Copy the selected TrackCandidate into the store. If the track has an underlying HGeantKine track it is stored at the same position in the HGeantKine store.
+                 *
+                 * @param track selected track
+                 * @param mask variations which accept the track (and its event)
+                 * @return position of the new track inside the store
+                 */
+                std::uint32_t Add(const TrackCandidate &track, VariationMask mask = allVariations)
+                {
+                    const auto position = static_cast<std::uint32_t>(m_px.size());
+                    PushColumns(track);
+                    m_variationMask.back() = mask;
+
+                    if (track.GeantKineTrack != nullptr)
+                    {
+                        if (m_kineStore == nullptr)
+                            m_kineStore = std::make_unique<TrackStore>(m_eventId);
+
+                        // keep both stores aligned, so the same position can be used in both
+                        while (m_kineStore->size() < position)
+                            m_kineStore->PushEmpty();
+                        m_kineStore->PushColumns(*track.GeantKineTrack);
+                        m_hasKine.back() = 1;
+                    }
+
+                    return position;
+                }
+                /**
+                 * @brief Copy a track (and its HGeantKine counterpart) from another store
+                 *
+                 * @param track handle to the track in the other store
+                 * @return position of the new track inside the store
+                 */
+                std::uint32_t Add(const TrackHandle &track)
+                {
+                    const auto position = static_cast<std::uint32_t>(m_px.size());
+                    PushColumns(*track.GetStore(),track.GetPosition());
+
+                    if (track.HasGeantKine())
+                    {
+                        if (m_kineStore == nullptr)
+                            m_kineStore = std::make_unique<TrackStore>(m_eventId);
+
+                        while (m_kineStore->size() < position)
+                            m_kineStore->PushEmpty();
+                        m_kineStore->Add(track.GetGeantKine());
+                        m_hasKine.back() = 1;
+                    }
+
+                    return position;
+                }
+                /**
+                 * @brief Remove all tracks and assign the store to another event. The allocated memory is kept, so a reused store does not allocate in the steady state
+                 *
+                 * @param evtId unique ID of the new event
+                 */
+                void Reset(EventIdentifier evtId)
+                {
+                    m_eventId = evtId;
+                    for (auto *column : {&m_px, &m_py, &m_pz, &m_energy, &m_phi, &m_theta, &m_rapidity, &m_pt})
+                        column->clear();
+                    m_sector.clear();
+                    m_trackIndex.clear();
+                    m_wires.clear();
+                    m_metaHits.clear();
+                    m_hasKine.clear();
+                    m_variationMask.clear();
+                    if (m_kineStore != nullptr)
+                        m_kineStore->Reset(evtId);
+                }
+                /**
+                 * @brief Get the size of the memory allocated by the columns (including the HGeantKine store)
+                 *
+                 * @return std::size_t
+                 */
+                [[nodiscard]] std::size_t GetAllocatedBytes() const noexcept
+                {
+                    std::size_t bytes = 0;
+                    for (const auto *column : {&m_px, &m_py, &m_pz, &m_energy, &m_phi, &m_theta, &m_rapidity, &m_pt})
+                        bytes += column->capacity() * sizeof(float);
+                    bytes += m_sector.capacity() * sizeof(short int) + m_trackIndex.capacity() * sizeof(std::uint32_t);
+                    bytes += m_wires.capacity() * sizeof(HADES::MDC::PackedLayersTrack) + m_metaHits.capacity() * sizeof(std::uint16_t);
+                    bytes += m_hasKine.capacity() * sizeof(std::uint8_t) + m_variationMask.capacity() * sizeof(VariationMask);
+                    if (m_kineStore != nullptr)
+                        bytes += m_kineStore->GetAllocatedBytes();
+
+                    return bytes;
+                }
+                /**
+                 * @brief Get the handle to the track at a given position
+                 *
+                 * @param position
+                 * @return TrackHandle
+                 */
+                [[nodiscard]] TrackHandle GetHandle(std::uint32_t position) const noexcept
+                {
+                    return TrackHandle(this,position);
+                }
+                /**
+                 * @brief Get the number of stored tracks
+                 *
+                 * @return std::size_t
+                 */
+                [[nodiscard]] std::size_t size() const noexcept {return m_px.size();}
+                /**
+                 * @brief Check if the store is empty
+                 *
+                 * @return true if there are no tracks
+                 */
+                [[nodiscard]] bool empty() const noexcept {return m_px.empty();}
+                /**
+                 * @brief Get the unique ID of the event to which the stored tracks belong
+                 *
+                 * @return EventIdentifier
+                 */
+                [[nodiscard]] EventIdentifier GetEventID() const noexcept {return m_eventId;}
+                /**
+                 * @brief Get the store holding the HGeantKine counterparts of the tracks (nullptr if there are none)
+                 *
+                 * @return const TrackStore*
+                 */
+                [[nodiscard]] const TrackStore* GetGeantKineStore() const noexcept {return m_kineStore.get();}
+
+                [[nodiscard]] const float* GetPxColumn() const noexcept {return m_px.data();}
+                [[nodiscard]] const float* GetPyColumn() const noexcept {return m_py.data();}
+                [[nodiscard]] const float* GetPzColumn() const noexcept {return m_pz.data();}
+                [[nodiscard]] const float* GetEnergyColumn() const noexcept {return m_energy.data();}
+                [[nodiscard]] const float* GetPhiColumn() const noexcept {return m_phi.data();}
+                [[nodiscard]] const float* GetThetaColumn() const noexcept {return m_theta.data();}
+                [[nodiscard]] const float* GetRapidityColumn() const noexcept {return m_rapidity.data();}
+                [[nodiscard]] const float* GetPtColumn() const noexcept {return m_pt.data();}
+                [[nodiscard]] const short int* GetSectorColumn() const noexcept {return m_sector.data();}
+                [[nodiscard]] const std::uint32_t* GetTrackIndexColumn() const noexcept {return m_trackIndex.data();}
+                /**
+                 * @brief Get the fired wires of a given track
+                 *
+                 * @param position
+                 * @return fixed-capacity collection of fired wires
+                 */
+                [[nodiscard]] const HADES::MDC::PackedLayersTrack& GetPackedWires(std::uint32_t position) const noexcept {return m_wires[position];}
+                /**
+                 * @brief Get the block of META hits of a given track (metaBlockSize slots, empty slots are set to emptySlot)
+                 *
+                 * @param position
+                 * @return pointer to the first slot of the block
+                 */
+                [[nodiscard]] const std::uint16_t* GetMetaBlock(std::uint32_t position) const noexcept {return m_metaHits.data() + position * metaBlockSize;}
+                /**
+                 * @brief Check if the track at a given position has an HGeantKine counterpart
+                 *
+                 * @param position
+                 * @return true if it has and false otherwise
+                 */
+                [[nodiscard]] bool HasGeantKine(std::uint32_t position) const noexcept {return m_hasKine[position] != 0;}
+                /**
+                 * @brief Get the variations which accept the track at a given position
+                 *
+                 * @param position
+                 * @return VariationMask
+                 */
+                [[nodiscard]] VariationMask GetVariationMask(std::uint32_t position) const noexcept {return m_variationMask[position];}
+        };
+
+        TrackIdentifier TrackHandle::GetID() const noexcept {return TrackIdentifier{m_store->GetEventID(),m_store->GetTrackIndexColumn()[m_index]};}
+        std::size_t TrackHandle::GetIndex() const noexcept {return m_store->GetTrackIndexColumn()[m_index];}
+        float TrackHandle::GetPx() const noexcept {return m_store->GetPxColumn()[m_index];}
+        float TrackHandle::GetPy() const noexcept {return m_store->GetPyColumn()[m_index];}
+        float TrackHandle::GetPz() const noexcept {return m_store->GetPzColumn()[m_index];}
+        float TrackHandle::GetEnergy() const noexcept {return m_store->GetEnergyColumn()[m_index];}
+        float TrackHandle::GetPhi() const noexcept {return m_store->GetPhiColumn()[m_index];}
+        float TrackHandle::GetTheta() const noexcept {return m_store->GetThetaColumn()[m_index];}
+        float TrackHandle::GetRapidity() const noexcept {return m_store->GetRapidityColumn()[m_index];}
+        float TrackHandle::GetPt() const noexcept {return m_store->GetPtColumn()[m_index];}
+        short int TrackHandle::GetSector() const noexcept {return m_store->GetSectorColumn()[m_index];}
+        const HADES::MDC::PackedLayersTrack& TrackHandle::GetPackedWires() const noexcept {return m_store->GetPackedWires(m_index);}
+        HADES::MDC::LayersTrack TrackHandle::GetAllWires() const {return m_store->GetPackedWires(m_index).Unpack();}
+        Span<std::uint16_t> TrackHandle::GetMetaHits() const noexcept
+        {
+            // the hits are stored as a prefix of the block, followed by the empty slots
+            const std::uint16_t *block = m_store->GetMetaBlock(m_index);
+            std::size_t nHits = 0;
+            while (nHits < TrackStore::metaBlockSize && block[nHits] != TrackStore::emptySlot)
+                ++nHits;
+
+            return Span<std::uint16_t>(block,nHits);
+        }
+        bool TrackHandle::HasGeantKine() const noexcept {return m_store->HasGeantKine(m_index);}
+        TrackHandle TrackHandle::GetGeantKine() const noexcept
+        {
+            return HasGeantKine() ? TrackHandle(m_store->GetGeantKineStore(),m_index) : TrackHandle();
+        }
+        VariationMask TrackHandle::GetVariationMask() const noexcept {return m_store->GetVariationMask(m_index);}
+    } // namespace Selection
+
+#endif
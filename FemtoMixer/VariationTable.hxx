@@ -0,0 +1,244 @@
+/**
+ * @file VariationTable.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Table of cut variations evaluated in a single pass. Events, tracks and pairs are tagged with the bitmask of the variations which accept them.
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef VariationTable_hxx
+    #define VariationTable_hxx
+
+    #include <functional>
+    #include <iostream>
+    #include <memory>
+    #include <stdexcept>
+    #include <string>
+    #include <vector>
+
+    #include "MixingGroups.hxx"
+    #include "PairUtils.hxx"
+
+    namespace Mixing
+    {
+        /**
+         * @brief Single set of event, track and pair cuts (e.g. the nominal selection or one systematic variation)
+         *
+         */
+        struct Variation
+        {
+            std::string name;
+            Selection::EventCuts event;
+            Selection::TrackCuts track;
+            PairCuts pair;
+        };
+
+        /**
+         * @brief Collection of cut variations (at most maxVariations). Each object is evaluated once by all variations and the result is stored as a Selection::VariationMask, so a whole systematic campaign is done with a single reading of the data and a single pair building.
+         *
+         */
+        class VariationTable
+        {
+            public:
+                static constexpr std::size_t maxVariations = 8 * sizeof(Selection::VariationMask);
+
+            private:
+                std::vector<Variation> m_variations;
+                PairRejection m_pairRejection;
+
+                [[nodiscard]] static constexpr Selection::VariationMask Bit(std::size_t variation) noexcept {return Selection::VariationMask(1) << variation;}
+
+            public:
+                VariationTable() {}
+                /**
+                 * @brief Add a new variation, its bit in the variation mask is equal to the number of previously added variations
+                 *
+                 * @param variation
+                 * @return index of the variation
+                 * @throws std::length_error if the table already has maxVariations variations
+                 * @throws std::invalid_argument if the pair cuts are invalid (see PairCuts::Validate)
+                 */
+                std::size_t Add(const Variation &variation)
+                {
+                    if (m_variations.size() >= maxVariations)
+                        throw std::length_error("VariationTable: at most " + std::to_string(maxVariations) + " variations are supported");
+                    variation.pair.Validate();
+
+                    m_variations.push_back(variation);
+                    return m_variations.size() - 1;
+                }
+                /**
+                 * @brief Get the number of variations
+                 *
+                 * @return std::size_t
+                 */
+                [[nodiscard]] std::size_t GetNVariations() const noexcept {return m_variations.size();}
+                /**
+                 * @brief Get the variation with a given index
+                 *
+                 * @param variation index of the variation
+                 * @return const Variation&
+                 */
+                [[nodiscard]] const Variation& GetVariation(std::size_t variation) const {return m_variations.at(variation);}
+                /**
+                 * @brief Get the mask of all variations in the table
+                 *
+                 * @return Selection::VariationMask
+                 */
+                [[nodiscard]] Selection::VariationMask GetFullMask() const noexcept
+                {
+                    return (m_variations.size() == maxVariations) ? Selection::allVariations : Bit(m_variations.size()) - 1;
+                }
+                /**
+                 * @brief Evaluate the event selection of all variations
+                 *
+                 * @tparam T HADES target setup
+                 * @param event
+                 * @return mask of the variations which accept the event
+                 */
+                template <HADES::Target::Setup T>
+                [[nodiscard]] Selection::VariationMask SelectEvent(Selection::EventCandidate &event) const
+                {
+                    Selection::VariationMask mask = 0;
+                    for (std::size_t i = 0; i < m_variations.size(); ++i)
+                        if (event.SelectEvent<T>(m_variations[i].event))
+                            mask |= Bit(i);
+
+                    return mask;
+                }
+                /**
+                 * @brief Evaluate the track selection of all variations
+                 *
+                 * @param track
+                 * @return mask of the variations which accept the track
+                 */
+                [[nodiscard]] Selection::VariationMask SelectTrack(const Selection::TrackCandidate &track) const
+                {
+                    Selection::VariationMask mask = 0;
+                    for (std::size_t i = 0; i < m_variations.size(); ++i)
+                        if (track.SelectTrack(m_variations[i].track))
+                            mask |= Bit(i);
+
+                    return mask;
+                }
+                /**
+                 * @brief Evaluate the pair rejection of the variations which accept both tracks of the pair. The detector-level variables of the pair are calculated only once
+                 *
+                 * @param pair
+                 * @return mask of the variations which accept the pair
+                 */
+                [[nodiscard]] Selection::VariationMask SelectPair(const Selection::PairCandidate &pair) const
+                {
+                    Selection::VariationMask mask = 0;
+                    for (std::size_t i = 0; i < m_variations.size(); ++i)
+                        if ((pair.GetVariationMask() & Bit(i)) && !m_pairRejection.Reject(pair,m_variations[i].pair))
+                            mask |= Bit(i);
+
+                    return mask;
+                }
+                /**
+                 * @brief Get the group to which the pair belongs for the given variation: the group assigned by the mixer, or the rejected group if this variation rejects the pair
+                 *
+                 * @param group group assigned by the mixer
+                 * @param pair
+                 * @param variation index of the variation
+                 * @return GroupId
+                 */
+                [[nodiscard]] static GroupId GetPairGroup(GroupId group, const Selection::PairCandidate &pair, std::size_t variation) noexcept
+                {
+                    return (pair.GetPairCutMask() & Bit(variation)) ? group : rejectedGroup;
+                }
+                /**
+                 * @brief Call the function for every variation present in the mask
+                 *
+                 * @param mask
+                 * @param func callable with the signature void(std::size_t variation)
+                 */
+                template <typename Func>
+                void ForEachVariation(Selection::VariationMask mask, Func &&func) const
+                {
+                    for (std::size_t i = 0; i < m_variations.size(); ++i)
+                        if (mask & Bit(i))
+                            func(i);
+                }
+                /**
+                 * @brief Creates a pair cutting function for the mixer. It stores the mask of the accepting variations in the pair (PairCandidate::SetPairCutMask) and rejects the pair only if no variation accepts it. The table must outlive the function
+                 *
+                 * @return std::function
+                 */
+                [[nodiscard]] std::function<bool (const std::shared_ptr<Selection::PairCandidate> &)> MakePairCuttingFunction() const
+                {
+                    return [this](const std::shared_ptr<Selection::PairCandidate> &pair)
+                    {
+                        pair->SetPairCutMask(this->SelectPair(*pair));
+                        return pair->GetPairCutMask() == 0;
+                    };
+                }
+                /**
+                 * @brief Print all variations
+                 *
+                 */
+                void PrintSettings() const
+                {
+                    std::cout << "---=== VariationTable settings ===---\n";
+                    for (const auto &variation : m_variations)
+                    {
+                        std::cout << variation.name << ":\tcent {";
+                        for (const auto &cent : variation.event.centIndex)
+                            std::cout << " " << cent;
+                        std::cout << " }, nSigma (" << variation.event.nSigmaX << "," << variation.event.nSigmaY << "," << variation.event.nSigmaZ << ")";
+                        std::cout << ", bad layers <= " << variation.track.maxBadLayers << ", layers in plane >= " << variation.track.minLayersInPlane;
+                        std::cout << ", close hits (" << variation.pair.closeHitsFraction << "," << variation.pair.closeHitsCutoff << ")";
+                        std::cout << ", both layers >= " << variation.pair.minBothLayers << ", shared META cells <= " << variation.pair.maxSharedMetaCells << "\n";
+                    }
+                    std::cout << "\n";
+                }
+                /**
+                 * @brief Creates the table of the 1D systematic variations (same as in systematics/1D), the nominal selection is the first variation
+                 *
+                 * @param nominal nominal track cuts (with the 2 sigma beta vs momentum cuts)
+                 * @param rpcCut1Sigma 1 sigma beta vs momentum cut for the RPC tracks (betaPdown)
+                 * @param tofCut1Sigma 1 sigma beta vs momentum cut for the ToF tracks (betaPdown)
+                 * @param rpcCut3Sigma 3 sigma beta vs momentum cut for the RPC tracks (betaPup)
+                 * @param tofCut3Sigma 3 sigma beta vs momentum cut for the ToF tracks (betaPup)
+                 * @return VariationTable
+                 */
+                [[nodiscard]] static VariationTable CreateSystematics1D(const Selection::TrackCuts &nominal, const TCutG *rpcCut1Sigma, const TCutG *tofCut1Sigma, const TCutG *rpcCut3Sigma, const TCutG *tofCut3Sigma)
+                {
+                    VariationTable table;
+                    const Variation base{"nominal",{},nominal,{}};
+                    table.Add(base);
+
+                    auto addVariation = [&table,&base](const std::string &name, auto &&modify)
+                    {
+                        Variation variation = base;
+                        variation.name = name;
+                        modify(variation);
+                        table.Add(variation);
+                    };
+
+                    addVariation("BLdown",[](Variation &v){v.pair.minBothLayers = 19;});
+                    addVariation("BLup",[](Variation &v){v.pair.minBothLayers = 21;});
+                    addVariation("FCHdown",[](Variation &v){v.pair.closeHitsFraction = 0.5;});
+                    addVariation("FCHup",[](Variation &v){v.pair.closeHitsFraction = 1;});
+                    addVariation("SMCup",[](Variation &v){v.pair.maxSharedMetaCells = 1;});
+                    addVariation("badLayersup",[](Variation &v){v.track.maxBadLayers = 2;});
+                    addVariation("betaPdown",[&](Variation &v){v.track.rpcCut = rpcCut1Sigma; v.track.tofCut = tofCut1Sigma;});
+                    addVariation("betaPup",[&](Variation &v){v.track.rpcCut = rpcCut3Sigma; v.track.tofCut = tofCut3Sigma;});
+                    addVariation("vertXdown",[](Variation &v){v.event.nSigmaX = 1;});
+                    addVariation("vertXup",[](Variation &v){v.event.nSigmaX = 3;});
+                    addVariation("vertYdown",[](Variation &v){v.event.nSigmaY = 1;});
+                    addVariation("vertYup",[](Variation &v){v.event.nSigmaY = 3;});
+                    addVariation("vertZdown",[](Variation &v){v.event.nSigmaZ = 1;});
+                    // vertZup is not included, nSigmaZ > 2 overlaps between neighbouring plates (see EventCandidate::SelectEvent); SMCdown and badLayersdown are identical to the nominal selection
+                    addVariation("wiresPMdown",[](Variation &v){v.track.minLayersInPlane = 3;});
+                    addVariation("wiresPMup",[](Variation &v){v.track.minLayersInPlane = 6;});
+
+                    return table;
+                }
+        };
+    } // namespace Mixing
+
+#endif
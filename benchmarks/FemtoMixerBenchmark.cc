@@ -0,0 +1,339 @@
+// Micro-benchmarks of the FemtoMixer headers on synthetic events (benchmarks/SyntheticEvents.hxx), no HYDRA and no DSTs needed.
+// The HYDRA classes are replaced by the stand-ins from benchmarks/hydra, so the same code paths as in newFemtoAnalysis.cc are measured.
+// Build and run with "make run" in this directory, the results are written as JSON into benchmarks/results.
+// The heap allocations are counted (see FemtoMixer/StageProfiler.hxx), so the allocation-free pair path can be checked by BM_PairBuildAllocations.
+#define FEMTOMIXER_COUNT_ALLOCATIONS
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "SyntheticEvents.hxx"
+
+#include "FemtoMixer/EventUtils.hxx"
+#include "FemtoMixer/JJFemtoMixer.hxx"
+#include "FemtoMixer/MdcWires.hxx"
+#include "FemtoMixer/PairCandidate.hxx"
+#include "FemtoMixer/PairKinematics.hxx"
+#include "FemtoMixer/PairUtils.hxx"
+#include "FemtoMixer/StageProfiler.hxx"
+
+namespace
+{
+    using Mixer = Mixing::JJFemtoMixer<Selection::EventCandidate,Selection::TrackHandle,Selection::PairCandidate,Mixing::PairBinning1D,Mixing::NominalPairCuts>;
+
+    // the same events are reused by all benchmarks (generated once, with a fixed seed)
+    const std::vector<std::shared_ptr<Selection::EventCandidate> >& GetEvents()
+    {
+        static const auto events = Synthetic::EventGenerator().GenerateEvents(1000);
+        return events;
+    }
+
+    const std::vector<Synthetic::GeneratedTrack>& GetGeneratedTracks()
+    {
+        static const auto tracks = []
+        {
+            Synthetic::EventGenerator generator;
+            std::vector<Synthetic::GeneratedTrack> output(1024);
+            for (auto &track : output)
+                track = generator.GenerateTrack();
+            return output;
+        }();
+        return tracks;
+    }
+
+    // all same-event track pairs of the events
+    const std::vector<std::pair<Selection::TrackHandle,Selection::TrackHandle> >& GetTrackPairs()
+    {
+        static const auto pairs = []
+        {
+            std::vector<std::pair<Selection::TrackHandle,Selection::TrackHandle> > output;
+            for (const auto &event : GetEvents())
+            {
+                const auto &tracks = event->GetTrackList();
+                for (std::size_t i = 0; i < tracks.size(); ++i)
+                    for (std::size_t j = i + 1; j < tracks.size(); ++j)
+                        output.emplace_back(tracks[i],tracks[j]);
+            }
+            return output;
+        }();
+        return pairs;
+    }
+} // namespace
+
+//--------------------------------------------------------------------------------
+// Track level
+//--------------------------------------------------------------------------------
+static void BM_CreateTrackLayers(benchmark::State &state)
+{
+    const auto &tracks = GetGeneratedTracks();
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(HADES::MDC::CreateTrackLayers(tracks[i++ % tracks.size()].wires));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CreateTrackLayers);
+
+static void BM_CreatePackedTrackLayers(benchmark::State &state)
+{
+    const auto &tracks = GetGeneratedTracks();
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(HADES::MDC::CreatePackedTrackLayers(tracks[i++ % tracks.size()].wires));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CreatePackedTrackLayers);
+
+static void BM_TrackCandidate(benchmark::State &state)
+{
+    auto tracks = GetGeneratedTracks();
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        auto &track = tracks[i % tracks.size()];
+        benchmark::DoNotOptimize(Selection::TrackCandidate(&track.candidate,HADES::MDC::CreateTrackLayers(track.wires),Selection::EventIdentifier(1,1000),0.f,i,14));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TrackCandidate);
+
+//--------------------------------------------------------------------------------
+// Pair level
+//--------------------------------------------------------------------------------
+static void BM_Kinematics(benchmark::State &state)
+{
+    const auto &pairs = GetTrackPairs();
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        const auto &[track1,track2] = pairs[i++ % pairs.size()];
+        benchmark::DoNotOptimize(Selection::Kinematics::Calculate(track1.GetPx(),track1.GetPy(),track1.GetPz(),track1.GetEnergy(),track2.GetPx(),track2.GetPy(),track2.GetPz(),track2.GetEnergy()));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Kinematics);
+
+// one track against all tracks of an event, as done by the mixer
+static void BM_KinematicsBlock(benchmark::State &state)
+{
+    const auto &events = GetEvents();
+    Selection::Kinematics::KinematicsBlock block;
+    std::size_t i = 0, nPairs = 0;
+    for (auto _ : state)
+    {
+        const auto &track1 = events[i % events.size()]->GetTrackList().front();
+        const auto &store = events[(i + 1) % events.size()]->GetTrackStore();
+        const Selection::Kinematics::TrackBlock partners{store.GetPxColumn(),store.GetPyColumn(),store.GetPzColumn(),store.GetEnergyColumn(),std::min(store.size(),Selection::Kinematics::blockSize)};
+        Selection::Kinematics::CalculateBlock(track1.GetPx(),track1.GetPy(),track1.GetPz(),track1.GetEnergy(),partners,block);
+        benchmark::ClobberMemory();
+        nPairs += partners.size;
+        ++i;
+    }
+    state.SetItemsProcessed(nPairs);
+}
+BENCHMARK(BM_KinematicsBlock);
+
+// includes the CFKinematics of the pair
+static void BM_PairCandidate(benchmark::State &state)
+{
+    const auto &pairs = GetTrackPairs();
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        const auto &[track1,track2] = pairs[i++ % pairs.size()];
+        benchmark::DoNotOptimize(Selection::PairCandidate(track1,track2));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PairCandidate);
+
+static void BM_CalculateWireDistances(benchmark::State &state)
+{
+    const auto &pairs = GetTrackPairs();
+    std::vector<HADES::MDC::LayersPair> layers;
+    for (std::size_t i = 0; i < std::min<std::size_t>(pairs.size(),4096); ++i)
+        layers.push_back(HADES::MDC::CreatePairLayers(pairs[i].first.GetAllWires(),pairs[i].second.GetAllWires()));
+
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(HADES::MDC::CalculateWireDistances(layers[i++ % layers.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CalculateWireDistances);
+
+static void BM_CalculateWireDistancesPacked(benchmark::State &state)
+{
+    const auto &pairs = GetTrackPairs();
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        const auto &[track1,track2] = pairs[i++ % pairs.size()];
+        benchmark::DoNotOptimize(HADES::MDC::CalculateWireDistances(track1.GetPackedWires(),track2.GetPackedWires()));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CalculateWireDistancesPacked);
+
+// the detector variables are cached in the pair, so a new pair is created for every call
+static void BM_PairRejection(benchmark::State &state)
+{
+    const auto &pairs = GetTrackPairs();
+    const Mixing::PairRejection rejection;
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        const auto &[track1,track2] = pairs[i++ % pairs.size()];
+        const Selection::PairCandidate pair(track1,track2);
+        benchmark::DoNotOptimize(rejection.Reject(pair,Mixing::PairCuts{}));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PairRejection);
+
+// the same cuts as BM_PairRejection as a compile-time policy, the rejection counters are reported per pair
+static void BM_NominalPairCuts(benchmark::State &state)
+{
+    const auto &pairs = GetTrackPairs();
+    const Mixing::NominalPairCuts pairCuts;
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        const auto &[track1,track2] = pairs[i++ % pairs.size()];
+        const Selection::PairCandidate pair(track1,track2);
+        benchmark::DoNotOptimize(pairCuts.Reject(pair));
+    }
+    state.SetItemsProcessed(state.iterations());
+    for (std::size_t cut = 0; cut < Mixing::NominalPairCuts::nCuts; ++cut)
+        state.counters[Mixing::NominalPairCuts::cutNames[cut]] = benchmark::Counter(pairCuts.GetNRejected(cut),benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_NominalPairCuts);
+
+// a small set of pairs (fits into the L1 cache), so the grouping itself is measured and not the memory access
+static void BM_PairGrouping1D(benchmark::State &state)
+{
+    const auto &pairs = GetTrackPairs();
+    std::vector<std::shared_ptr<Selection::PairCandidate> > candidates;
+    for (std::size_t i = 0; i < std::min<std::size_t>(pairs.size(),256); ++i)
+        candidates.push_back(std::make_shared<Selection::PairCandidate>(pairs[i].first,pairs[i].second));
+
+    const Mixing::PairGrouping grouping;
+    const auto hashing = grouping.MakePairGroupingFunction1D();
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(hashing(candidates[i++ % candidates.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PairGrouping1D);
+
+// the same grouping without the std::function, as used by the mixer
+static void BM_PairBinning1D(benchmark::State &state)
+{
+    const auto &pairs = GetTrackPairs();
+    std::vector<Selection::PairCandidate> candidates;
+    for (std::size_t i = 0; i < std::min<std::size_t>(pairs.size(),256); ++i)
+        candidates.emplace_back(pairs[i].first,pairs[i].second);
+
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(Mixing::PairBinning1D::GetGroup(candidates[i++ % candidates.size()]));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PairBinning1D);
+
+// pair construction, rejection and grouping exactly as done by the mixer for every pair (signal pairs of one event per iteration), it fails if any heap allocation happens on this path
+static void BM_PairBuildAllocations(benchmark::State &state)
+{
+    const auto &events = GetEvents();
+
+    Mixer mixer;
+    mixer.SetPairHashingFunction(Mixing::PairBinning1D());
+    mixer.SetPairCuttingFunction(Mixing::NominalPairCuts());
+    mixer.SetOutOfRangeGroup(Mixing::outOfRangeGroup);
+
+    std::size_t nPairs = 0, nAccepted = 0;
+    auto countPair = [&nPairs,&nAccepted](Mixing::GroupId group, const Selection::PairCandidate &)
+    {
+        ++nPairs;
+        nAccepted += (group != Mixing::rejectedGroup);
+    };
+
+    std::size_t i = 0;
+    const std::uint64_t allocationStart = JJUtils::Detail::allocationCount;
+    for (auto _ : state)
+    {
+        mixer.ForEachSignalPair(events[i++ % events.size()],countPair);
+    }
+    const std::uint64_t allocations = JJUtils::Detail::allocationCount - allocationStart;
+
+    state.SetItemsProcessed(nPairs);
+    state.counters["allocationsPerPair"] = (nPairs > 0) ? static_cast<double>(allocations) / nPairs : 0.;
+    state.counters["acceptedFraction"] = (nPairs > 0) ? static_cast<double>(nAccepted) / nPairs : 0.;
+    if (allocations > 0)
+        state.SkipWithError("heap allocation on the pair-build path");
+}
+BENCHMARK(BM_PairBuildAllocations);
+
+//--------------------------------------------------------------------------------
+// Full mixing loop (signal and background pairs of one event, with the nominal grouping and cuts), the argument is the buffer depth
+//--------------------------------------------------------------------------------
+static void BM_Mixing(benchmark::State &state)
+{
+    const auto &events = GetEvents();
+    const Mixing::EventGrouping eventGrouping;
+
+    Mixer mixer;
+    mixer.SetMaxBufferSize(state.range(0));
+    mixer.SetEventHashingFunction(eventGrouping.MakeEventGroupingFunction());
+    mixer.SetPairHashingFunction(Mixing::PairBinning1D());
+    mixer.SetPairCuttingFunction(Mixing::NominalPairCuts());
+    mixer.SetOutOfRangeGroup(Mixing::outOfRangeGroup);
+
+    double nPairs = 0;
+    auto countPair = [&nPairs](Mixing::GroupId group, const Selection::PairCandidate &)
+    {
+        nPairs += (group != Mixing::rejectedGroup);
+    };
+
+    // filling the buffers of all event classes first (the events are reused if needed), so every measured event is mixed with a full buffer
+    std::set<Mixing::GroupId> eventClasses;
+    for (const auto &event : events)
+        eventClasses.insert(eventGrouping.MakeEventGroupingFunction()(event));
+
+    std::size_t i = 0;
+    for (; i < static_cast<std::size_t>(state.range(0)) * eventClasses.size(); ++i)
+        mixer.BufferEvent(events[i % events.size()]);
+
+    nPairs = 0;
+    std::size_t nEvents = 0;
+    const std::uint64_t allocationStart = JJUtils::Detail::allocationCount;
+    for (auto _ : state)
+    {
+        const auto &event = events[i++ % events.size()];
+        mixer.ForEachSignalPair(event,countPair);
+        mixer.BufferEvent(event);
+        mixer.ForEachMixedPair(event,countPair);
+        ++nEvents;
+    }
+    state.SetItemsProcessed(nEvents);
+    state.counters["pairs"] = benchmark::Counter(nPairs,benchmark::Counter::kIsRate);
+    state.counters["eventClasses"] = eventClasses.size();
+    state.counters["allocationsPerEvent"] = static_cast<double>(JJUtils::Detail::allocationCount - allocationStart) / std::max<std::size_t>(nEvents,1);
+}
+BENCHMARK(BM_Mixing)->Arg(10)->Arg(50)->Arg(200)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,211 @@
+/**
+ * @file SyntheticEvents.hxx
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Generator of synthetic Au+Au 1.23A GeV proton events for the FemtoMixer benchmarks: thermal momentum spectra in the HADES acceptance, wire patterns following the track direction and META hits, all filled into the HYDRA stand-ins
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef SyntheticEvents_hxx
+    #define SyntheticEvents_hxx
+
+    #include <algorithm>
+    #include <cmath>
+    #include <cstdint>
+    #include <memory>
+    #include <random>
+    #include <vector>
+
+    #include "hparticlecand.h"
+    #include "hparticlemetamatcher.h"
+    #include "heventheader.h"
+    #include "hparticleevtinfo.h"
+
+    #include "FemtoMixer/EventCandidate.hxx"
+    #include "FemtoMixer/Target.hxx"
+    #include "FemtoMixer/TrackCandidate.hxx"
+
+    namespace Synthetic
+    {
+        /**
+         * @brief Parameters of the generated events. The default values roughly correspond to the selected protons in 0-10% central Au+Au collisions from Apr12
+         *
+         */
+        struct GeneratorSettings
+        {
+            double meanMultiplicity = 25; // mean number of protons per event (Poisson)
+            double meanNCharged = 180, sigmaNCharged = 25; // TOF+RPC multiplicity used for the event grouping
+            double temperature = 80; // [MeV] inverse slope of the m_T spectrum
+            double midRapidity = 0.74, sigmaRapidity = 0.4;
+            double thetaMin = 18, thetaMax = 85; // [deg] HADES acceptance
+            double secondWireProbability = 0.3; // probability that a neighbouring wire fired in the layer as well
+            double missingLayerProbability = 0.05; // probability that a layer has no fired wire
+            std::uint64_t seed = 0;
+        };
+
+        /**
+         * @brief One generated track in the form returned by HYDRA
+         *
+         */
+        struct GeneratedTrack
+        {
+            HParticleCand candidate;
+            HParticleWireInfo wires;
+        };
+
+        class EventGenerator
+        {
+            private:
+                static constexpr double protonMass = 938.272; // [MeV]
+                static constexpr std::array<int,HADES::MDC::WireInfo::numberOfPlanes> wiresPerPlane{190,200,250,300}; // approximate number of wires in a layer of each MDC plane
+                static constexpr std::array<double,HADES::MDC::WireInfo::numberOfLayersInPlane> stereoAngles{40,-20,0,0,20,-40}; // [deg] wire orientation of each layer
+
+                GeneratorSettings m_settings;
+                std::mt19937_64 m_generator;
+                std::uint32_t m_eventNumber;
+
+                [[nodiscard]] double Uniform(double min, double max) {return std::uniform_real_distribution<double>(min,max)(m_generator);}
+                [[nodiscard]] double Gauss(double mean, double sigma) {return std::normal_distribution<double>(mean,sigma)(m_generator);}
+                [[nodiscard]] bool Chance(double probability) {return Uniform(0.,1.) < probability;}
+
+                /**
+                 * @brief Draw the transverse kinetic energy from the m_T exp(-m_T/T) spectrum (a mixture of an exponential and a gamma distribution, so no rejection is needed)
+                 *
+                 * @return m_T - m [MeV]
+                 */
+                [[nodiscard]] double DrawKineticEnergy()
+                {
+                    const double temperature = m_settings.temperature;
+                    if (Chance(protonMass / (protonMass + temperature)))
+                        return std::exponential_distribution<double>(1. / temperature)(m_generator);
+                    return std::gamma_distribution<double>(2.,temperature)(m_generator);
+                }
+
+            public:
+                explicit EventGenerator(const GeneratorSettings &settings = {}) : m_settings(settings), m_generator(settings.seed), m_eventNumber(0) {}
+                /**
+                 * @brief Generate one proton inside the acceptance, together with its wires and META hits
+                 *
+                 * @return GeneratedTrack
+                 */
+                [[nodiscard]] GeneratedTrack GenerateTrack()
+                {
+                    GeneratedTrack track;
+                    HParticleCand &cand = track.candidate;
+
+                    double theta = 0, phi = 0;
+                    do
+                    {
+                        const double mt = protonMass + DrawKineticEnergy();
+                        const double rapidity = Gauss(m_settings.midRapidity,m_settings.sigmaRapidity);
+                        const double pt = std::sqrt(mt * mt - protonMass * protonMass);
+                        phi = Uniform(0.,360.);
+                        cand.SetXYZM(pt * std::cos(phi * TMath::DegToRad()),pt * std::sin(phi * TMath::DegToRad()),mt * std::sinh(rapidity),protonMass);
+                        theta = cand.Theta() * TMath::RadToDeg();
+                    }
+                    while (theta < m_settings.thetaMin || theta > m_settings.thetaMax);
+
+                    cand.phi = phi;
+                    cand.theta = theta;
+                    cand.beta = cand.P() / cand.E();
+                    cand.mass = Gauss(protonMass,30.);
+                    cand.mass2 = cand.mass * cand.mass;
+                    cand.sector = static_cast<Short_t>(std::fmod(phi + 300.,360.) / 60.); // sector 0 is centred at 90 deg
+                    cand.system = (theta < 45) ? 0 : 1;
+                    cand.innerSegmentChi2 = std::exponential_distribution<double>(0.2)(m_generator);
+                    cand.outerSegmentChi2 = std::exponential_distribution<double>(0.2)(m_generator);
+                    cand.metaMatchQuality = std::abs(Gauss(0.,1.));
+                    cand.chi2 = std::exponential_distribution<double>(0.1)(m_generator);
+                    cand.atMdcEdge = Chance(0.02);
+
+                    // position within the sector, used for the META cells and the stereo wires
+                    const double phiInSector = std::fmod(phi + 330.,60.) / 60.; // [0,1)
+                    const double thetaFraction = (theta - m_settings.thetaMin) / (m_settings.thetaMax - m_settings.thetaMin); // [0,1]
+                    if (cand.system == 0)
+                    {
+                        cand.metaModule[0] = std::min(static_cast<int>(phiInSector * 6),5);
+                        cand.metaCell[0] = std::min(static_cast<int>((theta - m_settings.thetaMin) / (45. - m_settings.thetaMin) * 31),30);
+                    }
+                    else
+                    {
+                        cand.metaModule[0] = std::min(static_cast<int>((theta - 45.) / (m_settings.thetaMax - 45.) * 8),7);
+                        cand.metaCell[0] = std::min(static_cast<int>(phiInSector * 8),7);
+                    }
+                    if (Chance(0.1)) // hit shared with the neighbouring cell
+                    {
+                        cand.metaModule[1] = cand.metaModule[0];
+                        cand.metaCell[1] = std::max(cand.metaCell[0] - 1,0);
+                    }
+
+                    for (std::size_t plane = 0; plane < HADES::MDC::WireInfo::numberOfPlanes; ++plane)
+                        for (std::size_t layer = 0; layer < HADES::MDC::WireInfo::numberOfLayersInPlane; ++layer)
+                        {
+                            Int_t *wires = track.wires.ar[plane][layer];
+                            wires[0] = wires[1] = HADES::MDC::WireInfo::noWire;
+                            if (Chance(m_settings.missingLayerProbability))
+                                continue;
+
+                            const double stereo = std::sin(stereoAngles[layer] * TMath::DegToRad()) * (phiInSector - 0.5);
+                            const int wire = static_cast<int>(std::lround((0.1 + 0.8 * thetaFraction + 0.1 * stereo) * wiresPerPlane[plane] + Gauss(0.,0.3)));
+                            wires[0] = std::clamp(wire,0,wiresPerPlane[plane] - 1);
+                            if (Chance(m_settings.secondWireProbability))
+                                wires[1] = std::min(wires[0] + 1,wiresPerPlane[plane] - 1);
+                        }
+
+                    return track;
+                }
+                /**
+                 * @brief Generate an event and its tracks, and build the EventCandidate with the HYDRA constructors (the event is selected, so the target plate is set)
+                 *
+                 * @return std::shared_ptr<Selection::EventCandidate>
+                 */
+                [[nodiscard]] std::shared_ptr<Selection::EventCandidate> GenerateEvent()
+                {
+                    constexpr auto plates = HADES::Target::GetZPlatePositions<HADES::Target::Setup::Apr12>();
+
+                    HEventHeader header;
+                    header.runNumber = 1;
+                    header.seqNumber = static_cast<Int_t>(++m_eventNumber);
+                    header.vertex.pos.x = HADES::Target::GetXTargetPosition<HADES::Target::Setup::Apr12>().first;
+                    header.vertex.pos.y = HADES::Target::GetYTargetPosition<HADES::Target::Setup::Apr12>().first;
+                    const auto &plate = plates[std::uniform_int_distribution<std::size_t>(0,plates.size() - 1)(m_generator)];
+                    header.vertex.pos.z = plate.first + Gauss(0.,plate.second / 2);
+
+                    HParticleEvtInfo info;
+                    const int nCharged = std::max(0,static_cast<int>(Gauss(m_settings.meanNCharged,m_settings.sigmaNCharged)));
+                    info.rpcMult = nCharged * 2 / 3;
+                    info.tofMult = nCharged - info.rpcMult;
+
+                    auto event = std::make_shared<Selection::EventCandidate>(&header,&info,1,Uniform(0.,2 * TMath::Pi()));
+                    event->SelectEvent<HADES::Target::Setup::Apr12>({1},3,3,2);
+
+                    const int nTracks = std::poisson_distribution<int>(m_settings.meanMultiplicity)(m_generator);
+                    for (int i = 0; i < nTracks; ++i)
+                    {
+                        GeneratedTrack track = GenerateTrack();
+                        event->AddTrack(Selection::TrackCandidate(&track.candidate,HADES::MDC::CreateTrackLayers(track.wires),event->GetID(),event->GetReactionPlane(),i,14));
+                    }
+
+                    return event;
+                }
+                /**
+                 * @brief Generate a list of events
+                 *
+                 * @param nEvents
+                 * @return std::vector<std::shared_ptr<Selection::EventCandidate> >
+                 */
+                [[nodiscard]] std::vector<std::shared_ptr<Selection::EventCandidate> > GenerateEvents(std::size_t nEvents)
+                {
+                    std::vector<std::shared_ptr<Selection::EventCandidate> > events;
+                    events.reserve(nEvents);
+                    for (std::size_t i = 0; i < nEvents; ++i)
+                        events.push_back(GenerateEvent());
+
+                    return events;
+                }
+        };
+    } // namespace Synthetic
+
+#endif
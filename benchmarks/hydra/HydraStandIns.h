@@ -0,0 +1,154 @@
+/**
+ * @file HydraStandIns.h
+ * @author Jędrzej Kołaś (jedrzej.kolas.dokt@pw.edu.pl)
+ * @brief Minimal stand-ins of the HYDRA classes used by the FemtoMixer headers, so the HYDRA code paths (CreateTrackLayers, the HParticleCand constructor of TrackCandidate, ...) can be benchmarked without a HYDRA installation. Only the members used by FemtoMixer are provided, the values are set directly by the synthetic event generator.
+ * @version 0.1.0
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2026
+ *
+ */
+#ifndef HydraStandIns_h
+    #define HydraStandIns_h
+
+    #include <cmath>
+    #include <vector>
+
+    #include "Rtypes.h"
+    #include "TLorentzVector.h"
+
+    namespace HPhysicsConstants
+    {
+        inline Double_t mass(Int_t /*pid*/) {return 938.272;} // only protons are generated
+        inline Int_t charge(Int_t /*pid*/) {return 1;}
+    }
+
+    /**
+     * @brief Stand-in of HParticleCand, the angles are in degrees (as in HYDRA)
+     *
+     */
+    class HParticleCand : public TLorentzVector
+    {
+        public:
+            Float_t phi = 0, theta = 0, beta = 0, mass = 0, mass2 = 0;
+            Float_t innerSegmentChi2 = 0, outerSegmentChi2 = 0, metaMatchQuality = 0, chi2 = 0;
+            Short_t charge = 1, sector = 0;
+            Int_t system = 0; // 0 RPC, 1 ToF
+            Int_t metaModule[2] = {-1,-1}, metaCell[2] = {-1,-1};
+            Bool_t atMdcEdge = kFALSE;
+
+            void calc4vectorProperties(Double_t m) {SetXYZM(Px(),Py(),Pz(),m);}
+            Float_t getPhi() const {return phi;}
+            Float_t getTheta() const {return theta;}
+            Float_t getBeta() const {return beta;}
+            Short_t getCharge() const {return charge;}
+            Short_t getSector() const {return sector;}
+            Bool_t isAtAnyMdcEdge() const {return atMdcEdge;}
+            Float_t getMass() const {return mass;}
+            Float_t getMass2() const {return mass2;}
+            Int_t getSystem() const {return system;}
+            Float_t getInnerSegmentChi2() const {return innerSegmentChi2;}
+            Float_t getOuterSegmentChi2() const {return outerSegmentChi2;}
+            Float_t getMetaMatchQuality() const {return metaMatchQuality;}
+            Float_t getChi2() const {return chi2;}
+            Int_t getMetaModule(Int_t hit) const {return metaModule[hit];}
+            Int_t getMetaCell(Int_t hit) const {return metaCell[hit];}
+    };
+
+    class HParticleCandSim : public HParticleCand
+    {
+        public:
+            Int_t getGeantPID() const {return 14;}
+    };
+
+    class HGeantRpc
+    {
+        public:
+            Int_t column = -1, cell = -1;
+            Int_t getColumn() const {return column;}
+            Int_t getCell() const {return cell;}
+    };
+
+    class HGeantTof
+    {
+        public:
+            Int_t module = -1, cell = -1;
+            Int_t getModule() const {return module;}
+            Int_t getCell() const {return cell;}
+    };
+
+    class HGeantKine
+    {
+        public:
+            Float_t px = 0, py = 0, pz = 0;
+            Int_t sector = 0, system = 0;
+
+            Float_t getTotalMomentum() const {return std::sqrt(px * px + py * py + pz * pz);}
+            Float_t getTransverseMomentum() const {return std::sqrt(px * px + py * py);}
+            Float_t getM() const {return HPhysicsConstants::mass(14);}
+            Float_t getE() const {return std::sqrt(getTotalMomentum() * getTotalMomentum() + getM() * getM());}
+            Float_t getPhiDeg() const {return std::atan2(py,px) * 180. / M_PI + ((py < 0) ? 360. : 0.);}
+            Float_t getThetaDeg() const {return std::atan2(getTransverseMomentum(),pz) * 180. / M_PI;}
+            Float_t getRapidity() const {return 0.5 * std::log((getE() + pz) / (getE() - pz));}
+            void getMomentum(Float_t &x, Float_t &y, Float_t &z) const {x = px; y = py; z = pz;}
+            Int_t getID() const {return 14;}
+            Int_t getSector() const {return sector;}
+            Int_t getSystem() const {return system;}
+            Bool_t isAtAnyMdcEdge() const {return kFALSE;}
+            Bool_t getRpcHits(std::vector<HGeantRpc*> &) {return kFALSE;}
+            Bool_t getTofHits(std::vector<HGeantTof*> &) {return kFALSE;}
+    };
+
+    /**
+     * @brief Stand-in of HParticleWireInfo: up to two fired wires per module and layer, -1 marks no wire
+     *
+     */
+    struct HParticleWireInfo
+    {
+        Int_t ar[4][6][2];
+    };
+
+    class HParticleMetaMatcher {};
+
+    namespace HParticleTool
+    {
+        inline Bool_t isGoodMetaCell(HParticleCand *, Double_t, Bool_t) {return kTRUE;}
+    }
+
+    class HGeomVector
+    {
+        public:
+            Double_t x = 0, y = 0, z = 0;
+            Double_t X() const {return x;}
+            Double_t Y() const {return y;}
+            Double_t Z() const {return z;}
+    };
+
+    class HVertex
+    {
+        public:
+            HGeomVector pos;
+            const HGeomVector& getPos() const {return pos;}
+    };
+
+    class HEventHeader
+    {
+        public:
+            Int_t runNumber = 0, seqNumber = 0;
+            HVertex vertex;
+            Int_t getEventRunNumber() const {return runNumber;}
+            Int_t getEventSeqNumber() const {return seqNumber;}
+            HVertex& getVertexReco() {return vertex;}
+    };
+
+    class HParticleEvtInfo
+    {
+        public:
+            Int_t rpcMult = 0, tofMult = 0;
+            Int_t getSumRpcMultHitCut() const {return rpcMult;}
+            Int_t getSumTofMultCut() const {return tofMult;}
+    };
+
+    class HParticleEvtChara {};
+
+#endif
@@ -0,0 +1,2 @@
+// stand-in of the HYDRA header, see HydraStandIns.h
+#include "HydraStandIns.h"
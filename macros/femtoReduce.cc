@@ -0,0 +1,22 @@
+#include "TString.h"
+
+#include "../FemtoMixer/FemtoReducer.hxx"
+
+// merges the outputs of the farm jobs (instead of hadd), run it again when more jobs have finished: only the new files are added to the output
+// inputs - wildcard (e.g. /lustre/hades/user/kjedrzej/apr12/apr12ana_all_*.root) or a list of files (*.list or *.txt)
+int femtoReduce(TString inputs = "/lustre/hades/user/kjedrzej/apr12/apr12ana_all_*.root", TString outfile = "/lustre/hades/user/kjedrzej/apr12/apr12ana_all.root", Int_t nThreads = 8)
+{
+    Mixing::ReduceSettings settings;
+    settings.nThreads = nThreads;
+
+    Mixing::FemtoReducer reducer(outfile.Data(),settings);
+    const std::size_t nInputs = reducer.AddInputs(inputs.Data());
+    std::cout << "files found: " << nInputs << "\t already merged: " << reducer.GetMergedInputs().size() << "\n\n";
+
+    const bool isConsistent = reducer.Reduce();
+    reducer.Print();
+    if (!isConsistent)
+        std::cerr << "femtoReduce: some files have pair counts which do not agree with hCounter, check the jobs listed above" << std::endl;
+
+    return isConsistent ? 0 : 1;
+}
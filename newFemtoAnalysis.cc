@@ -1,7 +1,15 @@
 #include "Includes.h"
-#include "../JJFemtoMixer/JJFemtoMixer.hxx"
+#include "FemtoMixer/JJFemtoMixer.hxx"
 #include "FemtoMixer/PairUtils.hxx"
 #include "FemtoMixer/EventUtils.hxx"
+#include "FemtoMixer/CFHistogramBank.hxx"
+#include "FemtoMixer/PairTuple.hxx"
+#include "FemtoMixer/BackgroundSampler.hxx"
+#include "FemtoMixer/ShardedEventProcessor.hxx"
+#include "FemtoMixer/Checkpoint.hxx"
+#include "FemtoMixer/DstReader.hxx"
+#include "FemtoMixer/StageProfiler.hxx" // define FEMTOMIXER_PROFILING before this include to get the per-stage timing
+#include <chrono>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -15,16 +23,52 @@ bool isSim(T *t) {return false;}
 template <>
 bool isSim(HParticleCandSim *t) {return true;}
 
-struct HistogramCollection
+// mixing and histogramming of one worker thread; each worker owns the mixing buffers of its event classes
+struct FemtoWorker
 {
-	TH1D hQinvSign,hQinvBckg;
-	TH3D hQoslSign,hQoslBckg;
+	Mixing::JJFemtoMixer<Selection::EventCandidate,Selection::TrackHandle,Selection::PairCandidate,Mixing::PairBinning1D,Mixing::NominalPairCuts> mixer;
+	Mixing::CFHistogramBank histogramBank;
+	Mixing::BackgroundSampler sampler;
+	JJUtils::StageProfiler profiler; // mixing and histogram filling of this worker
+	double nAllPairs = 0, nSelectedPairs = 0;
+	std::unique_ptr<Mixing::PairTupleWriter> pairTuple; // accepted low-q pairs for the offline rebinning, null if this output is disabled
+
+	void operator()(const std::shared_ptr<Selection::EventCandidate> &evt)
+	{
+		JJ_PROFILE_STAGE(profiler,JJUtils::Stage::Mixing);
+		const Mixing::GroupId eventClass = (pairTuple != nullptr) ? mixer.GetEventGroup(evt) : 0;
+
+		// pairs are histogrammed as soon as they are formed, without collecting them
+		mixer.ForEachSignalPair(evt,[this,eventClass](Mixing::GroupId group, const Selection::PairCandidate &pair)
+		{
+			nAllPairs += 1;
+			if (group != Mixing::rejectedGroup && group != Mixing::outOfRangeGroup)
+				nSelectedPairs += 1;
+
+			JJ_PROFILE_SAMPLED_STAGE(profiler,JJUtils::Stage::HistogramFill);
+			histogramBank.Fill(Mixing::CFSample::Signal,group,pair);
+			if (pairTuple != nullptr)
+				pairTuple->Fill(Mixing::CFSample::Signal,eventClass,group,pair);
+		});
+
+		mixer.BufferEvent(evt);
+		mixer.ForEachMixedPair(evt,sampler,[this,eventClass](Mixing::GroupId group, const Selection::PairCandidate &pair, double weight)
+		{
+			JJ_PROFILE_SAMPLED_STAGE(profiler,JJUtils::Stage::HistogramFill);
+			histogramBank.Fill(Mixing::CFSample::Background,group,pair,weight);
+			if (pairTuple != nullptr)
+				pairTuple->Fill(Mixing::CFSample::Background,eventClass,group,pair,weight);
+		});
+	}
 };
 
-int newFemtoAnalysis(TString inputlist = "", TString outfile = "femtoOutFile.root", Long64_t nDesEvents = -1, Int_t maxFiles = -1)
+// checkpointMinutes > 0 writes the mixing buffers, the histograms and the next entry to outfile_checkpoint.root every checkpointMinutes (and the buffers once more at the end of the job); a rerun with the same arguments resumes from it
+// warmStartFile fills the mixing buffers from the checkpoint of another job (e.g. the previous file of the run) before the first event
+int newFemtoAnalysis(TString inputlist = "", TString outfile = "femtoOutFile.root", Long64_t nDesEvents = -1, Int_t maxFiles = -1, Int_t nThreads = 1, Bool_t writePairTuple = kFALSE, Int_t checkpointMinutes = 0, TString warmStartFile = "")
 {
 	gStyle->SetOptStat(0);
 	gROOT->SetBatch(kTRUE);
+	ROOT::EnableThreadSafety(); // DST reading stays in this thread, mixing and histogramming is done by nThreads workers
 	
 	constexpr bool isCustomDst{false};
 	constexpr bool isSimulation{false}; // for now this could be easly just const
@@ -113,23 +157,28 @@ int newFemtoAnalysis(TString inputlist = "", TString outfile = "femtoOutFile.roo
     // By default all categories are booked therefore -* (Unbook all) first and book the ones needed
     // All required categories have to be booked except the global Event Header which is always booked
     //--------------------------------------------------------------------------------
-    std::string inputString = "-*,+HParticleCand,+HParticleEvtInfo,+HWallHit";
+    std::vector<std::string> fCategories{"HParticleCand","HParticleEvtInfo"};
+	if (!isSimulation)
+		fCategories.push_back("HWallHit"); // read by HParticleEvtChara for the event plane (in simulation it comes from HGeantHeader)
 	if (isCustomDst)
-		inputString += ",+HMdcSeg";
+		fCategories.push_back("HMdcSeg");
 	if (isSimulation)
-		inputString += ",+HGeantKine";
-    if (!loop->setInput(inputString.data()))
+		fCategories.push_back("HGeantKine");
+    if (!loop->setInput(JJUtils::DstReader::MakeInputString(fCategories).data()))
 		exit(1);
 
 	gHades->setBeamTimeID(HADES::kApr12); // this is needed when using the ParticleEvtChara
 	
     //--------------------------------------------------------------------------------
-    // Setting the cache size of the HLoop internal TChain to read data from the DSTs
+    // Setting up the read path of the HLoop internal TChain: only the booked branches are cached, the next cache block is prefetched in the background
     // Improves performance of the lustre storage by decreasing load on lustre META servers
     //--------------------------------------------------------------------------------
-    loop->getChain()->SetCacheSize(8e6); // 8Mb
-    loop->getChain()->AddBranchToCache("*", kTRUE);
-    loop->getChain()->StopCacheLearningPhase();
+	// background decompression of the cached baskets, remove on single-core slots
+	// both settings are process-wide: implicit MT and parallel unzip apply to every TTree read in this job, and they have to be set before the cache is created
+	ROOT::EnableImplicitMT(2);
+	TTreeCacheUnzip::SetParallelUnzip(TTreeCacheUnzip::kEnable);
+	JJUtils::DstReader fDstReader(loop->getChain()); // also enables TFile.AsyncPrefetching (process-wide, see JJUtils::DstReader)
+	fDstReader.PrintSettings();
 
     loop->printCategories(); // Just for informative purposes
 	
@@ -161,7 +210,20 @@ int newFemtoAnalysis(TString inputlist = "", TString outfile = "femtoOutFile.roo
 
 	TH2D *hPhiTheta = new TH2D("hPhiTheta","#phi vs #theta distribution of tracks;#phi [deg];#theta [deg]",360,0,360,90,0,90);
 
-	std::map<std::string, HistogramCollection> fMapFoHistograms;
+	const Mixing::PairGrouping fPairGrouping;
+	Mixing::CFHistogramSettings fHistogramSettings;
+	fHistogramSettings.fillQinv = false;
+	fHistogramSettings.qoslAxis = {125,0.,500.};
+	fHistogramSettings.qoslStorage = Mixing::GridStorage::Sparse; // only the filled q_osl bins are kept in memory, Dense books ~16 MB per histogram up front in the bank of every worker
+
+	Mixing::BackgroundSamplingSettings fSamplingSettings;
+	fSamplingSettings.mode = Mixing::BackgroundSampling::None; // QDependent or FixedCount subsample the mixed pairs above qFull (and fill them with weights), e.g. for the deep buffer in simulation
+	fSamplingSettings.qFull = 150.f;
+	std::uint64_t fWorkerSeed = fSamplingSettings.seed; // every worker gets its own random sequence
+
+	Mixing::PairTupleSettings fPairTupleSettings; // used only if writePairTuple is set, every worker writes its own file (outfile with the _pairs_<worker> suffix)
+	fPairTupleSettings.qInvMax = 500.f;
+	std::size_t fWorkerIndex = 0;
 
 	TFile *cutfile_betamom_pionCmom = new TFile("/lustre/hades/user/tscheib/apr12/ID_Cuts/BetaMomIDCuts_PionsProtons_gen8_DATA_RK400_PionConstMom.root");
 	TCutG* betamom_2sig_p_tof_pionCmom = cutfile_betamom_pionCmom->Get<TCutG>("BetaCutProton_TOF_2.0");
@@ -169,19 +231,82 @@ int newFemtoAnalysis(TString inputlist = "", TString outfile = "femtoOutFile.roo
 	
 	// create objects for particle selection and mixing
 	std::shared_ptr<Selection::EventCandidate> fEvent;	
-	std::shared_ptr<Selection::TrackCandidate> fTrack;
+	Selection::TrackCandidate fTrack;
 
 	// create object for getting MDC wires
 	HParticleWireInfo fWireInfo;
 	HGeantHeader *geantHeader;
 
-	std::map<std::string,std::vector<std::shared_ptr<Selection::PairCandidate> > > fSignMap, fBckgMap;
+	const Mixing::EventGrouping fEventGrouping;
 
-    Mixing::JJFemtoMixer<Selection::EventCandidate,Selection::TrackCandidate,Selection::PairCandidate> mixer;
-	mixer.SetMaxBufferSize((isSimulation) ? 200 : 50); // ana=50, sim=200
-	mixer.SetEventHashingFunction(Mixing::EventGrouping{}.MakeEventGroupingFunction());
-	mixer.SetPairHashingFunction(Mixing::PairGrouping{}.MakePairGroupingFunction1D());
-	mixer.SetPairCuttingFunction(Mixing::PairRejection{}.MakePairRejectionFunction());
+	//--------------------------------------------------------------------------------
+	// Checking for a checkpoint of an interrupted run of this job
+	//--------------------------------------------------------------------------------
+	const std::string fCheckpointFile = Mixing::CheckpointWriter::MakeFileName(outfile.Data());
+	const std::string fInputName = std::string(inputlist.Data()) + ";maxFiles=" + std::to_string(maxFiles) + ";nEvents=" + std::to_string(nDesEvents);
+	std::unique_ptr<Mixing::CheckpointReader> fCheckpoint;
+	if (checkpointMinutes > 0 && Mixing::CheckpointReader::Exists(fCheckpointFile))
+	{
+		fCheckpoint = std::make_unique<Mixing::CheckpointReader>(fCheckpointFile);
+		if (fCheckpoint->IsFinished())
+		{
+			std::cout << "checkpoint " << fCheckpointFile << " belongs to a finished run, starting from the beginning\n";
+			fCheckpoint.reset();
+		}
+		else if (fCheckpoint->GetInput() != fInputName)
+		{
+			throw std::runtime_error("checkpoint " + fCheckpointFile + " was written for another input (" + fCheckpoint->GetInput() + "), remove it to start from the beginning");
+		}
+		else if (writePairTuple)
+		{
+			std::cout << "resuming from a checkpoint, the pair tuple is not written (it would miss the pairs of the processed entries)\n";
+			writePairTuple = kFALSE;
+		}
+	}
+
+	// events are sharded by their class, so the mixing in each class is the same as in a serial run
+	Mixing::ShardedEventProcessor<std::shared_ptr<Selection::EventCandidate>,FemtoWorker> processor(nThreads,
+		[&]()
+		{
+			FemtoWorker worker{{},Mixing::CFHistogramBank::Create1D(fPairGrouping,fHistogramSettings),Mixing::BackgroundSampler(fSamplingSettings),{}}; // all histograms are booked here
+			worker.sampler.SetSeed(fWorkerSeed++);
+			worker.mixer.SetMaxBufferSize((isSimulation) ? 200 : 50); // ana=50, sim=200
+			worker.mixer.SetEventHashingFunction(fEventGrouping.MakeEventGroupingFunction());
+			worker.mixer.SetPairHashingFunction(Mixing::PairBinning1D());
+			worker.mixer.SetPairCuttingFunction(Mixing::NominalPairCuts());
+			worker.mixer.SetOutOfRangeGroup(Mixing::outOfRangeGroup); // pairs outside of the kT/y ranges are discarded anyway, so do not check them
+			worker.mixer.SetPairPrefilter(Mixing::PairGrouping::MakePairPrefilter1D()); // mixed pairs outside of the kT/y ranges are not even created (the out-of-range background stays empty)
+			if (writePairTuple)
+				worker.pairTuple = std::make_unique<Mixing::PairTupleWriter>(Mixing::PairTupleWriter::MakeFileName(outfile.Data(),fWorkerIndex),fPairTupleSettings);
+			++fWorkerIndex;
+			return worker;
+		},
+		fEventGrouping.MakeEventGroupingFunction());
+	processor.GetWorker(0).mixer.PrintSettings();
+	processor.GetWorker(0).histogramBank.PrintSettings();
+	processor.GetWorker(0).sampler.PrintSettings();
+	std::cout << "number of workers: " << processor.GetNWorkers() << "\n\n";
+
+	//--------------------------------------------------------------------------------
+	// Restoring the mixing buffers (each event class goes to the worker responsible for it)
+	//--------------------------------------------------------------------------------
+	auto restoreMixingBuffers = [&processor](const Mixing::CheckpointReader &checkpoint)
+	{
+		std::size_t nRestored = 0;
+		processor.Synchronize([&]()
+		{
+			nRestored = checkpoint.ForEachBufferedEvent([&processor](Mixing::GroupId eventClass, Selection::EventIdentifier eventId, const std::vector<Selection::TrackHandle> &tracks)
+			{
+				processor.GetWorker(processor.GetWorkerIndex(eventClass)).mixer.BufferEvent(eventClass,eventId,tracks);
+			});
+		});
+		return nRestored;
+	};
+	if (fCheckpoint == nullptr && warmStartFile != "")
+	{
+		const Mixing::CheckpointReader warmStart(warmStartFile.Data());
+		std::cout << "warm start: " << restoreMixingBuffers(warmStart) << " events restored into the mixing buffers from " << warmStartFile << "\n\n";
+	}
 	
     //--------------------------------------------------------------------------------
     // The following counter histogram is used to gather some basic information on the analysis
@@ -205,6 +330,63 @@ int newFemtoAnalysis(TString inputlist = "", TString outfile = "femtoOutFile.roo
 	hCounter->GetXaxis()->SetBinLabel(5, "All Pairs");
 	hCounter->GetXaxis()->SetBinLabel(6, "Selected Pairs");
 
+	Long64_t fFirstEntry = 0;
+	if (fCheckpoint != nullptr)
+	{
+		fFirstEntry = fCheckpoint->GetNextEntry();
+		std::cout << "resuming from " << fCheckpointFile << " at entry " << fFirstEntry << ": " << restoreMixingBuffers(*fCheckpoint) << " events restored into the mixing buffers\n\n";
+		processor.Synchronize([&]()
+		{
+			FemtoWorker &worker = processor.GetWorker(0);
+			fCheckpoint->AddHistogramBanks(worker.histogramBank);
+			if (auto counter = fCheckpoint->GetObject<TH1D>("hCounter"))
+			{
+				// the pair counts belong to the workers, they are added to the counter at the end
+				worker.nAllPairs += counter->GetBinContent(cNumAllPairs + 1);
+				worker.nSelectedPairs += counter->GetBinContent(cNumSelectedPairs + 1);
+				counter->SetBinContent(cNumAllPairs + 1,0);
+				counter->SetBinContent(cNumSelectedPairs + 1,0);
+				hCounter->Add(counter.get());
+			}
+			if (auto phiTheta = fCheckpoint->GetObject<TH2D>("hPhiTheta"))
+				hPhiTheta->Add(phiTheta.get());
+		});
+		fCheckpoint.reset();
+	}
+
+	//--------------------------------------------------------------------------------
+	// Writing the checkpoint while the workers are idle. The final one holds only the mixing buffers, for the warm start of the next job
+	//--------------------------------------------------------------------------------
+	auto writeCheckpoint = [&](Long64_t nextEntry, bool isFinished)
+	{
+		processor.Synchronize([&]()
+		{
+			Mixing::CheckpointWriter writer(fCheckpointFile);
+			for (std::size_t worker = 0; worker < processor.GetNWorkers(); ++worker)
+			{
+				writer.AddMixingBuffer(processor.GetWorker(worker).mixer.GetMixingPool());
+				if (!isFinished)
+					writer.AddHistogramBank(processor.GetWorker(worker).histogramBank);
+			}
+			if (!isFinished)
+			{
+				std::unique_ptr<TH1D> counter(static_cast<TH1D*>(hCounter->Clone()));
+				counter->SetDirectory(nullptr);
+				for (std::size_t worker = 0; worker < processor.GetNWorkers(); ++worker)
+				{
+					counter->Fill(cNumAllPairs,processor.GetWorker(worker).nAllPairs);
+					counter->Fill(cNumSelectedPairs,processor.GetWorker(worker).nSelectedPairs);
+				}
+				writer.AddObject(*counter);
+				writer.AddObject(*hPhiTheta);
+			}
+			writer.Commit(nextEntry,fInputName,isFinished);
+		});
+		std::cout << "checkpoint written to " << fCheckpointFile << " (next entry: " << nextEntry << ")" << std::endl;
+	};
+	const std::chrono::minutes fCheckpointInterval(std::max<Int_t>(checkpointMinutes,0));
+	auto fLastCheckpoint = std::chrono::steady_clock::now();
+
 	//--------------------------------------------------------------------------------
 	// wire information w/o HMdcSeg class access
 	//--------------------------------------------------------------------------------
@@ -272,6 +454,7 @@ int newFemtoAnalysis(TString inputlist = "", TString outfile = "femtoOutFile.roo
     TStopwatch timer;
     timer.Reset();
     timer.Start();
+	JJUtils::StageProfiler fProfiler; // stages done in this thread (the workers have their own profilers)
 
     //--------------------------------------------------------------------------------
     // The amount of events to be processed
@@ -284,9 +467,20 @@ int newFemtoAnalysis(TString inputlist = "", TString outfile = "femtoOutFile.roo
     // The global event loop which loops over all events in the DST files added to HLoop
     // The loop breaks if the end is reached
     //--------------------------------------------------------------------------------
-    for (Long64_t event = 0; event < nEvents; event++) 
+    for (Long64_t event = fFirstEntry; event < nEvents; event++) 
     {
-		if (loop->nextEvent(event) <= 0) 
+		if (checkpointMinutes > 0 && std::chrono::steady_clock::now() - fLastCheckpoint >= fCheckpointInterval)
+		{
+			writeCheckpoint(event,false);
+			fLastCheckpoint = std::chrono::steady_clock::now();
+		}
+
+		Int_t nReadBytes = 0;
+		{
+			JJ_PROFILE_STAGE(fProfiler,JJUtils::Stage::DstRead);
+			nReadBytes = fDstReader.NextEvent(*loop,event);
+		}
+		if (nReadBytes <= 0) 
 		{
 			std::cout << " Last events processed " << endl;
 			break;
@@ -375,10 +569,13 @@ int newFemtoAnalysis(TString inputlist = "", TString outfile = "femtoOutFile.roo
 		//--------------------------------------------------------------------------------
 		// Resetting the track sorter and selecting hadrons ranked by Chi2 Runge Kutta
 		//--------------------------------------------------------------------------------
-		sorter.cleanUp();
-		sorter.resetFlags(kTRUE, kTRUE, kTRUE, kTRUE);
-		sorter.fill(HParticleTrackSorter::selectHadrons);
-		sorter.selectBest(Particle::ESwitch::kIsBestRKSorter, Particle::ESelect::kIsHadronSorter);
+		{
+			JJ_PROFILE_STAGE(fProfiler,JJUtils::Stage::TrackSorter);
+			sorter.cleanUp();
+			sorter.resetFlags(kTRUE, kTRUE, kTRUE, kTRUE);
+			sorter.fill(HParticleTrackSorter::selectHadrons);
+			sorter.selectBest(Particle::ESwitch::kIsBestRKSorter, Particle::ESelect::kIsHadronSorter);
+		}
 	
 		//--------------------------------------------------------------------------------
 		// The loop over all tracks (Particle Candidates in the current event
@@ -391,7 +588,10 @@ int newFemtoAnalysis(TString inputlist = "", TString outfile = "femtoOutFile.roo
 			particle_cand->setMomentum(particle_cand->getCorrectedMomentumPID(protonPID));
 			
 			//fWireManager = matcher->getWireManager();
-			matcher->getWireInfoDirect(particle_cand,fWireInfo);
+			{
+				JJ_PROFILE_STAGE(fProfiler,JJUtils::Stage::WireFetch);
+				matcher->getWireInfoDirect(particle_cand,fWireInfo);
+			}
 
 			//--------------------------------------------------------------------------------
 			// Discarding all tracks that have been discarded by the track sorter and counting all / good tracks
@@ -404,32 +604,35 @@ int newFemtoAnalysis(TString inputlist = "", TString outfile = "femtoOutFile.roo
 			// Getting information on the current track (Not all of them necessary for all analyses)
 			//--------------------------------------------------------------------------------
 
-			if constexpr (isSimulation)
 			{
-				fTrack = std::make_shared<Selection::TrackCandidate>(
-					particle_cand,
-					nullptr,
-					HADES::MDC::CreateTrackLayers(fWireInfo),
-					fEvent->GetID(),
-					fEvent->GetReactionPlane(),
-					track,
-					protonPID);
-			}
-			else
-			{
-				fTrack = std::make_shared<Selection::TrackCandidate>(
-					particle_cand,
-					HADES::MDC::CreateTrackLayers(fWireInfo),
-					fEvent->GetID(),
-					fEvent->GetReactionPlane(),
-					track,
-					protonPID);
+				JJ_PROFILE_STAGE(fProfiler,JJUtils::Stage::TrackConstruction);
+				if constexpr (isSimulation)
+				{
+					fTrack = Selection::TrackCandidate(
+						particle_cand,
+						nullptr,
+						HADES::MDC::CreateTrackLayers(fWireInfo),
+						fEvent->GetID(),
+						fEvent->GetReactionPlane(),
+						track,
+						protonPID);
+				}
+				else
+				{
+					fTrack = Selection::TrackCandidate(
+						particle_cand,
+						HADES::MDC::CreateTrackLayers(fWireInfo),
+						fEvent->GetID(),
+						fEvent->GetReactionPlane(),
+						track,
+						protonPID);
+				}
 			}
 			//================================================================================================================================================================
 			// Put your analyses on track level here
 			//================================================================================================================================================================
 			
-			if (fTrack->GetSystem() == Selection::Detector::RPC)
+			if (fTrack.GetSystem() == Selection::Detector::RPC)
 			{
 				// fill RPC monitors for all tracks
 			}
@@ -438,16 +641,21 @@ int newFemtoAnalysis(TString inputlist = "", TString outfile = "femtoOutFile.roo
 				// fill ToF monitors for all tracks
 			}
 
-			if (!fTrack->SelectTrack(betamom_2sig_p_rpc_pionCmom,betamom_2sig_p_tof_pionCmom))
+			bool isSelected = false;
+			{
+				JJ_PROFILE_STAGE(fProfiler,JJUtils::Stage::TrackSelection);
+				isSelected = fTrack.SelectTrack(betamom_2sig_p_rpc_pionCmom,betamom_2sig_p_tof_pionCmom);
+			}
+			if (!isSelected)
 				continue;
 
 			//fSmearer.SmearMomenta(fTrack); // this will smear your momenta
 
 			fEvent->AddTrack(fTrack);
-			hPhiTheta->Fill(fTrack->GetPhi(),fTrack->GetTheta());
+			hPhiTheta->Fill(fTrack.GetPhi(),fTrack.GetTheta());
 			hCounter->Fill(cNumSelectedTracks);
 
-			if (fTrack->GetSystem() == Selection::Detector::RPC)
+			if (fTrack.GetSystem() == Selection::Detector::RPC)
 			{
 				// fill RPC monitors for accepted tracks
 			}
@@ -459,58 +667,34 @@ int newFemtoAnalysis(TString inputlist = "", TString outfile = "femtoOutFile.roo
 		} // End of track loop
 
 		if (fEvent->GetTrackListSize() > 2) // if track vector has entries
-		{
-            fSignMap = mixer.AddEvent(fEvent,fEvent->GetTrackList());
-			fBckgMap = mixer.GetSimilarPairs(fEvent);
+			processor.Push(fEvent); // femto mixing is done by the worker responsible for this event class
+	} // End of event loop
+	fDstReader.Finish();
 
-			for (const auto &signalEntry : fSignMap)
-			{
-				for (const auto &entry : signalEntry.second)
-				{
-					hCounter->Fill(cNumAllPairs);
-					if (fMapFoHistograms.find(signalEntry.first) == fMapFoHistograms.end())
-					{
-						HistogramCollection histos{
-							TH1D(/* TString::Format("hQinvSign_%s",signalEntry.first.data()),"Signal of Protons 0-10%% centrality;q_{inv} [MeV/c];CF(q_{inv})",750,0,3000 */),
-							TH1D(/* TString::Format("hQinvBckg_%s",signalEntry.first.data()),"Backgound of Protons 0-10%% centrality;q_{inv} [MeV/c];CF(q_{inv})",750,0,3000 */),
-							TH3D(TString::Format("hQoslSign_%s",signalEntry.first.data()),"Signal of Protons 0-10%% centrality;q_{out} [MeV/c];q_{side} [MeV/c];q_{long} [MeV/c];CF(q_{inv})",125,0,500,125,0,500,125,0,500),
-							TH3D(TString::Format("hQoslBckg_%s",signalEntry.first.data()),"Background of Protons 0-10%% centrality;q_{out} [MeV/c];q_{side} [MeV/c];q_{long} [MeV/c];CF(q_{inv})",125,0,500,125,0,500,125,0,500)
-						};
-						fMapFoHistograms.emplace(signalEntry.first,std::move(histos));
-					}
-					// fMapFoHistograms.at(signalEntry.first).hQinvSign.Fill(entry->GetQinv());
-					float qout,qside,qlong;
-					std::tie(qout,qside,qlong) = entry->GetOSL();
-					fMapFoHistograms.at(signalEntry.first).hQoslSign.Fill(qout,qside,qlong);
-
-					if (signalEntry.first != "bad" && signalEntry.first != "0")
-						hCounter->Fill(cNumSelectedPairs);
-				}
-			}
+	//--------------------------------------------------------------------------------
+	// Waiting for the workers and reducing their results
+	//--------------------------------------------------------------------------------
+	processor.Finish();
+	if (checkpointMinutes > 0)
+		writeCheckpoint(nEvents,true);
 
-			for (const auto &backgroundEntry : fBckgMap)
-			{
-				for (const auto &entry : backgroundEntry.second)
-				{
-					if (fMapFoHistograms.find(backgroundEntry.first) == fMapFoHistograms.end())
-					{
-						HistogramCollection histos{
-						TH1D(/* TString::Format("hQinvSign_%s",backgroundEntry.first.data()),"Signal of Protons 0-10%% centrality;q_{inv} [MeV/c];CF(q_{inv})",750,0,3000 */),
-						TH1D(/* TString::Format("hQinvBckg_%s",backgroundEntry.first.data()),"Backgound of Protons 0-10%% centrality;q_{inv} [MeV/c];CF(q_{inv})",750,0,3000 */),
-						TH3D(TString::Format("hQoslSign_%s",backgroundEntry.first.data()),"Signal of Protons 0-10%% centrality;q_{out} [MeV/c];q_{side} [MeV/c];q_{long} [MeV/c];CF(q_{inv})",125,0,500,125,0,500,125,0,500),
-						TH3D(TString::Format("hQoslBckg_%s",backgroundEntry.first.data()),"Background of Protons 0-10%% centrality;q_{out} [MeV/c];q_{side} [MeV/c];q_{long} [MeV/c];CF(q_{inv})",125,0,500,125,0,500,125,0,500)
-						};
-						fMapFoHistograms.emplace(backgroundEntry.first,std::move(histos));
-					}
-					// fMapFoHistograms.at(backgroundEntry.first).hQinvBckg.Fill(entry->GetQinv());
-					float qout,qside,qlong;
-					std::tie(qout,qside,qlong) = entry->GetOSL();
-					fMapFoHistograms.at(backgroundEntry.first).hQoslBckg.Fill(qout,qside,qlong);
-				}
-			}
-			
-		} // End of femto mixing
-	} // End of event loop
+	Mixing::CFHistogramBank &fHistogramBank = processor.GetWorker(0).histogramBank;
+	Mixing::NominalPairCuts fPairCuts; // rejection counters of all workers
+	for (std::size_t worker = 0; worker < processor.GetNWorkers(); ++worker)
+	{
+		if (worker > 0)
+			fHistogramBank.Add(processor.GetWorker(worker).histogramBank);
+		hCounter->Fill(cNumAllPairs,processor.GetWorker(worker).nAllPairs);
+		hCounter->Fill(cNumSelectedPairs,processor.GetWorker(worker).nSelectedPairs);
+		fProfiler.Add(processor.GetWorker(worker).profiler);
+		fProfiler.Add(processor.GetWorker(worker).mixer.GetProfiler());
+		fPairCuts.Add(processor.GetWorker(worker).mixer.GetPairCuttingFunction());
+		if (processor.GetWorker(worker).pairTuple != nullptr)
+		{
+			std::cout << "pairs stored in the pair tuple of worker " << worker << ": " << processor.GetWorker(worker).pairTuple->GetEntries() << "\n";
+			processor.GetWorker(worker).pairTuple->Close();
+		}
+	}
 	
 	static ProcInfo_t info;
 	constexpr float toGB = 1.f/1024.f/1024.f;
@@ -525,11 +709,18 @@ int newFemtoAnalysis(TString inputlist = "", TString outfile = "femtoOutFile.roo
     sorter.finalize();
     timer.Stop();
     std::cout << "Finished DST processing" << endl;
+	std::cout << "real time: " << timer.RealTime() << " s\t CPU time: " << timer.CpuTime() << " s\n\n";
+	fProfiler.Print();
+	fDstReader.Print();
+	fPairCuts.Print();
+	if (Selection::TrackStore::GetNDroppedMetaHits() > 0) // only HGeantKine tracks can have more META hits than the stored block
+		std::cout << "Warning: " << Selection::TrackStore::GetNDroppedMetaHits() << " META hits did not fit into the track block of " << Selection::TrackStore::metaBlockSize << " cells and were dropped\n";
 
 	//--------------------------------------------------------------------------------
     // Showing how much of the buffer was used for each event hash
     //--------------------------------------------------------------------------------
-	mixer.PrintStatus();
+	for (std::size_t worker = 0; worker < processor.GetNWorkers(); ++worker)
+		processor.GetWorker(worker).mixer.PrintStatus();
 
     //--------------------------------------------------------------------------------
     // Creating output file and storing results there
@@ -538,18 +729,13 @@ int newFemtoAnalysis(TString inputlist = "", TString outfile = "femtoOutFile.roo
     out->cd();
 
     hCounter->Write();
+	fProfiler.Write();
 	
     //================================================================================================================================================================
     // Remember to write your results to the output file here
     //================================================================================================================================================================
 
-	for (auto &histos : fMapFoHistograms)
-	{
-		// histos.second.hQinvSign.Write();
-		// histos.second.hQinvBckg.Write();
-		histos.second.hQoslSign.Write();
-		histos.second.hQoslBckg.Write();
-	}
+	fHistogramBank.Write();
 
 	hPhiTheta->Write();
 	
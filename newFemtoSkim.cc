@@ -0,0 +1,461 @@
+#include "Includes.h"
+#include "FemtoMixer/FemtoSkim.hxx"
+#include "FemtoMixer/DstReader.hxx"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <random>
+#include <type_traits>
+
+// defining a helper function
+template <typename T>
+bool isSim(T *t) {return false;}
+template <>
+bool isSim(HParticleCandSim *t) {return true;}
+
+// One pass over the DSTs, which stores the preselected events and tracks in a femto skim (see FemtoMixer/FemtoSkim.hxx).
+// Events are stored with loose cuts and tracks before the track selection, so the systematic variations can be run on the skim with newSkimFemtoAnalysis.cc
+int newFemtoSkim(TString inputlist = "", TString outfile = "femtoSkim.root", Long64_t nDesEvents = -1, Int_t maxFiles = -1)
+{
+	gStyle->SetOptStat(0);
+	gROOT->SetBatch(kTRUE);
+	
+	constexpr bool isCustomDst{false};
+	constexpr bool isSimulation{false}; // for now this could be easly just const
+	constexpr int protonPID{14};
+
+	//--------------------------------------------------------------------------------
+    // Initialization of the global ROOT object and the Hades Loop
+    // The Hades Loop used as an interface to the DST data (Basically a container of a TChain).
+    // kTRUE - The global HADES object is being created if not existing
+    //--------------------------------------------------------------------------------
+    TROOT dst_analysis("DstAnalysisMacro", "Simple DST analysis Macro");
+    HLoop* loop = new HLoop(kTRUE);
+	const TString beamtime="apr12";
+	
+	Int_t mdcMods[6][4]=
+	{ {1,1,1,1},
+	{1,1,1,1},
+	{1,1,1,1},
+	{1,1,1,1},
+	{1,1,1,1},
+	{1,1,1,1} };
+	TString asciiParFile     = "";
+	TString rootParFile;
+	if (isSimulation)
+	{
+		rootParFile = "/cvmfs/hadessoft.gsi.de/param/sim/apr12/allParam_APR12_sim_run_12001_gen9_07112017.root";
+	}
+	else
+	{
+		//rootParFile = "/cvmfs/hadessoft.gsi.de/param/real/apr12/allParam_APR12_gen9_27092017.root"; //gen9
+		rootParFile = "/cvmfs/hadessoft.gsi.de/param/real/apr12/allParam_APR12_gen10_16122024.root"; //gen10
+		//rootParFile = "/cvmfs/hadessoft.gsi.de/param/real/feb24/allParam_feb24_gen0_16042024.root"; // Au+Au 800 MeV
+	}
+	TString paramSource      = "root"; // root, ascii, oracle
+	TString paramrelease     = "APR12_dst_gen10"; 
+	HDst::setupSpectrometer(beamtime,mdcMods,"rich,mdc,tof,rpc,shower,wall,start,tbox");
+	HDst::setupParameterSources(paramSource,asciiParFile,rootParFile,paramrelease); 
+
+    //--------------------------------------------------------------------------------
+    // The following block finds / adds the input DST files to the HLoop
+    //--------------------------------------------------------------------------------
+    if (maxFiles == -1)
+		loop->addMultFiles(inputlist);     //use instead of addFiles if run on batch farm
+    else 
+    {
+		Int_t nFiles = 0;
+
+		TString inputFolder;
+		if (isSimulation) // simulation
+		{
+			//inputFolder = "/lustre/hades/dstsim/apr12/gen9vertex/no_enhancement_gcalor/root"; // Au+Au 800 MeV
+			//inputFolder = "/lustre/hades/dstsim/apr12/gen9vertex/no_enhancement_gcalor/root"; // Au+Au 2.4 GeV gen9
+			inputFolder = "/lustre/hades/dstsim/apr12/au1230au/gen10/bmax10/no_enhancement_gcalor/root"; // Au+Au 2.4 GeV gen10
+		}
+		else // data
+		{
+			if (isCustomDst)
+			{
+				inputFolder = "/lustre/hades/user/kjedrzej/customDST/apr12PlusHMdcSeg/5sec/109"; // test Robert filtered events
+			}
+			else
+			{
+				//inputFolder = "/lustre/hades/dst/feb24/gen0c/060/01/root"; // Au+Au 800 MeV
+				//inputFolder = "/lustre/hades/dst/apr12/gen9/122/root"; // Au+Au 2.4 GeV gen9
+				inputFolder = "/lustre/hades/dst/apr12/gen10/122/root"; // Au+Au 2.4 GeV gen10
+			}
+		}
+	
+		TSystemDirectory* inputDir = new TSystemDirectory("inputDir", inputFolder);
+		TList* files = inputDir->GetListOfFiles();
+
+		for (Int_t i = 0; i <= files->LastIndex() && nFiles < maxFiles; i++) 
+		{
+			if (((TSystemFile*) files->At(i))->IsDirectory())
+				continue;
+			
+			loop->addFile(inputFolder + "/" + ((TSystemFile*) files->At(i))->GetName());
+			nFiles++;
+		}
+	}
+
+	loop->readSectorFileList("/lustre/hades/user/sspies/SectorFileLists/Apr12AuAu1230_Gen10_Hadrons.list");
+    
+    //--------------------------------------------------------------------------------
+    // Booking the categories to be read from the DST files.
+    // By default all categories are booked therefore -* (Unbook all) first and book the ones needed
+    // All required categories have to be booked except the global Event Header which is always booked
+    //--------------------------------------------------------------------------------
+    std::vector<std::string> fCategories{"HParticleCand","HParticleEvtInfo"};
+	if (!isSimulation)
+		fCategories.push_back("HWallHit"); // read by HParticleEvtChara for the event plane (in simulation it comes from HGeantHeader)
+	if (isCustomDst)
+		fCategories.push_back("HMdcSeg");
+	if (isSimulation)
+		fCategories.push_back("HGeantKine");
+    if (!loop->setInput(JJUtils::DstReader::MakeInputString(fCategories).data()))
+		exit(1);
+
+	gHades->setBeamTimeID(HADES::kApr12); // this is needed when using the ParticleEvtChara
+	
+    //--------------------------------------------------------------------------------
+    // Setting up the read path of the HLoop internal TChain: only the booked branches are cached, the next cache block is prefetched in the background
+    // Improves performance of the lustre storage by decreasing load on lustre META servers
+    //--------------------------------------------------------------------------------
+	// background decompression of the cached baskets, remove on single-core slots
+	// both settings are process-wide: implicit MT and parallel unzip apply to every TTree read in this job, and they have to be set before the cache is created
+	ROOT::EnableImplicitMT(2);
+	TTreeCacheUnzip::SetParallelUnzip(TTreeCacheUnzip::kEnable);
+	JJUtils::DstReader fDstReader(loop->getChain()); // also enables TFile.AsyncPrefetching (process-wide, see JJUtils::DstReader)
+	fDstReader.PrintSettings();
+
+    loop->printCategories(); // Just for informative purposes
+	
+    //--------------------------------------------------------------------------------
+    // Creating the placeholder variables to read data from categories and getting categories (They have to be booked!)
+    //--------------------------------------------------------------------------------
+    HParticleCand*    particle_cand;	
+    HEventHeader*     event_header;
+    HParticleEvtInfo* particle_info;
+
+    HCategory* particle_info_cat = (HCategory*) HCategoryManager::getCategory(catParticleEvtInfo);
+    HCategory* particle_cand_cat = (HCategory*) HCategoryManager::getCategory(catParticleCand);
+
+	if (isSimulation && !isSim(particle_cand)) // verification if you changed particle_cand class for running simulations
+	{
+		throw std::runtime_error("particle candidate must be of type HParticleCandSim"); // in C++17 this can be evaluated at compile-time, c++14 doesnt support if constexpr (condition)...
+	}
+	else if (!isSimulation && isSim(particle_cand))
+	{
+		throw std::runtime_error("particle candidate must be of type HParticleCand");
+	}
+
+    if (!particle_cand_cat) // If the category for the reconstructed trackes does not exist the macro makes no sense
+		exit(1);
+	
+    //================================================================================================================================================================
+    // Put your object declarations here
+    //================================================================================================================================================================
+
+	// create objects for particle selection and mixing
+	std::shared_ptr<Selection::EventCandidate> fEvent;	
+	Selection::TrackCandidate fTrack;
+
+	// create object for getting MDC wires
+	HParticleWireInfo fWireInfo;
+	HGeantHeader *geantHeader;
+
+	Selection::FemtoSkimWriter fSkimWriter(outfile.Data());
+	std::vector<Selection::TrackCandidate> fPreselectedTracks;
+	
+    //--------------------------------------------------------------------------------
+    // The following counter histogram is used to gather some basic information on the analysis
+    //--------------------------------------------------------------------------------
+    enum Counters_e {
+	cNumAllEvents      = 0,
+	cNumSelectedEvents = 1,
+	cNumAllTracks      = 2,
+	cNumSelectedTracks = 3,
+	cNumCounters       = 4
+    };
+
+    TH1D* hCounter = new TH1D("hCounter", "", cNumCounters, 0, cNumCounters);
+
+    hCounter->GetXaxis()->SetBinLabel(1, "All Events");
+    hCounter->GetXaxis()->SetBinLabel(2, "Selected Events");
+    hCounter->GetXaxis()->SetBinLabel(3, "All Tracks");
+    hCounter->GetXaxis()->SetBinLabel(4, "Selected Tracks");
+
+	//--------------------------------------------------------------------------------
+	// wire information w/o HMdcSeg class access
+	//--------------------------------------------------------------------------------
+	HTaskSet *masterTaskSet = gHades->getTaskSet("all");
+    HParticleMetaMatcher* matcher = new HParticleMetaMatcher();
+    matcher->setDebug();
+	matcher->setUseEMC(kFALSE);
+	matcher->setRunWireManager(false);
+	if (isCustomDst)
+		matcher->setUseSeg(kTRUE);
+    masterTaskSet->add(matcher);
+
+	//--------------------------------------------------------------------------------
+	// Momentum corrected for energy loss (look-up table)
+	//--------------------------------------------------------------------------------
+    HEnergyLossCorrPar enLossCorr;
+    enLossCorr.setDefaultPar(beamtime);
+
+	//--------------------------------------------------------------------------------
+	// event characteristic & reaction plane
+	//--------------------------------------------------------------------------------
+	HParticleEvtChara evtChara;
+
+	std::cout << "HParticleEvtChara: reading input for energy 1.23A GeV... " << std::endl;
+	TString ParameterfileCVMFS;
+	if (isSimulation) // Simulation
+	{
+		ParameterfileCVMFS = "/cvmfs/hadessoft.gsi.de/param/eventchara/centrality_epcorr_sim_au1230au_gen9vertex_UrQMD_minbias_2019_04_pass0.root";
+	}
+	else // Data
+	{
+		//ParameterfileCVMFS = "/lustre/hades/user/bkardan/param/development/centrality_epcorr_feb24_au800au_1850A_gen0c_2024_04_pass10.root";  // Au+Au 800 MeV
+		ParameterfileCVMFS = "/cvmfs/hadessoft.gsi.de/param/eventchara/centrality_epcorr_apr12_gen8_2019_02_pass30.root"; // Au+Au 2.4 GeV
+	}
+
+	if (!evtChara.setParameterFile(ParameterfileCVMFS))
+	{
+		std::cout << "Parameterfile not found !!! " << std::endl;
+		return kFALSE;
+	}
+
+	if (!evtChara.init())
+	{
+		std::cout << "HParticleEvtChara not init!!! " << std::endl;
+		return kFALSE;
+	}
+	
+	Int_t eCentEstSP  = HParticleEvtChara::kSelectedParticleCand;
+	Int_t eCentEst    = HParticleEvtChara::kTOFRPC;
+	Int_t eCentClass1 = HParticleEvtChara::k10;
+	Int_t eEPcorr     = HParticleEvtChara::kDefault;
+	std::cout << "\t selected EPcorrection method is:  "  << evtChara.getStringEventPlaneCorrection(eEPcorr) << std::endl;
+
+	std::cout << "EVTChara for TOF+RPC hits " << std::endl;
+	evtChara.printCentralityClass(eCentEst, eCentClass1);
+
+	std::cout << "EVTChara for the selected particles " << std::endl;
+	evtChara.printCentralityClass(eCentEstSP, eCentClass1);
+
+    //--------------------------------------------------------------------------------
+    // Creating and initializing the track sorter and a simple stopwatch object
+    //--------------------------------------------------------------------------------
+    HParticleTrackSorter sorter;
+    sorter.init();
+    TStopwatch timer;
+    timer.Reset();
+    timer.Start();
+
+    //--------------------------------------------------------------------------------
+    // The amount of events to be processed
+    //--------------------------------------------------------------------------------
+    Long64_t nEvents = loop->getEntries();
+    if (nDesEvents >= 0 && nEvents > nDesEvents)
+		nEvents = nDesEvents;
+
+    //--------------------------------------------------------------------------------
+    // The global event loop which loops over all events in the DST files added to HLoop
+    // The loop breaks if the end is reached
+    //--------------------------------------------------------------------------------
+    for (Long64_t event = 0; event < nEvents; event++) 
+    {
+		if (fDstReader.NextEvent(*loop,event) <= 0) 
+		{
+			std::cout << " Last events processed " << endl;
+			break;
+		}
+
+		// TString tmp; // dummy variable; required by HLoop::isNewFile
+		// if (loop->isNewFile(tmp) && !isSimulation)
+		// {
+		// 	if (!loop->goodSector(0) || !loop->goodSector(1) || !loop->goodSector(3) || !loop->goodSector(4) || !loop->goodSector(5)) // no sector 2 in Au+Au
+		// 	{
+		// 		event += loop->getTree()->GetEntries() - 1;
+		// 		continue;
+		// 	}
+		// }
+
+		hCounter->Fill(cNumAllEvents);
+
+		//--------------------------------------------------------------------------------
+		// Just the progress of the analysis
+		//--------------------------------------------------------------------------------
+		HTool::printProgress(event, nEvents, 1, "Analyzed events: ");
+
+		//--------------------------------------------------------------------------------
+		// Getting the amount of tracks (Particle Candidates), the global event header, the Particle event Info object and the reconstructed global event vertex
+		//--------------------------------------------------------------------------------
+		Int_t nTracks           = particle_cand_cat->getEntries();
+		event_header            = gHades->getCurrentEvent()->getHeader();
+		particle_info           = HCategoryManager::getObject(particle_info, particle_info_cat, 0);
+		HGeomVector EventVertex  = event_header->getVertexReco().getPos();
+		
+		Int_t centClassIndex    = evtChara.getCentralityClass(eCentEst, eCentClass1); // 0 is overflow, 1 is 0-10, etc.
+		Float_t EventPlane = -1;
+		Float_t EventPlaneA = -1;
+		Float_t EventPlaneB = -1;
+
+		if constexpr (isSimulation)
+		{
+			geantHeader = loop->getGeantHeader();
+			if (geantHeader == nullptr)
+				continue;
+			
+			EventPlane = geantHeader->getEventPlane() * TMath::DegToRad();
+			EventPlaneA = EventPlane;
+			EventPlaneB = EventPlane;
+		}
+		else
+		{
+			EventPlane = evtChara.getEventPlane(eEPcorr);
+			EventPlaneA = evtChara.getEventPlane(eEPcorr,1);
+			EventPlaneB = evtChara.getEventPlane(eEPcorr,2);
+		}
+		
+		if (EventPlane < 0)
+			continue;
+		if (EventPlaneA < 0 || EventPlaneB < 0)
+			continue;
+		
+		fEvent = std::make_shared<Selection::EventCandidate>(event_header,particle_info,centClassIndex,EventPlane);
+
+		//--------------------------------------------------------------------------------
+		// Discarding bad events with multiple criteria and counting amount of all / good events
+		//--------------------------------------------------------------------------------
+        
+		if (   !particle_info->isGoodEvent(Particle::kGoodVertexClust)
+			|| !particle_info->isGoodEvent(Particle::kGoodVertexCand)
+			|| !particle_info->isGoodEvent(Particle::kGoodSTART)
+			|| !particle_info->isGoodEvent(Particle::kNoPileUpSTART)
+			|| !particle_info->isGoodEvent(Particle::kGoodTRIGGER)
+			|| !particle_info->isGoodEvent(Particle::kNoVETO)
+			|| !particle_info->isGoodEvent(Particle::kGoodSTARTVETO)
+			|| !particle_info->isGoodEvent(Particle::kGoodSTARTMETA))
+			continue;
+
+		if (particle_info->getNStartCluster() >= 5)
+			continue;
+	
+		//================================================================================================================================================================
+		// Put your analyses on event level here
+		//================================================================================================================================================================
+		
+		// loosest cuts of all variations, the final event selection is done when reading the skim
+		if (! fEvent->SelectEvent<HADES::Target::Setup::Apr12>({1,2,3,4},3,3,2))
+			continue;
+
+		hCounter->Fill(cNumSelectedEvents);
+		
+		//--------------------------------------------------------------------------------
+		// Resetting the track sorter and selecting hadrons ranked by Chi2 Runge Kutta
+		//--------------------------------------------------------------------------------
+		sorter.cleanUp();
+		sorter.resetFlags(kTRUE, kTRUE, kTRUE, kTRUE);
+		sorter.fill(HParticleTrackSorter::selectHadrons);
+		sorter.selectBest(Particle::ESwitch::kIsBestRKSorter, Particle::ESelect::kIsHadronSorter);
+		fPreselectedTracks.clear();
+	
+		//--------------------------------------------------------------------------------
+		// The loop over all tracks (Particle Candidates in the current event
+		//--------------------------------------------------------------------------------
+		for (Int_t track = 0; track < nTracks; track++) 
+		{
+			particle_cand = HCategoryManager::getObject(particle_cand, particle_cand_cat, track);
+
+			// I have a vague idea about how it should be done: set momentum and then call calc4vectorproperties before using
+			particle_cand->setMomentum(particle_cand->getCorrectedMomentumPID(protonPID));
+			
+			//fWireManager = matcher->getWireManager();
+			matcher->getWireInfoDirect(particle_cand,fWireInfo);
+
+			//--------------------------------------------------------------------------------
+			// Discarding all tracks that have been discarded by the track sorter and counting all / good tracks
+			//--------------------------------------------------------------------------------
+			hCounter->Fill(cNumAllTracks);
+	
+			if (!particle_cand->isFlagBit(Particle::kIsUsed))
+				continue;
+			//--------------------------------------------------------------------------------
+			// Getting information on the current track (Not all of them necessary for all analyses)
+			//--------------------------------------------------------------------------------
+
+			if constexpr (isSimulation)
+			{
+				fTrack = Selection::TrackCandidate(
+					particle_cand,
+					nullptr,
+					HADES::MDC::CreateTrackLayers(fWireInfo),
+					fEvent->GetID(),
+					fEvent->GetReactionPlane(),
+					track,
+					protonPID);
+			}
+			else
+			{
+				fTrack = Selection::TrackCandidate(
+					particle_cand,
+					HADES::MDC::CreateTrackLayers(fWireInfo),
+					fEvent->GetID(),
+					fEvent->GetReactionPlane(),
+					track,
+					protonPID);
+			}
+			// the track selection is done when reading the skim
+			fPreselectedTracks.push_back(fTrack);
+			hCounter->Fill(cNumSelectedTracks);
+		} // End of track loop
+
+		if (fPreselectedTracks.size() > 1) // at least one pair is needed
+			fSkimWriter.Fill(*fEvent,fPreselectedTracks);
+	} // End of event loop
+	fDstReader.Finish();
+
+	static ProcInfo_t info;
+	constexpr float toGB = 1.f/1024.f/1024.f;
+
+	gSystem->GetProcInfo(&info);
+	std::cout << "\n---=== Memory Usage ===---\n";
+	std::cout << "resident memory used: " << info.fMemResident*toGB << " GB\t virtual memory used: " << info.fMemVirtual*toGB << " GB\n\n";
+
+    //--------------------------------------------------------------------------------
+    // Doing some cleanup and finalization work
+    //--------------------------------------------------------------------------------
+    sorter.finalize();
+    timer.Stop();
+    std::cout << "Finished DST processing" << endl;
+	fDstReader.Print();
+
+	std::cout << "stored events: " << fSkimWriter.GetEntries() << "\n";
+	if (Selection::TrackStore::GetNDroppedMetaHits() > 0) // only HGeantKine tracks can have more META hits than the stored block
+		std::cout << "Warning: " << Selection::TrackStore::GetNDroppedMetaHits() << " META hits did not fit into the track block of " << Selection::TrackStore::metaBlockSize << " cells and were dropped\n";
+	fSkimWriter.Close();
+
+    //--------------------------------------------------------------------------------
+    // Creating output file and storing results there
+    //--------------------------------------------------------------------------------
+    TFile* out = new TFile(TString(outfile).ReplaceAll(".root","_counters.root").Data(), "RECREATE");
+    out->cd();
+
+    hCounter->Write();
+	
+    //--------------------------------------------------------------------------------
+    // Closing file and finalization
+    //--------------------------------------------------------------------------------
+    out->Save();
+    out->Close();
+
+    std::cout << "####################################################" << endl;
+	gROOT->SetBatch(kFALSE);
+	return 0;
+	}
+
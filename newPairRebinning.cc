@@ -0,0 +1,90 @@
+// Rebuilds the correlation function histograms from the pair tuples (FemtoMixer/PairTuple.hxx) written by newFemtoAnalysis.cc or newSkimFemtoAnalysis.cc with writePairTuple set.
+// The pair intervals (RebinnedBinning) and the q binning (fHistogramSettings) can be changed here without rerunning over the data, as long as they stay inside the ranges used by the analysis (and below its q_inv limit, for q_osl below qInvMax / sqrt(3) per component).
+// The tuples are read by nThreads threads, each one reads its own range of pairs into its own histogram bank.
+#define FEMTOMIXER_STANDALONE
+
+#include "TROOT.h"
+#include "TFile.h"
+#include "TStopwatch.h"
+#include "TString.h"
+
+#include "FemtoMixer/CFHistogramBank.hxx"
+#include "FemtoMixer/PairTuple.hxx"
+#include "FemtoMixer/PairUtils.hxx"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// the new pair groups, any Mixing::Binning can be used (e.g. with a finer rapidity axis)
+using RebinnedBinning = Mixing::PairBinning1D;
+
+int newPairRebinning(TString inputfile = "femtoOutFile_pairs_*.root", TString outfile = "rebinnedOutFile.root", Int_t nThreads = 1)
+{
+	gROOT->SetBatch(kTRUE);
+	ROOT::EnableThreadSafety(); // every thread has its own reader and histograms
+
+	// q_inv <= |q_LCMS|, so a tuple cut at q_inv < qInvMax holds every pair inside the sphere |q_LCMS| < qInvMax, but only a part of the pairs outside of it;
+	// the q_osl axis is therefore limited to the cube inscribed in that sphere (qInvMax / sqrt(3) per component), the corners of a larger cube would be under-filled
+	const Mixing::PairTupleSettings fTupleSettings; // has to match the settings used to write the tuple
+	constexpr double qoslBinWidth = 4.; // [MeV/c]
+	const int nQoslBins = static_cast<int>(fTupleSettings.qInvMax / std::sqrt(3.) / qoslBinWidth);
+
+	Mixing::CFHistogramSettings fHistogramSettings;
+	fHistogramSettings.fillQinv = false;
+	fHistogramSettings.qoslAxis = {nQoslBins,0.,nQoslBins * qoslBinWidth}; // 72 bins up to 288 MeV/c for qInvMax = 500 MeV/c
+	fHistogramSettings.qoslStorage = Mixing::GridStorage::Dense;
+
+	const Long64_t nPairs = Mixing::PairTupleReader(inputfile.Data(),false).GetEntries();
+	const std::size_t nReaders = std::max<Int_t>(nThreads,1);
+	std::cout << "pairs in the tuple: " << nPairs << "\t reading threads: " << nReaders << "\n\n";
+
+	std::vector<Mixing::CFHistogramBank> fHistogramBanks;
+	for (std::size_t thread = 0; thread < nReaders; ++thread)
+		fHistogramBanks.push_back(Mixing::CFHistogramBank::Create<RebinnedBinning>(fHistogramSettings)); // all histograms are booked here
+	fHistogramBanks.front().PrintSettings();
+
+	TStopwatch timer;
+	timer.Start();
+
+	//--------------------------------------------------------------------------------
+	// Reading the pairs, the close-track columns are not needed for the histograms
+	//--------------------------------------------------------------------------------
+	std::vector<std::thread> fReaders;
+	for (std::size_t thread = 0; thread < nReaders; ++thread)
+		fReaders.emplace_back([&,thread]()
+		{
+			Mixing::PairTupleReader reader(inputfile.Data(),false);
+			reader.SetEntryRange(nPairs * thread / nReaders,nPairs * (thread + 1) / nReaders);
+			Mixing::CFHistogramBank &histogramBank = fHistogramBanks[thread];
+			while (reader.Next())
+			{
+				const Mixing::PairTupleRecord &pair = reader.GetRecord();
+				histogramBank.Fill(pair.GetSample(),RebinnedBinning::GetGroup(pair),pair.qInv,pair.qOut,pair.qSide,pair.qLong,pair.weight);
+			}
+		});
+	for (auto &reader : fReaders)
+		reader.join();
+
+	Mixing::CFHistogramBank &fHistogramBank = fHistogramBanks.front();
+	for (std::size_t thread = 1; thread < nReaders; ++thread)
+		fHistogramBank.Add(fHistogramBanks[thread]);
+
+	timer.Stop();
+	std::cout << "Finished rebinning" << std::endl;
+	std::cout << "real time: " << timer.RealTime() << " s\t CPU time: " << timer.CpuTime() << " s\n\n";
+
+	//--------------------------------------------------------------------------------
+	// Creating output file and storing results there
+	//--------------------------------------------------------------------------------
+	TFile* out = new TFile(outfile.Data(), "RECREATE");
+	out->cd();
+
+	fHistogramBank.Write();
+
+	out->Save();
+	out->Close();
+
+	return 0;
+}
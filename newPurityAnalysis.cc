@@ -1,9 +1,11 @@
 #include "Includes.h"
 #include "FemtoMixer/EventCandidate.hxx"
 #include "FemtoMixer/PairCandidate.hxx"
-#include "../JJFemtoMixer/JJFemtoMixer.hxx"
+#include "FemtoMixer/JJFemtoMixer.hxx"
 #include "FemtoMixer/EventUtils.hxx"
 #include "FemtoMixer/PairUtils.hxx"
+#include "FemtoMixer/CFHistogramBank.hxx"
+#include "FemtoMixer/ShardedEventProcessor.hxx"
 #include <iostream>
 #include <string>
 #include <vector>
@@ -17,16 +19,39 @@ bool isSim(T *t) {return false;}
 template <>
 bool isSim(HParticleCandSim *t) {return true;}
 
-struct HistogramCollection
+// numerator and denominator versions of the same DST event (nullptr if the event has too few tracks)
+struct PurityEvents
 {
-	TH1D hQinvSign;
-	TH3D hQoslSign;
+	std::shared_ptr<Selection::EventCandidate> num, den;
 };
 
-int newPurityAnalysis(TString inputlist = "", TString outfile = "purityOutFile.root", Long64_t nDesEvents = -1, Int_t maxFiles = 10)	//for simulation set approx 100 files and output name testOutFileSim.root
+// mixing and histogramming of one worker thread; each worker owns the mixing buffers of its event classes
+struct PurityWorker
+{
+	Mixing::JJFemtoMixer<Selection::EventCandidate,Selection::TrackHandle,Selection::PairCandidate,Mixing::PairBinning1D,Mixing::NominalPairCuts> mixerNum, mixerDen;
+	Mixing::CFHistogramBank histogramBank;
+
+	void operator()(const PurityEvents &events)
+	{
+		if (events.num != nullptr)
+		{
+			mixerNum.ForEachSignalPair(events.num,[this](Mixing::GroupId group, const Selection::PairCandidate &pair) {histogramBank.Fill(Mixing::CFSample::Signal,group,pair);});
+			mixerNum.BufferEvent(events.num);
+		}
+
+		if (events.den != nullptr)
+		{
+			mixerDen.ForEachSignalPair(events.den,[this](Mixing::GroupId group, const Selection::PairCandidate &pair) {histogramBank.Fill(Mixing::CFSample::Background,group,pair);});
+			mixerDen.BufferEvent(events.den);
+		}
+	}
+};
+
+int newPurityAnalysis(TString inputlist = "", TString outfile = "purityOutFile.root", Long64_t nDesEvents = -1, Int_t maxFiles = 10, Int_t nThreads = 1)	//for simulation set approx 100 files and output name testOutFileSim.root
 {
 	gStyle->SetOptStat(0);
 	gROOT->SetBatch(kTRUE);
+	ROOT::EnableThreadSafety(); // DST reading stays in this thread, mixing and histogramming is done by nThreads workers
 	
 	constexpr int protonPID{14};
 	constexpr std::size_t mixerBuffer{0};
@@ -119,7 +144,14 @@ int newPurityAnalysis(TString inputlist = "", TString outfile = "purityOutFile.r
     // Put your object declarations here
     //================================================================================================================================================================
 
-	std::map<std::string, HistogramCollection> fMapFoHistogramsNum,fMapFoHistogramsDen;
+	const Mixing::PairGrouping fPairGrouping;
+	Mixing::CFHistogramSettings fHistogramSettings; // numerator is stored as the "signal" and denominator as the "background"
+	fHistogramSettings.fillQinv = true;
+	fHistogramSettings.fillQosl = false;
+	fHistogramSettings.signalTag = "Num";
+	fHistogramSettings.backgroundTag = "Den";
+	fHistogramSettings.signalTitle = "Numerator of Proton Purity 0-10% centrality";
+	fHistogramSettings.backgroundTitle = "Denominator of Proton Purity 0-10% centrality";
 
 	TFile *cutfile_betamom_pionCmom = new TFile("/lustre/hades/user/tscheib/apr12/ID_Cuts/BetaMomIDCuts_PionsProtons_gen8_DATA_RK400_PionConstMom.root");
 	TCutG* betamom_2sig_p_tof_pionCmom = cutfile_betamom_pionCmom->Get<TCutG>("BetaCutProton_TOF_2.0");
@@ -127,26 +159,33 @@ int newPurityAnalysis(TString inputlist = "", TString outfile = "purityOutFile.r
 	
 	// create objects for particle selection and mixing
 	std::shared_ptr<Selection::EventCandidate> fEventNum,fEventDen;
-	std::shared_ptr<Selection::TrackCandidate> fTrackNum,fTrackDen;
+	Selection::TrackCandidate fTrackNum,fTrackDen;
 	HGeantHeader *geantHeader;
 
 	// create object for getting MDC wires
 	HParticleWireInfo fWireInfo;
 
-	std::map<std::string,std::vector<std::shared_ptr<Selection::PairCandidate> > > fSignMapNum, fSignMapDen;
-
-    Mixing::JJFemtoMixer<Selection::EventCandidate,Selection::TrackCandidate,Selection::PairCandidate> mixerNum,mixerDen;
-	mixerNum.SetMaxBufferSize(mixerBuffer);
-	mixerNum.SetEventHashingFunction(Mixing::EventGrouping{}.MakeEventGroupingFunction());
-	mixerNum.SetPairHashingFunction(Mixing::PairGrouping{}.MakePairGroupingFunction1D());
-	mixerNum.SetPairCuttingFunction(Mixing::PairRejection{}.MakePairRejectionFunction());
-	mixerNum.PrintSettings();
+	const Mixing::EventGrouping fEventGrouping;
 
-	mixerDen.SetMaxBufferSize(mixerBuffer);
-	mixerDen.SetEventHashingFunction(Mixing::EventGrouping{}.MakeEventGroupingFunction());
-	mixerDen.SetPairHashingFunction(Mixing::PairGrouping{}.MakePairGroupingFunction1D());
-	mixerDen.SetPairCuttingFunction(Mixing::PairRejection{}.MakePairRejectionFunction());
-	mixerDen.PrintSettings();
+	// events are sharded by their class, so the mixing in each class is the same as in a serial run
+	Mixing::ShardedEventProcessor<PurityEvents,PurityWorker> processor(nThreads,
+		[&]()
+		{
+			PurityWorker worker{{},{},Mixing::CFHistogramBank::Create1D(fPairGrouping,fHistogramSettings)}; // all histograms are booked here
+			for (auto *mixer : {&worker.mixerNum,&worker.mixerDen})
+			{
+				mixer->SetMaxBufferSize(mixerBuffer);
+				mixer->SetEventHashingFunction(fEventGrouping.MakeEventGroupingFunction());
+				mixer->SetPairHashingFunction(Mixing::PairBinning1D());
+				mixer->SetPairCuttingFunction(Mixing::NominalPairCuts());
+			}
+			return worker;
+		},
+		[&fEventGrouping](const PurityEvents &events){return fEventGrouping.GetEventIndex((events.num != nullptr) ? events.num : events.den);});
+	processor.GetWorker(0).mixerNum.PrintSettings();
+	processor.GetWorker(0).mixerDen.PrintSettings();
+	processor.GetWorker(0).histogramBank.PrintSettings();
+	std::cout << "number of workers: " << processor.GetNWorkers() << "\n\n";
 	
     //--------------------------------------------------------------------------------
     // The following counter histogram is used to gather some basic information on the analysis
@@ -346,7 +385,7 @@ int newPurityAnalysis(TString inputlist = "", TString outfile = "purityOutFile.r
 			//--------------------------------------------------------------------------------
 			// Getting information on the current track (Not all of them necessary for all analyses)
 			//--------------------------------------------------------------------------------
-			fTrackNum = std::make_shared<Selection::TrackCandidate>(
+			fTrackNum = Selection::TrackCandidate(
 					particle_cand,
 					static_cast<HGeantKine*>(kine_cand_cat->getObject(particle_cand->getGeantTrack() - 1)),
 					HADES::MDC::CreateTrackLayers(fWireInfo),
@@ -355,7 +394,7 @@ int newPurityAnalysis(TString inputlist = "", TString outfile = "purityOutFile.r
 					track,
 					protonPID);
 
-			fTrackDen = std::make_shared<Selection::TrackCandidate>(
+			fTrackDen = Selection::TrackCandidate(
 					particle_cand,
 					static_cast<HGeantKine*>(kine_cand_cat->getObject(particle_cand->getGeantTrack() - 1)),
 					HADES::MDC::CreateTrackLayers(fWireInfo),
@@ -368,65 +407,31 @@ int newPurityAnalysis(TString inputlist = "", TString outfile = "purityOutFile.r
 			//================================================================================================================================================================
 
 
-			if (fTrackNum->SelectTrack(betamom_2sig_p_rpc_pionCmom,betamom_2sig_p_tof_pionCmom))
+			if (fTrackNum.SelectTrack(betamom_2sig_p_rpc_pionCmom,betamom_2sig_p_tof_pionCmom))
 				fEventNum->AddTrack(fTrackNum);
 
-			if (fTrackDen->SelectTrack(betamom_2sig_p_rpc_pionCmom,betamom_2sig_p_tof_pionCmom,false))
+			if (fTrackDen.SelectTrack(betamom_2sig_p_rpc_pionCmom,betamom_2sig_p_tof_pionCmom,false))
 				fEventDen->AddTrack(fTrackDen);
 
 			hCounter->Fill(cNumSelectedTracks);
 
 		} // End of track loop
 
-		if (fEventNum->GetTrackListSize() > 2) // if track vector has entries
-		{
-            fSignMapNum = mixerNum.AddEvent(fEventNum,fEventNum->GetTrackList());
-
-			for (const auto &signalEntry : fSignMapNum)
-			{
-				for (const auto &entry : signalEntry.second)
-				{
-					if (fMapFoHistogramsNum.find(signalEntry.first) == fMapFoHistogramsNum.end())
-					{
-						HistogramCollection histos{
-						TH1D(TString::Format("hQinvNum_%s",signalEntry.first.data()),"Numerator of Proton Purity 0-10%% centrality;q_{inv} [MeV/c];CF(q_{inv})",750,0,3000),
-						TH3D(/* TString::Format("hQoslNum_%lu",signalEntry.first),"Purity of Protons 0-10%% centrality;q_{out} [MeV/c];q_{side} [MeV/c];q_{long} [MeV/c];CF(q_{inv})",64,0,500,64,0,500,64,0,500 */),
-						};
-						fMapFoHistogramsNum.emplace(signalEntry.first,std::move(histos));
-					}
-					fMapFoHistogramsNum.at(signalEntry.first).hQinvSign.Fill(entry->GetQinv());
-					/* float qout,qside,qlong;
-					std::tie(qout,qside,qlong) = entry.GetOSL();
-					fMapFoHistogramsNum.at(signalEntry.first).hQoslSign.Fill(qout,qside,qlong); */
-				}
-			}
-		}
-
-		if (fEventDen->GetTrackListSize() > 2) // if track vector has entries
-		{
-            fSignMapDen = mixerDen.AddEvent(fEventDen,fEventDen->GetTrackList());
-
-			for (const auto &signalEntry : fSignMapDen)
-			{
-				for (const auto &entry : signalEntry.second)
-				{
-					if (fMapFoHistogramsDen.find(signalEntry.first) == fMapFoHistogramsDen.end())
-					{
-						HistogramCollection histos{
-						TH1D(TString::Format("hQinvDen_%s",signalEntry.first.data()),"Denominator of Proton Purity 0-10%% centrality;q_{inv} [MeV/c];CF(q_{inv})",750,0,3000),
-						TH3D(/* TString::Format("hQoslDen_%lu",signalEntry.first),"Purity of Protons 0-10%% centrality;q_{out} [MeV/c];q_{side} [MeV/c];q_{long} [MeV/c];CF(q_{inv})",64,0,500,64,0,500,64,0,500 */),
-						};
-						fMapFoHistogramsDen.emplace(signalEntry.first,std::move(histos));
-					}
-					fMapFoHistogramsDen.at(signalEntry.first).hQinvSign.Fill(entry->GetQinv());
-					/* float qout,qside,qlong;
-					std::tie(qout,qside,qlong) = entry.GetOSL();
-					fMapFoHistogramsDen.at(signalEntry.first).hQoslSign.Fill(qout,qside,qlong); */
-				}
-			}
-		}
+		PurityEvents events{
+			(fEventNum->GetTrackListSize() > 2) ? fEventNum : nullptr, // if track vector has entries
+			(fEventDen->GetTrackListSize() > 2) ? fEventDen : nullptr};
+		if (events.num != nullptr || events.den != nullptr)
+			processor.Push(events); // pairing is done by the worker responsible for this event class
 
 	} // End of event loop
+
+	//--------------------------------------------------------------------------------
+	// Waiting for the workers and reducing their results
+	//--------------------------------------------------------------------------------
+	processor.Finish();
+	Mixing::CFHistogramBank &fHistogramBank = processor.GetWorker(0).histogramBank;
+	for (std::size_t worker = 1; worker < processor.GetNWorkers(); ++worker)
+		fHistogramBank.Add(processor.GetWorker(worker).histogramBank);
 	
 	static ProcInfo_t info;
 	constexpr float toGB = 1.f/1024.f/1024.f;
@@ -445,8 +450,11 @@ int newPurityAnalysis(TString inputlist = "", TString outfile = "purityOutFile.r
 	//--------------------------------------------------------------------------------
     // Showing how much of the buffer was used for each event hash
     //--------------------------------------------------------------------------------
-	mixerNum.PrintStatus();
-	mixerDen.PrintStatus();
+	for (std::size_t worker = 0; worker < processor.GetNWorkers(); ++worker)
+	{
+		processor.GetWorker(worker).mixerNum.PrintStatus();
+		processor.GetWorker(worker).mixerDen.PrintStatus();
+	}
 
     //--------------------------------------------------------------------------------
     // Creating output file and storing results there
@@ -460,17 +468,7 @@ int newPurityAnalysis(TString inputlist = "", TString outfile = "purityOutFile.r
     // Remember to write your results to the output file here
     //================================================================================================================================================================
 
-	for (const auto &histos : fMapFoHistogramsNum)
-	{
-		histos.second.hQinvSign.Write();
-		//histos.second.hQoslSign.Write();
-	}
-
-	for (const auto &histos : fMapFoHistogramsDen)
-	{
-		histos.second.hQinvSign.Write();
-		//histos.second.hQoslSign.Write();
-	}
+	fHistogramBank.Write();
 	
     //--------------------------------------------------------------------------------
     // Closing file and finalization
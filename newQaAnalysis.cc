@@ -1,7 +1,7 @@
 #include "Includes.h"
 //#include "FemtoMixer/EventCandidate.hxx"
 //#include "FemtoMixer/PairCandidate.hxx"
-#include "../JJFemtoMixer/JJFemtoMixer.hxx"
+#include "FemtoMixer/JJFemtoMixer.hxx"
 #include "FemtoMixer/PairUtils.hxx"
 #include "FemtoMixer/EventUtils.hxx"
 
@@ -281,20 +281,20 @@ int newQaAnalysis(TString inputlist = "", TString outfile = "qaOutFile.root", Lo
 
 	// create objects for particle selection
 	std::shared_ptr<Selection::EventCandidate> fEvent;	
-	std::shared_ptr<Selection::TrackCandidate> fTrack;
+	Selection::TrackCandidate fTrack;
 	HParticleWireInfo fWireInfo;
 	HGeantHeader *geantHeader;
 	std::size_t tracks;
 	float betaReco, betaKine, momReco, momKine, rapReco, rapKine, ptReco, ptKine;
 	int binDistance;
 
-	std::map<std::string,std::vector<std::shared_ptr<Selection::PairCandidate> > > fSignMap, fBckgMap;	
+	std::map<Mixing::GroupId,std::vector<std::shared_ptr<Selection::PairCandidate> > > fSignMap, fBckgMap;	
 
-    Mixing::JJFemtoMixer<Selection::EventCandidate,Selection::TrackCandidate,Selection::PairCandidate> mixer;
+    Mixing::JJFemtoMixer<Selection::EventCandidate,Selection::TrackHandle,Selection::PairCandidate,Mixing::PairBinning1D,Mixing::NominalPairCuts> mixer;
 	mixer.SetMaxBufferSize(0);
 	mixer.SetEventHashingFunction(Mixing::EventGrouping{}.MakeEventGroupingFunction());
-	mixer.SetPairHashingFunction(Mixing::PairGrouping{}.MakePairGroupingFunction1D());
-	mixer.SetPairCuttingFunction(Mixing::PairRejection{}.MakePairRejectionFunction());
+	mixer.SetPairHashingFunction(Mixing::PairBinning1D());
+	mixer.SetPairCuttingFunction(Mixing::NominalPairCuts());
 	mixer.PrintSettings();
 
     //--------------------------------------------------------------------------------
@@ -524,7 +524,7 @@ int newQaAnalysis(TString inputlist = "", TString outfile = "qaOutFile.root", Lo
 			//--------------------------------------------------------------------------------
 			if constexpr (isSimulation)
 			{
-				fTrack = std::make_shared<Selection::TrackCandidate>(
+				fTrack = Selection::TrackCandidate(
 					particle_cand,
 					static_cast<HGeantKine*>(kine_cand_cat->getObject(particle_cand->getGeantTrack() - 1)),
 					HADES::MDC::CreateTrackLayers(fWireInfo),
@@ -535,7 +535,7 @@ int newQaAnalysis(TString inputlist = "", TString outfile = "qaOutFile.root", Lo
 			}
 			else
 			{
-				fTrack = std::make_shared<Selection::TrackCandidate>(
+				fTrack = Selection::TrackCandidate(
 					particle_cand,
 					HADES::MDC::CreateTrackLayers(fWireInfo),
 					fEvent->GetID(),
@@ -548,83 +548,83 @@ int newQaAnalysis(TString inputlist = "", TString outfile = "qaOutFile.root", Lo
 			// Put your analyses on track level here
 			//================================================================================================================================================================
 			
-			if (fTrack->GetSystem() == Selection::Detector::RPC)
+			if (fTrack.GetSystem() == Selection::Detector::RPC)
 			{
-				for (const auto &hit : fTrack->GetMetaHits())
+				for (const auto &hit : fTrack.GetMetaHits())
 				{
-					hMetaCellsRPC->Fill(fTrack->GetSector(),hit);
+					hMetaCellsRPC->Fill(fTrack.GetSector(),hit);
 				}
 			}
 			else
 			{
-				for (const auto &hit : fTrack->GetMetaHits())
+				for (const auto &hit : fTrack.GetMetaHits())
 				{
-					hMetaCellsToF->Fill(fTrack->GetSector(),hit);
+					hMetaCellsToF->Fill(fTrack.GetSector(),hit);
 				}
 			}
 
-			if (!fTrack->SelectTrack(betamom_2sig_p_rpc_pionCmom,betamom_2sig_p_tof_pionCmom))
+			if (!fTrack.SelectTrack(betamom_2sig_p_rpc_pionCmom,betamom_2sig_p_tof_pionCmom))
 				continue;
 
-			betaReco = fTrack->GetBeta();
-			momReco = fTrack->GetP();
-			rapReco = fTrack->GetRapidity();
-			ptReco = fTrack->GetPt();
+			betaReco = fTrack.GetBeta();
+			momReco = fTrack.GetP();
+			rapReco = fTrack.GetRapidity();
+			ptReco = fTrack.GetPt();
 			if (isSimulation)
 			{
-				betaKine = fTrack->GetGeantKine()->GetBeta();
-				momKine = fTrack->GetGeantKine()->GetP();
-				rapKine = fTrack->GetGeantKine()->GetRapidity();
-				ptKine = fTrack->GetGeantKine()->GetPt();
+				betaKine = fTrack.GetGeantKine()->GetBeta();
+				momKine = fTrack.GetGeantKine()->GetP();
+				rapKine = fTrack.GetGeantKine()->GetRapidity();
+				ptKine = fTrack.GetGeantKine()->GetPt();
 			
 
 				hPtRap->Fill(ptReco, rapReco - fBeamRapidity);
 				binDistance = CalcBinDistance(hPtRap, ptReco, rapReco - fBeamRapidity, ptKine, rapKine - fBeamRapidity);
 				hPtRapReco->Fill(ptReco, rapReco - fBeamRapidity, 1./(binDistance + 1));
 			
-				hPhiTheta->Fill(fTrack->GetPhi(),fTrack->GetTheta());
-				hInnerChi2Phi->Fill(fTrack->GetGeantKine()->GetPhi() - fTrack->GetPhi(),fTrack->GetInnerSegChi2());
-				hInnerChi2Theta->Fill(fTrack->GetGeantKine()->GetTheta() - fTrack->GetTheta(),fTrack->GetInnerSegChi2());
-				hOuterChi2Phi->Fill(fTrack->GetGeantKine()->GetPhi() - fTrack->GetPhi(),fTrack->GetOuterSegChi2());
-				hOuterChi2Theta->Fill(fTrack->GetGeantKine()->GetTheta() - fTrack->GetTheta(),fTrack->GetOuterSegChi2());
-				hMetaQualityMom->Fill(momKine - momReco,fTrack->GetMetaMatchQuality());
-				hChi2Mom->Fill(momKine - momReco, fTrack->GetChi2());
+				hPhiTheta->Fill(fTrack.GetPhi(),fTrack.GetTheta());
+				hInnerChi2Phi->Fill(fTrack.GetGeantKine()->GetPhi() - fTrack.GetPhi(),fTrack.GetInnerSegChi2());
+				hInnerChi2Theta->Fill(fTrack.GetGeantKine()->GetTheta() - fTrack.GetTheta(),fTrack.GetInnerSegChi2());
+				hOuterChi2Phi->Fill(fTrack.GetGeantKine()->GetPhi() - fTrack.GetPhi(),fTrack.GetOuterSegChi2());
+				hOuterChi2Theta->Fill(fTrack.GetGeantKine()->GetTheta() - fTrack.GetTheta(),fTrack.GetOuterSegChi2());
+				hMetaQualityMom->Fill(momKine - momReco,fTrack.GetMetaMatchQuality());
+				hChi2Mom->Fill(momKine - momReco, fTrack.GetChi2());
 
 				hMomResolution->Fill(momReco,1./momKine - 1./momReco);
-				hPhiResolution->Fill(momReco,fTrack->GetGeantKine()->GetPhi() - fTrack->GetPhi());
-				hThetaResolution->Fill(momReco,fTrack->GetGeantKine()->GetTheta() - fTrack->GetTheta());
+				hPhiResolution->Fill(momReco,fTrack.GetGeantKine()->GetPhi() - fTrack.GetPhi());
+				hThetaResolution->Fill(momReco,fTrack.GetGeantKine()->GetTheta() - fTrack.GetTheta());
 			}
 			
 			for (const int &layer : HADES::MDC::WireInfo::allLayerIndexing)
 			{
-				hSegNcells->Fill(layer + 1,fTrack->GetWires(layer).size());
-				hWiresMultiplicityGood->Fill(fTrack->GetSector(), layer, fTrack->GetWires(layer).size());
+				hSegNcells->Fill(layer + 1,fTrack.GetWires(layer).size());
+				hWiresMultiplicityGood->Fill(fTrack.GetSector(), layer, fTrack.GetWires(layer).size());
 			}
 
-			hXMom->Fill(fTrack->GetPx());
-			hYMom->Fill(fTrack->GetPy());
-			hZMom->Fill(fTrack->GetPz());
-			hEne->Fill(fTrack->GetEnergy());
+			hXMom->Fill(fTrack.GetPx());
+			hYMom->Fill(fTrack.GetPy());
+			hZMom->Fill(fTrack.GetPz());
+			hEne->Fill(fTrack.GetEnergy());
 
 			fEvent->AddTrack(fTrack);
 
-			if (fTrack->GetSystem() == Selection::Detector::RPC)
+			if (fTrack.GetSystem() == Selection::Detector::RPC)
 			{
-				hBetaMomRpc->Fill(momReco * fTrack->GetCharge(),betaReco);
-				binDistance = CalcBinDistance(hBetaMomRpc,momReco * fTrack->GetCharge(),betaReco,momKine * fTrack->GetCharge(),betaKine);	
-				hBetaMomRpcReco->Fill(momReco * fTrack->GetCharge(), betaReco, 1./(binDistance + 1));
+				hBetaMomRpc->Fill(momReco * fTrack.GetCharge(),betaReco);
+				binDistance = CalcBinDistance(hBetaMomRpc,momReco * fTrack.GetCharge(),betaReco,momKine * fTrack.GetCharge(),betaKine);	
+				hBetaMomRpcReco->Fill(momReco * fTrack.GetCharge(), betaReco, 1./(binDistance + 1));
 
-				hM2momRpc->Fill(fTrack->GetM2()*fMeVtoGeV*fMeVtoGeV,abs(fTrack->GetP())*fMeVtoGeV);
-				hMinvRpc->Fill(fTrack->GetM()*fMeVtoGeV);
+				hM2momRpc->Fill(fTrack.GetM2()*fMeVtoGeV*fMeVtoGeV,abs(fTrack.GetP())*fMeVtoGeV);
+				hMinvRpc->Fill(fTrack.GetM()*fMeVtoGeV);
 			}
 			else
 			{
-				hBetaMomTof->Fill(momReco * fTrack->GetCharge(),betaReco);
-				binDistance = CalcBinDistance(hBetaMomTof,momReco * fTrack->GetCharge(),betaReco,momKine * fTrack->GetCharge(),betaKine);	
-				hBetaMomTofReco->Fill(momReco * fTrack->GetCharge(), betaReco, 1./(binDistance + 1));
+				hBetaMomTof->Fill(momReco * fTrack.GetCharge(),betaReco);
+				binDistance = CalcBinDistance(hBetaMomTof,momReco * fTrack.GetCharge(),betaReco,momKine * fTrack.GetCharge(),betaKine);	
+				hBetaMomTofReco->Fill(momReco * fTrack.GetCharge(), betaReco, 1./(binDistance + 1));
 
-				hM2momTof->Fill(fTrack->GetM2()*fMeVtoGeV*fMeVtoGeV,abs(fTrack->GetP())*fMeVtoGeV);
-				hMinvTof->Fill(fTrack->GetM()*fMeVtoGeV);
+				hM2momTof->Fill(fTrack.GetM2()*fMeVtoGeV*fMeVtoGeV,abs(fTrack.GetP())*fMeVtoGeV);
+				hMinvTof->Fill(fTrack.GetM()*fMeVtoGeV);
 			}
 		} // End of track loop
 
@@ -645,7 +645,7 @@ int newQaAnalysis(TString inputlist = "", TString outfile = "qaOutFile.root", Lo
 					std::tie(qOut,qSide,qLong) = elem->GetOSL();
 
 					hCounter->Fill(cNumAllPairs);
-					if (pair.first != "bad") // if not rejected
+					if (pair.first != Mixing::rejectedGroup) // if not rejected
 					{
 						if (elem->AreTracksFromTheSameSector()) // those observables only make sense when we are in the same sector
 						{
@@ -693,7 +693,7 @@ int newQaAnalysis(TString inputlist = "", TString outfile = "qaOutFile.root", Lo
 
 						ktDistGood.at(fEvent->GetCentrality())->Fill(elem->GetKt());
 						rapDistGood.at(fEvent->GetCentrality())->Fill(elem->GetRapidity() - fBeamRapidity);
-						if (pair.first != "0") // if is not overflow in pair kinematics
+						if (pair.first != Mixing::outOfRangeGroup) // if is not overflow in pair kinematics
 						{
 							hDPhiDThetaSignGood->Fill(elem->GetDPhi(),elem->GetDTheta());
 							hCounter->Fill(cNumSelectedPairs);
@@ -745,7 +745,7 @@ int newQaAnalysis(TString inputlist = "", TString outfile = "qaOutFile.root", Lo
 			{
 				for (const auto &entry : backgroundEntry.second)
 				{
-					if (backgroundEntry.first != "bad" && backgroundEntry.first != "0")
+					if (backgroundEntry.first != Mixing::rejectedGroup && backgroundEntry.first != Mixing::outOfRangeGroup)
 					{
 						hDPhiDThetaBckgGood->Fill(entry->GetDPhi(),entry->GetDTheta());
 					}
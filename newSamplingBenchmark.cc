@@ -0,0 +1,175 @@
+// Benchmark of the background subsampling (FemtoMixer/BackgroundSampler.hxx) run on a femto skim, without HYDRA.
+// Every sampling mode has its own mixer fed with the same events; the CPU time spent on mixing and the statistical
+// precision of the q_inv correlation function are compared with the full (not sampled) background.
+#define FEMTOMIXER_STANDALONE
+
+#include "TROOT.h"
+#include "TFile.h"
+#include "TStyle.h"
+#include "TString.h"
+#include "TStopwatch.h"
+#include "TCutG.h"
+#include "TH1D.h"
+
+#include "FemtoMixer/FemtoSkim.hxx"
+#include "FemtoMixer/JJFemtoMixer.hxx"
+#include "FemtoMixer/PairUtils.hxx"
+#include "FemtoMixer/EventUtils.hxx"
+#include "FemtoMixer/BackgroundSampler.hxx"
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// one sampling mode under test
+struct SamplingCase
+{
+	std::string name;
+	Mixing::JJFemtoMixer<Selection::EventCandidate,Selection::TrackHandle,Selection::PairCandidate,Mixing::PairBinning1D,Mixing::NominalPairCuts> mixer;
+	Mixing::BackgroundSampler sampler;
+	std::unique_ptr<TH1D> hSign, hBckg;
+	TStopwatch timer;
+	double nBckgPairs = 0;
+};
+
+// mean relative error of the correlation function in the q_inv range [qMin,qMax), the background is normalised to the signal in the whole range
+double MeanRelativeError(const TH1D &sign, const TH1D &bckg, double qMin, double qMax)
+{
+	double sum = 0;
+	int nBins = 0;
+	for (int bin = sign.FindFixBin(qMin); bin < sign.FindFixBin(qMax); ++bin)
+	{
+		const double s = sign.GetBinContent(bin), b = bckg.GetBinContent(bin);
+		if (s <= 0 || b <= 0)
+			continue;
+
+		sum += std::sqrt(std::pow(sign.GetBinError(bin) / s,2) + std::pow(bckg.GetBinError(bin) / b,2));
+		++nBins;
+	}
+
+	return (nBins > 0) ? sum / nBins : 0.;
+}
+
+int newSamplingBenchmark(TString inputfile = "femtoSkim.root", TString outfile = "samplingBenchmark.root", Long64_t nDesEvents = -1, std::size_t bufferSize = 200, std::uint64_t seed = 0)
+{
+	gStyle->SetOptStat(0);
+	gROOT->SetBatch(kTRUE);
+
+	constexpr float qFull{150.f};
+	constexpr double qMax{500.};
+
+	Selection::FemtoSkimReader fSkimReader(inputfile.Data());
+
+	TFile *cutfile_betamom_pionCmom = new TFile("/lustre/hades/user/tscheib/apr12/ID_Cuts/BetaMomIDCuts_PionsProtons_gen8_DATA_RK400_PionConstMom.root");
+	TCutG* betamom_2sig_p_tof_pionCmom = cutfile_betamom_pionCmom->Get<TCutG>("BetaCutProton_TOF_2.0");
+	TCutG* betamom_2sig_p_rpc_pionCmom = cutfile_betamom_pionCmom->Get<TCutG>("BetaCutProton_RPC_2.0");
+
+	const Mixing::EventGrouping fEventGrouping;
+
+	//--------------------------------------------------------------------------------
+	// The sampling modes under test, the first one is the reference
+	//--------------------------------------------------------------------------------
+	std::vector<Mixing::BackgroundSamplingSettings> fSettings(6);
+	fSettings[1].mode = Mixing::BackgroundSampling::FixedCount;
+	fSettings[1].pairsPerEvent = 2000;
+	fSettings[2].mode = Mixing::BackgroundSampling::FixedCount;
+	fSettings[2].pairsPerEvent = 500;
+	fSettings[3].mode = Mixing::BackgroundSampling::QDependent;
+	fSettings[3].exponent = 2.f;
+	fSettings[4].mode = Mixing::BackgroundSampling::QDependent;
+	fSettings[4].exponent = 3.f;
+	fSettings[5].mode = Mixing::BackgroundSampling::FixedCount;
+	fSettings[5].pairsPerEvent = 500;
+	const std::vector<std::string> fNames{"full","fixed2000","fixed500","qDependent2","qDependent3","fixed500lowQTree"};
+
+	std::vector<SamplingCase> fCases(fSettings.size());
+	for (std::size_t i = 0; i < fCases.size(); ++i)
+	{
+		fSettings[i].qFull = qFull;
+		fSettings[i].seed = seed;
+
+		auto &samplingCase = fCases[i];
+		samplingCase.name = fNames[i];
+		samplingCase.sampler = Mixing::BackgroundSampler(fSettings[i]);
+		samplingCase.hSign = std::make_unique<TH1D>(("hQinvSign_" + fNames[i]).data(),"Signal;q_{inv} [MeV/c];CF(q_{inv})",125,0.,qMax);
+		samplingCase.hBckg = std::make_unique<TH1D>(("hQinvBckg_" + fNames[i]).data(),"Background;q_{inv} [MeV/c];CF(q_{inv})",125,0.,qMax);
+		samplingCase.hSign->Sumw2();
+		samplingCase.hBckg->Sumw2();
+		samplingCase.hSign->SetDirectory(nullptr);
+		samplingCase.hBckg->SetDirectory(nullptr);
+		samplingCase.timer.Reset();
+
+		samplingCase.mixer.SetMaxBufferSize(bufferSize);
+		samplingCase.mixer.SetEventHashingFunction(fEventGrouping.MakeEventGroupingFunction());
+		samplingCase.mixer.SetPairHashingFunction(Mixing::PairBinning1D());
+		samplingCase.mixer.SetPairCuttingFunction(Mixing::NominalPairCuts());
+		samplingCase.mixer.SetOutOfRangeGroup(Mixing::outOfRangeGroup);
+		samplingCase.mixer.SetPairPrefilter(Mixing::PairGrouping::MakePairPrefilter1D());
+		samplingCase.mixer.SetLowQSearch(fNames[i] == "fixed500lowQTree");
+		samplingCase.sampler.PrintSettings();
+	}
+
+	Long64_t nEvents = fSkimReader.GetEntries();
+	if (nDesEvents >= 0 && nEvents > nDesEvents)
+		nEvents = nDesEvents;
+
+	std::shared_ptr<Selection::EventCandidate> fEvent;
+	for (Long64_t event = 0; event < nEvents && fSkimReader.Next(); event++)
+	{
+		fEvent = fSkimReader.GetEvent();
+		if (! fEvent->SelectEvent<HADES::Target::Setup::Apr12>({1},2,2,2))
+			continue;
+
+		for (const auto &fTrack : fSkimReader.GetTracks())
+			if (fTrack.SelectTrack(betamom_2sig_p_rpc_pionCmom,betamom_2sig_p_tof_pionCmom))
+				fEvent->AddTrack(fTrack);
+
+		if (fEvent->GetTrackListSize() < 2)
+			continue;
+
+		for (auto &samplingCase : fCases)
+		{
+			samplingCase.timer.Start(kFALSE);
+			samplingCase.mixer.ForEachSignalPair(fEvent,[&samplingCase](Mixing::GroupId group, const Selection::PairCandidate &pair)
+			{
+				if (group != Mixing::rejectedGroup && group != Mixing::outOfRangeGroup)
+					samplingCase.hSign->Fill(pair.GetQinv());
+			});
+			samplingCase.mixer.BufferEvent(fEvent);
+			samplingCase.mixer.ForEachMixedPair(fEvent,samplingCase.sampler,[&samplingCase](Mixing::GroupId group, const Selection::PairCandidate &pair, double weight)
+			{
+				samplingCase.nBckgPairs += 1;
+				if (group != Mixing::rejectedGroup && group != Mixing::outOfRangeGroup)
+					samplingCase.hBckg->Fill(pair.GetQinv(),weight);
+			});
+			samplingCase.timer.Stop();
+		}
+	}
+
+	//--------------------------------------------------------------------------------
+	// Cost and precision of each mode, relative to the full background
+	//--------------------------------------------------------------------------------
+	const double referenceTime = fCases.front().timer.CpuTime();
+	std::cout << "mode\tCPU time [s]\tspeed-up\tbackground pairs\tCF rel. error (q < " << qFull << ")\tCF rel. error (q >= " << qFull << ")\n";
+	for (auto &samplingCase : fCases)
+	{
+		samplingCase.hBckg->Scale(samplingCase.hSign->Integral() / samplingCase.hBckg->Integral());
+		std::cout << samplingCase.name << "\t" << samplingCase.timer.CpuTime() << "\t" << referenceTime / samplingCase.timer.CpuTime() << "\t"
+			<< samplingCase.nBckgPairs << "\t" << MeanRelativeError(*samplingCase.hSign,*samplingCase.hBckg,0.,qFull) << "\t"
+			<< MeanRelativeError(*samplingCase.hSign,*samplingCase.hBckg,qFull,qMax) << "\n";
+	}
+
+	TFile* out = new TFile(outfile.Data(), "RECREATE");
+	out->cd();
+	for (auto &samplingCase : fCases)
+	{
+		samplingCase.hSign->Write();
+		samplingCase.hBckg->Write();
+	}
+	out->Save();
+	out->Close();
+
+	gROOT->SetBatch(kFALSE);
+	return 0;
+}
@@ -0,0 +1,264 @@
+// Femtoscopic analysis run on a femto skim (created with newFemtoSkim.cc), without HYDRA.
+// The event and track selection are rerun on the stored candidates, so the cuts can be varied here.
+#define FEMTOMIXER_STANDALONE
+
+#include "TROOT.h"
+#include "TFile.h"
+#include "TStyle.h"
+#include "TString.h"
+#include "TSystem.h"
+#include "TStopwatch.h"
+#include "TCutG.h"
+#include "TH1D.h"
+#include "TH2D.h"
+
+#include "FemtoMixer/FemtoSkim.hxx"
+#include "FemtoMixer/JJFemtoMixer.hxx"
+#include "FemtoMixer/PairUtils.hxx"
+#include "FemtoMixer/EventUtils.hxx"
+#include "FemtoMixer/CFHistogramBank.hxx"
+#include "FemtoMixer/PairTuple.hxx"
+#include "FemtoMixer/BackgroundSampler.hxx"
+#include "FemtoMixer/ShardedEventProcessor.hxx"
+#include "FemtoMixer/StageProfiler.hxx" // define FEMTOMIXER_PROFILING before this include to get the per-stage timing
+#include <iostream>
+#include <string>
+#include <vector>
+
+// mixing and histogramming of one worker thread; each worker owns the mixing buffers of its event classes
+struct SkimFemtoWorker
+{
+	Mixing::JJFemtoMixer<Selection::EventCandidate,Selection::TrackHandle,Selection::PairCandidate,Mixing::PairBinning1D,Mixing::NominalPairCuts> mixer;
+	Mixing::CFHistogramBank histogramBank;
+	Mixing::BackgroundSampler sampler;
+	JJUtils::StageProfiler profiler; // mixing and histogram filling of this worker
+	double nAllPairs = 0, nSelectedPairs = 0;
+	std::unique_ptr<Mixing::PairTupleWriter> pairTuple; // accepted low-q pairs for the offline rebinning, null if this output is disabled
+
+	void operator()(const std::shared_ptr<Selection::EventCandidate> &evt)
+	{
+		JJ_PROFILE_STAGE(profiler,JJUtils::Stage::Mixing);
+		const Mixing::GroupId eventClass = (pairTuple != nullptr) ? mixer.GetEventGroup(evt) : 0;
+
+		// pairs are histogrammed as soon as they are formed, without collecting them
+		mixer.ForEachSignalPair(evt,[this,eventClass](Mixing::GroupId group, const Selection::PairCandidate &pair)
+		{
+			nAllPairs += 1;
+			if (group != Mixing::rejectedGroup && group != Mixing::outOfRangeGroup)
+				nSelectedPairs += 1;
+
+			JJ_PROFILE_SAMPLED_STAGE(profiler,JJUtils::Stage::HistogramFill);
+			histogramBank.Fill(Mixing::CFSample::Signal,group,pair);
+			if (pairTuple != nullptr)
+				pairTuple->Fill(Mixing::CFSample::Signal,eventClass,group,pair);
+		});
+
+		mixer.BufferEvent(evt);
+		mixer.ForEachMixedPair(evt,sampler,[this,eventClass](Mixing::GroupId group, const Selection::PairCandidate &pair, double weight)
+		{
+			JJ_PROFILE_SAMPLED_STAGE(profiler,JJUtils::Stage::HistogramFill);
+			histogramBank.Fill(Mixing::CFSample::Background,group,pair,weight);
+			if (pairTuple != nullptr)
+				pairTuple->Fill(Mixing::CFSample::Background,eventClass,group,pair,weight);
+		});
+	}
+};
+
+int newSkimFemtoAnalysis(TString inputfile = "femtoSkim.root", TString outfile = "femtoOutFile.root", Long64_t nDesEvents = -1, Int_t nThreads = 1, Bool_t writePairTuple = kFALSE)
+{
+	gStyle->SetOptStat(0);
+	gROOT->SetBatch(kTRUE);
+	ROOT::EnableThreadSafety(); // skim reading stays in this thread, mixing and histogramming is done by nThreads workers
+
+	constexpr bool isSimulation{false};
+
+	//--------------------------------------------------------------------------------
+	// Opening the femto skim (wildcards are accepted)
+	//--------------------------------------------------------------------------------
+	Selection::FemtoSkimReader fSkimReader(inputfile.Data());
+
+	//================================================================================================================================================================
+	// Put your object declarations here
+	//================================================================================================================================================================
+
+	TH2D *hPhiTheta = new TH2D("hPhiTheta","#phi vs #theta distribution of tracks;#phi [deg];#theta [deg]",360,0,360,90,0,90);
+
+	const Mixing::PairGrouping fPairGrouping;
+	Mixing::CFHistogramSettings fHistogramSettings;
+	fHistogramSettings.fillQinv = false;
+	fHistogramSettings.qoslAxis = {125,0.,500.};
+	fHistogramSettings.qoslStorage = Mixing::GridStorage::Dense; // switch to Sparse to keep only the filled q_osl bins in memory (each worker has its own bank)
+
+	Mixing::BackgroundSamplingSettings fSamplingSettings;
+	fSamplingSettings.mode = Mixing::BackgroundSampling::None; // QDependent or FixedCount subsample the mixed pairs above qFull (and fill them with weights), e.g. for the deep buffer in simulation
+	fSamplingSettings.qFull = 150.f;
+	std::uint64_t fWorkerSeed = fSamplingSettings.seed; // every worker gets its own random sequence
+
+	Mixing::PairTupleSettings fPairTupleSettings; // used only if writePairTuple is set, every worker writes its own file (outfile with the _pairs_<worker> suffix)
+	fPairTupleSettings.qInvMax = 500.f;
+	std::size_t fWorkerIndex = 0;
+
+	TFile *cutfile_betamom_pionCmom = new TFile("/lustre/hades/user/tscheib/apr12/ID_Cuts/BetaMomIDCuts_PionsProtons_gen8_DATA_RK400_PionConstMom.root");
+	TCutG* betamom_2sig_p_tof_pionCmom = cutfile_betamom_pionCmom->Get<TCutG>("BetaCutProton_TOF_2.0");
+	TCutG* betamom_2sig_p_rpc_pionCmom = cutfile_betamom_pionCmom->Get<TCutG>("BetaCutProton_RPC_2.0");
+
+	std::shared_ptr<Selection::EventCandidate> fEvent;
+
+	const Mixing::EventGrouping fEventGrouping;
+
+	// events are sharded by their class, so the mixing in each class is the same as in a serial run
+	Mixing::ShardedEventProcessor<std::shared_ptr<Selection::EventCandidate>,SkimFemtoWorker> processor(nThreads,
+		[&]()
+		{
+			SkimFemtoWorker worker{{},Mixing::CFHistogramBank::Create1D(fPairGrouping,fHistogramSettings),Mixing::BackgroundSampler(fSamplingSettings),{}}; // all histograms are booked here
+			worker.sampler.SetSeed(fWorkerSeed++);
+			worker.mixer.SetMaxBufferSize((isSimulation) ? 200 : 50); // ana=50, sim=200
+			worker.mixer.SetEventHashingFunction(fEventGrouping.MakeEventGroupingFunction());
+			worker.mixer.SetPairHashingFunction(Mixing::PairBinning1D());
+			worker.mixer.SetPairCuttingFunction(Mixing::NominalPairCuts());
+			worker.mixer.SetOutOfRangeGroup(Mixing::outOfRangeGroup); // pairs outside of the kT/y ranges are discarded anyway, so do not check them
+			worker.mixer.SetPairPrefilter(Mixing::PairGrouping::MakePairPrefilter1D()); // mixed pairs outside of the kT/y ranges are not even created (the out-of-range background stays empty)
+			if (writePairTuple)
+				worker.pairTuple = std::make_unique<Mixing::PairTupleWriter>(Mixing::PairTupleWriter::MakeFileName(outfile.Data(),fWorkerIndex),fPairTupleSettings);
+			++fWorkerIndex;
+			return worker;
+		},
+		fEventGrouping.MakeEventGroupingFunction());
+	processor.GetWorker(0).mixer.PrintSettings();
+	processor.GetWorker(0).histogramBank.PrintSettings();
+	processor.GetWorker(0).sampler.PrintSettings();
+	std::cout << "number of workers: " << processor.GetNWorkers() << "\n\n";
+
+	//--------------------------------------------------------------------------------
+	// The following counter histogram is used to gather some basic information on the analysis
+	//--------------------------------------------------------------------------------
+	enum Counters_e {
+	cNumAllEvents      = 0,
+	cNumSelectedEvents = 1,
+	cNumAllTracks      = 2,
+	cNumSelectedTracks = 3,
+	cNumAllPairs       = 4,
+	cNumSelectedPairs  = 5,
+	cNumCounters       = 6
+	};
+
+	TH1D* hCounter = new TH1D("hCounter", "", cNumCounters, 0, cNumCounters);
+
+	hCounter->GetXaxis()->SetBinLabel(1, "All Events");
+	hCounter->GetXaxis()->SetBinLabel(2, "Selected Events");
+	hCounter->GetXaxis()->SetBinLabel(3, "All Tracks");
+	hCounter->GetXaxis()->SetBinLabel(4, "Selected Tracks");
+	hCounter->GetXaxis()->SetBinLabel(5, "All Pairs");
+	hCounter->GetXaxis()->SetBinLabel(6, "Selected Pairs");
+
+	TStopwatch timer;
+	timer.Reset();
+	timer.Start();
+	JJUtils::StageProfiler fProfiler; // stages done in this thread (the workers have their own profilers), the skim reading is counted as the DST read
+
+	//--------------------------------------------------------------------------------
+	// The amount of events to be processed
+	//--------------------------------------------------------------------------------
+	Long64_t nEvents = fSkimReader.GetEntries();
+	if (nDesEvents >= 0 && nEvents > nDesEvents)
+		nEvents = nDesEvents;
+
+	//--------------------------------------------------------------------------------
+	// The event loop over the skim; the stored events already passed the event quality flags and the loose skim cuts
+	//--------------------------------------------------------------------------------
+	for (Long64_t event = 0; event < nEvents; event++)
+	{
+		bool hasEvent = false;
+		{
+			JJ_PROFILE_STAGE(fProfiler,JJUtils::Stage::DstRead);
+			hasEvent = fSkimReader.Next();
+		}
+		if (!hasEvent)
+			break;
+
+		hCounter->Fill(cNumAllEvents);
+
+		fEvent = fSkimReader.GetEvent();
+
+		//================================================================================================================================================================
+		// Put your analyses on event level here
+		//================================================================================================================================================================
+
+		if (! fEvent->SelectEvent<HADES::Target::Setup::Apr12>({1},2,2,2))
+			continue;
+
+		hCounter->Fill(cNumSelectedEvents);
+
+		for (const auto &fTrack : fSkimReader.GetTracks())
+		{
+			hCounter->Fill(cNumAllTracks);
+
+			//================================================================================================================================================================
+			// Put your analyses on track level here
+			//================================================================================================================================================================
+
+			bool isSelected = false;
+			{
+				JJ_PROFILE_STAGE(fProfiler,JJUtils::Stage::TrackSelection);
+				isSelected = fTrack.SelectTrack(betamom_2sig_p_rpc_pionCmom,betamom_2sig_p_tof_pionCmom);
+			}
+			if (!isSelected)
+				continue;
+
+			fEvent->AddTrack(fTrack);
+			hPhiTheta->Fill(fTrack.GetPhi(),fTrack.GetTheta());
+			hCounter->Fill(cNumSelectedTracks);
+		} // End of track loop
+
+		if (fEvent->GetTrackListSize() > 2) // if track vector has entries
+			processor.Push(fEvent); // femto mixing is done by the worker responsible for this event class
+	} // End of event loop
+
+	//--------------------------------------------------------------------------------
+	// Waiting for the workers and reducing their results
+	//--------------------------------------------------------------------------------
+	processor.Finish();
+	Mixing::CFHistogramBank &fHistogramBank = processor.GetWorker(0).histogramBank;
+	Mixing::NominalPairCuts fPairCuts; // rejection counters of all workers
+	for (std::size_t worker = 0; worker < processor.GetNWorkers(); ++worker)
+	{
+		if (worker > 0)
+			fHistogramBank.Add(processor.GetWorker(worker).histogramBank);
+		hCounter->Fill(cNumAllPairs,processor.GetWorker(worker).nAllPairs);
+		hCounter->Fill(cNumSelectedPairs,processor.GetWorker(worker).nSelectedPairs);
+		fProfiler.Add(processor.GetWorker(worker).profiler);
+		fProfiler.Add(processor.GetWorker(worker).mixer.GetProfiler());
+		fPairCuts.Add(processor.GetWorker(worker).mixer.GetPairCuttingFunction());
+		if (processor.GetWorker(worker).pairTuple != nullptr)
+		{
+			std::cout << "pairs stored in the pair tuple of worker " << worker << ": " << processor.GetWorker(worker).pairTuple->GetEntries() << "\n";
+			processor.GetWorker(worker).pairTuple->Close();
+		}
+	}
+
+	timer.Stop();
+	std::cout << "Finished skim processing" << std::endl;
+	std::cout << "real time: " << timer.RealTime() << " s\t CPU time: " << timer.CpuTime() << " s\n\n";
+	fProfiler.Print();
+	fPairCuts.Print();
+
+	for (std::size_t worker = 0; worker < processor.GetNWorkers(); ++worker)
+		processor.GetWorker(worker).mixer.PrintStatus();
+
+	//--------------------------------------------------------------------------------
+	// Creating output file and storing results there
+	//--------------------------------------------------------------------------------
+	TFile* out = new TFile(outfile.Data(), "RECREATE");
+	out->cd();
+
+	hCounter->Write();
+	fProfiler.Write();
+	fHistogramBank.Write();
+	hPhiTheta->Write();
+
+	out->Save();
+	out->Close();
+
+	gROOT->SetBatch(kFALSE);
+	return 0;
+}
@@ -0,0 +1,262 @@
+// Systematic variations of the femtoscopic analysis run on a femto skim (created with newFemtoSkim.cc), without HYDRA.
+// All variations from Mixing::VariationTable are evaluated in a single pass: events, tracks and pairs are tagged with the mask of the accepting variations,
+// and the CF histograms of each variation are written into a separate directory of the output file.
+#define FEMTOMIXER_STANDALONE
+
+#include "TROOT.h"
+#include "TFile.h"
+#include "TStyle.h"
+#include "TString.h"
+#include "TSystem.h"
+#include "TStopwatch.h"
+#include "TCutG.h"
+#include "TH1D.h"
+#include "TH2D.h"
+
+#include "FemtoMixer/FemtoSkim.hxx"
+#include "FemtoMixer/VariationTable.hxx"
+#include "FemtoMixer/JJFemtoMixer.hxx"
+#include "FemtoMixer/PairUtils.hxx"
+#include "FemtoMixer/EventUtils.hxx"
+#include "FemtoMixer/CFHistogramBank.hxx"
+#include "FemtoMixer/ShardedEventProcessor.hxx"
+#include <array>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// mixing and histogramming of one worker thread; each worker owns the mixing buffers of its event classes and one histogram bank per variation
+struct SystematicsWorker
+{
+	const Mixing::VariationTable *variations;
+	Mixing::JJFemtoMixer<Selection::EventCandidate,Selection::TrackHandle,Selection::PairCandidate,Mixing::PairBinning1D> mixer;
+	std::vector<Mixing::CFHistogramBank> histogramBanks;
+	std::vector<double> nAllPairs, nSelectedPairs;
+
+	// fill the pair into the bank of every variation which accepts its tracks
+	void Fill(Mixing::CFSample sample, Mixing::GroupId group, const Selection::PairCandidate &pair)
+	{
+		variations->ForEachVariation(pair.GetVariationMask(),[&](std::size_t variation)
+		{
+			const Mixing::GroupId variationGroup = Mixing::VariationTable::GetPairGroup(group,pair,variation);
+			histogramBanks[variation].Fill(sample,variationGroup,pair);
+
+			if (sample == Mixing::CFSample::Signal)
+			{
+				nAllPairs[variation] += 1;
+				if (variationGroup != Mixing::rejectedGroup && variationGroup != Mixing::outOfRangeGroup)
+					nSelectedPairs[variation] += 1;
+			}
+		});
+	}
+
+	void operator()(const std::shared_ptr<Selection::EventCandidate> &evt)
+	{
+		mixer.ForEachSignalPair(evt,[this](Mixing::GroupId group, const Selection::PairCandidate &pair) {Fill(Mixing::CFSample::Signal,group,pair);});
+		mixer.BufferEvent(evt);
+		mixer.ForEachMixedPair(evt,[this](Mixing::GroupId group, const Selection::PairCandidate &pair) {Fill(Mixing::CFSample::Background,group,pair);});
+	}
+};
+
+int newSkimSystematicsAnalysis(TString inputfile = "femtoSkim.root", TString outfile = "femtoSystematicsOutFile.root", Long64_t nDesEvents = -1, Int_t nThreads = 1)
+{
+	gStyle->SetOptStat(0);
+	gROOT->SetBatch(kTRUE);
+	ROOT::EnableThreadSafety(); // skim reading stays in this thread, mixing and histogramming is done by nThreads workers
+
+	constexpr bool isSimulation{false};
+
+	//--------------------------------------------------------------------------------
+	// Opening the femto skim (wildcards are accepted)
+	//--------------------------------------------------------------------------------
+	Selection::FemtoSkimReader fSkimReader(inputfile.Data());
+
+	//================================================================================================================================================================
+	// Put your object declarations here
+	//================================================================================================================================================================
+
+	const Mixing::PairGrouping fPairGrouping;
+	Mixing::CFHistogramSettings fHistogramSettings;
+	fHistogramSettings.fillQinv = true; // 1D systematics, q_osl of every variation would not fit into memory
+	fHistogramSettings.fillQosl = false;
+
+	TFile *cutfile_betamom_pionCmom = new TFile("/lustre/hades/user/tscheib/apr12/ID_Cuts/BetaMomIDCuts_PionsProtons_gen8_DATA_RK400_PionConstMom.root");
+	TCutG* betamom_2sig_p_tof_pionCmom = cutfile_betamom_pionCmom->Get<TCutG>("BetaCutProton_TOF_2.0");
+	TCutG* betamom_2sig_p_rpc_pionCmom = cutfile_betamom_pionCmom->Get<TCutG>("BetaCutProton_RPC_2.0");
+	TCutG* betamom_1sig_p_tof_pionCmom = cutfile_betamom_pionCmom->Get<TCutG>("BetaCutProton_TOF_1.0");
+	TCutG* betamom_1sig_p_rpc_pionCmom = cutfile_betamom_pionCmom->Get<TCutG>("BetaCutProton_RPC_1.0");
+	TCutG* betamom_3sig_p_tof_pionCmom = cutfile_betamom_pionCmom->Get<TCutG>("BetaCutProton_TOF_3.0");
+	TCutG* betamom_3sig_p_rpc_pionCmom = cutfile_betamom_pionCmom->Get<TCutG>("BetaCutProton_RPC_3.0");
+
+	Selection::TrackCuts fNominalTrackCuts;
+	fNominalTrackCuts.rpcCut = betamom_2sig_p_rpc_pionCmom;
+	fNominalTrackCuts.tofCut = betamom_2sig_p_tof_pionCmom;
+	const Mixing::VariationTable fVariations = Mixing::VariationTable::CreateSystematics1D(fNominalTrackCuts,
+		betamom_1sig_p_rpc_pionCmom,betamom_1sig_p_tof_pionCmom,betamom_3sig_p_rpc_pionCmom,betamom_3sig_p_tof_pionCmom);
+	const std::size_t nVariations = fVariations.GetNVariations();
+	fVariations.PrintSettings();
+
+	std::shared_ptr<Selection::EventCandidate> fEvent;
+	std::vector<std::pair<const Selection::TrackCandidate*,Selection::VariationMask> > fSelectedTracks; // tracks accepted by any variation, with their masks
+	std::array<std::size_t,Mixing::VariationTable::maxVariations> fNTracksPerVariation;
+
+	const Mixing::EventGrouping fEventGrouping;
+
+	// events are sharded by their class, so the mixing in each class is the same as in a serial run
+	Mixing::ShardedEventProcessor<std::shared_ptr<Selection::EventCandidate>,SystematicsWorker> processor(nThreads,
+		[&]()
+		{
+			SystematicsWorker worker{&fVariations,{},{},std::vector<double>(nVariations,0.),std::vector<double>(nVariations,0.)};
+			for (std::size_t variation = 0; variation < nVariations; ++variation)
+				worker.histogramBanks.push_back(Mixing::CFHistogramBank::Create1D(fPairGrouping,fHistogramSettings)); // all histograms are booked here
+			worker.mixer.SetMaxBufferSize((isSimulation) ? 200 : 50); // ana=50, sim=200
+			worker.mixer.SetEventHashingFunction(fEventGrouping.MakeEventGroupingFunction());
+			worker.mixer.SetPairHashingFunction(Mixing::PairBinning1D());
+			worker.mixer.SetPairCuttingFunction(fVariations.MakePairCuttingFunction()); // the pair is rejected only if all variations reject it
+			worker.mixer.SetOutOfRangeGroup(Mixing::outOfRangeGroup); // pairs outside of the kT/y ranges are discarded anyway, so do not check them
+			worker.mixer.SetPairPrefilter(Mixing::PairGrouping::MakePairPrefilter1D()); // mixed pairs outside of the kT/y ranges are not even created (the out-of-range background stays empty)
+			return worker;
+		},
+		fEventGrouping.MakeEventGroupingFunction());
+	processor.GetWorker(0).mixer.PrintSettings();
+	processor.GetWorker(0).histogramBanks.front().PrintSettings();
+	std::cout << "number of workers: " << processor.GetNWorkers() << "\n\n";
+
+	//--------------------------------------------------------------------------------
+	// The following counter histogram is used to gather some basic information on the analysis
+	//--------------------------------------------------------------------------------
+	enum Counters_e {
+	cNumAllEvents      = 0,
+	cNumSelectedEvents = 1,
+	cNumAllTracks      = 2,
+	cNumSelectedTracks = 3,
+	cNumAllPairs       = 4,
+	cNumSelectedPairs  = 5,
+	cNumCounters       = 6
+	};
+
+	std::vector<TH1D*> hCounter(nVariations,nullptr);
+	for (std::size_t variation = 0; variation < nVariations; ++variation)
+	{
+		hCounter[variation] = new TH1D("hCounter", "", cNumCounters, 0, cNumCounters);
+		hCounter[variation]->SetDirectory(nullptr);
+		hCounter[variation]->GetXaxis()->SetBinLabel(1, "All Events");
+		hCounter[variation]->GetXaxis()->SetBinLabel(2, "Selected Events");
+		hCounter[variation]->GetXaxis()->SetBinLabel(3, "All Tracks");
+		hCounter[variation]->GetXaxis()->SetBinLabel(4, "Selected Tracks");
+		hCounter[variation]->GetXaxis()->SetBinLabel(5, "All Pairs");
+		hCounter[variation]->GetXaxis()->SetBinLabel(6, "Selected Pairs");
+	}
+	// fill the counter of every variation present in the mask
+	auto fillCounters = [&](Selection::VariationMask mask, int counter)
+	{
+		fVariations.ForEachVariation(mask,[&](std::size_t variation){hCounter[variation]->Fill(counter);});
+	};
+
+	TStopwatch timer;
+	timer.Reset();
+	timer.Start();
+
+	//--------------------------------------------------------------------------------
+	// The amount of events to be processed
+	//--------------------------------------------------------------------------------
+	Long64_t nEvents = fSkimReader.GetEntries();
+	if (nDesEvents >= 0 && nEvents > nDesEvents)
+		nEvents = nDesEvents;
+
+	//--------------------------------------------------------------------------------
+	// The event loop over the skim; the stored events already passed the event quality flags and the loose skim cuts
+	//--------------------------------------------------------------------------------
+	for (Long64_t event = 0; event < nEvents && fSkimReader.Next(); event++)
+	{
+		fillCounters(fVariations.GetFullMask(),cNumAllEvents);
+
+		fEvent = fSkimReader.GetEvent();
+
+		//================================================================================================================================================================
+		// Put your analyses on event level here
+		//================================================================================================================================================================
+
+		const Selection::VariationMask eventMask = fVariations.SelectEvent<HADES::Target::Setup::Apr12>(*fEvent);
+		if (eventMask == 0)
+			continue;
+
+		fillCounters(eventMask,cNumSelectedEvents);
+
+		const std::vector<Selection::TrackCandidate> fTracks = fSkimReader.GetTracks();
+		fSelectedTracks.clear();
+		fNTracksPerVariation.fill(0);
+		for (const auto &fTrack : fTracks)
+		{
+			fillCounters(eventMask,cNumAllTracks);
+
+			//================================================================================================================================================================
+			// Put your analyses on track level here
+			//================================================================================================================================================================
+
+			const Selection::VariationMask trackMask = eventMask & fVariations.SelectTrack(fTrack);
+			if (trackMask == 0)
+				continue;
+
+			fSelectedTracks.emplace_back(&fTrack,trackMask);
+			fVariations.ForEachVariation(trackMask,[&](std::size_t variation){++fNTracksPerVariation[variation];});
+			fillCounters(trackMask,cNumSelectedTracks);
+		} // End of track loop
+
+		// the multiplicity cut of the standalone analysis (more than 2 tracks) is applied to each variation separately,
+		// the variations with too few tracks are removed from the track masks, so they neither form pairs in this event nor mix it
+		Selection::VariationMask multiplicityMask = 0;
+		fVariations.ForEachVariation(eventMask,[&](std::size_t variation)
+		{
+			if (fNTracksPerVariation[variation] > 2)
+				multiplicityMask |= Selection::VariationMask(1) << variation;
+		});
+		if (multiplicityMask == 0)
+			continue;
+
+		for (const auto &[track,trackMask] : fSelectedTracks)
+			if ((trackMask & multiplicityMask) != 0)
+				fEvent->AddTrack(*track,trackMask & multiplicityMask);
+
+		processor.Push(fEvent); // femto mixing is done by the worker responsible for this event class
+	} // End of event loop
+
+	//--------------------------------------------------------------------------------
+	// Waiting for the workers and reducing their results
+	//--------------------------------------------------------------------------------
+	processor.Finish();
+	std::vector<Mixing::CFHistogramBank> &fHistogramBanks = processor.GetWorker(0).histogramBanks;
+	for (std::size_t worker = 0; worker < processor.GetNWorkers(); ++worker)
+		for (std::size_t variation = 0; variation < nVariations; ++variation)
+		{
+			if (worker > 0)
+				fHistogramBanks[variation].Add(processor.GetWorker(worker).histogramBanks[variation]);
+			hCounter[variation]->Fill(cNumAllPairs,processor.GetWorker(worker).nAllPairs[variation]);
+			hCounter[variation]->Fill(cNumSelectedPairs,processor.GetWorker(worker).nSelectedPairs[variation]);
+		}
+
+	timer.Stop();
+	std::cout << "Finished skim processing" << std::endl;
+
+	for (std::size_t worker = 0; worker < processor.GetNWorkers(); ++worker)
+		processor.GetWorker(worker).mixer.PrintStatus();
+
+	//--------------------------------------------------------------------------------
+	// Creating output file and storing results there (one directory per variation, with the same content as the output of newFemtoAnalysis.cc)
+	//--------------------------------------------------------------------------------
+	TFile* out = new TFile(outfile.Data(), "RECREATE");
+
+	for (std::size_t variation = 0; variation < nVariations; ++variation)
+	{
+		out->mkdir(fVariations.GetVariation(variation).name.data())->cd();
+		hCounter[variation]->Write();
+		fHistogramBanks[variation].Write();
+	}
+
+	out->Save();
+	out->Close();
+
+	gROOT->SetBatch(kFALSE);
+	return 0;
+}